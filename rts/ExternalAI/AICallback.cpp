@@ -835,21 +835,22 @@ static inline bool unit_IsNeutral(const CUnit* unit) {
 	return unit->IsNeutral();
 }
 
-static int myAllyTeamId = -1;
+// per thread, async AIs filter their units in parallel
+static __thread int myAllyTeamId = -1;
 
-/// You have to set myAllyTeamId before calling this function. NOT thread safe!
+/// You have to set myAllyTeamId before calling this function.
 static inline bool unit_IsEnemy(const CUnit* unit) {
 	return (!teamHandler->Ally(unit->allyteam, myAllyTeamId)
 			&& !unit_IsNeutral(unit));
 }
 
-/// You have to set myAllyTeamId before calling this function. NOT thread safe!
+/// You have to set myAllyTeamId before calling this function.
 static inline bool unit_IsFriendly(const CUnit* unit) {
 	return (teamHandler->Ally(unit->allyteam, myAllyTeamId)
 			&& !unit_IsNeutral(unit));
 }
 
-/// You have to set myAllyTeamId before calling this function. NOT thread safe!
+/// You have to set myAllyTeamId before calling this function.
 static inline bool unit_IsInLos(const CUnit* unit) {
 
 	// Skip in-sensor-range test if the unit is allied with our team.
@@ -860,7 +861,7 @@ static inline bool unit_IsInLos(const CUnit* unit) {
 			|| ((unit->losStatus[myAllyTeamId] & LOS_INLOS) != 0));
 }
 
-/// You have to set myAllyTeamId before calling this function. NOT thread safe!
+/// You have to set myAllyTeamId before calling this function.
 static inline bool unit_IsInRadar(const CUnit* unit) {
 
 	// Skip in-sensor-range test if the unit is allied with our team.
@@ -871,17 +872,17 @@ static inline bool unit_IsInRadar(const CUnit* unit) {
 			|| ((unit->losStatus[myAllyTeamId] & LOS_INRADAR) != 0));
 }
 
-/// You have to set myAllyTeamId before calling this function. NOT thread safe!
+/// You have to set myAllyTeamId before calling this function.
 static inline bool unit_IsEnemyAndInLos(const CUnit* unit) {
 	return (unit_IsEnemy(unit) && unit_IsInLos(unit));
 }
 
-/// You have to set myAllyTeamId before calling this function. NOT thread safe!
+/// You have to set myAllyTeamId before calling this function.
 static inline bool unit_IsEnemyAndInLosOrRadar(const CUnit* unit) {
 	return (unit_IsEnemy(unit) && (unit_IsInLos(unit) || unit_IsInRadar(unit)));
 }
 
-/// You have to set myAllyTeamId before calling this function. NOT thread safe!
+/// You have to set myAllyTeamId before calling this function.
 static inline bool unit_IsNeutralAndInLos(const CUnit* unit) {
 	return (unit_IsNeutral(unit) && unit_IsInLos(unit));
 }
@@ -162,6 +162,23 @@ void CEngineOutHandler::Update() {
 	DO_FOR_SKIRMISH_AIS(Update(frame))
 }
 
+void CEngineOutHandler::RunAsyncAIs() {
+	AI_EVT_MTH();
+
+	// exceptions from the AI threads were logged by them already
+	for (auto& ai: id_skirmishAI) {
+		(ai.second)->StartAsync();
+	}
+}
+
+void CEngineOutHandler::FinishAsyncAIs() {
+	AI_EVT_MTH();
+
+	for (auto& ai: id_skirmishAI) {
+		(ai.second)->FinishAsync();
+	}
+}
+
 
 
 // Do only if the unit is not allied, in which case we know
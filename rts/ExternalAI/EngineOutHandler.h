@@ -41,6 +41,15 @@ public:
 
 	void Update();
 
+	/**
+	 * With AsyncSkirmishAIs, the events of a sim frame are handed to the
+	 * AI threads by RunAsyncAIs once the frame is done. FinishAsyncAIs has
+	 * to be called before anything changes the sim state again; it waits
+	 * for the threads and executes the commands they gave.
+	 */
+	void RunAsyncAIs();
+	void FinishAsyncAIs();
+
 	/** Group should return false if it doenst want the unit for some reason. */
 	bool UnitAddedToGroup(const CUnit& unit, const CGroup& group);
 	/** No way to refuse giving up a unit. */
@@ -2466,6 +2466,49 @@ struct SSkirmishAICallback {
 
 	bool              (CALLING_CONV *Debug_GraphDrawer_isEnabled)(int skirmishAIId);
 
+
+// BEGINN OBJECT UnitSnapshot
+	/**
+	 * The unit snapshot holds every unit this team's ally-team can see
+	 * (allied, or in LOS or radar), one column per getUnitSnapshot* call.
+	 * Index i of every column belongs to the same unit. It is built once
+	 * per frame, on the first request, and shared by all AIs of the
+	 * ally-team, so fetching all columns once per frame is much cheaper
+	 * than calling the per-unit functions (Unit_getPos, ...) for each unit.
+	 * If cheats are enabled, the snapshot holds all units on the map.
+	 *
+	 * Every column has the same number of entries (the number of units),
+	 * positions and velocities have three floats per unit.
+	 */
+	int               (CALLING_CONV *getUnitSnapshotUnits)(int skirmishAIId, int* unitIds, int unitIds_sizeMax); //$ ARRAY:unitIds
+
+	/**
+	 * Same as Unit_getDef: -1 for radar blips never seen in LOS,
+	 * the decoy def for decoys of enemies.
+	 */
+	int               (CALLING_CONV *getUnitSnapshotDefs)(int skirmishAIId, int* unitDefIds, int unitDefIds_sizeMax); //$ ARRAY:unitDefIds
+
+	/** Same as Unit_getPos, includes the radar error for blips. */
+	int               (CALLING_CONV *getUnitSnapshotPositions)(int skirmishAIId, float* positions_AposF3, int positions_AposF3_sizeMax); //$ ARRAY:positions_AposF3
+
+	int               (CALLING_CONV *getUnitSnapshotVelocities)(int skirmishAIId, float* velocities_AposF3, int velocities_AposF3_sizeMax); //$ ARRAY:velocities_AposF3
+
+	/** Same as Unit_getHealth: -1 for units out of LOS. */
+	int               (CALLING_CONV *getUnitSnapshotHealth)(int skirmishAIId, float* health, int health_sizeMax); //$ ARRAY:health
+
+	/** In [0, 1], 1 for finished units, -1 for units out of LOS. */
+	int               (CALLING_CONV *getUnitSnapshotBuildProgress)(int skirmishAIId, float* buildProgress, int buildProgress_sizeMax); //$ ARRAY:buildProgress
+
+	/**
+	 * Bit-field per unit:
+	 * 1: in LOS
+	 * 2: in radar
+	 * 4: allied
+	 * 8: neutral
+	 */
+	int               (CALLING_CONV *getUnitSnapshotVisibility)(int skirmishAIId, int* visibility, int visibility_sizeMax); //$ ARRAY:visibility
+// END OBJECT UnitSnapshot
+
 };
 
 #if	defined(__cplusplus)
@@ -7,6 +7,7 @@
 #include "ExternalAI/SkirmishAILibraryInfo.h"
 #include "ExternalAI/SAIInterfaceCallbackImpl.h"
 #include "ExternalAI/SkirmishAIHandler.h"
+#include "ExternalAI/SkirmishAIWorker.h"
 #include "ExternalAI/Interface/AISCommands.h"
 #include "ExternalAI/Interface/SSkirmishAICallback.h"
 #include "ExternalAI/Interface/SSkirmishAILibrary.h"
@@ -32,6 +33,7 @@
 #include "Sim/Weapons/Weapon.h"
 #include "Sim/Weapons/PlasmaRepulser.h"
 #include "Sim/Misc/CategoryHandler.h"
+#include "Sim/Misc/GlobalSynced.h"
 #include "Sim/Misc/Resource.h"
 #include "Sim/Misc/ResourceHandler.h"
 #include "Sim/Misc/ResourceMapAnalyzer.h"
@@ -44,6 +46,12 @@
 #include "System/FileSystem/ArchiveScanner.h"
 #include "System/Log/ILog.h"
 
+#include <algorithm>
+#include <limits>
+#include <mutex>
+
+#include <boost/thread/mutex.hpp>
+
 
 static const char* SKIRMISH_AIS_VERSION_COMMON = "common";
 
@@ -715,6 +723,12 @@ EXPORT(int) skirmishAiCallback_Engine_handleCommand(
 	int commandTopic,
 	void* commandData
 ) {
+	CSkirmishAIWorker* worker = CSkirmishAIWorker::GetCurrent();
+
+	// commands of async AIs are executed by the main thread
+	if (worker != nullptr)
+		return worker->HandleCommand(commandId, commandTopic, commandData);
+
 	int ret = 0;
 
 	CAICallback* clb = skirmishAIId_callback[skirmishAIId];
@@ -1521,25 +1535,25 @@ EXPORT(char*) skirmishAiCallback_DataDirs_allocatePath(
 	bool dir,
 	bool common
 ) {
-	static char path[2048];
+	// one buffer per AI, asynchronous AIs call this from their own threads
+	static char paths[MAX_SKIRMISH_AIS][2048];
+
+	checkSkirmishAIId(skirmishAIId);
+
+	char* path = paths[skirmishAIId];
 
-	if (!skirmishAiCallback_DataDirs_locatePath(skirmishAIId, &path[0], sizeof(path), relPath, writeable, create, dir, common))
+	if (!skirmishAiCallback_DataDirs_locatePath(skirmishAIId, path, sizeof(paths[0]), relPath, writeable, create, dir, common))
 		path[0] = 0;
 
-	return &path[0];
+	return path;
 }
 
 
 EXPORT(const char*) skirmishAiCallback_DataDirs_getWriteableDir(int skirmishAIId) {
 	checkSkirmishAIId(skirmishAIId);
 
-	static std::vector<std::string> writeableDataDirs;
-
-	// fill up writeableDataDirs until teamId index is in there
-	// if it is not yet
-	for (size_t wdd = writeableDataDirs.size(); wdd <= (size_t)skirmishAIId; ++wdd) {
-		writeableDataDirs.push_back("");
-	}
+	// fixed size, asynchronous AIs call this from their own threads
+	static std::string writeableDataDirs[MAX_SKIRMISH_AIS];
 
 	if (writeableDataDirs[skirmishAIId].empty()) {
 		char tmpRes[1024];
@@ -4242,6 +4256,150 @@ EXPORT(int) skirmishAiCallback_getTeamUnits(int skirmishAIId, int* unitIds, int
 }
 
 
+//########### BEGINN UnitSnapshot
+
+/// what one ally-team can see of all units, as columns (see SSkirmishAICallback.h)
+struct UnitSnapshot {
+	UnitSnapshot(): frameNum(std::numeric_limits<int>::min()) {}
+
+	int frameNum;
+
+	std::vector<int> unitIds;
+	std::vector<int> unitDefIds;
+	std::vector<float> positions;
+	std::vector<float> velocities;
+	std::vector<float> health;
+	std::vector<float> buildProgress;
+	std::vector<int> visibility;
+};
+
+enum {
+	SNAPSHOT_INLOS   = 1,
+	SNAPSHOT_INRADAR = 2,
+	SNAPSHOT_ALLIED  = 4,
+	SNAPSHOT_NEUTRAL = 8,
+};
+
+// one per ally-team, followed by one per ally-team for cheating AIs (they
+// see everything, but SNAPSHOT_ALLIED still depends on their ally-team)
+// the vectors keep their capacity, rebuilding does not allocate once warm
+static std::vector<UnitSnapshot> unitSnapshots;
+// async AIs of one ally-team share a snapshot
+static boost::mutex unitSnapshotsMutex;
+
+static void buildUnitSnapshot(UnitSnapshot& snapshot, int allyTeam, bool fullView) {
+	snapshot.unitIds.clear();
+	snapshot.unitDefIds.clear();
+	snapshot.positions.clear();
+	snapshot.velocities.clear();
+	snapshot.health.clear();
+	snapshot.buildProgress.clear();
+	snapshot.visibility.clear();
+
+	for (const CUnit* u: unitHandler->activeUnits) {
+		const UnitDef* unitDef = u->unitDef;
+		const UnitDef* decoyDef = unitDef->decoyDef;
+
+		const bool allied = teamHandler->Ally(u->allyteam, allyTeam);
+		const unsigned short losStatus = u->losStatus[allyTeam];
+
+		int flags = (u->IsNeutral())? SNAPSHOT_NEUTRAL: 0;
+
+		if (allied || fullView) {
+			flags |= (SNAPSHOT_INLOS | SNAPSHOT_INRADAR | (allied? SNAPSHOT_ALLIED: 0));
+			decoyDef = NULL;
+		} else {
+			flags |= ((losStatus & LOS_INLOS) != 0)? SNAPSHOT_INLOS: 0;
+			flags |= ((losStatus & LOS_INRADAR) != 0)? SNAPSHOT_INRADAR: 0;
+		}
+
+		if ((flags & (SNAPSHOT_INLOS | SNAPSHOT_INRADAR)) == 0)
+			continue;
+
+		const bool inLos = ((flags & SNAPSHOT_INLOS) != 0);
+		const bool knownDef = inLos || ((losStatus & (LOS_PREVLOS | LOS_CONTRADAR)) == (LOS_PREVLOS | LOS_CONTRADAR));
+		const float3 pos = (allied || fullView)? float3(u->midPos): u->GetErrorPos(allyTeam);
+
+		snapshot.unitIds.push_back(u->id);
+		snapshot.unitDefIds.push_back(knownDef? ((decoyDef != NULL)? decoyDef->id: unitDef->id): -1);
+		snapshot.positions.push_back(pos.x);
+		snapshot.positions.push_back(pos.y);
+		snapshot.positions.push_back(pos.z);
+		snapshot.velocities.push_back(u->speed.x);
+		snapshot.velocities.push_back(u->speed.y);
+		snapshot.velocities.push_back(u->speed.z);
+		snapshot.health.push_back(inLos? ((decoyDef != NULL)? (u->health * decoyDef->health / unitDef->health): u->health): -1.0f);
+		snapshot.buildProgress.push_back(inLos? (u->beingBuilt? u->buildProgress: 1.0f): -1.0f);
+		snapshot.visibility.push_back(flags);
+	}
+}
+
+static const UnitSnapshot& getUnitSnapshot(int skirmishAIId) {
+	const bool fullView = skirmishAiCallback_Cheats_isEnabled(skirmishAIId);
+	const int allyTeam = teamHandler->AllyTeam(skirmishAIId_teamId[skirmishAIId]);
+	const size_t numAllyTeams = teamHandler->ActiveAllyTeams();
+	const size_t index = allyTeam + (fullView? numAllyTeams: 0);
+
+	// no frame is simulated while async AIs run, the snapshot
+	// can not change any more once this returned
+	std::lock_guard<boost::mutex> lock(unitSnapshotsMutex);
+
+	if (unitSnapshots.size() <= index)
+		unitSnapshots.resize(numAllyTeams * 2);
+
+	UnitSnapshot& snapshot = unitSnapshots[index];
+
+	if (snapshot.frameNum != gs->frameNum) {
+		buildUnitSnapshot(snapshot, allyTeam, fullView);
+		snapshot.frameNum = gs->frameNum;
+	}
+
+	return snapshot;
+}
+
+template<typename T>
+static int copyUnitSnapshotColumn(const std::vector<T>& column, T* values, int valuesMaxSize) {
+	const int valuesRealSize = column.size();
+
+	if (values == nullptr)
+		return valuesRealSize;
+
+	const int valuesSize = std::min(valuesRealSize, std::max(0, valuesMaxSize));
+	std::copy(column.begin(), column.begin() + valuesSize, values);
+	return valuesSize;
+}
+
+EXPORT(int) skirmishAiCallback_getUnitSnapshotUnits(int skirmishAIId, int* unitIds, int unitIdsMaxSize) {
+	return copyUnitSnapshotColumn(getUnitSnapshot(skirmishAIId).unitIds, unitIds, unitIdsMaxSize);
+}
+
+EXPORT(int) skirmishAiCallback_getUnitSnapshotDefs(int skirmishAIId, int* unitDefIds, int unitDefIdsMaxSize) {
+	return copyUnitSnapshotColumn(getUnitSnapshot(skirmishAIId).unitDefIds, unitDefIds, unitDefIdsMaxSize);
+}
+
+EXPORT(int) skirmishAiCallback_getUnitSnapshotPositions(int skirmishAIId, float* positions, int positionsMaxSize) {
+	return copyUnitSnapshotColumn(getUnitSnapshot(skirmishAIId).positions, positions, positionsMaxSize);
+}
+
+EXPORT(int) skirmishAiCallback_getUnitSnapshotVelocities(int skirmishAIId, float* velocities, int velocitiesMaxSize) {
+	return copyUnitSnapshotColumn(getUnitSnapshot(skirmishAIId).velocities, velocities, velocitiesMaxSize);
+}
+
+EXPORT(int) skirmishAiCallback_getUnitSnapshotHealth(int skirmishAIId, float* health, int healthMaxSize) {
+	return copyUnitSnapshotColumn(getUnitSnapshot(skirmishAIId).health, health, healthMaxSize);
+}
+
+EXPORT(int) skirmishAiCallback_getUnitSnapshotBuildProgress(int skirmishAIId, float* buildProgress, int buildProgressMaxSize) {
+	return copyUnitSnapshotColumn(getUnitSnapshot(skirmishAIId).buildProgress, buildProgress, buildProgressMaxSize);
+}
+
+EXPORT(int) skirmishAiCallback_getUnitSnapshotVisibility(int skirmishAIId, int* visibility, int visibilityMaxSize) {
+	return copyUnitSnapshotColumn(getUnitSnapshot(skirmishAIId).visibility, visibility, visibilityMaxSize);
+}
+
+//########### END UnitSnapshot
+
+
 //########### BEGINN Team
 EXPORT(bool) skirmishAiCallback_Team_hasAIController(int skirmishAIId, int teamId) {
 	for (auto& tid : skirmishAIId_teamId) {
@@ -6015,6 +6173,13 @@ static void skirmishAiCallback_init(SSkirmishAICallback* callback) {
 	callback->Unit_Weapon_isShieldEnabled = &skirmishAiCallback_Unit_Weapon_isShieldEnabled;
 	callback->Unit_Weapon_getShieldPower = &skirmishAiCallback_Unit_Weapon_getShieldPower;
 	callback->Debug_GraphDrawer_isEnabled = &skirmishAiCallback_Debug_GraphDrawer_isEnabled;
+	callback->getUnitSnapshotUnits = &skirmishAiCallback_getUnitSnapshotUnits;
+	callback->getUnitSnapshotDefs = &skirmishAiCallback_getUnitSnapshotDefs;
+	callback->getUnitSnapshotPositions = &skirmishAiCallback_getUnitSnapshotPositions;
+	callback->getUnitSnapshotVelocities = &skirmishAiCallback_getUnitSnapshotVelocities;
+	callback->getUnitSnapshotHealth = &skirmishAiCallback_getUnitSnapshotHealth;
+	callback->getUnitSnapshotBuildProgress = &skirmishAiCallback_getUnitSnapshotBuildProgress;
+	callback->getUnitSnapshotVisibility = &skirmishAiCallback_getUnitSnapshotVisibility;
 }
 
 SSkirmishAICallback* skirmishAiCallback_getInstanceFor(
@@ -6029,6 +6194,9 @@ SSkirmishAICallback* skirmishAiCallback_getInstanceFor(
 	skirmishAIId_usesCheats[skirmishAIId]    = false;
 	skirmishAIId_teamId[skirmishAIId]        = teamId;
 
+	// a reloaded game starts counting frames again
+	unitSnapshots.clear();
+
 	skirmishAIId_cCallback[skirmishAIId].reset(new SSkirmishAICallback());
 	skirmishAiCallback_init(skirmishAIId_cCallback[skirmishAIId].get());
 
@@ -0,0 +1,219 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "SkirmishAIWorker.h"
+
+#include "AICallback.h"
+#include "EngineOutHandler.h"
+#include "SSkirmishAICallbackImpl.h"
+#include "Interface/AISCommands.h"
+#include "Sim/Units/UnitHandler.h"
+#include "System/Platform/Threading.h"
+#include "System/Util.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+static __thread CSkirmishAIWorker* currentWorker = nullptr;
+
+
+CSkirmishAIWorker::CSkirmishAIWorker(int skirmishAIId, CAICallback* callback)
+	: skirmishAIId(skirmishAIId)
+	, callback(callback)
+	, threadName("skirmishai" + IntToString(skirmishAIId))
+	, thread(nullptr)
+	, busy(false)
+	, waitingForCommand(false)
+	, commandRet(0)
+	, stop(false)
+	, finishing(false)
+{
+	thread = new boost::thread(boost::bind(&CSkirmishAIWorker::ThreadLoop, this));
+}
+
+CSkirmishAIWorker::~CSkirmishAIWorker()
+{
+	// AI exceptions were logged already, there is nobody to pass them on to
+	try {
+		Flush();
+	} catch (...) {
+	}
+
+	mutex.lock();
+	stop = true;
+	mutex.unlock();
+
+	cond.notify_all();
+	thread->join();
+	SafeDelete(thread);
+}
+
+
+CSkirmishAIWorker* CSkirmishAIWorker::GetCurrent()
+{
+	return currentWorker;
+}
+
+
+void CSkirmishAIWorker::Start()
+{
+	Finish();
+
+	if (pendingEvents.empty())
+		return;
+
+	mutex.lock();
+	events.swap(pendingEvents);
+	busy = true;
+	mutex.unlock();
+
+	cond.notify_all();
+}
+
+void CSkirmishAIWorker::Finish()
+{
+	// an executed command can lead here again
+	if (finishing)
+		return;
+
+	finishing = true;
+	mutex.lock();
+
+	while (true) {
+		ExecuteCommands();
+
+		if (!busy)
+			break;
+
+		cond.wait(mutex);
+	}
+
+	std::exception_ptr aiException;
+	std::swap(aiException, exception);
+
+	mutex.unlock();
+	finishing = false;
+
+	if (aiException)
+		std::rethrow_exception(aiException);
+}
+
+void CSkirmishAIWorker::Flush()
+{
+	Finish();
+
+	std::vector<Event> flushEvents;
+	flushEvents.swap(pendingEvents);
+
+	for (const Event& event: flushEvents) {
+		event();
+	}
+}
+
+
+void CSkirmishAIWorker::ExecuteCommands()
+{
+	while (!commands.empty()) {
+		const AICommand cmd = commands.front();
+		commands.pop_front();
+
+		mutex.unlock();
+
+		if (cmd.data == nullptr) {
+			// a copy, GiveOrder may change it
+			Command order = cmd.order;
+
+			if (cmd.unitId >= 0) {
+				callback->GiveOrder(cmd.unitId, &order);
+			} else {
+				callback->GiveGroupOrder(cmd.groupId, &order);
+			}
+
+			mutex.lock();
+			continue;
+		}
+
+		const int ret = skirmishAiCallback_Engine_handleCommand(skirmishAIId, COMMAND_TO_ID_ENGINE, cmd.id, cmd.topic, cmd.data);
+
+		mutex.lock();
+		commandRet = ret;
+		waitingForCommand = false;
+		cond.notify_all();
+	}
+}
+
+int CSkirmishAIWorker::HandleCommand(int commandId, int commandTopic, void* commandData)
+{
+	AICommand cmd = {Command(), -1, -1, commandId, commandTopic, commandData};
+
+	// unit orders are copied, the AI does not have to wait for them
+	if (newCommand(commandData, commandTopic, unitHandler->MaxUnits(), &cmd.order)) {
+		const SStopUnitCommand* unitCmd = static_cast<SStopUnitCommand*>(commandData);
+
+		cmd.order.aiCommandId = commandId;
+		cmd.unitId = unitCmd->unitId;
+		cmd.groupId = unitCmd->groupId;
+		cmd.data = nullptr;
+
+		mutex.lock();
+		commands.push_back(cmd);
+		mutex.unlock();
+		return 0;
+	}
+
+	mutex.lock();
+	commands.push_back(cmd);
+	waitingForCommand = true;
+	cond.notify_all();
+
+	while (waitingForCommand)
+		cond.wait(mutex);
+
+	const int ret = commandRet;
+	mutex.unlock();
+
+	return ret;
+}
+
+
+void CSkirmishAIWorker::ThreadLoop()
+{
+	Threading::SetThreadName(threadName);
+	currentWorker = this;
+
+	while (true) {
+		std::vector<Event> threadEvents;
+
+		mutex.lock();
+
+		while (events.empty() && !stop)
+			cond.wait(mutex);
+
+		if (stop) {
+			mutex.unlock();
+			break;
+		}
+
+		threadEvents.swap(events);
+		mutex.unlock();
+
+		std::exception_ptr aiException;
+
+		// like the synchronous path: log, then pass it on (to Finish)
+		try {
+			for (const Event& event: threadEvents) {
+				try {
+					event();
+				} CATCH_AI_EXCEPTION;
+			}
+		} catch (...) {
+			aiException = std::current_exception();
+		}
+
+		mutex.lock();
+		exception = aiException;
+		busy = false;
+		mutex.unlock();
+
+		cond.notify_all();
+	}
+}
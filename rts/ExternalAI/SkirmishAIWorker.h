@@ -0,0 +1,108 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef SKIRMISH_AI_WORKER_H
+#define SKIRMISH_AI_WORKER_H
+
+#include <deque>
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+
+#include "Sim/Units/CommandAI/Command.h"
+#include "System/Threading/SpringMutex.h"
+
+namespace boost {
+	class thread;
+};
+
+class CAICallback;
+
+
+/**
+ * @brief Runs the events of one Skirmish AI on a thread of its own
+ * Used for AIs that neither cheat nor get cheat events when
+ * AsyncSkirmishAIs is enabled. The engine only queues the events during
+ * a sim frame (Post), Start() hands them to the thread once the frame is
+ * done and Finish() waits for the thread before the sim state changes
+ * again, so the AI always sees the state of the last simulated frame.
+ *
+ * Commands the AI gives from its thread are executed by the main thread
+ * in Finish(): unit orders are queued and the AI goes on right away (the
+ * command returns 0), any other command blocks the AI until it was
+ * executed, so return values still arrive.
+ */
+class CSkirmishAIWorker
+{
+public:
+	typedef std::function<void()> Event;
+
+public:
+	CSkirmishAIWorker(int skirmishAIId, CAICallback* callback);
+	~CSkirmishAIWorker();
+
+	/// queues an event, sent to the AI after the next Start()
+	void Post(const Event& event) { pendingEvents.push_back(event); }
+
+	/// lets the thread handle the events queued since the last Start()
+	void Start();
+	/**
+	 * Waits until the thread handled all its events, executing the commands
+	 * of the AI meanwhile. Rethrows an exception thrown by the AI.
+	 */
+	void Finish();
+	/// Finish(), then sends the events not yet started on the calling thread
+	void Flush();
+
+	/// returns the worker running on the calling thread, if any
+	static CSkirmishAIWorker* GetCurrent();
+
+	/// called by the AI (on the worker thread) instead of handleCommand
+	int HandleCommand(int commandId, int commandTopic, void* commandData);
+
+private:
+	void ThreadLoop();
+	/// called with mutex locked
+	void ExecuteCommands();
+
+private:
+	struct AICommand {
+		/// a unit order if data is NULL, else blocks the AI
+		Command order;
+		int unitId;
+		int groupId;
+
+		int id;
+		int topic;
+		void* data;
+	};
+
+	int skirmishAIId;
+	CAICallback* callback;
+
+	std::string threadName;
+	boost::thread* thread;
+
+	/// only touched by the main thread
+	std::vector<Event> pendingEvents;
+
+	spring::mutex mutex;
+	/// signals the thread new events, and the main thread new commands
+	/// or that the thread is done
+	boost::condition_variable_any cond;
+
+	/// all guarded by mutex
+	std::vector<Event> events;
+	std::deque<AICommand> commands;
+	std::exception_ptr exception;
+	bool busy;
+	bool waitingForCommand;
+	int commandRet;
+	bool stop;
+
+	bool finishing;
+};
+
+#endif // SKIRMISH_AI_WORKER_H
@@ -11,6 +11,7 @@
 #include "SkirmishAILibrary.h"
 #include "SkirmishAILibraryInfo.h"
 #include "SkirmishAIData.h"
+#include "SkirmishAIWorker.h"
 #include "SSkirmishAICallbackImpl.h"
 
 #include "Interface/AISEvents.h"
@@ -19,8 +20,10 @@
 
 #include "Sim/Units/Unit.h"
 #include "Sim/Units/UnitHandler.h"
+#include "Sim/Misc/ResourceHandler.h"
 #include "Sim/Misc/TeamHandler.h"
 
+#include "System/Config/ConfigHandler.h"
 #include "System/FileSystem/DataDirsAccess.h"
 #include "System/FileSystem/FileQueryFlags.h"
 #include "System/FileSystem/FileSystem.h"
@@ -34,6 +37,9 @@
 
 #undef DeleteFile
 
+CONFIG(bool, AsyncSkirmishAIs).defaultValue(false)
+	.description("Handle the events of each non-cheating Skirmish AI on a thread of its own, parallel to the other AIs and to rendering. The AIs see the state of the last sim frame, their unit orders are given before the next one.");
+
 CR_BIND_DERIVED(CSkirmishAIWrapper, CObject, )
 CR_REG_METADATA(CSkirmishAIWrapper, (
 	CR_MEMBER(key),
@@ -43,6 +49,7 @@ CR_REG_METADATA(CSkirmishAIWrapper, (
 
 	CR_IGNORED(callback),
 	CR_IGNORED(cheats),
+	CR_IGNORED(worker),
 
 	CR_MEMBER(timerName),
 
@@ -110,14 +117,28 @@ void CSkirmishAIWrapper::CreateCallback() {
 	cheats.reset(new CAICheats(this));
 
 	sCallback = skirmishAiCallback_getInstanceFor(skirmishAIId, teamId, callback.get(), cheats.get());
+
+	if (!configHandler->GetBool("AsyncSkirmishAIs"))
+		return;
+
+	// the analyzers are created (and their cache files written) on first
+	// use, which must not happen concurrently on the AI threads
+	for (size_t n = 0; n < resourceHandler->GetNumResources(); n++) {
+		resourceHandler->GetResourceMapAnalyzer(n);
+	}
+
+	worker.reset(new CSkirmishAIWorker(skirmishAIId, callback.get()));
 }
 
 CSkirmishAIWrapper::~CSkirmishAIWrapper() {
+	// sends the events still queued
+	worker.reset();
+
 	// send release event
 	Release(skirmishAIHandler.GetLocalSkirmishAIDieReason(skirmishAIId));
 
 	{
-		SCOPED_TIMER(timerName.c_str());
+		ScopedTimer timer(timerName);
 
 		if (initOk)
 			library->Release(skirmishAIId);
@@ -133,9 +154,15 @@ CSkirmishAIWrapper::~CSkirmishAIWrapper() {
 }
 
 void CSkirmishAIWrapper::PreDestroy() {
+	FlushEvents();
 	callback->noMessages = true;
 }
 
+void CSkirmishAIWrapper::Dieing() {
+	FlushEvents();
+	dieing = true;
+}
+
 void CSkirmishAIWrapper::Serialize(creg::ISerializer* s) {
 }
 
@@ -148,7 +175,7 @@ void CSkirmishAIWrapper::PostLoad() {
 
 bool CSkirmishAIWrapper::LoadSkirmishAI(bool postLoad) {
 	{
-		SCOPED_TIMER(timerName.c_str());
+		ScopedTimer timer(timerName);
 
 		library = IAILibraryManager::GetInstance()->FetchSkirmishAILibrary(key);
 
@@ -221,6 +248,8 @@ bool CSkirmishAIWrapper::LoadSkirmishAI(bool postLoad) {
 
 
 void CSkirmishAIWrapper::Init() {
+	FlushEvents();
+
 	if (!LoadSkirmishAI(false))
 		return;
 
@@ -241,6 +270,8 @@ void CSkirmishAIWrapper::Release(int reason) {
 	if (!initialized || released)
 		return;
 
+	FlushEvents();
+
 	// NOTE: further cleanup is done in the destructor
 	const SReleaseEvent evtData = {reason};
 	HandleEvent(EVENT_RELEASE, &evtData);
@@ -278,6 +309,8 @@ void CSkirmishAIWrapper::Load(std::istream* loadStream)
 	const std::string tmpFile = createTempFileName("load", teamId, skirmishAIId);
 	const SLoadEvent evtData = {tmpFile.c_str()};
 
+	FlushEvents();
+
 	{
 		std::ofstream tmpFileStream;
 
@@ -296,6 +329,7 @@ void CSkirmishAIWrapper::Save(std::ostream* saveStream)
 	const std::string tmpFile = createTempFileName("save", teamId, skirmishAIId);
 	const SSaveEvent evtData = {tmpFile.c_str()};
 
+	FlushEvents();
 	HandleEvent(EVENT_SAVE, &evtData);
 
 	if (!FileSystem::FileExists(tmpFile))
@@ -314,24 +348,62 @@ void CSkirmishAIWrapper::Save(std::ostream* saveStream)
 
 
 
+bool CSkirmishAIWrapper::IsAsync() const {
+	return (worker != nullptr && !cheatEvents && !skirmishAiCallback_Cheats_isEnabled(skirmishAIId));
+}
+
+void CSkirmishAIWrapper::StartAsync() {
+	if (worker != nullptr)
+		worker->Start();
+}
+
+void CSkirmishAIWrapper::FinishAsync() {
+	if (worker != nullptr)
+		worker->Finish();
+}
+
+void CSkirmishAIWrapper::FlushEvents() {
+	if (worker != nullptr)
+		worker->Flush();
+}
+
+template<typename EventFunc>
+void CSkirmishAIWrapper::DispatchEvent(const EventFunc& event) {
+	if (IsAsync()) {
+		worker->Post(event);
+		return;
+	}
+
+	// an AI that started cheating gets its queued events first
+	FlushEvents();
+	event();
+}
+
+template<typename EventData>
+void CSkirmishAIWrapper::SendEvent(int topic, const EventData& evtData) {
+	DispatchEvent([this, topic, evtData]() { HandleEvent(topic, &evtData); });
+}
+
+
+
 void CSkirmishAIWrapper::UnitIdle(int unitId) {
 	const SUnitIdleEvent evtData = {unitId};
-	HandleEvent(EVENT_UNIT_IDLE, &evtData);
+	SendEvent(EVENT_UNIT_IDLE, evtData);
 }
 
 void CSkirmishAIWrapper::UnitCreated(int unitId, int builderId) {
 	const SUnitCreatedEvent evtData = {unitId, builderId};
-	HandleEvent(EVENT_UNIT_CREATED, &evtData);
+	SendEvent(EVENT_UNIT_CREATED, evtData);
 }
 
 void CSkirmishAIWrapper::UnitFinished(int unitId) {
 	const SUnitFinishedEvent evtData = {unitId};
-	HandleEvent(EVENT_UNIT_FINISHED, &evtData);
+	SendEvent(EVENT_UNIT_FINISHED, evtData);
 }
 
 void CSkirmishAIWrapper::UnitDestroyed(int unitId, int attackerUnitId) {
 	const SUnitDestroyedEvent evtData = {unitId, attackerUnitId};
-	HandleEvent(EVENT_UNIT_DESTROYED, &evtData);
+	SendEvent(EVENT_UNIT_DESTROYED, evtData);
 }
 
 void CSkirmishAIWrapper::UnitDamaged(
@@ -342,61 +414,63 @@ void CSkirmishAIWrapper::UnitDamaged(
 	int weaponDefId,
 	bool paralyzer
 ) {
-	float3 cpyDir = dir;
-	const SUnitDamagedEvent evtData = {unitId, attackerUnitId, damage, &cpyDir[0], weaponDefId, paralyzer};
+	DispatchEvent([=]() {
+		float3 cpyDir = dir;
+		const SUnitDamagedEvent evtData = {unitId, attackerUnitId, damage, &cpyDir[0], weaponDefId, paralyzer};
 
-	HandleEvent(EVENT_UNIT_DAMAGED, &evtData);
+		HandleEvent(EVENT_UNIT_DAMAGED, &evtData);
+	});
 }
 
 void CSkirmishAIWrapper::UnitMoveFailed(int unitId) {
 	const SUnitMoveFailedEvent evtData = {unitId};
-	HandleEvent(EVENT_UNIT_MOVE_FAILED, &evtData);
+	SendEvent(EVENT_UNIT_MOVE_FAILED, evtData);
 }
 
 void CSkirmishAIWrapper::UnitGiven(int unitId, int oldTeam, int newTeam) {
 	const SUnitGivenEvent evtData = {unitId, oldTeam, newTeam};
-	HandleEvent(EVENT_UNIT_GIVEN, &evtData);
+	SendEvent(EVENT_UNIT_GIVEN, evtData);
 }
 
 void CSkirmishAIWrapper::UnitCaptured(int unitId, int oldTeam, int newTeam) {
 	const SUnitCapturedEvent evtData = {unitId, oldTeam, newTeam};
-	HandleEvent(EVENT_UNIT_CAPTURED, &evtData);
+	SendEvent(EVENT_UNIT_CAPTURED, evtData);
 }
 
 
 void CSkirmishAIWrapper::EnemyCreated(int unitId) {
 	const SEnemyCreatedEvent evtData = {unitId};
-	HandleEvent(EVENT_ENEMY_CREATED, &evtData);
+	SendEvent(EVENT_ENEMY_CREATED, evtData);
 }
 
 void CSkirmishAIWrapper::EnemyFinished(int unitId) {
 	const SEnemyFinishedEvent evtData = {unitId};
-	HandleEvent(EVENT_ENEMY_FINISHED, &evtData);
+	SendEvent(EVENT_ENEMY_FINISHED, evtData);
 }
 
 void CSkirmishAIWrapper::EnemyEnterLOS(int unitId) {
 	const SEnemyEnterLOSEvent evtData = {unitId};
-	HandleEvent(EVENT_ENEMY_ENTER_LOS, &evtData);
+	SendEvent(EVENT_ENEMY_ENTER_LOS, evtData);
 }
 
 void CSkirmishAIWrapper::EnemyLeaveLOS(int unitId) {
 	const SEnemyLeaveLOSEvent evtData = {unitId};
-	HandleEvent(EVENT_ENEMY_LEAVE_LOS, &evtData);
+	SendEvent(EVENT_ENEMY_LEAVE_LOS, evtData);
 }
 
 void CSkirmishAIWrapper::EnemyEnterRadar(int unitId) {
 	const SEnemyEnterRadarEvent evtData = {unitId};
-	HandleEvent(EVENT_ENEMY_ENTER_RADAR, &evtData);
+	SendEvent(EVENT_ENEMY_ENTER_RADAR, evtData);
 }
 
 void CSkirmishAIWrapper::EnemyLeaveRadar(int unitId) {
 	const SEnemyLeaveRadarEvent evtData = {unitId};
-	HandleEvent(EVENT_ENEMY_LEAVE_RADAR, &evtData);
+	SendEvent(EVENT_ENEMY_LEAVE_RADAR, evtData);
 }
 
 void CSkirmishAIWrapper::EnemyDestroyed(int enemyUnitId, int attackerUnitId) {
 	const SEnemyDestroyedEvent evtData = {enemyUnitId, attackerUnitId};
-	HandleEvent(EVENT_ENEMY_DESTROYED, &evtData);
+	SendEvent(EVENT_ENEMY_DESTROYED, evtData);
 }
 
 void CSkirmishAIWrapper::EnemyDamaged(
@@ -407,30 +481,39 @@ void CSkirmishAIWrapper::EnemyDamaged(
 	int weaponDefId,
 	bool paralyzer
 ) {
-	float3 cpyDir = dir;
-	const SEnemyDamagedEvent evtData = {enemyUnitId, attackerUnitId, damage, &cpyDir[0], weaponDefId, paralyzer};
+	DispatchEvent([=]() {
+		float3 cpyDir = dir;
+		const SEnemyDamagedEvent evtData = {enemyUnitId, attackerUnitId, damage, &cpyDir[0], weaponDefId, paralyzer};
 
-	HandleEvent(EVENT_ENEMY_DAMAGED, &evtData);
+		HandleEvent(EVENT_ENEMY_DAMAGED, &evtData);
+	});
 }
 
 void CSkirmishAIWrapper::Update(int frame) {
 	const SUpdateEvent evtData = {frame};
-	HandleEvent(EVENT_UPDATE, &evtData);
+	SendEvent(EVENT_UPDATE, evtData);
 }
 
 void CSkirmishAIWrapper::SendChatMessage(const char* msg, int fromPlayerId) {
-	const SMessageEvent evtData = {fromPlayerId, msg};
-	HandleEvent(EVENT_MESSAGE, &evtData);
+	const std::string cpyMsg = msg;
+
+	DispatchEvent([=]() {
+		const SMessageEvent evtData = {fromPlayerId, cpyMsg.c_str()};
+		HandleEvent(EVENT_MESSAGE, &evtData);
+	});
 }
 
 void CSkirmishAIWrapper::SendLuaMessage(const char* inData, const char** outData) {
 	const SLuaMessageEvent evtData = {inData /*outData*/};
+
+	// has to be answered right away
+	FlushEvents();
 	HandleEvent(EVENT_LUA_MESSAGE, &evtData);
 }
 
 void CSkirmishAIWrapper::WeaponFired(int unitId, int weaponDefId) {
 	const SWeaponFiredEvent evtData = {unitId, weaponDefId};
-	HandleEvent(EVENT_WEAPON_FIRED, &evtData);
+	SendEvent(EVENT_WEAPON_FIRED, evtData);
 }
 
 void CSkirmishAIWrapper::PlayerCommandGiven(
@@ -438,17 +521,20 @@ void CSkirmishAIWrapper::PlayerCommandGiven(
 	const Command& c,
 	int playerId
 ) {
-	std::vector<int> unitIds = playerSelectedUnits;
-
+	const std::vector<int> unitIds = playerSelectedUnits;
 	const int cCommandId = extractAICommandTopic(&c, unitHandler->MaxUnits());
-	const SPlayerCommandEvent evtData = {&unitIds[0], static_cast<int>(playerSelectedUnits.size()), cCommandId, playerId};
 
-	HandleEvent(EVENT_PLAYER_COMMAND, &evtData);
+	DispatchEvent([=]() {
+		std::vector<int> cpyUnitIds = unitIds;
+		const SPlayerCommandEvent evtData = {&cpyUnitIds[0], static_cast<int>(cpyUnitIds.size()), cCommandId, playerId};
+
+		HandleEvent(EVENT_PLAYER_COMMAND, &evtData);
+	});
 }
 
 void CSkirmishAIWrapper::CommandFinished(int unitId, int commandId, int commandTopicId) {
 	const SCommandFinishedEvent evtData = {unitId, commandId, commandTopicId};
-	HandleEvent(EVENT_COMMAND_FINISHED, &evtData);
+	SendEvent(EVENT_COMMAND_FINISHED, evtData);
 }
 
 void CSkirmishAIWrapper::SeismicPing(
@@ -457,15 +543,18 @@ void CSkirmishAIWrapper::SeismicPing(
 	const float3& pos,
 	float strength
 ) {
-	float3 cpyPos = pos;
-	const SSeismicPingEvent evtData = {&cpyPos[0], strength};
+	DispatchEvent([=]() {
+		float3 cpyPos = pos;
+		const SSeismicPingEvent evtData = {&cpyPos[0], strength};
 
-	HandleEvent(EVENT_SEISMIC_PING, &evtData);
+		HandleEvent(EVENT_SEISMIC_PING, &evtData);
+	});
 }
 
 
 int CSkirmishAIWrapper::HandleEvent(int topic, const void* data) const {
-	SCOPED_TIMER(timerName.c_str());
+	// not SCOPED_TIMER, the name differs per AI instance
+	ScopedTimer timer(timerName);
 
 	if (!dieing || (topic == EVENT_RELEASE))
 		return library->HandleEvent(skirmishAIId, topic, data);
@@ -14,6 +14,7 @@
 class CAICallback;
 class CAICheats;
 class CSkirmishAILibrary;
+class CSkirmishAIWorker;
 struct SSkirmishAICallback;
 
 struct Command;
@@ -61,7 +62,16 @@ public:
 	 * the Skirmish AI Handler instead.
 	 * @see CSkirmishAIHandler::SetLocalSkirmishAIDieing()
 	 */
-	void Dieing() { dieing = true; }
+	void Dieing();
+
+	/**
+	 * Async AIs (see AsyncSkirmishAIs) only queue their events during the
+	 * sim frame, StartAsync hands them to the AI's thread and FinishAsync
+	 * waits for the thread; both do nothing for synchronous AIs.
+	 * @see CSkirmishAIWorker
+	 */
+	void StartAsync();
+	void FinishAsync();
 
 
 	// AI Events
@@ -99,9 +109,18 @@ public:
 	void SetCheatEventsEnabled(bool enable) { cheatEvents = enable; }
 	bool IsCheatEventsEnabled() const { return cheatEvents; }
 
+	/// cheating AIs always get their events synchronously
+	bool IsAsync() const;
+
 private:
 	bool LoadSkirmishAI(bool postLoad);
 
+	/// queues the event for the AI's thread or sends it right away
+	template<typename EventFunc> void DispatchEvent(const EventFunc& event);
+	template<typename EventData> void SendEvent(int topic, const EventData& evtData);
+	/// sends the events queued so far, before one that can not wait
+	void FlushEvents();
+
 	/**
 	 * CAUTION: takes C AI Interface events, not engine C++ ones!
 	 */
@@ -115,6 +134,7 @@ private:
 
 	std::unique_ptr<CAICallback> callback;
 	std::unique_ptr<CAICheats> cheats;
+	std::unique_ptr<CSkirmishAIWorker> worker;
 
 	std::string timerName;
 
@@ -14,8 +14,12 @@
 #include "ConsoleHistory.h"
 #include "GameHelper.h"
 #include "GameSetup.h"
+#include "GameVersion.h"
 #include "GlobalUnsynced.h"
 #include "LoadScreen.h"
+#include "ReplayAnalysis.h"
+#include "SimTelemetry.h"
+#include "SyncChecksumStream.h"
 #include "SelectedUnitsHandler.h"
 #include "WaitCommandsAI.h"
 #include "WordCompletion.h"
@@ -116,17 +120,26 @@
 #include "System/SpringApp.h"
 #include "System/Util.h"
 #include "System/Input/KeyInput.h"
+#include "System/CRC.h"
+#include "System/FileSystem/ArchiveScanner.h"
+#include "System/FileSystem/DataDirsAccess.h"
+#include "System/FileSystem/FileQueryFlags.h"
 #include "System/FileSystem/FileSystem.h"
 #include "System/FileSystem/VFSHandler.h"
 #include "System/LoadSave/LoadSaveHandler.h"
+#include "System/LoadSave/CregLoadSaveHandler.h"
 #include "System/LoadSave/DemoRecorder.h"
 #include "System/Log/ILog.h"
+#include "System/Platform/Threading.h"
 #include "System/Platform/Watchdog.h"
 #include "System/Sound/ISound.h"
 #include "System/Sound/ISoundChannels.h"
 #include "System/Sync/DumpState.h"
 #include "System/TimeProfiler.h"
 
+#include <boost/thread/thread.hpp>
+#include <exception>
+
 
 #undef CreateDirectory
 
@@ -139,6 +152,8 @@ CONFIG(int, ShowPlayerInfo).defaultValue(1).headlessValue(0);
 CONFIG(float, GuiOpacity).defaultValue(0.8f).minimumValue(0.0f).maximumValue(1.0f).description("Sets the opacity of the built-in Spring UI. Generally has no effect on LuaUI widgets. Can be set in-game using shift+, to decrease and shift+. to increase.");
 CONFIG(std::string, InputTextGeo).defaultValue("");
 CONFIG(bool, LuaModUICtrl).defaultValue(true).headlessValue(false);
+CONFIG(bool, DefsCache).defaultValue(true).description("Store the tables returned by gamedata/defs.lua per game, map and game/map options, and reuse them on the next start instead of running the def scripts again.");
+CONFIG(bool, PreloadModels).defaultValue(true).headlessValue(false).description("Parse all unit and feature models (and decode their textures) in the background while the game is loading, instead of on first use.");
 
 
 CGame* game = NULL;
@@ -203,6 +218,7 @@ CR_REG_METADATA(CGame, (
 	CR_IGNORED(jobDispatcher),
 	CR_IGNORED(worldDrawer),
 	CR_IGNORED(defsParser),
+	CR_IGNORED(replayAnalysis),
 	CR_IGNORED(saveFile),
 
 	// from CGameController
@@ -253,6 +269,7 @@ CGame::CGame(const std::string& mapName, const std::string& modName, ILoadSaveHa
 	, consoleHistory(NULL)
 	, worldDrawer(NULL)
 	, defsParser(NULL)
+	, replayAnalysis(NULL)
 	, saveFile(saveFile)
 	, finishedLoading(false)
 	, gameOver(false)
@@ -323,6 +340,11 @@ CGame::~CGame()
 	ENTER_SYNCED_CODE();
 	LOG("[%s]1]", __FUNCTION__);
 
+	SafeDelete(replayAnalysis);
+	simTelemetry.Close();
+	syncChecksumStream.Close();
+	// async AIs may still read from Lua
+	eoh->FinishAsyncAIs();
 	KillLua();
 	KillMisc();
 	KillRendering();
@@ -330,6 +352,7 @@ CGame::~CGame()
 	KillSimulation();
 
 	LOG("[%s][2]", __FUNCTION__);
+	CCregLoadSaveHandler::WaitForPendingSave();
 	SafeDelete(saveFile); // ILoadSaveHandler, depends on vfsHandler via ~IArchive
 	SafeDelete(jobDispatcher);
 
@@ -424,6 +447,49 @@ void CGame::LoadMap(const std::string& mapName)
 }
 
 
+/**
+ * The tables returned by defs.lua only depend on the game and map
+ * archives, the options passed to them and the engine version.
+ * Returns false for unpacked archives: the scanner does not reliably
+ * notice when files inside a directory change.
+ */
+static bool GetDefsCacheKey(std::string& cacheFile, std::string& cacheKey)
+{
+	static const std::string cacheDir = dataDirsAccess.LocateDir(FileSystem::GetCacheDir() + "/defs/", FileQueryFlags::WRITE | FileQueryFlags::CREATE_DIRS);
+
+	const std::string modArchive = archiveScanner->ArchiveFromName(gameSetup->modName);
+	const std::string mapArchive = archiveScanner->ArchiveFromName(gameSetup->mapName);
+
+	std::vector<std::string> archives = archiveScanner->GetAllArchivesUsedBy(modArchive);
+	const std::vector<std::string> mapArchives = archiveScanner->GetAllArchivesUsedBy(mapArchive);
+	archives.insert(archives.end(), mapArchives.begin(), mapArchives.end());
+
+	for (const std::string& archive: archives) {
+		if (StringToLower(FileSystem::GetExtension(archive)) == "sdd")
+			return false;
+	}
+
+	char checksums[32];
+	SNPRINTF(checksums, sizeof(checksums), "%08x %08x",
+		archiveScanner->GetArchiveCompleteChecksum(modArchive),
+		archiveScanner->GetArchiveCompleteChecksum(mapArchive));
+
+	cacheKey = SpringVersion::GetSync() + "\n" + checksums + "\n";
+
+	for (const auto& opt: CGameSetup::GetModOptions()) {
+		cacheKey += "modopt:" + opt.first + "=" + opt.second + "\n";
+	}
+	for (const auto& opt: CGameSetup::GetMapOptions()) {
+		cacheKey += "mapopt:" + opt.first + "=" + opt.second + "\n";
+	}
+
+	char fileName[32];
+	SNPRINTF(fileName, sizeof(fileName), "%08x.bin", CRC::GetCRC(cacheKey.data(), cacheKey.size()));
+
+	cacheFile = cacheDir + fileName;
+	return true;
+}
+
 void CGame::LoadDefs()
 {
 	ENTER_SYNCED_CODE();
@@ -433,7 +499,21 @@ void CGame::LoadDefs()
 		icon::iconHandler = new icon::CIconHandler();
 	}
 
-	{
+	// sounds.lua does not depend on the defs, parse it (and
+	// decode the preloaded sounds) while defs.lua is running
+	std::exception_ptr soundDefsError;
+	boost::thread soundDefsThread([&soundDefsError]() {
+		Threading::SetThreadName("sounddefs");
+
+		try {
+			ScopedOnceTimer timer("Game::LoadDefs (Sound)");
+			sound->LoadSoundDefs("gamedata/sounds.lua", SPRING_VFS_MOD_BASE);
+		} catch (...) {
+			soundDefsError = std::current_exception();
+		}
+	});
+
+	try {
 		ScopedOnceTimer timer("Game::LoadDefs (GameData)");
 		loadscreen->SetLoadMessage("Loading GameData Definitions");
 
@@ -444,9 +524,21 @@ void CGame::LoadDefs()
 		defsParser->AddFunc("GetMapOptions", LuaSyncedRead::GetMapOptions);
 		defsParser->EndTable();
 
-		// run the parser
-		if (!defsParser->Execute()) {
-			throw content_error("Defs-Parser: " + defsParser->GetErrorLog());
+		std::string cacheFile;
+		std::string cacheKey;
+
+		const bool useCache = configHandler->GetBool("DefsCache") && GetDefsCacheKey(cacheFile, cacheKey);
+
+		if (useCache && defsParser->ReadCache(cacheFile, cacheKey)) {
+			LOG("[%s] using cached gamedata definitions \"%s\"", __FUNCTION__, cacheFile.c_str());
+		} else {
+			// run the parser
+			if (!defsParser->Execute()) {
+				throw content_error("Defs-Parser: " + defsParser->GetErrorLog());
+			}
+			if (useCache) {
+				defsParser->WriteCache(cacheFile, cacheKey);
+			}
 		}
 		const LuaTable root = defsParser->GetRoot();
 		if (!root.IsValid()) {
@@ -469,13 +561,18 @@ void CGame::LoadDefs()
 		if (!root.SubTable("MoveDefs").IsValid()) {
 			throw content_error("Error loading MoveDefs");
 		}
+	} catch (...) {
+		soundDefsThread.join();
+		throw;
 	}
 
 	{
-		ScopedOnceTimer timer("Game::LoadDefs (Sound)");
 		loadscreen->SetLoadMessage("Loading Sound Definitions");
+		soundDefsThread.join();
+
+		if (soundDefsError)
+			std::rethrow_exception(soundDefsError);
 
-		sound->LoadSoundDefs("gamedata/sounds.lua", SPRING_VFS_MOD_BASE);
 		chatSound = sound->GetSoundId("IncomingChat");
 	}
 
@@ -512,6 +609,18 @@ void CGame::PostLoadSimulation()
 	loadscreen->SetLoadMessage("Loading Feature Definitions");
 	featureHandler = new CFeatureHandler(defsParser);
 
+	if (configHandler->GetBool("PreloadModels")) {
+		// parsed by the model loader threads while loading continues;
+		// whoever needs one of these first waits only if a loader thread
+		// is parsing it already, a model still queued is parsed right away
+		for (const UnitDef& ud: unitDefHandler->unitDefs) {
+			ud.PreloadModel();
+		}
+		for (const auto& fdi: featureHandler->GetFeatureDefs()) {
+			featureHandler->GetFeatureDefByID(fdi.second)->PreloadModel();
+		}
+	}
+
 	losHandler = new CLosHandler();
 
 	// pre-load the PFS, gets finalized after Lua
@@ -653,8 +762,10 @@ void CGame::LoadLua()
 
 	LEAVE_SYNCED_CODE();
 
-	loadscreen->SetLoadMessage("Loading LuaUI");
-	CLuaUI::LoadFreeHandler();
+	if (!CReplayAnalysis::enabled) {
+		loadscreen->SetLoadMessage("Loading LuaUI");
+		CLuaUI::LoadFreeHandler();
+	}
 
 	// last in, first served
 	luaInputReceiver = new LuaInputReceiver();
@@ -708,6 +819,13 @@ void CGame::LoadFinalize()
 		benchmark.ResetState();
 	}
 
+	if (CReplayAnalysis::enabled) {
+		replayAnalysis = new CReplayAnalysis();
+	}
+
+	simTelemetry.Open();
+	syncChecksumStream.Open();
+
 	lastReadNetTime = spring_gettime();
 	lastSimFrameTime = lastReadNetTime;
 	lastDrawFrameTime = lastReadNetTime;
@@ -1440,7 +1558,7 @@ void CGame::SimFrame() {
 	tracefile << "New frame:" << gs->frameNum << " " << gs->GetRandSeed() << "\n";
 #endif
 
-	if (!skipping) {
+	if (!skipping && !CReplayAnalysis::enabled) {
 		// everything here is unsynced and should ideally moved to Game::Update()
 		waitCommandsAI.Update();
 		geometricObjects->Update();
@@ -1456,27 +1574,42 @@ void CGame::SimFrame() {
 	}
 
 	// everything from here is simulation
+	simTelemetry.BeginFrame();
 	{
 		SCOPED_TIMER("EventHandler::GameFrame");
 		eventHandler.GameFrame(gs->frameNum);
+		simTelemetry.Lap(CSimTelemetry::STAGE_GAMEFRAME);
 	}
 	{
 		SCOPED_TIMER("SimFrame");
 		helper->Update();
+		simTelemetry.Lap(CSimTelemetry::STAGE_HELPER);
 		mapDamage->Update();
+		simTelemetry.Lap(CSimTelemetry::STAGE_MAPDAMAGE);
 		pathManager->Update();
+		simTelemetry.Lap(CSimTelemetry::STAGE_PATHING);
 		unitHandler->Update();
+		simTelemetry.Lap(CSimTelemetry::STAGE_UNITS);
 		projectileHandler->Update();
+		simTelemetry.Lap(CSimTelemetry::STAGE_PROJECTILES);
 		featureHandler->Update();
+		simTelemetry.Lap(CSimTelemetry::STAGE_FEATURES);
 		GCobEngine.Tick(33);
 		GUnitScriptEngine.Tick(33);
+		simTelemetry.Lap(CSimTelemetry::STAGE_SCRIPTS);
 		wind.Update();
 		losHandler->Update();
+		simTelemetry.Lap(CSimTelemetry::STAGE_LOS);
 		interceptHandler.Update(false);
 
 		teamHandler->GameFrame(gs->frameNum);
 		playerHandler->GameFrame(gs->frameNum);
 	}
+	simTelemetry.EndFrame(gs->frameNum);
+	syncChecksumStream.Update(gs->frameNum);
+
+	// async AIs run until the next net message is processed
+	eoh->RunAsyncAIs();
 
 	lastSimFrameTime = spring_gettime();
 	gu->avgSimFrameTime = mix(gu->avgSimFrameTime, (lastSimFrameTime - lastFrameTime).toMilliSecsf(), 0.05f);
@@ -1485,7 +1618,7 @@ void CGame::SimFrame() {
 	eventHandler.DbgTimingInfo(TIMING_SIM, lastFrameTime, lastSimFrameTime);
 
 	#ifdef HEADLESS
-	{
+	if (!CReplayAnalysis::enabled) {
 		const float msecMaxSimFrameTime = 1000.0f / (GAME_SPEED * gs->wantedSpeedFactor);
 		const float msecDifSimFrameTime = (lastSimFrameTime - lastFrameTime).toMilliSecsf();
 		// multiply by 0.5 to give unsynced code some execution time (50% of our sleep-budget)
@@ -20,6 +20,7 @@ class ILoadSaveHandler;
 class Action;
 class ChatMessage;
 class CWorldDrawer;
+class CReplayAnalysis;
 
 
 class CGame : public CGameController
@@ -221,6 +222,9 @@ private:
 
 	LuaParser* defsParser;
 
+	/// only in replay analysis mode, torn down with the game
+	CReplayAnalysis* replayAnalysis;
+
 	/// for reloading the savefile
 	ILoadSaveHandler* saveFile;
 
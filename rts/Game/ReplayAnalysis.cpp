@@ -0,0 +1,254 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include <algorithm>
+#include <cstdio>
+
+#include "ReplayAnalysis.h"
+
+#include "GameSetup.h"
+#include "GlobalUnsynced.h"
+#include "SimTelemetry.h"
+#include "UI/GuiHandler.h"
+#include "Net/GameServer.h"
+#include "Sim/Misc/GlobalSynced.h"
+#include "Sim/Misc/Team.h"
+#include "Sim/Misc/TeamHandler.h"
+#include "System/Log/ILog.h"
+#include "System/Sync/SyncChecker.h"
+
+bool CReplayAnalysis::enabled = false;
+std::string CReplayAnalysis::outputFile = "replay_analysis.json";
+
+// the local client still throttles the server, this is just "unlimited"
+static const char* MAX_REPLAY_SPEED = "1000";
+// how long to wait for more frames after the demo stream ended
+static const float DEMO_END_TIMEOUT = 2000.0f;
+
+
+static std::string EscapeJSON(const std::string& str)
+{
+	std::string ret;
+	ret.reserve(str.size());
+
+	for (const char c: str) {
+		if (c == '"' || c == '\\')
+			ret += '\\';
+		ret += c;
+	}
+
+	return ret;
+}
+
+// null without SYNCCHECK, there is nothing to compare then
+static std::string FormatChecksum(unsigned int checksum)
+{
+#ifdef SYNCCHECK
+	char buf[16];
+	snprintf(buf, sizeof(buf), "\"%08x\"", checksum);
+	return buf;
+#else
+	return "null";
+#endif
+}
+
+
+CReplayAnalysis::CReplayAnalysis()
+	: CEventClient("[CReplayAnalysis]", 271991, false)
+	, startTime(spring_gettime())
+	, lastFrameTime(spring_gettime())
+	, runningChecksum(0)
+	, finished(false)
+{
+	eventHandler.AddClient(this);
+	simTelemetry.CollectTotals();
+}
+
+CReplayAnalysis::~CReplayAnalysis()
+{
+	eventHandler.RemoveClient(this);
+}
+
+
+void CReplayAnalysis::GameFrame(int gameFrame)
+{
+	lastFrameTime = spring_gettime();
+
+	if (gameFrame == 0) {
+		std::vector<std::string> cmds;
+		cmds.push_back(std::string("@@setmaxspeed ") + MAX_REPLAY_SPEED);
+		cmds.push_back(std::string("@@setminspeed ") + MAX_REPLAY_SPEED);
+		guihandler->RunCustomCommands(cmds, false);
+		return;
+	}
+
+	if ((gameFrame % (60 * GAME_SPEED)) == 0)
+		AddMinuteSample(gameFrame);
+}
+
+void CReplayAnalysis::GameOver(const std::vector<unsigned char>& winningAllyTeams)
+{
+	winners = winningAllyTeams;
+	Finish(true);
+}
+
+void CReplayAnalysis::Update()
+{
+	if (finished || gameServer == NULL)
+		return;
+	// a scripted game has to end itself
+	if (!gameSetup->hostDemo)
+		return;
+	// demo reader is released once the server sent the whole stream
+	if (gameServer->GetDemoReader() != NULL)
+		return;
+	if ((spring_gettime() - lastFrameTime).toMilliSecsf() < DEMO_END_TIMEOUT)
+		return;
+
+	// no GAMEOVER in the demo, e.g. everybody left or the host crashed
+	Finish(false);
+}
+
+void CReplayAnalysis::DbgTimingInfo(DbgTimingInfoType type, const spring_time start, const spring_time end)
+{
+	if (type != TIMING_SIM)
+		return;
+
+	frameTimes.push_back((end - start).toMilliSecsf());
+
+#ifdef SYNCCHECK
+	// the sync checksum only covers the frames since the last reset (see
+	// NetCommands.cpp), fold it in at the end of every frame instead
+	const unsigned int checksum = CSyncChecker::GetChecksum();
+	runningChecksum ^= checksum + 0x9e3779b9 + (runningChecksum << 6) + (runningChecksum >> 2);
+#endif
+}
+
+
+void CReplayAnalysis::AddMinuteSample(int frameNum)
+{
+	MinuteSample sample;
+	sample.frameNum = frameNum;
+	sample.simTime = 0.0f;
+	sample.maxFrameTime = 0.0f;
+
+	// GameFrame runs before the frame is simulated, so this covers all
+	// frames up to the previous one
+	sample.checksum = runningChecksum;
+
+	const size_t firstFrame = minutes.empty()? 0: minutes.back().frameNum;
+	const size_t lastFrame = std::min(frameTimes.size(), size_t(frameNum));
+
+	for (size_t n = firstFrame; n < lastFrame; n++) {
+		sample.simTime += frameTimes[n];
+		sample.maxFrameTime = std::max(sample.maxFrameTime, frameTimes[n]);
+	}
+
+	minutes.push_back(sample);
+}
+
+void CReplayAnalysis::Finish(bool gameOver)
+{
+	if (finished)
+		return;
+
+	finished = true;
+
+	if (WriteResults(gameOver)) {
+		LOG("[%s] wrote results for %d frames to \"%s\"", __FUNCTION__, gs->frameNum + 1, outputFile.c_str());
+	} else {
+		LOG_L(L_ERROR, "[%s] could not write \"%s\"", __FUNCTION__, outputFile.c_str());
+	}
+
+	gu->globalQuit = true;
+}
+
+bool CReplayAnalysis::WriteResults(bool gameOver) const
+{
+	FILE* file = fopen(outputFile.c_str(), "w");
+
+	if (file == NULL)
+		return false;
+
+	std::vector<float> sortedTimes(frameTimes);
+	std::sort(sortedTimes.begin(), sortedTimes.end());
+
+	float totalTime = 0.0f;
+	for (const float t: frameTimes) {
+		totalTime += t;
+	}
+
+	#define PERCENTILE(p) (sortedTimes.empty()? 0.0f: sortedTimes[(sortedTimes.size() - 1) * p / 100])
+
+	fprintf(file, "{\n");
+	fprintf(file, "\t\"demo\": \"%s\",\n", EscapeJSON((gameSetup != NULL)? gameSetup->demoName: "").c_str());
+	fprintf(file, "\t\"frames\": %d,\n", gs->frameNum + 1);
+	fprintf(file, "\t\"gameOver\": %s,\n", gameOver? "true": "false");
+	fprintf(file, "\t\"syncChecksums\": %s,\n",
+#ifdef SYNCCHECK
+		"true"
+#else
+		"false"
+#endif
+	);
+	fprintf(file, "\t\"wallTime\": %.3f,\n", (spring_gettime() - startTime).toSecsf());
+
+	fprintf(file, "\t\"winningAllyTeams\": [");
+	for (size_t n = 0; n < winners.size(); n++) {
+		fprintf(file, "%s%d", (n > 0)? ", ": "", int(winners[n]));
+	}
+	fprintf(file, "],\n");
+
+	fprintf(file, "\t\"simTime\": {\"total\": %.3f, \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f},\n",
+		totalTime,
+		frameTimes.empty()? 0.0f: totalTime / frameTimes.size(),
+		PERCENTILE(50), PERCENTILE(95), PERCENTILE(99), PERCENTILE(100));
+
+	#undef PERCENTILE
+
+	fprintf(file, "\t\"minutes\": [\n");
+	for (size_t n = 0; n < minutes.size(); n++) {
+		const MinuteSample& m = minutes[n];
+		fprintf(file, "\t\t{\"frame\": %d, \"checksum\": %s, \"simTime\": %.3f, \"maxFrameTime\": %.4f}%s\n",
+			m.frameNum, FormatChecksum(m.checksum).c_str(), m.simTime, m.maxFrameTime, (n + 1 < minutes.size())? ",": "");
+	}
+	fprintf(file, "\t],\n");
+
+	// every simulated frame folded in, same build + same input gives the same value
+	fprintf(file, "\t\"finalChecksum\": %s,\n", FormatChecksum(runningChecksum).c_str());
+
+	// ms spent in each part of SimFrame over the whole game
+	fprintf(file, "\t\"stages\": {");
+	for (int n = 0; n < CSimTelemetry::NUM_STAGES; n++) {
+		const CSimTelemetry::Stage stage = CSimTelemetry::Stage(n);
+		fprintf(file, "%s\"%s\": %.3f", (n > 0)? ", ": "", CSimTelemetry::GetStageName(stage), simTelemetry.GetTotalTime(stage));
+	}
+	fprintf(file, "},\n");
+
+	// Gaia has no statistics worth reporting
+	const int numTeams = teamHandler->ActiveTeams() - int(gs->useLuaGaia);
+
+	fprintf(file, "\t\"teams\": [\n");
+	for (int i = 0; i < numTeams; i++) {
+		const CTeam* team = teamHandler->Team(i);
+		const TeamStatistics& s = team->GetCurrentStats();
+
+		fprintf(file, "\t\t{\"team\": %d, \"allyTeam\": %d, \"isDead\": %s,", i, teamHandler->AllyTeam(i), team->isDead? "true": "false");
+		fprintf(file, " \"metalUsed\": %.1f, \"energyUsed\": %.1f, \"metalProduced\": %.1f, \"energyProduced\": %.1f,", s.metalUsed, s.energyUsed, s.metalProduced, s.energyProduced);
+		fprintf(file, " \"metalExcess\": %.1f, \"energyExcess\": %.1f, \"metalReceived\": %.1f, \"energyReceived\": %.1f,", s.metalExcess, s.energyExcess, s.metalReceived, s.energyReceived);
+		fprintf(file, " \"metalSent\": %.1f, \"energySent\": %.1f, \"damageDealt\": %.1f, \"damageReceived\": %.1f,", s.metalSent, s.energySent, s.damageDealt, s.damageReceived);
+		fprintf(file, " \"unitsProduced\": %d, \"unitsDied\": %d, \"unitsReceived\": %d, \"unitsSent\": %d,", s.unitsProduced, s.unitsDied, s.unitsReceived, s.unitsSent);
+		fprintf(file, " \"unitsCaptured\": %d, \"unitsOutCaptured\": %d, \"unitsKilled\": %d}%s\n", s.unitsCaptured, s.unitsOutCaptured, s.unitsKilled, (i + 1 < numTeams)? ",": "");
+	}
+	fprintf(file, "\t],\n");
+
+	// one entry per SimFrame, in ms
+	fprintf(file, "\t\"frameTimes\": [");
+	for (size_t n = 0; n < frameTimes.size(); n++) {
+		fprintf(file, "%s%.3f", (n > 0)? ",": "", frameTimes[n]);
+	}
+	fprintf(file, "]\n");
+	fprintf(file, "}\n");
+
+	fclose(file);
+	return true;
+}
@@ -0,0 +1,81 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _REPLAY_ANALYSIS_H
+#define _REPLAY_ANALYSIS_H
+
+#include <string>
+#include <vector>
+
+#include "System/EventHandler.h"
+
+
+/**
+ * @brief Replays a demo as fast as possible and writes the results as JSON
+ * Enabled by --replay-analysis, meant for the headless build. The game
+ * runs without LuaUI and without the unsynced per-frame work, the speed
+ * is only limited by how fast the local client can simulate. Once the
+ * game is over (or the demo ran out) the team statistics, one sync
+ * checksum per game minute, the final checksum (both null in builds
+ * without SYNCCHECK), the time spent in each
+ * SimFrame stage and the time every SimFrame took are written to the
+ * output file and the engine quits.
+ *
+ * A start script works too, the game then has to end itself (GameOver).
+ *
+ * tools/DemoTool/replay_analysis.py runs many demos this way in parallel,
+ * tools/benchmark/sim/simbench.sh uses it for scripted sim benchmarks.
+ */
+class CReplayAnalysis : public CEventClient
+{
+public:
+	static bool enabled;
+	static std::string outputFile;
+
+public:
+	CReplayAnalysis();
+	~CReplayAnalysis();
+
+	// CEventClient interface
+	bool WantsEvent(const std::string& eventName) {
+		return
+			(eventName == "GameFrame") ||
+			(eventName == "GameOver") ||
+			(eventName == "Update") ||
+			(eventName == "DbgTimingInfo");
+	}
+	bool GetFullRead() const { return true; }
+	int  GetReadAllyTeam() const { return AllAccessTeam; }
+
+	void GameFrame(int gameFrame);
+	void GameOver(const std::vector<unsigned char>& winningAllyTeams);
+	void Update();
+	void DbgTimingInfo(DbgTimingInfoType type, const spring_time start, const spring_time end);
+
+private:
+	struct MinuteSample {
+		int frameNum;
+		unsigned int checksum;
+		float simTime;    ///< ms spent in SimFrame during this minute
+		float maxFrameTime;
+	};
+
+	void AddMinuteSample(int frameNum);
+	void Finish(bool gameOver);
+	bool WriteResults(bool gameOver) const;
+
+private:
+	/// ms per SimFrame, indexed by frame number
+	std::vector<float> frameTimes;
+	std::vector<MinuteSample> minutes;
+	std::vector<unsigned char> winners;
+
+	spring_time startTime;
+	spring_time lastFrameTime;
+
+	/// sync checksums of all simulated frames folded together
+	unsigned int runningChecksum;
+
+	bool finished;
+};
+
+#endif // _REPLAY_ANALYSIS_H
@@ -0,0 +1,206 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <boost/asio.hpp>
+
+#include "SimTelemetry.h"
+
+#include "GlobalUnsynced.h"
+#include "Net/Protocol/NetProtocol.h"
+#include "Sim/Features/FeatureHandler.h"
+#include "Sim/Misc/GlobalSynced.h"
+#include "Sim/Projectiles/ProjectileHandler.h"
+#include "Sim/Units/UnitHandler.h"
+#include "System/Config/ConfigHandler.h"
+#include "System/FileSystem/DataDirsAccess.h"
+#include "System/FileSystem/FileQueryFlags.h"
+#include "System/Log/ILog.h"
+#include "System/Net/Socket.h"
+#include "lib/lua/include/LuaUser.h"
+
+CONFIG(std::string, SimTelemetryFile).defaultValue("")
+	.description("Where to stream SimFrame statistics (one JSON object per line) to; a file in the write-dir or unix:<path> for a Unix datagram socket. Empty disables.");
+CONFIG(int, SimTelemetryInterval).defaultValue(30).minimumValue(1)
+	.description("Number of SimFrames summed up in one telemetry record.");
+
+CSimTelemetry simTelemetry;
+
+static const char* SOCKET_PREFIX = "unix:";
+
+static const char* STAGE_NAMES[CSimTelemetry::NUM_STAGES] = {
+	"gameFrame",
+	"helper",
+	"mapDamage",
+	"pathing",
+	"units",
+	"projectiles",
+	"features",
+	"scripts",
+	"los",
+	"other",
+};
+
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+struct CSimTelemetry::Socket {
+	Socket(const std::string& path)
+		: socket(netcode::netservice)
+		, endpoint(path)
+	{
+		socket.open();
+		socket.non_blocking(true);
+	}
+
+	/// returns false if the record was dropped
+	bool Send(const char* buf, size_t len) {
+		boost::system::error_code err;
+		socket.send_to(boost::asio::buffer(buf, len), endpoint, 0, err);
+		return !err;
+	}
+
+	boost::asio::local::datagram_protocol::socket socket;
+	boost::asio::local::datagram_protocol::endpoint endpoint;
+};
+#else
+struct CSimTelemetry::Socket {
+	Socket(const std::string& path) {
+		throw std::runtime_error("Unix sockets are not supported on this platform");
+	}
+	bool Send(const char* buf, size_t len) { return false; }
+};
+#endif
+
+
+
+CSimTelemetry::CSimTelemetry()
+	: interval(1)
+	, numFrames(0)
+	, isOpen(false)
+	, collectTotals(false)
+	, file(NULL)
+	, socket(NULL)
+{
+	ResetRecord();
+	std::fill(totalTimes, totalTimes + NUM_STAGES, 0.0f);
+}
+
+CSimTelemetry::~CSimTelemetry()
+{
+	Close();
+}
+
+
+void CSimTelemetry::Open()
+{
+	Close();
+
+	const std::string sink = configHandler->GetString("SimTelemetryFile");
+
+	if (sink.empty())
+		return;
+
+	interval = configHandler->GetInt("SimTelemetryInterval");
+
+	if (sink.compare(0, strlen(SOCKET_PREFIX), SOCKET_PREFIX) == 0) {
+		try {
+			socket = new Socket(sink.substr(strlen(SOCKET_PREFIX)));
+		} catch (const std::exception& ex) {
+			LOG_L(L_ERROR, "[%s] could not open socket %s: %s", __FUNCTION__, sink.c_str(), ex.what());
+			return;
+		}
+	} else {
+		const std::string fileName = dataDirsAccess.LocateFile(sink, FileQueryFlags::WRITE);
+
+		if ((file = fopen(fileName.c_str(), "w")) == NULL) {
+			LOG_L(L_ERROR, "[%s] could not open %s", __FUNCTION__, fileName.c_str());
+			return;
+		}
+	}
+
+	LOG("[%s] streaming SimFrame statistics to %s every %d frames", __FUNCTION__, sink.c_str(), interval);
+
+	isOpen = true;
+	numFrames = 0;
+	ResetRecord();
+}
+
+void CSimTelemetry::Close()
+{
+	if (file != NULL)
+		fclose(file);
+
+	delete socket;
+
+	file = NULL;
+	socket = NULL;
+	isOpen = false;
+}
+
+
+const char* CSimTelemetry::GetStageName(Stage stage)
+{
+	return STAGE_NAMES[stage];
+}
+
+void CSimTelemetry::ResetRecord()
+{
+	std::fill(stageTimes, stageTimes + NUM_STAGES, 0.0f);
+	maxFrameTime = 0.0f;
+}
+
+void CSimTelemetry::EndFrame(int frameNum)
+{
+	Lap(STAGE_OTHER);
+
+	if (!isOpen)
+		return;
+
+	maxFrameTime = std::max(maxFrameTime, (lapStart - frameStart).toMilliSecsf());
+
+	if ((++numFrames % interval) != 0)
+		return;
+
+	WriteRecord(frameNum);
+	ResetRecord();
+}
+
+void CSimTelemetry::WriteRecord(int frameNum)
+{
+	SLuaInfo luaInfo;
+	spring_lua_alloc_get_stats(&luaInfo);
+
+	char buf[1024];
+	int len = 0;
+
+	len += snprintf(buf + len, sizeof(buf) - len, "{\"frame\": %d, \"frames\": %d, \"stages\": {", frameNum, interval);
+
+	for (int n = 0; n < NUM_STAGES; n++) {
+		len += snprintf(buf + len, sizeof(buf) - len, "%s\"%s\": %.3f", (n > 0)? ", ": "", STAGE_NAMES[n], stageTimes[n]);
+	}
+
+	len += snprintf(buf + len, sizeof(buf) - len,
+		"}, \"maxFrameTime\": %.3f, \"units\": %u, \"projectiles\": %u, \"features\": %u, "
+		"\"luaAllocedBytes\": %u, \"luaStates\": %u, \"netQueue\": %u, \"speedFactor\": %.3f}\n",
+		maxFrameTime,
+		unsigned(unitHandler->activeUnits.size()),
+		unsigned(projectileHandler->syncedProjectiles.size() + projectileHandler->unsyncedProjectiles.size()),
+		unsigned(featureHandler->GetActiveFeatures().size()),
+		luaInfo.allocedBytes,
+		luaInfo.numLuaStates,
+		(clientNet != NULL)? clientNet->GetNumWaitingServerPackets(): 0u,
+		gs->speedFactor
+	);
+
+	len = std::min(len, int(sizeof(buf) - 1));
+
+	if (file != NULL) {
+		fwrite(buf, 1, len, file);
+		fflush(file);
+	}
+	if (socket != NULL) {
+		socket->Send(buf, len);
+	}
+}
@@ -0,0 +1,98 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _SIM_TELEMETRY_H
+#define _SIM_TELEMETRY_H
+
+#include <cstdio>
+#include <string>
+
+#include "System/Misc/SpringTime.h"
+
+
+/**
+ * @brief Streams per-SimFrame statistics while a game is running
+ * Set SimTelemetryFile to a file name (relative to the write-dir) or to
+ * "unix:<path>" to send to a Unix datagram socket. Every
+ * SimTelemetryInterval frames one JSON object (one line) is written with
+ * the time spent in each SimFrame stage, the object counts, Lua memory
+ * and the number of packets waiting from the server. A socket never
+ * blocks the sim: records are dropped when nobody is listening.
+ *
+ * Lap() is called after every stage; it does nothing unless a sink is open
+ * or the totals were asked for (see CReplayAnalysis).
+ */
+class CSimTelemetry
+{
+public:
+	enum Stage {
+		STAGE_GAMEFRAME,  ///< the GameFrame event (mostly Lua)
+		STAGE_HELPER,
+		STAGE_MAPDAMAGE,
+		STAGE_PATHING,
+		STAGE_UNITS,
+		STAGE_PROJECTILES,
+		STAGE_FEATURES,
+		STAGE_SCRIPTS,
+		STAGE_LOS,
+		STAGE_OTHER,
+		NUM_STAGES
+	};
+
+public:
+	CSimTelemetry();
+	~CSimTelemetry();
+
+	/// opens the sink set in the config, if any
+	void Open();
+	void Close();
+	bool IsOpen() const { return isOpen; }
+
+	/// sum up the stage times of the whole game, even without a sink
+	void CollectTotals() { collectTotals = true; }
+	/// ms spent in the given stage since CollectTotals was called
+	float GetTotalTime(Stage stage) const { return totalTimes[stage]; }
+	static const char* GetStageName(Stage stage);
+
+	void BeginFrame() {
+		if (!isOpen && !collectTotals)
+			return;
+		frameStart = spring_gettime();
+		lapStart = frameStart;
+	}
+	void Lap(Stage stage) {
+		if (!isOpen && !collectTotals)
+			return;
+		const spring_time now = spring_gettime();
+		const float dt = (now - lapStart).toMilliSecsf();
+		stageTimes[stage] += dt;
+		totalTimes[stage] += dt;
+		lapStart = now;
+	}
+	void EndFrame(int frameNum);
+
+private:
+	void ResetRecord();
+	void WriteRecord(int frameNum);
+
+private:
+	int interval;
+	int numFrames;
+	bool isOpen;
+	bool collectTotals;
+
+	FILE* file;
+	/// keeps boost::asio out of this header
+	struct Socket;
+	Socket* socket;
+
+	spring_time frameStart;
+	spring_time lapStart;
+
+	float stageTimes[NUM_STAGES];
+	float totalTimes[NUM_STAGES];
+	float maxFrameTime;
+};
+
+extern CSimTelemetry simTelemetry;
+
+#endif // _SIM_TELEMETRY_H
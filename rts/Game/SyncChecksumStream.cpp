@@ -0,0 +1,303 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include <algorithm>
+#include <cstring>
+
+#include "SyncChecksumStream.h"
+
+#include "GameSetup.h"
+#include "Lua/LuaHandleSynced.h"
+#include "Net/Protocol/NetProtocol.h"
+#include "Sim/Features/Feature.h"
+#include "Sim/Features/FeatureDef.h"
+#include "Sim/Features/FeatureHandler.h"
+#include "Sim/Misc/GlobalConstants.h"
+#include "Sim/Misc/GlobalSynced.h"
+#include "Sim/Misc/LosHandler.h"
+#include "Sim/Misc/TeamHandler.h"
+#include "Sim/MoveTypes/GroundMoveType.h"
+#include "Sim/Projectiles/Projectile.h"
+#include "Sim/Projectiles/ProjectileHandler.h"
+#include "Sim/Units/Unit.h"
+#include "Sim/Units/UnitDef.h"
+#include "Sim/Units/UnitHandler.h"
+#include "System/Config/ConfigHandler.h"
+#include "System/FileSystem/DataDirsAccess.h"
+#include "System/FileSystem/FileQueryFlags.h"
+#include "System/FileSystem/FileSystem.h"
+#include "System/LoadSave/DemoRecorder.h"
+#include "System/Log/ILog.h"
+#include "System/Sync/HsiehHash.h"
+
+CONFIG(bool, SyncChecksumStream).defaultValue(false)
+	.description("Write per-subsystem checksums of the synced state for every SimFrame to a .sync file next to the demo, for finding where a desync started (tools/DemoTool/sync_diff.py).");
+
+CSyncChecksumStream syncChecksumStream;
+
+static const char FILE_MAGIC[8] = {'S', 'P', 'R', 'S', 'Y', 'N', 'C', '\0'};
+
+static const char* SUBSYSTEM_NAMES[CSyncChecksumStream::NUM_SUBSYSTEMS] = {
+	"units",
+	"projectiles",
+	"features",
+	"los",
+	"path",
+	"luarules",
+	"rng",
+};
+
+
+// only ever hash single values, structs could have padding in them
+template<typename T>
+static inline unsigned int Hash(unsigned int hash, const T& v) {
+	return HsiehHash(&v, sizeof(T), hash);
+}
+
+static inline unsigned int Hash(unsigned int hash, const float3& v) {
+	hash = Hash(hash, v.x);
+	hash = Hash(hash, v.y);
+	hash = Hash(hash, v.z);
+	return hash;
+}
+
+static unsigned int Hash(unsigned int hash, const LuaRulesParams::Params& params) {
+	hash = Hash(hash, unsigned(params.size()));
+
+	for (const LuaRulesParams::Param& param: params) {
+		hash = Hash(hash, param.los);
+		hash = Hash(hash, param.valueInt);
+		hash = HsiehHash(param.valueString.data(), param.valueString.size(), hash);
+	}
+
+	return hash;
+}
+
+
+
+CSyncChecksumStream::CSyncChecksumStream(): file(NULL)
+{
+	std::fill(checksums, checksums + NUM_SUBSYSTEMS, 0u);
+}
+
+CSyncChecksumStream::~CSyncChecksumStream()
+{
+	Close();
+}
+
+
+void CSyncChecksumStream::Open()
+{
+	Close();
+
+	if (!configHandler->GetBool("SyncChecksumStream"))
+		return;
+
+	std::string fileName;
+
+	if (clientNet != NULL && clientNet->GetDemoRecorder() != NULL) {
+		const std::string& demoName = clientNet->GetDemoRecorder()->GetName();
+		fileName = demoName.substr(0, demoName.find_last_of('.')) + ".sync";
+	} else if (gameSetup != NULL && gameSetup->hostDemo) {
+		// a replay, written next to the demos of this machine
+		if (!FileSystem::CreateDirectory("demos/"))
+			return;
+
+		fileName = dataDirsAccess.LocateFile("demos/" + FileSystem::GetBasename(gameSetup->demoName) + "_replay.sync", FileQueryFlags::WRITE);
+	} else {
+		LOG_L(L_WARNING, "[%s] no demo is recorded or watched, not writing sync checksums", __FUNCTION__);
+		return;
+	}
+
+	if ((file = fopen(fileName.c_str(), "wb")) == NULL) {
+		LOG_L(L_ERROR, "[%s] could not open %s", __FUNCTION__, fileName.c_str());
+		return;
+	}
+
+	const unsigned int header[2] = {VERSION, NUM_SUBSYSTEMS};
+
+	fwrite(FILE_MAGIC, sizeof(FILE_MAGIC), 1, file);
+	fwrite(header, sizeof(header), 1, file);
+
+	for (int n = 0; n < NUM_SUBSYSTEMS; n++) {
+		fwrite(SUBSYSTEM_NAMES[n], strlen(SUBSYSTEM_NAMES[n]) + 1, 1, file);
+	}
+
+	std::fill(checksums, checksums + NUM_SUBSYSTEMS, 0u);
+
+	LOG("[%s] writing per-subsystem sync checksums to %s", __FUNCTION__, fileName.c_str());
+}
+
+void CSyncChecksumStream::Close()
+{
+	if (file != NULL)
+		fclose(file);
+
+	file = NULL;
+}
+
+
+const char* CSyncChecksumStream::GetSubsystemName(Subsystem subsys)
+{
+	return SUBSYSTEM_NAMES[subsys];
+}
+
+
+void CSyncChecksumStream::Update(int frameNum)
+{
+	if (file == NULL)
+		return;
+
+	checksums[SUBSYS_UNITS      ] = HashUnits      (checksums[SUBSYS_UNITS      ]);
+	checksums[SUBSYS_PROJECTILES] = HashProjectiles(checksums[SUBSYS_PROJECTILES]);
+	checksums[SUBSYS_FEATURES   ] = HashFeatures   (checksums[SUBSYS_FEATURES   ]);
+	checksums[SUBSYS_LOS        ] = HashLos        (checksums[SUBSYS_LOS        ], (frameNum % LOS_FRAME_INTERVAL) == 0);
+	checksums[SUBSYS_PATH       ] = HashPath       (checksums[SUBSYS_PATH       ]);
+	checksums[SUBSYS_LUARULES   ] = HashLuaRules   (checksums[SUBSYS_LUARULES   ]);
+	checksums[SUBSYS_RNG        ] = HashRNG        (checksums[SUBSYS_RNG        ]);
+
+	const boost::int32_t frame = frameNum;
+
+	fwrite(&frame, sizeof(frame), 1, file);
+	fwrite(checksums, sizeof(checksums), 1, file);
+
+	// a desync is often followed by a crash, lose at most a second
+	if ((frameNum % GAME_SPEED) == 0)
+		fflush(file);
+}
+
+
+unsigned int CSyncChecksumStream::HashUnits(unsigned int hash) const
+{
+	hash = Hash(hash, unsigned(unitHandler->activeUnits.size()));
+
+	for (const CUnit* unit: unitHandler->activeUnits) {
+		hash = Hash(hash, unit->id);
+		hash = Hash(hash, unit->unitDef->id);
+		hash = Hash(hash, unit->team);
+		hash = Hash(hash, unit->allyteam);
+		hash = Hash(hash, unit->pos);
+		hash = Hash(hash, static_cast<const float3&>(unit->speed));
+		hash = Hash(hash, short(unit->heading));
+		hash = Hash(hash, unit->health);
+		hash = Hash(hash, unit->experience);
+		hash = Hash(hash, unit->buildProgress);
+		hash = Hash(hash, unit->beingBuilt);
+	}
+
+	return hash;
+}
+
+unsigned int CSyncChecksumStream::HashProjectiles(unsigned int hash) const
+{
+	const ProjectileContainer& projectiles = projectileHandler->syncedProjectiles;
+
+	hash = Hash(hash, unsigned(projectiles.size()));
+
+	for (const CProjectile* p: projectiles) {
+		hash = Hash(hash, p->id);
+		hash = Hash(hash, p->GetProjectileType());
+		hash = Hash(hash, p->GetOwnerID());
+		hash = Hash(hash, p->pos);
+		hash = Hash(hash, static_cast<const float3&>(p->speed));
+		hash = Hash(hash, p->deleteMe);
+	}
+
+	return hash;
+}
+
+unsigned int CSyncChecksumStream::HashFeatures(unsigned int hash) const
+{
+	const CFeatureSet& features = featureHandler->GetActiveFeatures();
+
+	hash = Hash(hash, unsigned(features.size()));
+
+	for (const CFeature* f: features) {
+		hash = Hash(hash, f->id);
+		hash = Hash(hash, f->def->id);
+		hash = Hash(hash, f->team);
+		hash = Hash(hash, f->pos);
+		hash = Hash(hash, f->health);
+		hash = Hash(hash, f->reclaimLeft);
+	}
+
+	return hash;
+}
+
+unsigned int CSyncChecksumStream::HashLos(unsigned int hash, bool withMaps) const
+{
+	const int numAllyTeams = teamHandler->ActiveAllyTeams();
+
+	for (int allyTeam = 0; allyTeam < numAllyTeams; allyTeam++) {
+		hash = Hash(hash, losHandler->globalLOS[allyTeam]);
+		hash = Hash(hash, losHandler->GetAllyTeamRadarErrorSize(allyTeam));
+	}
+
+	// the maps are large, hashing all of them every frame would slow the
+	// game down noticeably
+	if (!withMaps)
+		return hash;
+
+	const ILosType* losTypes[] = {
+		&losHandler->los,
+		&losHandler->airLos,
+		&losHandler->radar,
+		&losHandler->sonar,
+		&losHandler->seismic,
+		&losHandler->jammer,
+		&losHandler->sonarJammer,
+	};
+
+	for (const ILosType* losType: losTypes) {
+		for (const CLosMap& losMap: losType->losMaps) {
+			const std::vector<unsigned short>& data = losMap.GetData();
+			hash = HsiehHash(data.data(), data.size() * sizeof(data[0]), hash);
+		}
+	}
+
+	return hash;
+}
+
+unsigned int CSyncChecksumStream::HashPath(unsigned int hash) const
+{
+	for (const CUnit* unit: unitHandler->activeUnits) {
+		const AMoveType* moveType = unit->moveType;
+
+		if (moveType == NULL)
+			continue;
+
+		hash = Hash(hash, unit->id);
+		hash = Hash(hash, moveType->goalPos);
+		hash = Hash(hash, int(moveType->progressState));
+
+		const CGroundMoveType* groundMoveType = dynamic_cast<const CGroundMoveType*>(moveType);
+
+		if (groundMoveType == NULL)
+			continue;
+
+		hash = Hash(hash, groundMoveType->GetPathID());
+		hash = Hash(hash, float3(groundMoveType->GetCurrWayPoint()));
+		hash = Hash(hash, float3(groundMoveType->GetNextWayPoint()));
+	}
+
+	return hash;
+}
+
+unsigned int CSyncChecksumStream::HashLuaRules(unsigned int hash) const
+{
+	hash = Hash(hash, CLuaHandleSynced::GetGameParams());
+
+	for (int team = 0; team < teamHandler->ActiveTeams(); team++) {
+		hash = Hash(hash, teamHandler->Team(team)->modParams);
+	}
+
+	for (const CUnit* unit: unitHandler->activeUnits) {
+		hash = Hash(hash, unit->modParams);
+	}
+
+	return hash;
+}
+
+unsigned int CSyncChecksumStream::HashRNG(unsigned int hash) const
+{
+	return Hash(hash, gs->GetRandSeed());
+}
@@ -0,0 +1,76 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _SYNC_CHECKSUM_STREAM_H
+#define _SYNC_CHECKSUM_STREAM_H
+
+#include <cstdio>
+
+
+/**
+ * @brief Writes per-subsystem checksums of the synced state every SimFrame
+ * Enabled by SyncChecksumStream, works in any build. Next to the demo being
+ * recorded (or, when watching a demo, next to a _replay copy of its name in
+ * demos/) a .sync file is written with one checksum per subsystem for every
+ * frame. The checksums roll: each frame's hash is seeded with the one of
+ * the frame before, so once a subsystem diverged it stays different even if
+ * its state happens to converge again.
+ *
+ * tools/DemoTool/sync_diff.py compares two such files and reports the first
+ * frame and the subsystems that differ.
+ *
+ * File format (host byte order):
+ *   char[8]  "SPRSYNC\0"
+ *   uint32   version
+ *   uint32   number of subsystems
+ *   char[]   subsystem names, each NUL terminated
+ *   then per frame: int32 frame number, uint32 checksum per subsystem
+ */
+class CSyncChecksumStream
+{
+public:
+	enum Subsystem {
+		SUBSYS_UNITS,
+		SUBSYS_PROJECTILES,
+		SUBSYS_FEATURES,
+		SUBSYS_LOS,         ///< LOS maps only every LOS_FRAME_INTERVAL frames
+		SUBSYS_PATH,        ///< move goals, paths and waypoints of the units
+		SUBSYS_LUARULES,    ///< game, team and unit rules params
+		SUBSYS_RNG,
+		NUM_SUBSYSTEMS
+	};
+
+	static const unsigned int VERSION = 1;
+	static const int LOS_FRAME_INTERVAL = 30;
+
+public:
+	CSyncChecksumStream();
+	~CSyncChecksumStream();
+
+	/// opens the file if SyncChecksumStream is set
+	void Open();
+	void Close();
+	bool IsOpen() const { return (file != NULL); }
+
+	/// called at the end of every SimFrame
+	void Update(int frameNum);
+
+	static const char* GetSubsystemName(Subsystem subsys);
+
+private:
+	unsigned int HashUnits(unsigned int hash) const;
+	unsigned int HashProjectiles(unsigned int hash) const;
+	unsigned int HashFeatures(unsigned int hash) const;
+	unsigned int HashLos(unsigned int hash, bool withMaps) const;
+	unsigned int HashPath(unsigned int hash) const;
+	unsigned int HashLuaRules(unsigned int hash) const;
+	unsigned int HashRNG(unsigned int hash) const;
+
+private:
+	FILE* file;
+
+	unsigned int checksums[NUM_SUBSYSTEMS];
+};
+
+extern CSyncChecksumStream syncChecksumStream;
+
+#endif // _SYNC_CHECKSUM_STREAM_H
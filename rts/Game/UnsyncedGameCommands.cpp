@@ -82,6 +82,8 @@
 #include "System/Log/ILog.h"
 #include "System/GlobalConfig.h"
 #include "Net/Protocol/NetProtocol.h"
+#include "System/FileSystem/DataDirsAccess.h"
+#include "System/FileSystem/FileQueryFlags.h"
 #include "System/FileSystem/SimpleParser.h"
 #include "System/Sound/ISound.h"
 #include "System/Sound/ISoundChannels.h"
@@ -2844,6 +2846,49 @@ public:
 
 
 
+class ProfileTraceActionExecutor : public IUnsyncedActionExecutor {
+public:
+	ProfileTraceActionExecutor() : IUnsyncedActionExecutor("ProfileTrace",
+			"Record every profiled scope of every thread: start, or stop"
+			" [file] to write the trace to profiletraces/ in the write-dir"
+			" (chrome://tracing, ui.perfetto.dev)") {}
+
+	bool Execute(const UnsyncedAction& action) const {
+		const std::vector<std::string>& args = CSimpleParser::Tokenize(action.GetArgs(), 0);
+
+		if (args.size() == 1 && args[0] == "start") {
+			profiler.StartTrace();
+			LOG("[ProfileTrace] recording");
+			return true;
+		}
+
+		if ((args.size() == 1 || args.size() == 2) && args[0] == "stop") {
+			const std::string baseName = (args.size() == 2)? args[1]: "profile_trace.json";
+
+			// a bare file name only, the trace may not end up anywhere else
+			if (baseName.find_first_of("/\\:") != std::string::npos || baseName == "." || baseName == "..") {
+				LOG_L(L_WARNING, "[ProfileTrace] \"%s\" is not a plain file name", baseName.c_str());
+				return true;
+			}
+
+			const std::string fileName = dataDirsAccess.LocateFile("profiletraces/" + baseName, FileQueryFlags::WRITE | FileQueryFlags::CREATE_DIRS);
+			const int numEvents = profiler.StopTrace(fileName);
+
+			if (numEvents >= 0) {
+				LOG("[ProfileTrace] wrote %d events to \"%s\"", numEvents, fileName.c_str());
+			} else {
+				LOG_L(L_WARNING, "[ProfileTrace] could not write \"%s\"", fileName.c_str());
+			}
+			return true;
+		}
+
+		LOG_L(L_WARNING, "Give either of these as argument: start, stop [file]");
+		return true;
+	}
+};
+
+
+
 class RedirectToSyncedActionExecutor : public IUnsyncedActionExecutor {
 public:
 	RedirectToSyncedActionExecutor(const std::string& command)
@@ -3166,6 +3211,7 @@ void UnsyncedGameCommands::AddDefaultActionExecutors() {
 	AddActionExecutor(new ReloadGameActionExecutor());
 	AddActionExecutor(new ReloadShadersActionExecutor());
 	AddActionExecutor(new DebugInfoActionExecutor());
+	AddActionExecutor(new ProfileTraceActionExecutor());
 
 	// XXX are these redirects really required?
 	AddActionExecutor(new RedirectToSyncedActionExecutor("ATM"));
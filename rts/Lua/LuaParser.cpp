@@ -4,6 +4,8 @@
 #include "LuaParser.h"
 
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <limits.h>
 #include <boost/regex.hpp>
 
@@ -25,7 +27,7 @@
 #include "System/ScopedFPUSettings.h"
 #include "System/Util.h"
 
-LuaParser* LuaParser::currentParser = NULL;
+__thread LuaParser* LuaParser::currentParser = NULL;
 
 
 /******************************************************************************/
@@ -245,6 +247,291 @@ LuaTable LuaParser::GetRoot()
 }
 
 
+/******************************************************************************/
+//
+//  binary table cache
+//
+//  value := type:u8 (number:float | boolean:u8 | string:len:u32,bytes | table)
+//  table := #array:u32, #hash:u32, array values 1..#array, hash (key, value) pairs
+//
+//  written in host byte-order, the cache never leaves this machine
+//
+
+static const char TABLE_CACHE_MAGIC[8] = {'s', 'p', 'r', 'l', 'u', 'a', 't', '\0'};
+static const unsigned int TABLE_CACHE_VERSION = 1;
+// anything deeper is most likely a reference cycle
+static const int TABLE_CACHE_MAX_DEPTH = 32;
+
+
+static void AppendCacheData(std::vector<char>& buf, const void* data, size_t size)
+{
+	buf.insert(buf.end(), (const char*) data, ((const char*) data) + size);
+}
+
+static void AppendCacheU32(std::vector<char>& buf, unsigned int value)
+{
+	AppendCacheData(buf, &value, sizeof(value));
+}
+
+static bool IsCacheableType(int type)
+{
+	return (type == LUA_TNUMBER || type == LUA_TSTRING || type == LUA_TBOOLEAN || type == LUA_TTABLE);
+}
+
+static bool WriteCacheValue(lua_State* L, int index, int depth, std::vector<char>& buf)
+{
+	const int type = lua_type(L, index);
+
+	if (!IsCacheableType(type)) {
+		buf.push_back(char(LUA_TNIL));
+		return true;
+	}
+
+	buf.push_back(char(type));
+
+	switch (type) {
+		case LUA_TNUMBER: {
+			const float num = lua_tonumber(L, index);
+			AppendCacheData(buf, &num, sizeof(num));
+		} break;
+		case LUA_TBOOLEAN: {
+			buf.push_back(char(lua_toboolean(L, index)));
+		} break;
+		case LUA_TSTRING: {
+			size_t len = 0;
+			const char* str = lua_tolstring(L, index, &len);
+			AppendCacheU32(buf, len);
+			AppendCacheData(buf, str, len);
+		} break;
+		case LUA_TTABLE: {
+			if (depth >= TABLE_CACHE_MAX_DEPTH || !lua_checkstack(L, 3))
+				return false;
+
+			const int table = (index > 0)? index: (lua_gettop(L) + index + 1);
+			const int arraySize = lua_objlen(L, table);
+
+			AppendCacheU32(buf, arraySize);
+
+			// patched once the number of hash entries is known
+			const size_t hashSizePos = buf.size();
+			unsigned int hashSize = 0;
+			AppendCacheU32(buf, 0);
+
+			for (int i = 1; i <= arraySize; i++) {
+				lua_rawgeti(L, table, i);
+				const bool ok = WriteCacheValue(L, -1, depth + 1, buf);
+				lua_pop(L, 1);
+
+				if (!ok)
+					return false;
+			}
+
+			for (lua_pushnil(L); lua_next(L, table) != 0; lua_pop(L, 1)) {
+				const int keyType = lua_type(L, -2);
+
+				if (keyType == LUA_TTABLE || !IsCacheableType(keyType) || !IsCacheableType(lua_type(L, -1)))
+					continue;
+
+				if (keyType == LUA_TNUMBER) {
+					const float key = lua_tonumber(L, -2);
+
+					if (key >= 1 && key <= arraySize && key == int(key))
+						continue;
+				}
+
+				if (!WriteCacheValue(L, -2, depth + 1, buf) || !WriteCacheValue(L, -1, depth + 1, buf)) {
+					lua_pop(L, 2);
+					return false;
+				}
+
+				hashSize++;
+			}
+
+			memcpy(&buf[hashSizePos], &hashSize, sizeof(hashSize));
+		} break;
+	}
+
+	return true;
+}
+
+
+struct CacheReader {
+	CacheReader(const std::vector<char>& _buf): buf(_buf), pos(0) {}
+
+	bool Read(void* data, size_t size) {
+		if ((buf.size() - pos) < size)
+			return false;
+
+		memcpy(data, &buf[pos], size);
+		pos += size;
+		return true;
+	}
+
+	const std::vector<char>& buf;
+	size_t pos;
+};
+
+static bool ReadCacheValue(lua_State* L, CacheReader& reader, int depth)
+{
+	unsigned char type = LUA_TNIL;
+
+	if (!reader.Read(&type, sizeof(type)))
+		return false;
+	if (!lua_checkstack(L, 3))
+		return false;
+
+	switch (type) {
+		case LUA_TNIL: {
+			lua_pushnil(L);
+		} break;
+		case LUA_TNUMBER: {
+			float num = 0.0f;
+			if (!reader.Read(&num, sizeof(num)))
+				return false;
+			lua_pushnumber(L, num);
+		} break;
+		case LUA_TBOOLEAN: {
+			unsigned char bol = 0;
+			if (!reader.Read(&bol, sizeof(bol)))
+				return false;
+			lua_pushboolean(L, bol);
+		} break;
+		case LUA_TSTRING: {
+			unsigned int len = 0;
+			if (!reader.Read(&len, sizeof(len)) || (reader.buf.size() - reader.pos) < len)
+				return false;
+			lua_pushlstring(L, (len > 0)? &reader.buf[reader.pos]: "", len);
+			reader.pos += len;
+		} break;
+		case LUA_TTABLE: {
+			unsigned int sizes[2] = {0, 0};
+			if (depth >= TABLE_CACHE_MAX_DEPTH || !reader.Read(sizes, sizeof(sizes)))
+				return false;
+			// every entry takes at least one byte, guards against huge allocations
+			if (((reader.buf.size() - reader.pos) / 2) < (sizes[0] + sizes[1]))
+				return false;
+
+			lua_createtable(L, sizes[0], sizes[1]);
+
+			for (unsigned int i = 1; i <= sizes[0]; i++) {
+				if (!ReadCacheValue(L, reader, depth + 1))
+					return false;
+				lua_rawseti(L, -2, i);
+			}
+			for (unsigned int i = 0; i < sizes[1]; i++) {
+				if (!ReadCacheValue(L, reader, depth + 1) || !ReadCacheValue(L, reader, depth + 1))
+					return false;
+				// a nil key can only come from a broken file
+				if (lua_isnil(L, -2))
+					return false;
+				lua_rawset(L, -3);
+			}
+		} break;
+		default: {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+bool LuaParser::WriteCache(const string& cacheFile, const string& cacheKey) const
+{
+	if (!IsValid() || !valid)
+		return false;
+
+	std::vector<char> buf;
+	AppendCacheData(buf, TABLE_CACHE_MAGIC, sizeof(TABLE_CACHE_MAGIC));
+	AppendCacheU32(buf, TABLE_CACHE_VERSION);
+	AppendCacheU32(buf, cacheKey.size());
+	AppendCacheData(buf, cacheKey.data(), cacheKey.size());
+
+	lua_rawgeti(L, LUA_REGISTRYINDEX, rootRef);
+	const bool ok = WriteCacheValue(L, -1, 0, buf);
+	lua_pop(L, 1);
+
+	if (!ok) {
+		LOG_L(L_WARNING, "[%s] tables of %s can not be cached", __FUNCTION__, fileName.c_str());
+		return false;
+	}
+
+	FILE* file = fopen(cacheFile.c_str(), "wb");
+
+	if (file == NULL) {
+		LOG_L(L_WARNING, "[%s] could not write \"%s\"", __FUNCTION__, cacheFile.c_str());
+		return false;
+	}
+
+	const bool written = (fwrite(&buf[0], buf.size(), 1, file) == 1);
+	fclose(file);
+
+	if (!written)
+		remove(cacheFile.c_str());
+
+	return written;
+}
+
+
+bool LuaParser::ReadCache(const string& cacheFile, const string& cacheKey)
+{
+	if (!IsValid())
+		return false;
+
+	assert(initDepth == 0);
+	rootRef = LUA_NOREF;
+
+	std::vector<char> buf;
+	FILE* file = fopen(cacheFile.c_str(), "rb");
+
+	if (file == NULL)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	const long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	if (size > 0) {
+		buf.resize(size);
+
+		if (fread(&buf[0], size, 1, file) != 1)
+			buf.clear();
+	}
+
+	fclose(file);
+
+	CacheReader reader(buf);
+	char magic[sizeof(TABLE_CACHE_MAGIC)];
+	unsigned int header[2] = {0, 0}; // version, key length
+
+	bool ok = true;
+	ok = ok && reader.Read(magic, sizeof(magic)) && (memcmp(magic, TABLE_CACHE_MAGIC, sizeof(magic)) == 0);
+	ok = ok && reader.Read(header, sizeof(header)) && (header[0] == TABLE_CACHE_VERSION);
+	ok = ok && (header[1] == cacheKey.size()) && ((buf.size() - reader.pos) >= header[1]);
+	ok = ok && (cacheKey.compare(0, cacheKey.size(), &buf[reader.pos], header[1]) == 0);
+
+	// a different key means a different mod, map or options, not an error
+	if (!ok)
+		return false;
+
+	reader.pos += header[1];
+
+	const int top = lua_gettop(L);
+
+	if (!ReadCacheValue(L, reader, 0) || !lua_istable(L, -1) || reader.pos != buf.size()) {
+		LOG_L(L_WARNING, "[%s] ignoring broken cache \"%s\"", __FUNCTION__, cacheFile.c_str());
+		lua_settop(L, top);
+		return false;
+	}
+
+	initDepth = -1;
+	rootRef = luaL_ref(L, LUA_REGISTRYINDEX);
+	lua_settop(L, 0);
+	valid = true;
+	return true;
+}
+
+
 /******************************************************************************/
 
 void LuaParser::PushParam()
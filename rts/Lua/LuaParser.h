@@ -131,6 +131,13 @@ class LuaParser {
 
 		bool Execute();
 
+		/// Stores the root table returned by Execute() in a binary file,
+		/// only numbers, strings, booleans and tables are written.
+		bool WriteCache(const string& cacheFile, const string& cacheKey) const;
+		/// Alternative to Execute(), restores a root table from a file
+		/// written by WriteCache with the same key without running any Lua.
+		bool ReadCache(const string& cacheFile, const string& cacheKey);
+
 		bool IsValid() const { return (L != NULL); }
 
 		LuaTable GetRoot();
@@ -205,7 +212,8 @@ class LuaParser {
 		static int FileExists(lua_State* L);
 
 	private:
-		static LuaParser* currentParser;
+		/// per thread, parsers may run concurrently during loading
+		static __thread LuaParser* currentParser;
 };
 
 
@@ -2271,6 +2271,7 @@ int LuaSyncedCtrl::SetUnitPieceParent(lua_State* L)
 	lmpAlteredPiece->parent->RemoveChild(lmpAlteredPiece );
 	lmpAlteredPiece->SetParent(lmpParentPiece);
 	lmpParentPiece->AddChild(lmpAlteredPiece);
+	unit->localModel.UpdatePieceOrder();
 	return 0;
 }
 
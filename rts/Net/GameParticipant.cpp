@@ -1,6 +1,7 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
 #include "GameParticipant.h"
+#include "SpectatorRelay.h"
 
 #include "Net/Protocol/BaseNetProtocol.h"
 #include "Sim/Misc/GlobalConstants.h"
@@ -15,14 +16,19 @@ GameParticipant::GameParticipant()
 , isLocal(false)
 , isReconn(false)
 , isMidgameJoin(false)
+, relay(NULL)
 {
 	linkData[MAX_AIS] = PlayerLinkData(false);
 }
 
 void GameParticipant::SendData(boost::shared_ptr<const netcode::RawPacket> packet)
 {
-	if (link)
+	if (link) {
+		if (relay != NULL)
+			relay->FlushFor(id);
+
 		link->SendData(packet);
+	}
 }
 
 void GameParticipant::Connected(boost::shared_ptr<netcode::CConnection> _link, bool local)
@@ -37,6 +43,9 @@ void GameParticipant::Connected(boost::shared_ptr<netcode::CConnection> _link, b
 void GameParticipant::Kill(const std::string& reason, const bool flush)
 {
 	if (link) {
+		if (relay != NULL)
+			relay->FlushFor(id);
+
 		link->SendData(CBaseNetProtocol::Get().SendQuit(reason));
 
 		// make sure the Flush() performed by Close() has effect (forced flushes are undesirable)
@@ -14,6 +14,7 @@ namespace netcode
 	class CConnection;
 	class RawPacket;
 }
+class CSpectatorRelay;
 
 class GameParticipant : public PlayerBase
 {
@@ -45,6 +46,8 @@ public:
 	bool isReconn;
 	bool isMidgameJoin;
 	boost::shared_ptr<netcode::CConnection> link;
+	/// broadcasts may still be queued here, they have to go out before anything we send directly
+	CSpectatorRelay* relay;
 	PlayerStatistics lastStats;
 
 	struct PlayerLinkData {
@@ -2,6 +2,7 @@
 
 #include "System/Net/UDPListener.h"
 #include "System/Net/UDPConnection.h"
+#include "System/Net/Socket.h"
 
 #include <boost/bind.hpp>
 #include <boost/format.hpp>
@@ -17,6 +18,7 @@
 
 #include "GameParticipant.h"
 #include "GameSkirmishAI.h"
+#include "SpectatorRelay.h"
 #include "AutohostInterface.h"
 
 #include "Game/ClientSetup.h"
@@ -61,7 +63,6 @@
 #endif
 
 #define ALLOW_DEMO_GODMODE
-#define PKTCACHE_VECSIZE 1000
 
 using netcode::RawPacket;
 using boost::format;
@@ -75,6 +76,7 @@ CONFIG(bool, WhiteListAdditionalPlayers).defaultValue(true);
 CONFIG(bool, ServerRecordDemos).defaultValue(false).dedicatedValue(true);
 CONFIG(bool, ServerLogInfoMessages).defaultValue(false);
 CONFIG(bool, ServerLogDebugMessages).defaultValue(false);
+CONFIG(bool, ServerRelaySpectators).defaultValue(true).description("Merge the broadcasts of one server update into a single packet shared by all remote spectators.");
 CONFIG(std::string, AutohostIP).defaultValue("127.0.0.1");
 
 
@@ -176,12 +178,15 @@ CGameServer::CGameServer(
 	myGameData = newGameData;
 	myGameSetup = newGameSetup;
 
+	std::fill(relayLatencyBins, relayLatencyBins + NUM_RELAY_LATENCY_BINS, 0);
+
 	Initialize();
 }
 
 CGameServer::~CGameServer()
 {
 	quitServer = true;
+	netcode::WakeNetEventWaiter();
 
 	LOG_L(L_INFO, "[%s][1]", __FUNCTION__);
 	thread->join();
@@ -202,6 +207,8 @@ void CGameServer::Initialize()
 	logInfoMessages = configHandler->GetBool("ServerLogInfoMessages");
 	logDebugMessages = configHandler->GetBool("ServerLogDebugMessages");
 
+	spectatorRelay.reset(new CSpectatorRelay(players, configHandler->GetBool("ServerRelaySpectators")));
+
 	rng.Seed((myGameData->GetSetupText()).length());
 
 	// start network
@@ -248,6 +255,7 @@ void CGameServer::Initialize()
 		int playerID = 0;
 		for (GameParticipant& p: players) {
 			p.id = playerID++;
+			p.relay = spectatorRelay.get();
 		}
 
 		for (const SkirmishAIData& skd: aiStartData) {
@@ -424,9 +432,14 @@ void CGameServer::SkipTo(int targetFrameNum)
 	const bool wasPaused = isPaused;
 
 	if (!gameHasStarted) { return; }
-	if (serverFrameNum >= targetFrameNum) { return; }
 	if (demoReader == NULL) { return; }
 
+	// indexed demos know their length, do not announce a skip past the end
+	if (demoReader->GetNumFrames() > 0)
+		targetFrameNum = std::min(targetFrameNum, demoReader->GetNumFrames() - 1);
+
+	if (serverFrameNum >= targetFrameNum) { return; }
+
 	CommandMessage startMsg(str(format("skip start %d") %targetFrameNum), SERVER_PLAYER);
 	CommandMessage endMsg("skip end", SERVER_PLAYER);
 	Broadcast(boost::shared_ptr<const netcode::RawPacket>(startMsg.Pack()));
@@ -443,10 +456,12 @@ void CGameServer::SkipTo(int targetFrameNum)
 		if ((serverFrameNum % 20) != 0) { continue; }
 
 		// send data every few frames, as otherwise packets would grow too big
+		spectatorRelay->Flush();
 		UDPNet->Update();
 	}
 
 	Broadcast(boost::shared_ptr<const netcode::RawPacket>(endMsg.Pack()));
+	spectatorRelay->Flush();
 
 	if (UDPNet) {
 		UDPNet->Update();
@@ -569,11 +584,15 @@ bool CGameServer::SendDemoData(int targetFrameNum)
 void CGameServer::Broadcast(boost::shared_ptr<const netcode::RawPacket> packet)
 {
 	for (GameParticipant& p: players) {
-		p.SendData(packet);
+		if (!spectatorRelay->IsRelayed(p)) {
+			p.SendData(packet);
+		}
 	}
 
+	spectatorRelay->Broadcast(packet);
+
 	if (canReconnect || allowSpecJoin || !gameHasStarted)
-		AddToPacketCache(packet);
+		spectatorRelay->AddToCache(packet);
 
 	if (demoRecorder != NULL)
 		demoRecorder->SaveToDemo(packet->data, packet->length, GetDemoTime());
@@ -1950,7 +1969,7 @@ void CGameServer::StartGame(bool forced)
 	gameHasStarted = true;
 	startTime = gameTime;
 	if (!canReconnect && !allowSpecJoin)
-		packetCache.clear(); // free memory
+		spectatorRelay->ClearCache(); // free memory
 
 	if (UDPNet && !canReconnect && !allowSpecJoin)
 		UDPNet->SetAcceptingConnections(false); // do not accept new connections
@@ -2424,20 +2443,41 @@ void CGameServer::UpdateLoop()
 		Threading::SetAffinity(~0);
 
 		while (!quitServer) {
-			spring_sleep(spring_msecs(5));
+			// sleep until a packet arrives (from the UDP socket or the
+			// local client) or the next frame is due, whichever is first
+			const spring_time maxWait = GetNetWaitTime();
+			const bool netEvent = (UDPNet)? UDPNet->WaitForData(maxWait): netcode::WaitForNetEvents(NULL, maxWait);
+			const spring_time wakeTime = spring_gettime();
 
 			if (UDPNet)
 				UDPNet->Update();
 
 			Threading::RecursiveScopedLock scoped_lock(gameServerMutex);
 			ServerReadNet();
+
+			if (netEvent) {
+				const boost::int64_t relayTime = (spring_gettime() - wakeTime).toMicroSecsi();
+				unsigned int bin = 0;
+
+				while ((bin + 1) < NUM_RELAY_LATENCY_BINS && (boost::int64_t(1) << bin) <= relayTime)
+					bin++;
+
+				relayLatencyBins[bin]++;
+			}
+
 			Update();
+
+			// spectators get everything this iteration broadcast in one go
+			spectatorRelay->Flush();
 		}
 
+		LogRelayLatencies();
+
 		if (hostif)
 			hostif->SendQuit();
 
 		Broadcast(CBaseNetProtocol::Get().SendQuit("Server shutdown"));
+		spectatorRelay->Flush();
 
 		if (!reloadingServer) {
 			// this is to make sure the Flush has any effect at all (we don't want a forced flush)
@@ -2460,6 +2500,51 @@ void CGameServer::UpdateLoop()
 }
 
 
+spring_time CGameServer::GetNetWaitTime() const
+{
+	// never sleep longer than the old fixed poll interval while
+	// running; connections still need resends and keep-alives
+	if (!gameHasStarted || isPaused || PreSimFrame())
+		return spring_msecs(20);
+	if (demoReader != NULL || internalSpeed <= 0.0f)
+		return spring_msecs(5);
+
+	// frameTimeLeft (<= 0 between frames) is the part of a frame that
+	// still has to elapse since lastNewFrameTick, see CreateNewFrame
+	const float framesPerMilliSec = (GAME_SPEED * 0.001f) * internalSpeed;
+	const float msecsUntilFrame = (-frameTimeLeft / framesPerMilliSec) - (spring_gettime() - lastNewFrameTick).toMilliSecsf();
+	const boost::int64_t usecsUntilFrame = std::max(msecsUntilFrame * 1000.0f, 0.0f);
+
+	return std::min(spring_time::fromMicroSecs(usecsUntilFrame), spring_msecs(5));
+}
+
+void CGameServer::LogRelayLatencies() const
+{
+	if (spectatorRelay->GetNumBundles() > 0) {
+		LOG("[GameServer] spectator relay: %u packets merged into %u bundles, %u link sends",
+			spectatorRelay->GetNumRelayedPackets(), spectatorRelay->GetNumBundles(), spectatorRelay->GetNumLinkSends());
+	}
+
+	std::string bins;
+
+	for (unsigned int n = 0; n < NUM_RELAY_LATENCY_BINS; n++) {
+		if (relayLatencyBins[n] == 0)
+			continue;
+
+		if (n < NUM_RELAY_LATENCY_BINS - 1) {
+			bins += str(format(" <%ius:%u") %(1 << n) %relayLatencyBins[n]);
+		} else {
+			bins += str(format(" >=%ius:%u") %(1 << (n - 1)) %relayLatencyBins[n]);
+		}
+	}
+
+	if (bins.empty())
+		return;
+
+	LOG("[GameServer] packet relay latency histogram:%s", bins.c_str());
+}
+
+
 void CGameServer::KickPlayer(const int playerNum)
 {
 	if (!players[playerNum].link) { // only kick connected players
@@ -2564,6 +2649,7 @@ void CGameServer::AddAdditionalUser(const std::string& name, const std::string&
 	GameParticipant& p = players[playerNum];
 	assert(p.myState == GameParticipant::UNCONNECTED); // we only add _new_ players here, we don't handle reconnects here!
 	p.id = playerNum;
+	p.relay = spectatorRelay.get();
 	p.name = name;
 	p.spectator = spectator;
 	p.team = team;
@@ -2656,6 +2742,8 @@ unsigned CGameServer::BindConnection(std::string name, const std::string& passwd
 	if (terminate) {
 		Message(str(format(PlayerLeft) %newPlayer.GetType() %newPlayer.name %" terminating existing connection"));
 		Broadcast(CBaseNetProtocol::Get().SendPlayerLeft(newPlayerNumber, 0));
+		// relayed broadcasts queued for the old link must not end up on the new one
+		spectatorRelay->FlushFor(newPlayerNumber);
 		newPlayer.link.reset(); // prevent sending a quit message since this might kill the new connection
 		newPlayer.Kill("Terminating connection");
 		if (hostif)
@@ -2683,9 +2771,7 @@ unsigned CGameServer::BindConnection(std::string name, const std::string& passwd
 
 	// after gamedata and playerNum, the player can start loading
 	// throw at him all stuff he missed until now
-	for (auto& pv: packetCache)
-		for (boost::shared_ptr<const netcode::RawPacket>& p: pv)
-			newPlayer.SendData(p);
+	spectatorRelay->SendCache(newPlayer);
 
 	if (demoReader == NULL || myGameSetup->demoName.empty()) {
 		// player wants to play -> join team
@@ -2766,13 +2852,3 @@ void CGameServer::FreeSkirmishAIId(const unsigned char skirmishAIId)
 {
 	usedSkirmishAIIds.remove(skirmishAIId);
 }
-
-
-void CGameServer::AddToPacketCache(boost::shared_ptr<const netcode::RawPacket> &pckt)
-{
-	if (packetCache.empty() || packetCache.back().size() >= PKTCACHE_VECSIZE) {
-		packetCache.push_back(std::vector<boost::shared_ptr<const netcode::RawPacket> >());
-		packetCache.back().reserve(PKTCACHE_VECSIZE);
-	}
-	packetCache.back().push_back(pckt);
-}
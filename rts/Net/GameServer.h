@@ -40,6 +40,7 @@ namespace netcode
 class CDemoReader;
 class Action;
 class CDemoRecorder;
+class CSpectatorRelay;
 class AutohostInterface;
 class ClientSetup;
 class CGameSetup;
@@ -148,6 +149,9 @@ private:
 	void StartGame(bool forced);
 	void UpdateLoop();
 	void Update();
+	/// how long the server thread may block on the network before Update() has work
+	spring_time GetNetWaitTime() const;
+	void LogRelayLatencies() const;
 	void ProcessPacket(const unsigned playerNum, boost::shared_ptr<const netcode::RawPacket> packet);
 	void CheckSync();
 	void HandleConnectionAttempts();
@@ -175,8 +179,6 @@ private:
 	void Message(const std::string& message, bool broadcast = true);
 	void PrivateMessage(int playerNum, const std::string& message);
 
-	void AddToPacketCache(boost::shared_ptr<const netcode::RawPacket>& pckt);
-
 	float GetDemoTime() const;
 
 private:
@@ -239,8 +241,6 @@ private:
 	bool logInfoMessages;
 	bool logDebugMessages;
 
-	std::list< std::vector<boost::shared_ptr<const netcode::RawPacket> > > packetCache;
-
 	/////////////////// sync stuff ///////////////////
 #ifdef SYNCCHECK
 	std::set<int> outstandingSyncFrames;
@@ -266,6 +266,8 @@ private:
 	boost::scoped_ptr<CDemoReader> demoReader;
 	boost::scoped_ptr<CDemoRecorder> demoRecorder;
 	boost::scoped_ptr<AutohostInterface> hostif;
+	/// fan-out of broadcasts to spectators, also caches them for late joiners
+	boost::scoped_ptr<CSpectatorRelay> spectatorRelay;
 
 	UnsyncedRNG rng;
 	boost::thread* thread;
@@ -278,6 +280,10 @@ private:
 
 	int linkMinPacketSize;
 
+	/// bin i counts network wake-ups whose packets took < 2^i usecs to be relayed
+	static const unsigned int NUM_RELAY_LATENCY_BINS = 16;
+	unsigned int relayLatencyBins[NUM_RELAY_LATENCY_BINS];
+
 	union {
 		unsigned char charArray[16];
 		unsigned int intArray[4];
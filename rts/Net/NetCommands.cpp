@@ -16,6 +16,7 @@
 #include "Game/WordCompletion.h"
 #include "Game/IVideoCapturing.h"
 #include "Game/InMapDraw.h"
+#include "Game/ReplayAnalysis.h"
 #include "Game/Players/Player.h"
 #include "Game/Players/PlayerHandler.h"
 #include "Game/UI/GameSetupDrawer.h"
@@ -70,7 +71,7 @@ void CGame::SendClientProcUsage()
 	if ((spring_gettime() - lastProcUsageUpdateTime).toMilliSecsf() >= 1000.0f) {
 		lastProcUsageUpdateTime = spring_gettime();
 
-		if (playing) {
+		if (playing && !CReplayAnalysis::enabled) {
 			const float simProcUsage = (profiler.GetPercent("SimFrame"));
 			const float drawProcUsage = (profiler.GetPercent("GameController::Draw") / std::max(1.0f, globalRendering->FPS)) * gu->minFPS;
 			const float totalProcUsage = simProcUsage + drawProcUsage;
@@ -79,6 +80,7 @@ void CGame::SendClientProcUsage()
 			clientNet->Send(CBaseNetProtocol::Get().SendCPUUsage(totalProcUsage));
 		} else {
 			// the CPU-load percentage is undefined prior to SimFrame()
+			// (and a replay analysis should not get throttled by the server)
 			clientNet->Send(CBaseNetProtocol::Get().SendCPUUsage(0.0f));
 		}
 	}
@@ -242,6 +244,9 @@ void CGame::ClientReadNet()
 
 		lastReceivedNetPacketTime = spring_gettime();
 
+		// every message may change the sim state, async AIs read it
+		eoh->FinishAsyncAIs();
+
 		const unsigned char* inbuf = packet->data;
 		const unsigned dataLength = packet->length;
 		const unsigned char packetCode = inbuf[0];
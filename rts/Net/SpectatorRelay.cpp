@@ -0,0 +1,174 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "SpectatorRelay.h"
+
+#include "GameParticipant.h"
+#include "Net/Protocol/BaseNetProtocol.h"
+#include "System/Net/Connection.h"
+#include "System/Net/ProtocolDef.h"
+#include "System/Net/RawPacket.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+using netcode::RawPacket;
+
+// segments are only sealed at keyframes, so they hold at least this many packets
+static const unsigned int CACHE_SEGMENT_SIZE = 1000;
+// and at most this many (no keyframes are sent before the game starts)
+static const unsigned int CACHE_SEGMENT_MAX_SIZE = 4 * CACHE_SEGMENT_SIZE;
+
+
+CSpectatorRelay::CSpectatorRelay(std::vector<GameParticipant>& _players, bool _relaySpectators)
+	: players(_players)
+	, relaySpectators(_relaySpectators)
+	, numRelayedPackets(0)
+	, numBundles(0)
+	, numLinkSends(0)
+{
+}
+
+bool CSpectatorRelay::IsRelayed(const GameParticipant& p) const
+{
+	// local clients take packets as-is and can not split merged ones
+	return (relaySpectators && p.spectator && !p.isLocal && p.link);
+}
+
+
+void CSpectatorRelay::UpdateRecipients()
+{
+	curRecipients.clear();
+
+	for (const GameParticipant& p: players) {
+		if (IsRelayed(p)) {
+			curRecipients.push_back(p.id);
+		}
+	}
+}
+
+void CSpectatorRelay::Broadcast(boost::shared_ptr<const RawPacket> packet)
+{
+	UpdateRecipients();
+
+	// someone joined, left or stopped spectating; the queued packets
+	// were meant for the old set of spectators
+	if (!pendingPackets.empty() && curRecipients != pendingRecipients)
+		Flush();
+
+	if (curRecipients.empty())
+		return;
+
+	pendingRecipients.swap(curRecipients);
+	pendingPackets.push_back(packet);
+}
+
+void CSpectatorRelay::Flush()
+{
+	if (pendingPackets.empty())
+		return;
+
+	const boost::shared_ptr<const RawPacket> bundle = (pendingPackets.size() == 1)? pendingPackets[0]: MergePackets(pendingPackets);
+
+	for (const int playerNum: pendingRecipients) {
+		GameParticipant& p = players[playerNum];
+
+		if (!p.link)
+			continue;
+
+		p.link->SendData(bundle);
+		numLinkSends += 1;
+	}
+
+	numRelayedPackets += pendingPackets.size();
+	numBundles += 1;
+
+	pendingPackets.clear();
+	pendingRecipients.clear();
+}
+
+void CSpectatorRelay::FlushFor(int playerNum)
+{
+	if (pendingPackets.empty())
+		return;
+	// recipients are collected in id order
+	if (!std::binary_search(pendingRecipients.begin(), pendingRecipients.end(), playerNum))
+		return;
+
+	Flush();
+}
+
+
+void CSpectatorRelay::AddToCache(boost::shared_ptr<const RawPacket> packet)
+{
+	cacheDelta.push_back(packet);
+
+	if (cacheDelta.size() >= CACHE_SEGMENT_MAX_SIZE) {
+		SealCacheSegment();
+		return;
+	}
+
+	if (cacheDelta.size() >= CACHE_SEGMENT_SIZE && packet->data[0] == NETMSG_KEYFRAME)
+		SealCacheSegment();
+}
+
+void CSpectatorRelay::SealCacheSegment()
+{
+	// one allocation instead of thousands of tiny NEWFRAME packets
+	cacheSegments.push_back(MergePackets(cacheDelta));
+	cacheDelta.clear();
+}
+
+void CSpectatorRelay::SendCache(GameParticipant& p) const
+{
+	if (!p.link)
+		return;
+
+	if (p.isLocal) {
+		const netcode::ProtocolDef* proto = netcode::ProtocolDef::GetInstance();
+
+		for (const boost::shared_ptr<const RawPacket>& segment: cacheSegments) {
+			for (unsigned int pos = 0; pos < segment->length; ) {
+				const int pktLength = proto->PacketLength(segment->data + pos, segment->length - pos);
+
+				assert(proto->IsValidLength(pktLength, segment->length - pos));
+				p.link->SendData(boost::shared_ptr<const RawPacket>(new RawPacket(segment->data + pos, pktLength)));
+				pos += pktLength;
+			}
+		}
+	} else {
+		for (const boost::shared_ptr<const RawPacket>& segment: cacheSegments) {
+			p.link->SendData(segment);
+		}
+	}
+
+	for (const boost::shared_ptr<const RawPacket>& packet: cacheDelta) {
+		p.link->SendData(packet);
+	}
+}
+
+void CSpectatorRelay::ClearCache()
+{
+	// swap to actually free the memory
+	std::vector< boost::shared_ptr<const RawPacket> >().swap(cacheSegments);
+	std::vector< boost::shared_ptr<const RawPacket> >().swap(cacheDelta);
+}
+
+
+boost::shared_ptr<const RawPacket> CSpectatorRelay::MergePackets(const std::vector< boost::shared_ptr<const RawPacket> >& packets)
+{
+	unsigned int length = 0;
+
+	for (const boost::shared_ptr<const RawPacket>& packet: packets) {
+		length += packet->length;
+	}
+
+	RawPacket* merged = new RawPacket(length);
+
+	for (unsigned int pos = 0, n = 0; n < packets.size(); n++) {
+		memcpy(merged->data + pos, packets[n]->data, packets[n]->length);
+		pos += packets[n]->length;
+	}
+
+	return boost::shared_ptr<const RawPacket>(merged);
+}
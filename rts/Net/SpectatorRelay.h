@@ -0,0 +1,84 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _SPECTATOR_RELAY_H
+#define _SPECTATOR_RELAY_H
+
+#include <boost/shared_ptr.hpp>
+#include <vector>
+
+namespace netcode
+{
+	class RawPacket;
+}
+class GameParticipant;
+
+/**
+ * @brief Fans the server's broadcast stream out to remote spectators
+ * Instead of handing every message to every spectator link, broadcasts
+ * for spectators are collected during a server update and merged into a
+ * single packet that all of them share. UDP links split it back into
+ * messages on the receiving side, so clients see the same stream, and
+ * apply their outgoing bandwidth limit between the merged messages.
+ *
+ * The relay also owns the catch-up cache for late joiners: everything up
+ * to the last keyframe is kept in merged segments, only the delta since
+ * then is kept message by message.
+ */
+class CSpectatorRelay
+{
+public:
+	CSpectatorRelay(std::vector<GameParticipant>& players, bool relaySpectators);
+
+	/// true if broadcasts for this participant go through the relay
+	bool IsRelayed(const GameParticipant& p) const;
+
+	/**
+	 * @brief Queue a broadcast packet for all relayed participants
+	 * Sends pending packets first if the set of relayed participants
+	 * changed since they were queued.
+	 */
+	void Broadcast(boost::shared_ptr<const netcode::RawPacket> packet);
+
+	/// Hand the pending packets to the links of their recipients
+	void Flush();
+	/// Flush if the given participant has packets pending, call before sending to it directly
+	void FlushFor(int playerNum);
+
+	void AddToCache(boost::shared_ptr<const netcode::RawPacket> packet);
+	/// Send everything a late joiner missed
+	void SendCache(GameParticipant& p) const;
+	void ClearCache();
+
+	unsigned int GetNumRelayedPackets() const { return numRelayedPackets; }
+	unsigned int GetNumBundles() const { return numBundles; }
+	unsigned int GetNumLinkSends() const { return numLinkSends; }
+
+private:
+	void UpdateRecipients();
+	void SealCacheSegment();
+
+	static boost::shared_ptr<const netcode::RawPacket> MergePackets(const std::vector< boost::shared_ptr<const netcode::RawPacket> >& packets);
+
+private:
+	std::vector<GameParticipant>& players;
+
+	bool relaySpectators;
+
+	/// broadcasts queued since the last Flush
+	std::vector< boost::shared_ptr<const netcode::RawPacket> > pendingPackets;
+	/// who the pending packets are for
+	std::vector<int> pendingRecipients;
+	/// relayed participants at the time of the latest Broadcast
+	std::vector<int> curRecipients;
+
+	/// merged cache segments, each ending at a keyframe
+	std::vector< boost::shared_ptr<const netcode::RawPacket> > cacheSegments;
+	/// cached packets since the last keyframe
+	std::vector< boost::shared_ptr<const netcode::RawPacket> > cacheDelta;
+
+	unsigned int numRelayedPackets;
+	unsigned int numBundles;
+	unsigned int numLinkSends;
+};
+
+#endif // _SPECTATOR_RELAY_H
@@ -25,6 +25,7 @@ CR_REG_METADATA(LocalModelPiece, (
 	CR_MEMBER(colvol),
 	CR_MEMBER(numUpdatesSynced),
 	CR_MEMBER(lastMatrixUpdate),
+	CR_IGNORED(modelSpaceMatUpdated),
 	CR_MEMBER(scriptSetVisible),
 	CR_MEMBER(identityTransform),
 	CR_MEMBER(lmodelPieceIndex),
@@ -45,6 +46,7 @@ CR_REG_METADATA(LocalModel, (
 	CR_IGNORED(bvFrameTime),
 	CR_IGNORED(lodCount), //FIXME?
 	CR_MEMBER(pieces),
+	CR_MEMBER(pieceOrder),
 
 	CR_IGNORED(boundingVolume),
 	CR_IGNORED(luaMaterialData)
@@ -296,11 +298,12 @@ void LocalModel::SetModel(const S3DModel* model)
 	pieces.reserve(model->numPieces);
 
 	CreateLocalModelPieces(model->GetRootPiece());
+	UpdatePieceOrder();
 
-	// must recursively update matrices here too: for features
+	// must update matrices here too: for features
 	// LocalModel::Update is never called, but they might have
 	// baked piece rotations (if .dae)
-	pieces[0].UpdateMatricesRec(false);
+	UpdatePieceMatrices();
 	UpdateBoundingVolume(0);
 
 	assert(pieces.size() == model->numPieces);
@@ -330,6 +333,36 @@ LocalModelPiece* LocalModel::CreateLocalModelPieces(const S3DModelPiece* mpParen
 	return lmpParent;
 }
 
+void LocalModel::UpdatePieceOrder()
+{
+	// breadth-first, so every parent comes before its children even
+	// after SetUnitPieceParent moved a piece (pieces itself is only
+	// in depth-first order until then)
+	pieceOrder.clear();
+	pieceOrder.reserve(pieces.size());
+	pieceOrder.push_back(0);
+
+	for (unsigned int n = 0; n < pieceOrder.size(); n++) {
+		const LocalModelPiece& lmp = pieces[pieceOrder[n]];
+
+		for (const LocalModelPiece* child: lmp.children) {
+			pieceOrder.push_back(child->GetLModelPieceIndex());
+		}
+	}
+
+	// less if a piece was made a child of its own child, which
+	// disconnects both from the root (as in UpdateMatricesRec)
+	assert(pieceOrder.size() <= pieces.size());
+}
+
+void LocalModel::UpdatePieceMatrices()
+{
+	// same as pieces[0].UpdateMatricesRec(false), without the recursion
+	for (unsigned int n = 0; n < pieceOrder.size(); n++) {
+		pieces[pieceOrder[n]].UpdateMatrices();
+	}
+}
+
 void LocalModel::UpdateBoundingVolume(unsigned int frameNum)
 {
 	bvFrameTime = frameNum;
@@ -402,6 +435,8 @@ LocalModelPiece::LocalModelPiece(const S3DModelPiece* piece)
 	, numUpdatesSynced(1)
 	, lastMatrixUpdate(0)
 
+	, modelSpaceMatUpdated(false)
+
 	, scriptSetVisible(piece->HasGeometryData())
 	, identityTransform(true)
 
@@ -428,6 +463,28 @@ bool LocalModelPiece::UpdateMatrix()
 	return (original->ComposeTransform(pieceSpaceMat.LoadIdentity(), pos, rot, original->scales));
 }
 
+void LocalModelPiece::UpdateMatrices()
+{
+	// the parent was updated before (LocalModel::pieceOrder)
+	bool updateModelSpaceMat = (parent != NULL && parent->modelSpaceMatUpdated);
+
+	if (lastMatrixUpdate != numUpdatesSynced) {
+		lastMatrixUpdate = numUpdatesSynced;
+		identityTransform = UpdateMatrix();
+		updateModelSpaceMat = true;
+	}
+
+	if (updateModelSpaceMat) {
+		modelSpaceMat = pieceSpaceMat;
+
+		if (parent != NULL) {
+			modelSpaceMat >>= parent->modelSpaceMat;
+		}
+	}
+
+	modelSpaceMatUpdated = updateModelSpaceMat;
+}
+
 void LocalModelPiece::UpdateMatricesRec(bool updateChildMatrices)
 {
 	if (lastMatrixUpdate != numUpdatesSynced) {
@@ -289,6 +289,7 @@ struct LocalModelPiece
 	void SetLODCount(unsigned int count);
 
 	bool UpdateMatrix();
+	void UpdateMatrices();
 	void UpdateMatricesRec(bool updateChildMatrices);
 
 	// note: actually OBJECT_TO_WORLD but transform is the same
@@ -323,6 +324,8 @@ private:
 	unsigned numUpdatesSynced; // triggers UpdateMatrix (via UpdateMatricesRec) if != lastMatrixUpdate
 	unsigned lastMatrixUpdate;
 
+	bool modelSpaceMatUpdated; // set by UpdateMatrices, tells the children to update theirs
+
 public:
 	bool scriptSetVisible;  // TODO: add (visibility) maxradius!
 	bool identityTransform; // true IFF pieceSpaceMat (!) equals identity
@@ -384,9 +387,10 @@ struct LocalModel
 		DrawPiecesLOD(luaMaterialData.GetCurrentLOD());
 	}
 
+	// called in parallel for all units, touches nothing but this model
 	void Update(unsigned int frameNum) {
 		if (dirtyPieces > 0)
-			pieces[0].UpdateMatricesRec(false);
+			UpdatePieceMatrices();
 
 		// has its own fixed schedule independent of dirtyPieces
 		if ((frameNum - bvFrameTime) >= 15)
@@ -399,6 +403,9 @@ struct LocalModel
 	void SetModel(const S3DModel* model);
 	void SetLODCount(unsigned int count);
 	void PieceUpdated(unsigned int pieceIdx) { dirtyPieces += 1; }
+	// must be called after a piece was moved to another parent
+	void UpdatePieceOrder();
+	void UpdatePieceMatrices();
 	void UpdateBoundingVolume(unsigned int frameNum);
 
 
@@ -439,6 +446,8 @@ public:
 	unsigned int lodCount;
 
 	std::vector<LocalModelPiece> pieces;
+	// indices into <pieces>, every parent before its children
+	std::vector<unsigned int> pieceOrder;
 
 private:
 	// object-oriented box; accounts for piece movement
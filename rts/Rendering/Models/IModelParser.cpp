@@ -107,12 +107,23 @@ static void CheckPieceNormals(const S3DModel* model, const S3DModelPiece* modelP
 
 
 
+// parsing is mostly file-reading and texture decoding
+static const unsigned int MAX_PRELOAD_THREADS = 4;
+
+
 LoadQueue::~LoadQueue()
 {
-	if (thread != nullptr) {
+	JoinThreads();
+}
+
+void LoadQueue::JoinThreads()
+{
+	for (boost::thread*& thread: threads) {
 		thread->join();
 		SafeDelete(thread);
 	}
+
+	threads.clear();
 }
 
 __FORCE_ALIGN_STACK__
@@ -123,8 +134,15 @@ void LoadQueue::Pump()
 
 		{
 			GrabLock();
-			assert(queue.size() > 0);
+
+			if (queue.empty()) {
+				numActiveThreads -= 1;
+				FreeLock();
+				break;
+			}
+
 			modelName = queue.front();
+			queue.pop_front();
 			FreeLock();
 		}
 
@@ -132,35 +150,77 @@ void LoadQueue::Pump()
 
 		{
 			GrabLock();
-			queue.pop_front();
-			const bool empty = queue.empty();
+			pending.erase(modelName);
 			FreeLock();
-			if (empty)
-				break;
 		}
+
+		modelLoaded.notify_all();
 	}
 }
 
-void LoadQueue::Push(const std::string& modelName)
+void LoadQueue::Push(const std::string& name)
 {
+	const std::string modelName = StringToLower(name);
+
 	GrabLock();
 
-	if (queue.empty()) {
-		if (thread != nullptr) {
-			FreeLock();
+	if (!pending.insert(modelName).second) {
+		// already queued
+		FreeLock();
+		return;
+	}
+
+	queue.push_back(modelName);
+
+	if (numActiveThreads == 0 && !threads.empty()) {
+		// all exited (or are about to), reap them outside the lock
+		std::vector<boost::thread*> exitedThreads;
+		exitedThreads.swap(threads);
+
+		FreeLock();
 
+		for (boost::thread*& thread: exitedThreads) {
 			thread->join();
 			SafeDelete(thread);
-
-			GrabLock();
 		}
 
-		// mutex is still locked, thread will block if it gets
-		// to queue.front() before we get to queue.push_back()
-		thread = new boost::thread(boost::bind(&LoadQueue::Pump, this));
+		GrabLock();
 	}
 
-	queue.push_back(modelName);
+	const unsigned int maxThreads = std::max(1u, std::min(boost::thread::hardware_concurrency(), MAX_PRELOAD_THREADS));
+
+	// exited threads are only reaped once all are idle, so
+	// at most maxThreads exist at any time
+	if (numActiveThreads < queue.size() && threads.size() < maxThreads) {
+		numActiveThreads += 1;
+		threads.push_back(new boost::thread(boost::bind(&LoadQueue::Pump, this)));
+	}
+
+	FreeLock();
+}
+
+void LoadQueue::WaitFor(const std::string& modelName)
+{
+	GrabLock();
+
+	if (pending.find(modelName) == pending.end()) {
+		FreeLock();
+		return;
+	}
+
+	// not picked up by a loader thread yet: rather than waiting behind
+	// everything queued before it, the caller parses it right away
+	const auto it = std::find(queue.begin(), queue.end(), modelName);
+
+	if (it != queue.end()) {
+		queue.erase(it);
+		pending.erase(modelName);
+		FreeLock();
+		return;
+	}
+
+	while (pending.find(modelName) != pending.end())
+		modelLoaded.wait(mutex);
 
 	FreeLock();
 }
@@ -252,6 +312,11 @@ S3DModel* C3DModelLoader::Load3DModel(std::string name, bool preload)
 
 	StringToLowerInPlace(name);
 
+	// do not parse a model twice when it is being preloaded already,
+	// one that is only queued is parsed here instead
+	if (!preload)
+		loadQueue.WaitFor(name);
+
 	std::string  path;
 	std::string* refs[2] = {&name, &path};
 
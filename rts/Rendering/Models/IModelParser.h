@@ -5,8 +5,11 @@
 
 #include <unordered_map>
 #include <deque>
+#include <set>
+#include <vector>
 
 #include <string>
+#include <boost/thread/condition_variable.hpp>
 
 #include "System/Threading/SpringMutex.h"
 
@@ -25,21 +28,36 @@ public:
 };
 
 
+/**
+ * Parses models (and decodes their textures) in the background, on up to
+ * MAX_THREADS threads which exit once the queue is empty.
+ */
 struct LoadQueue {
 public:
-	LoadQueue(): thread(nullptr) {}
+	LoadQueue(): numActiveThreads(0) {}
 	~LoadQueue();
 
 	void Pump();
 	void Push(const std::string& modelName);
+	/// blocks while a preload thread parses the model, takes it out of the queue if none picked it up yet
+	void WaitFor(const std::string& modelName);
 
 	void GrabLock() { mutex.lock(); }
 	void FreeLock() { mutex.unlock(); }
 
+private:
+	void JoinThreads();
+
 private:
 	std::deque<std::string> queue;
+	/// queued or being parsed, lower-case
+	std::set<std::string> pending;
+
 	spring::mutex mutex;
-	boost::thread* thread;
+	boost::condition_variable_any modelLoaded;
+
+	std::vector<boost::thread*> threads;
+	unsigned int numActiveThreads;
 };
 
 
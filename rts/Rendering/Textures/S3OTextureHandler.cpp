@@ -4,8 +4,10 @@
 #include "Rendering/GL/myGL.h"
 #include "S3OTextureHandler.h"
 
+#include "System/Config/ConfigHandler.h"
 #include "System/FileSystem/FileHandler.h"
 #include "System/FileSystem/SimpleParser.h"
+#include "Rendering/GlobalRendering.h"
 #include "Rendering/ShadowHandler.h"
 #include "Rendering/UnitDrawer.h"
 #include "Rendering/Models/3DModel.h"
@@ -13,8 +15,11 @@
 #include "System/Util.h"
 #include "System/Exceptions.h"
 #include "System/Log/ILog.h"
+#include "System/Misc/SpringTime.h"
 #include "System/Platform/Threading.h"
 
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
 #include <algorithm>
 #include <cctype>
 #include <set>
@@ -29,6 +34,9 @@ LOG_REGISTER_SECTION_GLOBAL(LOG_SECTION_TEXTURE)
 
 #define TEX_MAT_UID(pTxID, sTxID) ((boost::uint64_t(pTxID) << 32u) | sTxID)
 
+CONFIG(bool, StreamModelTextures).defaultValue(true).description("Decode and upload unit textures that were not loaded during startup in the background, showing placeholder textures meanwhile, instead of stalling the frame the unit first appears in.");
+CONFIG(float, TextureStreamingBudget).defaultValue(2.0f).minimumValue(0.0f).description("Milliseconds per frame that may be spent uploading streamed unit textures, at least one texture is uploaded per frame.");
+
 
 // The S3O texture handler uses two textures.
 // The first contains diffuse color (RGB) and teamcolor (A)
@@ -41,7 +49,15 @@ LOG_REGISTER_SECTION_GLOBAL(LOG_SECTION_TEXTURE)
 CS3OTextureHandler* texturehandlerS3O = NULL;
 
 CS3OTextureHandler::CS3OTextureHandler()
+	: streaming(false)
+	, allowStreaming(configHandler->GetBool("StreamModelTextures"))
+	, streamingBudget(configHandler->GetFloat("TextureStreamingBudget"))
+	, decodeThread(nullptr)
+	, stopDecoding(false)
 {
+	placeholderTex[0] = 0;
+	placeholderTex[1] = 0;
+
 	// dummies
 	textures.push_back(S3OTexMat());
 	textures.push_back(S3OTexMat());
@@ -49,6 +65,16 @@ CS3OTextureHandler::CS3OTextureHandler()
 
 CS3OTextureHandler::~CS3OTextureHandler()
 {
+	if (decodeThread != nullptr) {
+		cacheMutex.lock();
+		stopDecoding = true;
+		cacheMutex.unlock();
+
+		decodeJobAdded.notify_all();
+		decodeThread->join();
+		SafeDelete(decodeThread);
+	}
+
 	for (S3OTexMat& texture: textures){
 		glDeleteTextures(1, &(texture.tex1));
 		glDeleteTextures(1, &(texture.tex2));
@@ -56,64 +82,122 @@ CS3OTextureHandler::~CS3OTextureHandler()
 	for (auto& it: bitmapCache) {
 		delete it.second;
 	}
+
+	glDeleteTextures(2, placeholderTex);
 }
 
 void CS3OTextureHandler::LoadS3OTexture(S3DModel* model)
 {
 	cacheMutex.lock();
-	model->textureType = LoadS3OTextureNow(model);
+
+	const bool uploaded =
+		(textureCache.find(model->tex1) != textureCache.end()) &&
+		(textureCache.find(model->tex2) != textureCache.end());
+
+	if (streaming && !uploaded) {
+		model->textureType = StreamS3OTexture(model);
+	} else {
+		model->textureType = LoadS3OTextureNow(model);
+	}
+
 	cacheMutex.unlock();
 }
 
 void CS3OTextureHandler::PreloadS3OTexture(S3DModel* model)
 {
-	cacheMutex.lock();
-	LoadTexture(model, model->tex1, true, true);
-	LoadTexture(model, model->tex2, false, true);
-	cacheMutex.unlock();
+	// a model parsed by the main thread while streaming, its
+	// textures are decoded in the background once it is drawn
+	if (Threading::IsMainThread() && streaming)
+		return;
+
+	// called by the model preload threads; file reads overlap, but DevIL
+	// decodes one image at a time (devilMutex, see CBitmap::Load)
+	PreloadTexture(DecodeJob(model, model->tex1, true));
+	PreloadTexture(DecodeJob(model, model->tex2, false));
 }
 
 
-unsigned int CS3OTextureHandler::LoadTexture(const S3DModel* model, const std::string& textureName, bool isTex1, bool preload)
+CS3OTextureHandler::DecodeJob::DecodeJob(const S3DModel* model, const std::string& textureName, bool isTex1)
+	: modelName(model->name)
+	, textureName(textureName)
+	, isTex1(isTex1)
+	, invertTexAlpha(model->invertTexAlpha)
+	, invertTexYAxis(model->invertTexYAxis)
 {
-	CBitmap _bitmap;
-	CBitmap* bitmap = &_bitmap;
+}
+
+void CS3OTextureHandler::DecodeTexture(const DecodeJob& job, CBitmap* bitmap)
+{
+	if (!bitmap->Load(job.textureName)) {
+		if (!bitmap->Load("unittextures/" + job.textureName)) {
+			LOG_L(L_WARNING, "[%s] could not load texture \"%s\" from model \"%s\"",
+				__FUNCTION__, job.textureName.c_str(), job.modelName.c_str());
+
+			// file not found (or headless build), set a single pixel so unit is visible
+			bitmap->AllocDummy(job.isTex1 ? SColor(255, 0, 0, 255) : SColor(0, 0, 0, 255));
+		}
+	}
+
+	if (job.isTex1 && job.invertTexAlpha)
+		bitmap->InvertAlpha();
+	if (job.invertTexYAxis)
+		bitmap->ReverseYAxis();
+}
+
+void CS3OTextureHandler::PreloadTexture(const DecodeJob& job)
+{
+	const std::string& textureName = job.textureName;
+
+	cacheMutex.lock();
+	const bool cached = (textureCache.find(textureName) != textureCache.end()) || (bitmapCache.find(textureName) != bitmapCache.end());
+	cacheMutex.unlock();
 
-	bool delBitmap = false;
+	if (cached)
+		return;
 
+	// do not hold the lock while decoding, it is the expensive part
+	CBitmap* bitmap = new CBitmap();
+	DecodeTexture(job, bitmap);
+
+	// another thread may have been faster; otherwise don't generate
+	// a texture yet, just save the bitmap for later
+	cacheMutex.lock();
+	if ((textureCache.find(textureName) == textureCache.end()) && (bitmapCache.find(textureName) == bitmapCache.end())) {
+		bitmapCache[textureName] = bitmap;
+		bitmap = nullptr;
+	}
+	cacheMutex.unlock();
+
+	delete bitmap;
+}
+
+unsigned int CS3OTextureHandler::LoadTexture(const S3DModel* model, const std::string& textureName, bool isTex1)
+{
 	auto textureIt = textureCache.find(textureName);
 	if (textureIt != textureCache.end())
 		return textureIt->second.texID;
 
 	auto bitmapIt = bitmapCache.find(textureName);
-	if (bitmapIt != bitmapCache.end()) {
-		bitmap = bitmapIt->second;
-		delBitmap = true;
-	} else {
-		if (preload) {
-			bitmap = new CBitmap();
-			bitmapCache[textureName] = bitmap;
-		}
-		if (!bitmap->Load(textureName)) {
-			if (!bitmap->Load("unittextures/" + textureName)) {
-				LOG_L(L_WARNING, "[%s] could not load texture \"%s\" from model \"%s\"",
-					__FUNCTION__, textureName.c_str(), model->name.c_str());
-
-				// file not found (or headless build), set a single pixel so unit is visible
-				bitmap->AllocDummy(isTex1 ? SColor(255, 0, 0, 255) : SColor(0, 0, 0, 255));
-			}
-		}
+	if (bitmapIt != bitmapCache.end())
+		return (UploadTexture(textureName, bitmapIt->second));
 
-		if (isTex1 && model->invertTexAlpha)
-			bitmap->InvertAlpha();
-		if (model->invertTexYAxis)
-			bitmap->ReverseYAxis();
+	CBitmap bitmap;
+	DecodeTexture(DecodeJob(model, textureName, isTex1), &bitmap);
 
-	}
-	//Don't generate a texture, just save the bitmap for later
-	if (preload)
-		return 0;
+	const unsigned int texID = bitmap.CreateTexture(true);
 
+	textureCache[textureName] = {
+		texID,
+		static_cast<unsigned int>(bitmap.xsize),
+		static_cast<unsigned int>(bitmap.ysize)
+	};
+
+	return texID;
+}
+
+unsigned int CS3OTextureHandler::UploadTexture(const std::string& textureName, CBitmap* bitmap)
+{
+	// bitmap must come from bitmapCache, it is released here
 	const unsigned int texID = bitmap->CreateTexture(true);
 
 	textureCache[textureName] = {
@@ -122,23 +206,163 @@ unsigned int CS3OTextureHandler::LoadTexture(const S3DModel* model, const std::s
 		static_cast<unsigned int>(bitmap->ysize)
 	};
 
-	if (delBitmap) {
-		bitmapCache.erase(textureName);
-		delete bitmap;
-	}
+	bitmapCache.erase(textureName);
+	delete bitmap;
 
 	return texID;
 }
 
 
+unsigned int CS3OTextureHandler::StreamS3OTexture(const S3DModel* model)
+{
+	// models sharing a texture pair share the streamed material
+	for (const StreamedTexMat& mat: streamedMats) {
+		if (mat.model->tex1 == model->tex1 && mat.model->tex2 == model->tex2)
+			return mat.num;
+	}
+
+	if (placeholderTex[0] == 0) {
+		// untextured, but still in team-color
+		CBitmap bitmap;
+		bitmap.AllocDummy(SColor(128, 128, 128, 255));
+		placeholderTex[0] = bitmap.CreateTexture();
+		bitmap.AllocDummy(SColor(0, 0, 0, 255));
+		placeholderTex[1] = bitmap.CreateTexture();
+	}
+
+	S3OTexMat texMat;
+	texMat.num       = textures.size();
+	texMat.tex1      = placeholderTex[0];
+	texMat.tex2      = placeholderTex[1];
+	texMat.tex1SizeX = 1;
+	texMat.tex1SizeY = 1;
+	texMat.tex2SizeX = 1;
+	texMat.tex2SizeY = 1;
+	texMat.bindFrame = globalRendering->drawFrame;
+
+	textures.push_back(texMat);
+	streamedMats.push_back({model, static_cast<unsigned int>(texMat.num)});
+
+	QueueDecode(model, model->tex1, true);
+	QueueDecode(model, model->tex2, false);
+
+	return texMat.num;
+}
+
+void CS3OTextureHandler::QueueDecode(const S3DModel* model, const std::string& textureName, bool isTex1)
+{
+	if (textureCache.find(textureName) != textureCache.end())
+		return;
+	if (bitmapCache.find(textureName) != bitmapCache.end())
+		return;
+	if (!decodingTextures.insert(textureName).second)
+		return;
+
+	decodeJobs.push_back(DecodeJob(model, textureName, isTex1));
+	decodeJobAdded.notify_one();
+
+	if (decodeThread == nullptr)
+		decodeThread = new boost::thread(boost::bind(&CS3OTextureHandler::DecodeThreadLoop, this));
+}
+
+void CS3OTextureHandler::DecodeThreadLoop()
+{
+	Threading::SetThreadName("s3otexdecode");
+
+	while (true) {
+		cacheMutex.lock();
+
+		while (decodeJobs.empty() && !stopDecoding)
+			decodeJobAdded.wait(cacheMutex);
+
+		if (stopDecoding) {
+			cacheMutex.unlock();
+			break;
+		}
+
+		const DecodeJob job = decodeJobs.front();
+		decodeJobs.pop_front();
+		cacheMutex.unlock();
+
+		PreloadTexture(job);
+
+		cacheMutex.lock();
+		decodingTextures.erase(job.textureName);
+		cacheMutex.unlock();
+	}
+}
+
+
+void CS3OTextureHandler::Update()
+{
+	streaming = allowStreaming;
+
+	if (streamedMats.empty())
+		return;
+
+	const spring_time startTime = spring_gettime();
+
+	// materials that were drawn recently first
+	std::stable_sort(streamedMats.begin(), streamedMats.end(), [&](const StreamedTexMat& a, const StreamedTexMat& b) {
+		return (textures[a.num].bindFrame > textures[b.num].bindFrame);
+	});
+
+	unsigned int numUploads = 0;
+
+	cacheMutex.lock();
+
+	for (auto it = streamedMats.begin(); it != streamedMats.end(); ) {
+		const std::string* texNames[2] = {&it->model->tex1, &it->model->tex2};
+
+		for (const std::string* texName: texNames) {
+			if (numUploads > 0 && (spring_gettime() - startTime).toMilliSecsf() >= streamingBudget)
+				break;
+			if (textureCache.find(*texName) != textureCache.end())
+				continue;
+
+			const auto bitmapIt = bitmapCache.find(*texName);
+
+			// not decoded yet
+			if (bitmapIt == bitmapCache.end())
+				continue;
+
+			UploadTexture(*texName, bitmapIt->second);
+			numUploads += 1;
+		}
+
+		const auto tex1It = textureCache.find(it->model->tex1);
+		const auto tex2It = textureCache.find(it->model->tex2);
+
+		if (tex1It == textureCache.end() || tex2It == textureCache.end()) {
+			++it;
+			continue;
+		}
+
+		// swap the real textures into the material models already use
+		S3OTexMat& texMat = textures[it->num];
+		texMat.tex1      = tex1It->second.texID;
+		texMat.tex2      = tex2It->second.texID;
+		texMat.tex1SizeX = tex1It->second.xsize;
+		texMat.tex1SizeY = tex1It->second.ysize;
+		texMat.tex2SizeX = tex2It->second.xsize;
+		texMat.tex2SizeY = tex2It->second.ysize;
+
+		textureTable.insert(std::make_pair(TEX_MAT_UID(texMat.tex1, texMat.tex2), it->num));
+		it = streamedMats.erase(it);
+	}
+
+	cacheMutex.unlock();
+}
+
+
 int CS3OTextureHandler::LoadS3OTextureNow(const S3DModel* model)
 {
 	LOG_L(L_INFO, "Load S3O texture now (Flip Y Axis: %s, Invert Team Alpha: %s)",
 			model->invertTexYAxis ? "yes" : "no",
 			model->invertTexAlpha ? "yes" : "no");
 
-	const unsigned int tex1ID = LoadTexture(model, model->tex1, true, false);
-	const unsigned int tex2ID = LoadTexture(model, model->tex2, false, false);
+	const unsigned int tex1ID = LoadTexture(model, model->tex1, true);
+	const unsigned int tex2ID = LoadTexture(model, model->tex2, false);
 
 	auto texTableIter = textureTable.find(TEX_MAT_UID(tex1ID, tex2ID));
 
@@ -163,6 +387,7 @@ unsigned int CS3OTextureHandler::InsertTextureMat(const S3DModel* model)
 	texMat.tex1SizeY = tex1.ysize;
 	texMat.tex2SizeX = tex2.xsize;
 	texMat.tex2SizeY = tex2.ysize;
+	texMat.bindFrame = 0;
 
 	textures.push_back(texMat);
 	textureTable[TEX_MAT_UID(texMat.tex1, texMat.tex2)] = texMat.num;
@@ -173,6 +398,7 @@ unsigned int CS3OTextureHandler::InsertTextureMat(const S3DModel* model)
 void CS3OTextureHandler::SetS3oTexture(int num)
 {
 	S3OTexMat& texMat = textures[num];
+	texMat.bindFrame = globalRendering->drawFrame;
 
 	if (shadowHandler->inShadowPass) {
 		glActiveTexture(GL_TEXTURE0);
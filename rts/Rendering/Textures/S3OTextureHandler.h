@@ -3,12 +3,19 @@
 #ifndef S3O_TEXTURE_HANDLER_H
 #define S3O_TEXTURE_HANDLER_H
 
+#include <boost/thread/condition_variable.hpp>
 #include <boost/unordered_map.hpp>
+#include <deque>
+#include <set>
 #include <string>
 #include <vector>
 
 #include "System/Threading/SpringMutex.h"
 
+namespace boost {
+	class thread;
+};
+
 struct S3DModel;
 class CBitmap;
 
@@ -26,6 +33,10 @@ public:
 
 		unsigned int tex2SizeX;
 		unsigned int tex2SizeY;
+
+		/// draw-frame this was last bound in, streamed textures
+		/// of recently drawn materials are uploaded first
+		unsigned int bindFrame;
 	};
 
 	struct CachedS3OTex {
@@ -40,10 +51,19 @@ public:
 	CS3OTextureHandler();
 	~CS3OTextureHandler();
 
+	/**
+	 * Once the game runs, textures that are not uploaded yet are
+	 * streamed: the model gets a material with placeholder textures
+	 * right away, decoding happens on a worker thread and Update()
+	 * swaps in the real textures.
+	 */
 	void LoadS3OTexture(S3DModel* model);
 	void PreloadS3OTexture(S3DModel* model);
 	void SetS3oTexture(int num);
 
+	/// called once per draw-frame, uploads decoded streamed textures
+	void Update();
+
 public:
 	const S3OTexMat* GetS3oTex(unsigned int num) {
 		if (num < textures.size())
@@ -53,10 +73,29 @@ public:
 	}
 
 private:
-	unsigned int LoadTexture(const S3DModel* model, const std::string& textureName, bool isTex1, bool preload);
+	/// what decoding a texture needs from its model, copied by value
+	/// since a queued job may outlive the model (see DecodeThreadLoop)
+	struct DecodeJob {
+		DecodeJob(const S3DModel* model, const std::string& textureName, bool isTex1);
+
+		std::string modelName;
+		std::string textureName;
+		bool isTex1;
+		bool invertTexAlpha;
+		bool invertTexYAxis;
+	};
+
+	unsigned int LoadTexture(const S3DModel* model, const std::string& textureName, bool isTex1);
+	void PreloadTexture(const DecodeJob& job);
+	static void DecodeTexture(const DecodeJob& job, CBitmap* bitmap);
 	int LoadS3OTextureNow(const S3DModel* model);
 	unsigned int InsertTextureMat(const S3DModel* model);
 
+	unsigned int UploadTexture(const std::string& textureName, CBitmap* bitmap);
+	unsigned int StreamS3OTexture(const S3DModel* model);
+	void QueueDecode(const S3DModel* model, const std::string& textureName, bool isTex1);
+	void DecodeThreadLoop();
+
 private:
 	typedef boost::unordered_map<std::string, CachedS3OTex> TextureCache;
 	typedef boost::unordered_map<std::string, CBitmap*> BitmapCache;
@@ -68,6 +107,26 @@ private:
 	spring::mutex cacheMutex;
 
 	std::vector<S3OTexMat> textures;
+
+private:
+	struct StreamedTexMat {
+		const S3DModel* model;
+		unsigned int num; ///< index into textures, still has the placeholders
+	};
+	/// only touched by the main thread
+	std::vector<StreamedTexMat> streamedMats;
+	unsigned int placeholderTex[2];
+	/// set once the game is drawn, textures loaded before are uploaded right away
+	bool streaming;
+	bool allowStreaming;
+	float streamingBudget;
+
+	/// guarded by cacheMutex
+	std::deque<DecodeJob> decodeJobs;
+	std::set<std::string> decodingTextures;
+	boost::condition_variable_any decodeJobAdded;
+	boost::thread* decodeThread;
+	bool stopDecoding;
 };
 
 extern CS3OTextureHandler* texturehandlerS3O;
@@ -146,6 +146,7 @@ void CWorldDrawer::Update(bool newSimFrame)
 	// lineDrawer.UpdateLineStipple();
 	treeDrawer->Update();
 	featureDrawer->Update();
+	texturehandlerS3O->Update();
 	IWater::ApplyPushedChanges(game);
 
 	if (newSimFrame) {
@@ -44,6 +44,7 @@ public:
 
 	// FIXME temp fix for CBaseGroundDrawer and AI interface, which need raw data
 	unsigned short& front() { return losmap.front(); }
+	const std::vector<unsigned short>& GetData() const { return losmap; }
 
 private:
 	void LosAdd(SLosInstance* instance) const;
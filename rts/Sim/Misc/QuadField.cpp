@@ -14,6 +14,7 @@
 	#include "Sim/Projectiles/Projectile.h"
 	#include "Sim/Units/Unit.h"
 	#include "Sim/Weapons/PlasmaRepulser.h"
+	#include "System/Platform/Threading.h"
 #endif
 
 #include "System/Util.h"
@@ -282,6 +283,27 @@ std::vector<int> CQuadField::GetQuadsOnRay(const float3 start, const float3 dir,
 
 
 #ifndef UNIT_TEST
+/**
+ * Objects spanning several quads are reported once, queries mark them with
+ * gs->GetTempNum(). The counter and the marks are shared and only used by
+ * the sim (main or load) thread; queries from other threads (asynchronous
+ * Skirmish AIs, running while the main thread draws) leave them alone and
+ * remove duplicates from their own result instead.
+ */
+static inline bool UseTempNums()
+{
+	return (Threading::IsMainThread() || Threading::IsGameLoadThread());
+}
+
+template<typename T>
+static void RemoveDuplicates(std::vector<T*>& objects)
+{
+	// by id, so the order does not depend on the heap layout
+	std::sort(objects.begin(), objects.end(), [](const T* a, const T* b) { return (a->id < b->id); });
+	objects.erase(std::unique(objects.begin(), objects.end()), objects.end());
+}
+
+
 void CQuadField::MovedUnit(CUnit* unit)
 {
 	auto newQuads = std::move(GetQuads(unit->pos, unit->radius));
@@ -450,31 +472,38 @@ void CQuadField::RemoveProjectile(CProjectile* p)
 std::vector<CUnit*> CQuadField::GetUnits(const float3& pos, float radius)
 {
 	const auto& quads = GetQuads(pos, radius);
-	const int tempNum = gs->GetTempNum();
+	const bool useTempNums = UseTempNums();
+	const int tempNum = useTempNums? gs->GetTempNum(): 0;
 	std::vector<CUnit*> units;
 
 	for (const int qi: quads) {
 		for (CUnit* u: baseQuads[qi].units) {
-			if (u->tempNum == tempNum)
+			if (useTempNums && u->tempNum == tempNum)
 				continue;
 
-			u->tempNum = tempNum;
+			if (useTempNums)
+				u->tempNum = tempNum;
+
 			units.push_back(u);
 		}
 	}
 
+	if (!useTempNums)
+		RemoveDuplicates(units);
+
 	return units;
 }
 
 std::vector<CUnit*> CQuadField::GetUnitsExact(const float3& pos, float radius, bool spherical)
 {
 	const auto& quads = GetQuads(pos, radius);
-	const int tempNum = gs->GetTempNum();
+	const bool useTempNums = UseTempNums();
+	const int tempNum = useTempNums? gs->GetTempNum(): 0;
 	std::vector<CUnit*> units;
 
 	for (const int qi: quads) {
 		for (CUnit* u: baseQuads[qi].units) {
-			if (u->tempNum == tempNum)
+			if (useTempNums && u->tempNum == tempNum)
 				continue;
 
 			const float totRad       = radius + u->radius;
@@ -486,33 +515,44 @@ std::vector<CUnit*> CQuadField::GetUnitsExact(const float3& pos, float radius, b
 			if (posUnitDstSq >= totRadSq)
 				continue;
 
-			u->tempNum = tempNum;
+			if (useTempNums)
+				u->tempNum = tempNum;
+
 			units.push_back(u);
 		}
 	}
 
+	if (!useTempNums)
+		RemoveDuplicates(units);
+
 	return units;
 }
 
 std::vector<CUnit*> CQuadField::GetUnitsExact(const float3& mins, const float3& maxs)
 {
 	const auto& quads = GetQuadsRectangle(mins, maxs);
-	const int tempNum = gs->GetTempNum();
+	const bool useTempNums = UseTempNums();
+	const int tempNum = useTempNums? gs->GetTempNum(): 0;
 	std::vector<CUnit*> units;
 
 	for (const int qi: quads) {
 		for (CUnit* unit: baseQuads[qi].units) {
 			const float3& pos = unit->pos;
 
-			if (unit->tempNum == tempNum) { continue; }
+			if (useTempNums && unit->tempNum == tempNum) { continue; }
 			if (pos.x < mins.x || pos.x > maxs.x) { continue; }
 			if (pos.z < mins.z || pos.z > maxs.z) { continue; }
 
-			unit->tempNum = tempNum;
+			if (useTempNums)
+				unit->tempNum = tempNum;
+
 			units.push_back(unit);
 		}
 	}
 
+	if (!useTempNums)
+		RemoveDuplicates(units);
+
 	return units;
 }
 
@@ -520,12 +560,13 @@ std::vector<CUnit*> CQuadField::GetUnitsExact(const float3& mins, const float3&
 std::vector<CFeature*> CQuadField::GetFeaturesExact(const float3& pos, float radius, bool spherical)
 {
 	const auto& quads = GetQuads(pos, radius);
-	const int tempNum = gs->GetTempNum();
+	const bool useTempNums = UseTempNums();
+	const int tempNum = useTempNums? gs->GetTempNum(): 0;
 	std::vector<CFeature*> features;
 
 	for (const int qi: quads) {
 		for (CFeature* f: baseQuads[qi].features) {
-			if (f->tempNum == tempNum)
+			if (useTempNums && f->tempNum == tempNum)
 				continue;
 
 			const float totRad       = radius + f->radius;
@@ -537,33 +578,44 @@ std::vector<CFeature*> CQuadField::GetFeaturesExact(const float3& pos, float rad
 			if (posDstSq >= totRadSq)
 				continue;
 
-			f->tempNum = tempNum;
+			if (useTempNums)
+				f->tempNum = tempNum;
+
 			features.push_back(f);
 		}
 	}
 
+	if (!useTempNums)
+		RemoveDuplicates(features);
+
 	return features;
 }
 
 std::vector<CFeature*> CQuadField::GetFeaturesExact(const float3& mins, const float3& maxs)
 {
 	const auto& quads = GetQuadsRectangle(mins, maxs);
-	const int tempNum = gs->GetTempNum();
+	const bool useTempNums = UseTempNums();
+	const int tempNum = useTempNums? gs->GetTempNum(): 0;
 	std::vector<CFeature*> features;
 
 	for (const int qi: quads) {
 		for (CFeature* feature: baseQuads[qi].features) {
 			const float3& pos = feature->pos;
 
-			if (feature->tempNum == tempNum) { continue; }
+			if (useTempNums && feature->tempNum == tempNum) { continue; }
 			if (pos.x < mins.x || pos.x > maxs.x) { continue; }
 			if (pos.z < mins.z || pos.z > maxs.z) { continue; }
 
-			feature->tempNum = tempNum;
+			if (useTempNums)
+				feature->tempNum = tempNum;
+
 			features.push_back(feature);
 		}
 	}
 
+	if (!useTempNums)
+		RemoveDuplicates(features);
+
 	return features;
 }
 
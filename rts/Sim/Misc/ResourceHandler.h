@@ -92,6 +92,8 @@ public:
 	 * @return	resource map analyzer
 	 *
 	 * Returns the resource map analyzer by index.
+	 * The analyzer is created on the first call, which is not thread-safe
+	 * (see CSkirmishAIWrapper::CreateCallback).
 	 */
 	const CResourceMapAnalyzer* GetResourceMapAnalyzer(int resourceId);
 
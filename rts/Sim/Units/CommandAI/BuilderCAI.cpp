@@ -13,6 +13,7 @@
 #include "Map/MapDamage.h"
 #include "Sim/Features/Feature.h"
 #include "Sim/Features/FeatureHandler.h"
+#include "Sim/Misc/GlobalSynced.h"
 #include "Sim/Misc/GroundBlockingObjectMap.h"
 #include "Sim/Misc/QuadField.h"
 #include "Sim/Misc/Team.h"
@@ -31,6 +32,8 @@
 #include "System/Log/ILog.h"
 #include "System/creg/STL_Map.h"
 
+#include <unordered_map>
+
 
 CR_BIND_DERIVED(CBuilderCAI ,CMobileCAI , )
 
@@ -59,6 +62,303 @@ CUnitSet CBuilderCAI::featureReclaimers;
 CUnitSet CBuilderCAI::resurrecters;
 
 
+
+/**
+ * Maps the target-ID of each builder's current CMD_RECLAIM or CMD_RESURRECT
+ * to the builders pursuing it, so the IsXBeingY checks made for every
+ * candidate of an area search do not have to walk all reclaimers.
+ *
+ * A builder's queue can change (new orders, Lua, FinishCommand) without it
+ * executing its command again, so whenever any command queue changed since
+ * the last lookup all registered builders are re-bucketed by their current
+ * target first. That is one pass per area search instead of one per
+ * candidate; builders no longer reclaiming (resurrecting) are dropped like
+ * the plain CUnitSet scans did.
+ */
+class CBuilderTargetIndex
+{
+public:
+	CBuilderTargetIndex(int _cmdID, CUnitSet& _units): cmdID(_cmdID), units(_units), numQueueChanges(0) {}
+
+	void Clear() {
+		units.clear();
+		targetUnits.clear();
+		unitTargets.clear();
+		numQueueChanges = CCommandQueue::GetNumChanges() - 1;
+	}
+
+	void Insert(CUnit* unit) {
+		units.insert(unit);
+
+		const int targetID = GetTargetID(unit);
+		const auto it = unitTargets.find(unit);
+
+		if (it != unitTargets.end()) {
+			if (it->second == targetID)
+				return;
+
+			EraseFromBucket(unit, it->second);
+		}
+
+		unitTargets[unit] = targetID;
+
+		if (targetID >= 0)
+			targetUnits[targetID].push_back(unit);
+	}
+
+	void Erase(CUnit* unit) {
+		units.erase(unit);
+
+		const auto it = unitTargets.find(unit);
+
+		if (it == unitTargets.end())
+			return;
+
+		EraseFromBucket(unit, it->second);
+		unitTargets.erase(it);
+	}
+
+	bool IsTargeted(int targetID, const CUnit* friendUnit) {
+		if (numQueueChanges != CCommandQueue::GetNumChanges())
+			Refresh();
+
+		const auto it = targetUnits.find(targetID);
+
+		if (it == targetUnits.end())
+			return false;
+
+		bool retval = false;
+
+		// NOTE: Insert and Erase modify the buckets, so defer them
+		std::vector<CUnit*> staleUnits;
+
+		for (CUnit* unit: it->second) {
+			if (GetTargetID(unit) != targetID) {
+				staleUnits.push_back(unit);
+				continue;
+			}
+			if (friendUnit == NULL || teamHandler->Ally(friendUnit->allyteam, unit->allyteam)) {
+				retval = true;
+				break;
+			}
+		}
+
+		for (CUnit* unit: staleUnits) {
+			if (GetTargetID(unit) < 0) {
+				Erase(unit);
+			} else {
+				Insert(unit);
+			}
+		}
+
+		return retval;
+	}
+
+private:
+	void Refresh() {
+		numQueueChanges = CCommandQueue::GetNumChanges();
+
+		// NOTE: Insert and Erase modify the set, so defer them
+		std::vector<CUnit*> staleUnits;
+
+		for (CUnit* unit: units) {
+			const auto it = unitTargets.find(unit);
+
+			if (it == unitTargets.end() || it->second != GetTargetID(unit))
+				staleUnits.push_back(unit);
+		}
+
+		for (CUnit* unit: staleUnits) {
+			if (GetTargetID(unit) < 0) {
+				Erase(unit);
+			} else {
+				Insert(unit);
+			}
+		}
+	}
+
+	int GetTargetID(const CUnit* unit) const {
+		const CCommandQueue& q = unit->commandAI->commandQue;
+
+		if (q.empty())
+			return -1;
+
+		const Command& c = q.front();
+
+		if (c.GetID() != cmdID)
+			return -1;
+
+		switch (cmdID) {
+			case CMD_RECLAIM: {
+				if (c.params.size() != 1 && c.params.size() != 5)
+					return -1;
+			} break;
+			default: {
+				if (c.params.size() != 1)
+					return -1;
+			} break;
+		}
+
+		return int(c.params[0]);
+	}
+
+	void EraseFromBucket(CUnit* unit, int targetID) {
+		const auto it = targetUnits.find(targetID);
+
+		if (it == targetUnits.end())
+			return;
+
+		VectorErase(it->second, unit);
+
+		if (it->second.empty())
+			targetUnits.erase(it);
+	}
+
+private:
+	const int cmdID;
+
+	CUnitSet& units;
+
+	std::unordered_map<int, std::vector<CUnit*> > targetUnits;
+	std::unordered_map<const CUnit*, int> unitTargets;
+
+	unsigned int numQueueChanges;
+};
+
+
+/**
+ * Builders given the same area command (e.g. a few hundred cons told to
+ * area-reclaim one field) all search the same circle; QuadField results
+ * are cached per frame so only the first of them pays for the query.
+ *
+ * Only IDs are stored and objects are re-tested on retrieval, so units or
+ * features that died or moved out of the circle are never returned. Those
+ * created after the query are picked up from the next frame on.
+ */
+class CAreaSearchCache
+{
+public:
+	CAreaSearchCache(): frameNum(-1) {}
+
+	void Clear() {
+		frameNum = -1;
+		unitQueries.clear();
+		featureQueries.clear();
+	}
+
+	std::vector<CUnit*> GetUnits(const float3& pos, float radius) {
+		const std::vector<int>* ids = FindQuery(unitQueries, pos, radius);
+		std::vector<CUnit*> units;
+
+		if (ids == NULL) {
+			units = quadField->GetUnitsExact(pos, radius, false);
+
+			if (unitQueries.size() < MAX_QUERIES)
+				unitQueries.push_back(MakeQuery(units, pos, radius));
+
+			return units;
+		}
+
+		units.reserve(ids->size());
+
+		for (const int id: *ids) {
+			CUnit* u = unitHandler->GetUnit(id);
+
+			if (u == NULL || !InSearchArea(u, pos, radius))
+				continue;
+
+			units.push_back(u);
+		}
+
+		return units;
+	}
+
+	std::vector<CFeature*> GetFeatures(const float3& pos, float radius) {
+		const std::vector<int>* ids = FindQuery(featureQueries, pos, radius);
+		std::vector<CFeature*> features;
+
+		if (ids == NULL) {
+			features = quadField->GetFeaturesExact(pos, radius, false);
+
+			if (featureQueries.size() < MAX_QUERIES)
+				featureQueries.push_back(MakeQuery(features, pos, radius));
+
+			return features;
+		}
+
+		features.reserve(ids->size());
+
+		for (const int id: *ids) {
+			CFeature* f = featureHandler->GetFeature(id);
+
+			if (f == NULL || !InSearchArea(f, pos, radius))
+				continue;
+
+			features.push_back(f);
+		}
+
+		return features;
+	}
+
+private:
+	struct Query {
+		float3 pos;
+		float radius;
+		std::vector<int> ids;
+	};
+
+	// same test as the non-spherical QuadField::Get*Exact
+	static bool InSearchArea(const CSolidObject* o, const float3& pos, float radius) {
+		return (pos.SqDistance2D(o->pos) < Square(radius + o->radius));
+	}
+
+	template<typename T>
+	static Query MakeQuery(const std::vector<T*>& objects, const float3& pos, float radius) {
+		Query q;
+		q.pos = pos;
+		q.radius = radius;
+		q.ids.reserve(objects.size());
+
+		for (const T* o: objects) {
+			q.ids.push_back(o->id);
+		}
+
+		return q;
+	}
+
+	const std::vector<int>* FindQuery(std::vector<Query>& queries, const float3& pos, float radius) {
+		if (frameNum != gs->frameNum) {
+			frameNum = gs->frameNum;
+			unitQueries.clear();
+			featureQueries.clear();
+			return NULL;
+		}
+
+		for (const Query& q: queries) {
+			if (q.radius == radius && q.pos.x == pos.x && q.pos.z == pos.z)
+				return &q.ids;
+		}
+
+		return NULL;
+	}
+
+private:
+	static const size_t MAX_QUERIES = 64;
+
+	int frameNum;
+
+	std::vector<Query> unitQueries;
+	std::vector<Query> featureQueries;
+};
+
+
+static CBuilderTargetIndex reclaimerIndex(CMD_RECLAIM, CBuilderCAI::reclaimers);
+static CBuilderTargetIndex featureReclaimerIndex(CMD_RECLAIM, CBuilderCAI::featureReclaimers);
+static CBuilderTargetIndex resurrecterIndex(CMD_RESURRECT, CBuilderCAI::resurrecters);
+
+static CAreaSearchCache areaSearchCache;
+
+
 static std::string GetUnitDefBuildOptionToolTip(const UnitDef* ud, bool disabled) {
 	std::string tooltip;
 
@@ -228,9 +528,10 @@ CBuilderCAI::~CBuilderCAI()
 
 void CBuilderCAI::InitStatic()
 {
-	reclaimers.clear();
-	featureReclaimers.clear();
-	resurrecters.clear();
+	reclaimerIndex.Clear();
+	featureReclaimerIndex.Clear();
+	resurrecterIndex.Clear();
+	areaSearchCache.Clear();
 }
 
 void CBuilderCAI::PostLoad()
@@ -1345,126 +1646,58 @@ int CBuilderCAI::GetDefaultCmd(const CUnit* pointed, const CFeature* feature)
 
 void CBuilderCAI::AddUnitToReclaimers(CUnit* unit)
 {
-	reclaimers.insert(unit);
+	reclaimerIndex.Insert(unit);
 }
 
 
 void CBuilderCAI::RemoveUnitFromReclaimers(CUnit* unit)
 {
-	reclaimers.erase(unit);
+	reclaimerIndex.Erase(unit);
 }
 
 
 void CBuilderCAI::AddUnitToFeatureReclaimers(CUnit* unit)
 {
-	featureReclaimers.insert(unit);
+	featureReclaimerIndex.Insert(unit);
 }
 
 void CBuilderCAI::RemoveUnitFromFeatureReclaimers(CUnit* unit)
 {
-	featureReclaimers.erase(unit);
+	featureReclaimerIndex.Erase(unit);
 }
 
 void CBuilderCAI::AddUnitToResurrecters(CUnit* unit)
 {
-	resurrecters.insert(unit);
+	resurrecterIndex.Insert(unit);
 }
 
 void CBuilderCAI::RemoveUnitFromResurrecters(CUnit* unit)
 {
-	resurrecters.erase(unit);
+	resurrecterIndex.Erase(unit);
 }
 
 
 /**
  * Checks if a unit is being reclaimed by a friendly con.
  *
- * We assume that there will not be a lot of reclaimers, because performance
- * would suck if there were. Ideally, reclaimers should be assigned on a
- * per-unit basis, but this requires tracking of deaths, which albeit
- * already done, is not exactly simple to follow.
- *
- * TODO easy: store reclaiming units per allyteam
- * TODO harder: update reclaimers as they start/finish reclaims and/or die
+ * Reclaimers are indexed by target (see CBuilderTargetIndex), so this
+ * stays cheap even with hundreds of area-reclaiming builders.
  */
 bool CBuilderCAI::IsUnitBeingReclaimed(const CUnit* unit, CUnit *friendUnit)
 {
-	bool retval = false;
-	std::list<CUnit*> rm;
-
-	for (CUnitSet::iterator it = reclaimers.begin(); it != reclaimers.end(); ++it) {
-		if ((*it)->commandAI->commandQue.empty()) {
-			rm.push_back(*it);
-			continue;
-		}
-		const Command& c = (*it)->commandAI->commandQue.front();
-		if (c.GetID() != CMD_RECLAIM || (c.params.size() != 1 && c.params.size() != 5)) {
-			rm.push_back(*it);
-			continue;
-		}
-		const int cmdUnitId = (int)c.params[0];
-		if (cmdUnitId == unit->id && (!friendUnit || teamHandler->Ally(friendUnit->allyteam, (*it)->allyteam))) {
-			retval = true;
-			break;
-		}
-	}
-	for (std::list<CUnit*>::iterator it = rm.begin(); it != rm.end(); ++it)
-		RemoveUnitFromReclaimers(*it);
-	return retval;
+	return reclaimerIndex.IsTargeted(unit->id, friendUnit);
 }
 
 
 bool CBuilderCAI::IsFeatureBeingReclaimed(int featureId, CUnit *friendUnit)
 {
-	bool retval = false;
-	std::list<CUnit*> rm;
-
-	for (CUnitSet::iterator it = featureReclaimers.begin(); it != featureReclaimers.end(); ++it) {
-		if ((*it)->commandAI->commandQue.empty()) {
-			rm.push_back(*it);
-			continue;
-		}
-		const Command& c = (*it)->commandAI->commandQue.front();
-		if (c.GetID() != CMD_RECLAIM || (c.params.size() != 1 && c.params.size() != 5)) {
-			rm.push_back(*it);
-			continue;
-		}
-		const int cmdFeatureId = (int)c.params[0];
-		if (cmdFeatureId-unitHandler->MaxUnits() == featureId && (!friendUnit || teamHandler->Ally(friendUnit->allyteam, (*it)->allyteam))) {
-			retval = true;
-			break;
-		}
-	}
-	for (std::list<CUnit*>::iterator it = rm.begin(); it != rm.end(); ++it)
-		RemoveUnitFromFeatureReclaimers(*it);
-	return retval;
+	return featureReclaimerIndex.IsTargeted(unitHandler->MaxUnits() + featureId, friendUnit);
 }
 
 
 bool CBuilderCAI::IsFeatureBeingResurrected(int featureId, CUnit *friendUnit)
 {
-	bool retval = false;
-	std::list<CUnit*> rm;
-
-	for (CUnitSet::iterator it = resurrecters.begin(); it != resurrecters.end(); ++it) {
-		if ((*it)->commandAI->commandQue.empty()) {
-			rm.push_back(*it);
-			continue;
-		}
-		const Command& c = (*it)->commandAI->commandQue.front();
-		if (c.GetID() != CMD_RESURRECT || c.params.size() != 1) {
-			rm.push_back(*it);
-			continue;
-		}
-		const int cmdFeatureId = (int)c.params[0];
-		if (cmdFeatureId-unitHandler->MaxUnits() == featureId && (!friendUnit || teamHandler->Ally(friendUnit->allyteam, (*it)->allyteam))) {
-			retval = true;
-			break;
-		}
-	}
-	for (std::list<CUnit*>::iterator it = rm.begin(); it != rm.end(); ++it)
-		RemoveUnitFromResurrecters(*it);
-	return retval;
+	return resurrecterIndex.IsTargeted(unitHandler->MaxUnits() + featureId, friendUnit);
 }
 
 
@@ -1496,7 +1729,7 @@ int CBuilderCAI::FindReclaimTarget(const float3& pos, float radius, unsigned cha
 	int rid = -1;
 
 	if (recUnits || recEnemy || recEnemyOnly) {
-		const std::vector<CUnit*>& units = quadField->GetUnitsExact(pos, radius, false);
+		const std::vector<CUnit*>& units = areaSearchCache.GetUnits(pos, radius);
 		for (std::vector<CUnit*>::const_iterator ui = units.begin(); ui != units.end(); ++ui) {
 			const CUnit* u = *ui;
 
@@ -1536,7 +1769,7 @@ int CBuilderCAI::FindReclaimTarget(const float3& pos, float radius, unsigned cha
 	if ((!best || !stationary) && !recEnemyOnly) {
 		best = NULL;
 		const CTeam* team = teamHandler->Team(owner->team);
-		const std::vector<CFeature*>& features = quadField->GetFeaturesExact(pos, radius, false);
+		const std::vector<CFeature*>& features = areaSearchCache.GetFeatures(pos, radius);
 		bool metal = false;
 		for (std::vector<CFeature*>::const_iterator fi = features.begin(); fi != features.end(); ++fi) {
 			const CFeature* f = *fi;
@@ -1607,7 +1840,7 @@ bool CBuilderCAI::FindResurrectableFeatureAndResurrect(const float3& pos,
                                                        unsigned char options,
 													   bool freshOnly)
 {
-	const std::vector<CFeature*> &features = quadField->GetFeaturesExact(pos, radius, false);
+	const std::vector<CFeature*> &features = areaSearchCache.GetFeatures(pos, radius);
 
 	const CFeature* best = NULL;
 	float bestDist = 1.0e30f;
@@ -1650,7 +1883,7 @@ bool CBuilderCAI::FindCaptureTargetAndCapture(const float3& pos, float radius,
                                               unsigned char options,
 											  bool healthyOnly)
 {
-	const std::vector<CUnit*> &cu = quadField->GetUnitsExact(pos, radius, false);
+	const std::vector<CUnit*> &cu = areaSearchCache.GetUnits(pos, radius);
 	std::vector<CUnit*>::const_iterator ui;
 
 	const CUnit* best = NULL;
@@ -1699,7 +1932,7 @@ bool CBuilderCAI::FindRepairTargetAndRepair(const float3& pos, float radius,
                                             bool attackEnemy,
 											bool builtOnly)
 {
-	const std::vector<CUnit*>& cu = quadField->GetUnitsExact(pos, radius, false);
+	const std::vector<CUnit*>& cu = areaSearchCache.GetUnits(pos, radius);
 	const CUnit* bestUnit = NULL;
 
 	const float maxSpeed = owner->moveType->GetMaxSpeed();
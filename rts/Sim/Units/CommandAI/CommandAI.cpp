@@ -49,6 +49,8 @@ CR_REG_METADATA(CCommandQueue, (
 	CR_MEMBER(tagCounter)
 ))
 
+unsigned int CCommandQueue::numChanges = 0;
+
 CR_BIND_DERIVED(CCommandAI, CObject, )
 CR_REG_METADATA(CCommandAI, (
 	CR_MEMBER(stockpileWeapon),
@@ -47,23 +47,28 @@ class CCommandQueue {
 
 		inline void pop_back()
 		{
+			numChanges++;
 			queue.pop_back();
 		}
 		inline void pop_front()
 		{
+			numChanges++;
 			queue.pop_front();
 		}
 
 		inline iterator erase(iterator pos)
 		{
+			numChanges++;
 			return queue.erase(pos);
 		}
 		inline iterator erase(iterator first, iterator last)
 		{
+			numChanges++;
 			return queue.erase(first, last);
 		}
 		inline void clear()
 		{
+			numChanges++;
 			queue.clear();
 		}
 
@@ -88,6 +93,14 @@ class CCommandQueue {
 		inline       Command& operator[](size_type i)       { return queue[i]; }
 		inline const Command& operator[](size_type i) const { return queue[i]; }
 
+		/**
+		 * Counts insertions and removals in all queues, lets indices over
+		 * the commands of many units (see CBuilderTargetIndex) tell cheaply
+		 * whether they are still up to date. Commands modified in place
+		 * through the non-const accessors are not counted.
+		 */
+		static unsigned int GetNumChanges() { return numChanges; }
+
 	private:
 		CCommandQueue() : queueType(CommandQueueType), tagCounter(0) {};
 		CCommandQueue(const CCommandQueue&);
@@ -101,6 +114,8 @@ class CCommandQueue {
 		std::deque<Command> queue;
 		QueueType queueType;
 		int tagCounter;
+
+		static unsigned int numChanges;
 };
 
 
@@ -116,6 +131,7 @@ inline int CCommandQueue::GetNextTag()
 
 inline void CCommandQueue::push_back(const Command& cmd)
 {
+	numChanges++;
 	queue.push_back(cmd);
 	queue.back().tag = GetNextTag();
 }
@@ -123,6 +139,7 @@ inline void CCommandQueue::push_back(const Command& cmd)
 
 inline void CCommandQueue::push_front(const Command& cmd)
 {
+	numChanges++;
 	queue.push_front(cmd);
 	queue.front().tag = GetNextTag();
 }
@@ -133,6 +150,7 @@ inline CCommandQueue::iterator CCommandQueue::insert(iterator pos,
 {
 	Command tmpCmd = cmd;
 	tmpCmd.tag = GetNextTag();
+	numChanges++;
 	return queue.insert(pos, tmpCmd);
 }
 
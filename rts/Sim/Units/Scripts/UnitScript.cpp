@@ -86,19 +86,9 @@ CUnitScript::CUnitScript(CUnit* unit)
 
 CUnitScript::~CUnitScript()
 {
-	bool haveAnimations = false;
-
-	for (int animType = ATurn; animType <= AMove; animType++) {
-		for (std::list<AnimInfo*>::iterator i = anims[animType].begin(); i != anims[animType].end(); ++i) {
-			// anim listeners are not owned by the anim in general, so don't delete them here
-			delete *i;
-		}
-
-		haveAnimations = (haveAnimations || !anims[animType].empty());
-	}
-
+	// anim listeners are not owned by the anim in general, so don't delete them here
 	// Remove us from possible animation ticking
-	if (haveAnimations)
+	if (HaveAnimations())
 		GUnitScriptEngine.RemoveInstance(this);
 }
 
@@ -108,15 +98,36 @@ CUnitScript::~CUnitScript()
 
 /**
  * @brief Unblocks all threads waiting on an animation
- * @param anim AnimInfo the corresponding animation
+ * @param type AnimType of the animation
+ * @param piece int piece of the animation
+ * @param axis int axis of the animation
  */
-void CUnitScript::UnblockAll(AnimInfo* anim)
+void CUnitScript::UnblockAll(AnimType type, int piece, int axis)
 {
-	std::list<IAnimListener *>::iterator li;
+	// the listeners are taken out before any is notified, AnimFinished can
+	// add new ones; nested calls (via RemoveAnim) use the space behind ours
+	const size_t start = unblockedListeners.size();
+	size_t numKept = 0;
+
+	for (size_t n = 0; n < animListeners.size(); n++) {
+		const AnimListener& al = animListeners[n];
+
+		if (al.type == type && al.piece == piece && al.axis == axis) {
+			unblockedListeners.push_back(al.listener);
+		} else {
+			animListeners[numKept++] = al;
+		}
+	}
+
+	animListeners.resize(numKept);
+
+	const size_t end = unblockedListeners.size();
 
-	for (li = anim->listeners.begin(); li != anim->listeners.end(); ++li) {
-		(*li)->AnimFinished(anim->type, anim->piece, anim->axis);
+	for (size_t n = start; n < end; n++) {
+		unblockedListeners[n]->AnimFinished(type, piece, axis);
 	}
+
+	unblockedListeners.resize(start);
 }
 
 
@@ -217,50 +228,52 @@ bool CUnitScript::DoSpin(float& cur, float dest, float &speed, float accel, int
 
 
 
-void CUnitScript::TickAnims(int deltaTime, AnimType type, std::list< std::list<AnimInfo*>::iterator >& doneAnims) {
+void CUnitScript::TickAnims(int deltaTime, AnimType type) {
+	std::vector<AnimInfo>& typeAnims = anims[type];
+
 	switch (type) {
 		case AMove: {
-			for (std::list<AnimInfo*>::iterator it = anims[type].begin(); it != anims[type].end(); ++it) {
-				AnimInfo* ai = *it;
+			for (AnimInfo& ai: typeAnims) {
+				LocalModelPiece* lmp = pieces[ai.piece];
 
 				// NOTE: we should not need to copy-and-set here, because
 				// MoveToward/TurnToward/DoSpin modify pos/rot by reference
-				float3 pos = pieces[ai->piece]->GetPosition();
+				float3 pos = lmp->GetPosition();
 
-				if (MoveToward(pos[ai->axis], ai->dest, ai->speed / (1000 / deltaTime))) {
-					ai->done = true; doneAnims.push_back(it);
+				if (MoveToward(pos[ai.axis], ai.dest, ai.speed / (1000 / deltaTime))) {
+					ai.done = true; doneAnims.push_back({type, ai.piece, ai.axis});
 				}
 
-				pieces[ai->piece]->SetPosition(pos);
-				unit->localModel.PieceUpdated(ai->piece);
+				lmp->SetPosition(pos);
+				unit->localModel.PieceUpdated(ai.piece);
 			}
 		} break;
 
 		case ATurn: {
-			for (std::list<AnimInfo*>::iterator it = anims[type].begin(); it != anims[type].end(); ++it) {
-				AnimInfo* ai = *it;
-				float3 rot = pieces[ai->piece]->GetRotation();
+			for (AnimInfo& ai: typeAnims) {
+				LocalModelPiece* lmp = pieces[ai.piece];
+				float3 rot = lmp->GetRotation();
 
-				if (TurnToward(rot[ai->axis], ai->dest, ai->speed / (1000 / deltaTime))) {
-					ai->done = true; doneAnims.push_back(it);
+				if (TurnToward(rot[ai.axis], ai.dest, ai.speed / (1000 / deltaTime))) {
+					ai.done = true; doneAnims.push_back({type, ai.piece, ai.axis});
 				}
 
-				pieces[ai->piece]->SetRotation(rot);
-				unit->localModel.PieceUpdated(ai->piece);
+				lmp->SetRotation(rot);
+				unit->localModel.PieceUpdated(ai.piece);
 			}
 		} break;
 
 		case ASpin: {
-			for (std::list<AnimInfo*>::iterator it = anims[type].begin(); it != anims[type].end(); ++it) {
-				AnimInfo* ai = *it;
-				float3 rot = pieces[ai->piece]->GetRotation();
+			for (AnimInfo& ai: typeAnims) {
+				LocalModelPiece* lmp = pieces[ai.piece];
+				float3 rot = lmp->GetRotation();
 
-				if (DoSpin(rot[ai->axis], ai->dest, ai->speed, ai->accel, 1000 / deltaTime)) {
-					ai->done = true; doneAnims.push_back(it);
+				if (DoSpin(rot[ai.axis], ai.dest, ai.speed, ai.accel, 1000 / deltaTime)) {
+					ai.done = true; doneAnims.push_back({type, ai.piece, ai.axis});
 				}
 
-				pieces[ai->piece]->SetRotation(rot);
-				unit->localModel.PieceUpdated(ai->piece);
+				lmp->SetRotation(rot);
+				unit->localModel.PieceUpdated(ai.piece);
 			}
 		} break;
 
@@ -277,14 +290,12 @@ void CUnitScript::TickAnims(int deltaTime, AnimType type, std::list< std::list<A
  */
 bool CUnitScript::Tick(int deltaTime)
 {
-	typedef std::list<AnimInfo*>::iterator AnimInfoIt;
-
-	// list of _iterators_ to finished animations,
-	// so we can get rid of them in constant time
-	std::list<AnimInfoIt> doneAnims;
+	// keys of the finished animations, in the order they finished
+	// (not indices, those change when listeners add or remove any)
+	doneAnims.clear();
 
 	for (int animType = ATurn; animType <= AMove; animType++) {
-		TickAnims(deltaTime, AnimType(animType), doneAnims);
+		TickAnims(deltaTime, AnimType(animType));
 	}
 
 	//! Tell listeners to unblock, and remove finished animations from the unit/script.
@@ -293,13 +304,16 @@ bool CUnitScript::Tick(int deltaTime)
 	//!     otherwise the callback function (AnimFinished()) can call AddAnimListener()
 	//!     and append it to the listeners-list again (causing an endless loop)!
 	//! NOTE: UnblockAll might result in new anims being added
-	for (std::list<AnimInfoIt>::const_iterator it = doneAnims.begin(); it != doneAnims.end(); ++it) {
-		AnimInfoIt animInfoIt = *it;
-		AnimInfo* animInfo = *animInfoIt;
+	for (size_t n = 0; n < doneAnims.size(); n++) {
+		const AnimKey key = doneAnims[n];
+		const int animIdx = FindAnim(key.type, key.piece, key.axis);
+
+		// already removed by a listener of an earlier one
+		if (animIdx < 0)
+			continue;
 
-		anims[animInfo->type].erase(animInfoIt);
-		UnblockAll(animInfo);
-		delete animInfo;
+		EraseAnim(key.type, animIdx);
+		UnblockAll(key.type, key.piece, key.axis);
 	}
 
 	return (HaveAnimations());
@@ -307,34 +321,49 @@ bool CUnitScript::Tick(int deltaTime)
 
 
 
-std::list<CUnitScript::AnimInfo*>::iterator CUnitScript::FindAnim(AnimType type, int piece, int axis)
+int CUnitScript::FindAnim(AnimType type, int piece, int axis) const
 {
-	for (std::list<AnimInfo*>::iterator i = anims[type].begin(); i != anims[type].end(); ++i) {
-		if (((*i)->piece == piece) && ((*i)->axis == axis))
-			return i;
-	}
+	if (piece < 0 || axis < 0 || axis > 2)
+		return -1;
+
+	const unsigned int idx = (piece * 3 + axis) * (AMove + 1) + type;
 
-	return anims[type].end();
+	if (idx >= animIndices.size())
+		return -1;
+
+	return animIndices[idx];
 }
 
-void CUnitScript::RemoveAnim(AnimType type, const std::list<AnimInfo*>::iterator& animInfoIt)
+void CUnitScript::EraseAnim(AnimType type, int animIdx)
 {
-	if (animInfoIt != anims[type].end()) {
-		AnimInfo* ai = *animInfoIt;
-		anims[type].erase(animInfoIt);
+	std::vector<AnimInfo>& typeAnims = anims[type];
 
-		// If this was the last animation, remove from currently animating list
-		// FIXME: this could be done in a cleaner way
-		if (!HaveAnimations()) {
-			GUnitScriptEngine.RemoveInstance(this);
-		}
+	AnimIndex(type, typeAnims[animIdx].piece, typeAnims[animIdx].axis) = -1;
+	typeAnims.erase(typeAnims.begin() + animIdx);
 
-		//! We need to unblock threads waiting on this animation, otherwise they will be lost in the void
-		//! NOTE: UnblockAll might result in new anims being added
-		UnblockAll(ai);
+	// keep the start order, the later ones move down by one
+	for (int n = animIdx; n < int(typeAnims.size()); n++) {
+		AnimIndex(type, typeAnims[n].piece, typeAnims[n].axis) = n;
+	}
+}
+
+void CUnitScript::RemoveAnim(AnimType type, int animIdx)
+{
+	if (animIdx < 0)
+		return;
 
-		delete ai;
+	const AnimInfo ai = anims[type][animIdx];
+	EraseAnim(type, animIdx);
+
+	// If this was the last animation, remove from currently animating list
+	// FIXME: this could be done in a cleaner way
+	if (!HaveAnimations()) {
+		GUnitScriptEngine.RemoveInstance(this);
 	}
+
+	//! We need to unblock threads waiting on this animation, otherwise they will be lost in the void
+	//! NOTE: UnblockAll might result in new anims being added
+	UnblockAll(type, ai.piece, ai.axis);
 }
 
 
@@ -347,6 +376,13 @@ void CUnitScript::AddAnim(AnimType type, int piece, int axis, float speed, float
 		ShowUnitScriptError("Invalid piecenumber");
 		return;
 	}
+	if (axis < 0 || axis > 2) {
+		ShowUnitScriptError("Invalid axis");
+		return;
+	}
+
+	if (animIndices.size() < (pieces.size() * 3 * (AMove + 1)))
+		animIndices.resize(pieces.size() * 3 * (AMove + 1), -1);
 
 	float destf = 0.0f;
 
@@ -359,8 +395,7 @@ void CUnitScript::AddAnim(AnimType type, int piece, int axis, float speed, float
 		}
 	}
 
-	std::list<AnimInfo*>::iterator animInfoIt;
-	AnimInfo* ai = NULL;
+	int animIdx = -1;
 	AnimType overrideType = ANone;
 
 	// first find an animation of a type we override
@@ -370,66 +405,65 @@ void CUnitScript::AddAnim(AnimType type, int piece, int axis, float speed, float
 	switch (type) {
 		case ATurn: {
 			overrideType = ASpin;
-			animInfoIt = FindAnim(overrideType, piece, axis);
+			animIdx = FindAnim(overrideType, piece, axis);
 		} break;
 		case ASpin: {
 			overrideType = ATurn;
-			animInfoIt = FindAnim(overrideType, piece, axis);
+			animIdx = FindAnim(overrideType, piece, axis);
 		} break;
 		case AMove: {
 			// ensure we never remove an animation of this type
 			overrideType = AMove;
-			animInfoIt = anims[overrideType].end();
+			animIdx = -1;
 		} break;
 		default: {
 		} break;
 	}
 	assert(overrideType >= 0);
 
-	if (animInfoIt != anims[overrideType].end())
-		RemoveAnim(overrideType, animInfoIt);
+	if (animIdx >= 0)
+		RemoveAnim(overrideType, animIdx);
 
 	// now find an animation of our own type
-	animInfoIt = FindAnim(type, piece, axis);
+	animIdx = FindAnim(type, piece, axis);
 
-	if (animInfoIt == anims[type].end()) {
+	if (animIdx < 0) {
 		// If we were not animating before, inform the engine of this so it can schedule us
 		// FIXME: this could be done in a cleaner way
 		if (!HaveAnimations()) {
 			GUnitScriptEngine.AddInstance(this);
 		}
 
-		ai = new AnimInfo();
-		ai->type = type;
-		ai->piece = piece;
-		ai->axis = axis;
-		anims[type].push_back(ai);
-	} else {
-		ai = *animInfoIt;
+		animIdx = anims[type].size();
+		anims[type].push_back(AnimInfo());
+		anims[type][animIdx].piece = piece;
+		anims[type][animIdx].axis = axis;
+		AnimIndex(type, piece, axis) = animIdx;
 	}
 
-	ai->dest  = destf;
-	ai->speed = speed;
-	ai->accel = accel;
-	ai->done = false;
+	AnimInfo& ai = anims[type][animIdx];
+	ai.dest  = destf;
+	ai.speed = speed;
+	ai.accel = accel;
+	ai.done = false;
 }
 
 
 void CUnitScript::Spin(int piece, int axis, float speed, float accel)
 {
-	std::list<AnimInfo*>::iterator animInfoIt = FindAnim(ASpin, piece, axis);
+	const int animIdx = FindAnim(ASpin, piece, axis);
 
 	//If we are already spinning, we may have to decelerate to the new speed
-	if (animInfoIt != anims[ASpin].end()) {
-		AnimInfo* ai = *animInfoIt;
-		ai->dest = speed;
+	if (animIdx >= 0) {
+		AnimInfo& ai = anims[ASpin][animIdx];
+		ai.dest = speed;
 
 		if (accel > 0) {
-			ai->accel = accel;
+			ai.accel = accel;
 		} else {
 			//Go there instantly. Or have a defaul accel?
-			ai->speed = speed;
-			ai->accel = 0;
+			ai.speed = speed;
+			ai.accel = 0;
 		}
 	} else {
 		//No accel means we start at desired speed instantly
@@ -443,17 +477,17 @@ void CUnitScript::Spin(int piece, int axis, float speed, float accel)
 
 void CUnitScript::StopSpin(int piece, int axis, float decel)
 {
-	std::list<AnimInfo*>::iterator animInfoIt = FindAnim(ASpin, piece, axis);
+	const int animIdx = FindAnim(ASpin, piece, axis);
 
 	if (decel <= 0) {
-		RemoveAnim(ASpin, animInfoIt);
+		RemoveAnim(ASpin, animIdx);
 	} else {
-		if (animInfoIt == anims[ASpin].end())
+		if (animIdx < 0)
 			return;
 
-		AnimInfo* ai = *animInfoIt;
-		ai->dest = 0;
-		ai->accel = decel;
+		AnimInfo& ai = anims[ASpin][animIdx];
+		ai.dest = 0;
+		ai.accel = decel;
 	}
 }
 
@@ -720,13 +754,11 @@ void CUnitScript::DropUnit(int u)
 //Returns true if there was an animation to listen to
 bool CUnitScript::AddAnimListener(AnimType type, int piece, int axis, IAnimListener *listener)
 {
-	std::list<AnimInfo*>::iterator animInfoIt = FindAnim(type, piece, axis);
-
-	if (animInfoIt != anims[type].end()) {
-		AnimInfo* ai = *animInfoIt;
+	const int animIdx = FindAnim(type, piece, axis);
 
-		if (!ai->done) {
-			ai->listeners.push_back(listener);
+	if (animIdx >= 0) {
+		if (!anims[type][animIdx].done) {
+			animListeners.push_back({listener, type, piece, axis});
 			return true;
 		}
 
@@ -63,30 +63,55 @@ protected:
 	bool busy;
 
 	struct AnimInfo {
-		AnimType type;
-		int axis;
 		int piece;
+		int axis;
 		float speed;
 		float dest;     // means final position when turning or moving, final speed when spinning
 		float accel;    // used for spinning, can be negative
 		bool done;
-		std::list<IAnimListener*> listeners;
 	};
 
-	std::list<AnimInfo*> anims[AMove + 1];
+	struct AnimListener {
+		IAnimListener* listener;
+		AnimType type;
+		int piece;
+		int axis;
+	};
+
+	struct AnimKey {
+		AnimType type;
+		int piece;
+		int axis;
+	};
+
+	// active animations per type, in the order they were started
+	std::vector<AnimInfo> anims[AMove + 1];
+	// index into anims[type] for each (type, piece, axis), -1 if none;
+	// sized by AddAnim since subclasses fill <pieces> after our ctor
+	std::vector<int> animIndices;
+	// every listener waiting for an animation, in the order they were added
+	std::vector<AnimListener> animListeners;
+
+	// scratch space, kept so that ticking does not allocate
+	std::vector<AnimKey> doneAnims;
+	std::vector<IAnimListener*> unblockedListeners;
 
 	bool hasSetSFXOccupy;
 	bool hasRockUnit;
 	bool hasStartBuilding;
 
-	void UnblockAll(AnimInfo* anim);
+	void UnblockAll(AnimType type, int piece, int axis);
 
 	bool MoveToward(float& cur, float dest, float speed);
 	bool TurnToward(float& cur, float dest, float speed);
 	bool DoSpin(float& cur, float dest, float& speed, float accel, int divisor);
 
-	std::list<AnimInfo*>::iterator FindAnim(AnimType anim, int piece, int axis);
-	void RemoveAnim(AnimType type, const std::list<AnimInfo*>::iterator& animInfoIt);
+	int& AnimIndex(AnimType type, int piece, int axis) {
+		return animIndices[(piece * 3 + axis) * (AMove + 1) + type];
+	}
+	int FindAnim(AnimType type, int piece, int axis) const;
+	void EraseAnim(AnimType type, int animIdx);
+	void RemoveAnim(AnimType type, int animIdx);
 	void AddAnim(AnimType type, int piece, int axis, float speed, float dest, float accel);
 
 	virtual void ShowScriptError(const std::string& msg) = 0;
@@ -139,7 +164,7 @@ public:
 	const CUnit* GetUnit() const { return unit; }
 
 	bool Tick(int deltaTime);
-	void TickAnims(int deltaTime, AnimType type, std::list< std::list<AnimInfo*>::iterator >& doneAnims);
+	void TickAnims(int deltaTime, AnimType type);
 
 	// animation, used by CCobThread
 	void Spin(int piece, int axis, float speed, float accel);
@@ -162,13 +187,13 @@ public:
 	int GetUnitVal(int val, int p1, int p2, int p3, int p4);
 	void SetUnitVal(int val, int param);
 
-	bool IsInAnimation(AnimType type, int piece, int axis) {
-		return (FindAnim(type, piece, axis) != anims[type].end());
+	bool IsInAnimation(AnimType type, int piece, int axis) const {
+		return (FindAnim(type, piece, axis) >= 0);
 	}
 	bool HaveAnimations() const {
 		return (!anims[ATurn].empty() || !anims[ASpin].empty() || !anims[AMove].empty());
 	}
-	inline bool HaveListeners() const;
+	bool HaveListeners() const { return (!animListeners.empty()); }
 
 	// checks for callin existence
 	bool HasSetSFXOccupy () const { return hasSetSFXOccupy; }
@@ -227,15 +252,4 @@ public:
 	virtual float TargetWeight(int weaponNum, const CUnit* targetUnit) = 0; // returns target weight
 };
 
-inline bool CUnitScript::HaveListeners() const {
-	for (int animType = ATurn; animType <= AMove; animType++) {
-		for (std::list<AnimInfo *>::const_iterator i = anims[animType].begin(); i != anims[animType].end(); ++i) {
-			if (!(*i)->listeners.empty()) {
-				return true;
-			}
-		}
-	}
-	return false;
-}
-
 #endif // UNIT_SCRIPT_H
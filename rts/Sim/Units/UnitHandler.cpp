@@ -13,6 +13,7 @@
 #include "System/EventHandler.h"
 #include "System/Log/ILog.h"
 #include "System/myMath.h"
+#include "System/ThreadPool.h"
 #include "System/TimeProfiler.h"
 #include "System/Util.h"
 #include "System/Sync/SyncTracer.h"
@@ -238,14 +239,26 @@ void CUnitHandler::Update()
 
 	{
 		SCOPED_TIMER("Unit::UpdateLocalModel");
-		for (CUnit* unit: activeUnits) {
-			// UnitScript only applies piece-space transforms so
-			// we apply the forward kinematics update separately
-			// (only if we have any dirty pieces)
-			// add ID as offset so the bounding-box update does
-			// not run at the same time for every model
-			unit->localModel.Update(gs->frameNum + unit->id);
-		}
+
+		// units per task, one each would cost more than the update
+		static const int CHUNK_SIZE = 64;
+
+		// every unit only touches its own LocalModel, so this can be
+		// done in parallel (and the results stay the same)
+		for_mt(0, activeUnits.size(), CHUNK_SIZE, [&](const int start) {
+			const int end = std::min(start + CHUNK_SIZE, int(activeUnits.size()));
+
+			for (int i = start; i < end; i++) {
+				CUnit* unit = activeUnits[i];
+
+				// UnitScript only applies piece-space transforms so
+				// we apply the forward kinematics update separately
+				// (only if we have any dirty pieces)
+				// add ID as offset so the bounding-box update does
+				// not run at the same time for every model
+				unit->localModel.Update(gs->frameNum + unit->id);
+			}
+		});
 	}
 
 	{
@@ -1,48 +1,300 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
 #include "CRC.h"
+#include "System/maindefines.h"
 
-extern "C" {
-#include "lib/7z/7zCrc.h"
+#include <cstring>
+#include <boost/cstdint.hpp>
+
+// NOTE:
+//   the values have to stay the same as those of the 7z CrcUpdate used
+//   before (the reflected CRC-32 of zip and png), archive checksums are
+//   compared between clients and cached in ArchiveCache.lua
+//
+//   the engine is built with -mno-sse2, the PCLMULQDQ code is compiled for
+//   its own target and only called when cpuid says the CPU has it
+
+#if (defined(__i386__) || defined(__x86_64__)) && (defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+	#define CRC_HAVE_CLMUL
+	#include <cpuid.h>
+	#include <immintrin.h>
+#endif
+
+
+static const boost::uint32_t CRC_POLY = 0xEDB88320;
+static const boost::uint32_t CRC_INIT_VAL = 0xFFFFFFFF;
+
+
+struct CRCTables {
+	CRCTables() {
+		for (boost::uint32_t i = 0; i < 256; i++) {
+			boost::uint32_t r = i;
+
+			for (int j = 0; j < 8; j++) {
+				r = (r >> 1) ^ (CRC_POLY & ~((r & 1) - 1));
+			}
+
+			t[0][i] = r;
+		}
+
+		for (int k = 1; k < 8; k++) {
+			for (int i = 0; i < 256; i++) {
+				t[k][i] = t[0][t[k - 1][i] & 0xFF] ^ (t[k - 1][i] >> 8);
+			}
+		}
+	}
+
+	// t[k][i] is the CRC of byte i followed by k zero bytes
+	boost::uint32_t t[8][256];
+};
+
+static const CRCTables& GetTables()
+{
+	static const CRCTables tables;
+	return tables;
+}
+
+
+// slice-by-8, reads 8 bytes per step (assumes a little-endian CPU)
+static boost::uint32_t UpdateTables(boost::uint32_t crc, const boost::uint8_t* p, size_t size)
+{
+	const boost::uint32_t (*t)[256] = GetTables().t;
+
+	for (; size >= 8; size -= 8, p += 8) {
+		boost::uint32_t lo;
+		boost::uint32_t hi;
+		memcpy(&lo, p + 0, sizeof(lo));
+		memcpy(&hi, p + 4, sizeof(hi));
+
+		lo ^= crc;
+		crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24]
+		    ^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+	}
+	for (; size > 0; size--, p++) {
+		crc = t[0][(crc ^ *p) & 0xFF] ^ (crc >> 8);
+	}
+
+	return crc;
+}
+
+
+#ifdef CRC_HAVE_CLMUL
+
+static bool CPUHasCLMul()
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return false;
+
+	return ((ecx & bit_PCLMUL) != 0 && (ecx & bit_SSE4_1) != 0);
+}
+
+// folds 64 bytes per step with carry-less multiplication, see Gopal et al.
+// "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction"
+// (Intel, 2009); the constants are those of the paper for the reflected
+// polynomial. size has to be a multiple of 16 and at least 64.
+__FORCE_ALIGN_STACK__
+__attribute__((target("pclmul,sse4.1")))
+static boost::uint32_t UpdateCLMul(boost::uint32_t crc, const boost::uint8_t* p, size_t size)
+{
+	static const boost::uint64_t k1k2[2] = {0x0154442bd4ULL, 0x01c6e41596ULL};
+	static const boost::uint64_t k3k4[2] = {0x01751997d0ULL, 0x00ccaa009eULL};
+	static const boost::uint64_t k5k0[2] = {0x0163cd6124ULL, 0x0000000000ULL};
+	static const boost::uint64_t poly[2] = {0x01db710641ULL, 0x01f7011641ULL};
+
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+	x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x00));
+	x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x10));
+	x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x20));
+	x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x30));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+	x0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(k1k2));
+
+	p += 64;
+	size -= 64;
+
+	// four independent lanes of 16 bytes
+	for (; size >= 64; size -= 64, p += 64) {
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x00)));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x10)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x20)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x30)));
+	}
+
+	// fold the lanes into one
+	x0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(k3k4));
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	for (; size >= 16; size -= 16, p += 16) {
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p))), x5);
+	}
+
+	// 128 to 64 bits
+	x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+	x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+	x1 = _mm_srli_si128(x1, 8);
+	x1 = _mm_xor_si128(x1, x2);
+
+	x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, x3);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	// Barrett reduction to 32 bits
+	x0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(poly));
+
+	x2 = _mm_and_si128(x1, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+	x2 = _mm_and_si128(x2, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	return _mm_extract_epi32(x1, 1);
 }
 
+static bool& UseCLMul()
+{
+	static bool useCLMul = CPUHasCLMul();
+	return useCLMul;
+}
+
+#endif
+
+
+static boost::uint32_t UpdateCRC(boost::uint32_t crc, const void* data, size_t size)
+{
+	const boost::uint8_t* p = static_cast<const boost::uint8_t*>(data);
+
+#ifdef CRC_HAVE_CLMUL
+	if (size >= 64 && UseCLMul()) {
+		const size_t clmulSize = size & ~size_t(15);
+
+		crc = UpdateCLMul(crc, p, clmulSize);
+		p += clmulSize;
+		size -= clmulSize;
+	}
+#endif
+
+	return UpdateTables(crc, p, size);
+}
+
+
+// a * b modulo the polynomial, both bit-reflected (x^0 is the MSB)
+static boost::uint32_t MultModP(boost::uint32_t a, boost::uint32_t b)
+{
+	boost::uint32_t m = 1u << 31;
+	boost::uint32_t p = 0;
+
+	for (; a != 0; m >>= 1) {
+		if ((a & m) != 0) {
+			p ^= b;
+			a ^= m;
+		}
+
+		b = (b & 1) ? ((b >> 1) ^ CRC_POLY) : (b >> 1);
+	}
+
+	return p;
+}
+
+// x^(8 * numBytes) modulo the polynomial
+static boost::uint32_t BytesShiftModP(unsigned int numBytes)
+{
+	boost::uint32_t p = 1u << 31; // x^0
+	boost::uint32_t x2k = 1u << 23; // x^8
+
+	for (; numBytes != 0; numBytes >>= 1) {
+		if ((numBytes & 1) != 0)
+			p = MultModP(x2k, p);
+
+		x2k = MultModP(x2k, x2k);
+	}
+
+	return p;
+}
 
-static bool crcTableInitialized;
 
 
 CRC::CRC()
 {
 	crc = CRC_INIT_VAL;
-	if (!crcTableInitialized) {
-		crcTableInitialized = true;
-		CrcGenerateTable();
-	}
 }
 
 
 unsigned int CRC::GetDigest() const
 {
-	// make a temporary copy to get away with the const
-	unsigned int temp = crc;
-	return CRC_GET_DIGEST(temp);
+	return (crc ^ CRC_INIT_VAL);
 }
 
 
 unsigned int CRC::GetCRC(const void* data, unsigned int size)
 {
-	return CrcUpdate(0, data, size);
+	return UpdateCRC(0, data, size);
 }
 
 
 CRC& CRC::Update(const void* data, unsigned int size)
 {
-	crc = CrcUpdate(crc, data, size);
+	crc = UpdateCRC(crc, data, size);
 	return *this;
 }
 
 
 CRC& CRC::Update(unsigned int data)
 {
-	crc = CrcUpdate(crc, &data, sizeof(unsigned));
+	crc = UpdateCRC(crc, &data, sizeof(unsigned));
+	return *this;
+}
+
+
+CRC& CRC::Combine(unsigned int chunkCRC, unsigned int chunkSize)
+{
+	// the register is linear in its start value: feeding the chunk to crc
+	// gives crc * x^(8 * chunkSize) xor (the chunk fed to 0)
+	crc = MultModP(BytesShiftModP(chunkSize), crc) ^ chunkCRC;
 	return *this;
 }
+
+
+bool CRC::HaveHardwareCRC()
+{
+#ifdef CRC_HAVE_CLMUL
+	return UseCLMul();
+#else
+	return false;
+#endif
+}
+
+void CRC::UseHardwareCRC(bool enable)
+{
+#ifdef CRC_HAVE_CLMUL
+	UseCLMul() = (enable && CPUHasCLMul());
+#endif
+}
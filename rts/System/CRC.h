@@ -5,7 +5,11 @@
 
 #include <string>
 
-/** @brief An updateable CRC-32 checksum. */
+/**
+ * @brief An updateable CRC-32 checksum.
+ * Uses carry-less multiplication (PCLMULQDQ) on CPUs that have it and
+ * slice-by-8 tables otherwise, the results are the same either way.
+ */
 class CRC
 {
 private:
@@ -29,10 +33,26 @@ public:
 	/** @brief Update CRC over the 4 bytes of data. */
 	CRC& Update(unsigned int data);
 
+	/**
+	 * @brief Update CRC over a chunk that was checksummed on its own
+	 * Gives the same result as Update(chunk, chunkSize) when chunkCRC is
+	 * GetCRC(chunk, chunkSize), so chunks of a large buffer can be hashed
+	 * in parallel and then combined in order.
+	 */
+	CRC& Combine(unsigned int chunkCRC, unsigned int chunkSize);
+
 	CRC& operator<<(int data)      { return Up(data); }
 	CRC& operator<<(unsigned data) { return Up(data); }
 	CRC& operator<<(float data)    { return Up(data); }
 
+	/** @brief Whether the PCLMULQDQ code path is used. */
+	static bool HaveHardwareCRC();
+	/**
+	 * @brief Switch between PCLMULQDQ and the tables
+	 * Only has an effect on CPUs that support it, for tests and benchmarks.
+	 */
+	static void UseHardwareCRC(bool enable);
+
 private:
 	unsigned int crc;
 };
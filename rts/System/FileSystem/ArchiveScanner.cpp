@@ -48,6 +48,10 @@ LOG_REGISTER_SECTION_GLOBAL(LOG_SECTION_ARCHIVESCANNER)
 const int INTERNAL_VER = 10;
 CArchiveScanner* archiveScanner = NULL;
 
+// layout of the binary cache, independent of INTERNAL_VER
+static const boost::uint32_t CACHE_FORMAT_VER = 1;
+static const char CACHE_MAGIC[8] = {'s', 'p', 'r', 'a', 'r', 'c', 'c', 0};
+
 
 
 /*
@@ -338,16 +342,35 @@ bool CArchiveScanner::ArchiveData::GetInfoValueBool(const std::string& key) cons
  * CArchiveScanner
  */
 
+static bool IsBaseContent(const std::string& fileName)
+{
+	return ((fileName == "bitmaps.sdz")
+		|| (fileName == "springcontent.sdz")
+		|| (fileName == "maphelper.sdz")
+		|| (fileName == "cursors.sdz"));
+}
+
+static bool IsSameFile(const struct stat& info, const std::string& fpath, unsigned int modified, boost::uint64_t size, const std::string& path)
+{
+	// size is unknown for entries migrated from the lua cache
+	return ((unsigned)info.st_mtime == modified) && ((size == 0) || (size == (boost::uint64_t)info.st_size)) && (fpath == path);
+}
+
+
 CArchiveScanner::CArchiveScanner()
 : isDirty(false)
 {
 	// the "cache" dir is created in DataDirLocater
 	const std:: string cacheFolder = dataDirLocater.GetWriteDirPath() + FileSystem::EnsurePathSepAtEnd(FileSystem::GetCacheBaseDir());
-	cachefile = cacheFolder + IntToString(INTERNAL_VER, "ArchiveCache%i.lua");
-	ReadCacheData(GetFilepath());
+	cachefile = cacheFolder + IntToString(INTERNAL_VER, "ArchiveCache%i.bin");
+
+	if (!ReadCacheData(GetFilepath())) {
+		// migrate from the lua caches of older versions
+		ReadLuaCacheData(cacheFolder + IntToString(INTERNAL_VER, "ArchiveCache%i.lua"));
+	}
 	if (archiveInfos.empty()) {
 		// when versioned ArchiveCache%i.lua is missing or empty, try old unversioned filename
-		ReadCacheData(cacheFolder + "ArchiveCache.lua");
+		ReadLuaCacheData(cacheFolder + "ArchiveCache.lua");
 	}
 
 	const std::vector<std::string>& datadirs = dataDirLocater.GetDataDirPaths();
@@ -407,12 +430,54 @@ void CArchiveScanner::ScanDirs(const std::vector<std::string>& scanDirs, bool do
 		}
 	}*/
 
-	// Create archiveInfos etc. when not being in cache already
+	// Sort out the archives which are cached already
+	std::vector<std::string> newArchives;
+	std::vector<ArchiveInfo*> missingChecksums;
+	std::map<std::string, std::string> seen; // lower-case name -> full name, cached or scheduled
+
 	for (const std::string& archive: foundArchives) {
-		ScanArchive(archive, doChecksum);
+		const std::string lcfn = StringToLower(FileSystem::GetFilename(archive));
+		const auto it = seen.find(lcfn);
+
+		if (it != seen.end()) {
+			LOG_L(L_ERROR, "Found a \"%s\" already in \"%s\", ignoring.", archive.c_str(), it->second.c_str());
+			if (IsBaseContent(lcfn)) {
+				throw user_error(std::string("duplicate base content detected:\n\t") + it->second + std::string("\n\t") + archive
+					+ std::string("\nPlease fix your configuration/installation as this can cause desyncs!"));
+			}
+			continue;
+		}
+
+		// the first copy found wins, whether it is cached or not; a later
+		// copy must not be scanned over it (nor hide a scheduled one)
+		seen[lcfn] = archive;
+
+		if (CheckCachedArchive(archive, doChecksum, &missingChecksums))
+			continue;
+
+		newArchives.push_back(archive);
+	}
+
+	// Create archiveInfos etc. for the new ones, opening archives and
+	// calculating checksums is what takes the time, do that in parallel
+	std::vector<ScanResult> results(newArchives.size());
+
+	for_mt(0, newArchives.size(), [&](const int i) {
+		ScanArchiveFile(newArchives[i], doChecksum, results[i]);
 	#if !defined(DEDICATED) && !defined(UNITSYNC)
 		Watchdog::ClearTimer(WDT_MAIN);
 	#endif
+	});
+	for_mt(0, missingChecksums.size(), [&](const int i) {
+		ArchiveInfo* ai = missingChecksums[i];
+		ai->checksum = GetCRC(ai->path + ai->origName);
+	#if !defined(DEDICATED) && !defined(UNITSYNC)
+		Watchdog::ClearTimer(WDT_MAIN);
+	#endif
+	});
+
+	for (const ScanResult& result: results) {
+		AddScanResult(result);
 	}
 
 	// Now we'll have to parse the replaces-stuff found in the mods
@@ -520,15 +585,17 @@ std::string CArchiveScanner::SearchMapFile(const IArchive* ar, std::string& erro
 	return "";
 }
 
-static bool IsBaseContent(const std::string& fileName)
+void CArchiveScanner::ScanArchive(const std::string& fullName, bool doChecksum)
 {
-	return ((fileName == "bitmaps.sdz")
-		|| (fileName == "springcontent.sdz")
-		|| (fileName == "maphelper.sdz")
-		|| (fileName == "cursors.sdz"));
+	if (CheckCachedArchive(fullName, doChecksum, NULL))
+		return;
+
+	ScanResult result;
+	ScanArchiveFile(fullName, doChecksum, result);
+	AddScanResult(result);
 }
 
-void CArchiveScanner::ScanArchive(const std::string& fullName, bool doChecksum)
+bool CArchiveScanner::CheckCachedArchive(const std::string& fullName, bool doChecksum, std::vector<ArchiveInfo*>* missingChecksums)
 {
 	const std::string fn    = FileSystem::GetFilename(fullName);
 	const std::string fpath = FileSystem::GetDirectory(fullName);
@@ -536,64 +603,85 @@ void CArchiveScanner::ScanArchive(const std::string& fullName, bool doChecksum)
 
 	// Stat file
 	struct stat info = {0};
-	int statfailed = stat(fullName.c_str(), &info);
 
 	// If stat fails, assume the archive is not broken nor cached
-	if (!statfailed) {
-		// Determine whether this archive has earlier be found to be broken
-		std::map<std::string, BrokenArchive>::iterator bai = brokenArchives.find(lcfn);
-		if (bai != brokenArchives.end()) {
-			if ((unsigned)info.st_mtime == bai->second.modified && fpath == bai->second.path) {
-				bai->second.updated = true;
-				return;
-			}
+	if (stat(fullName.c_str(), &info) != 0)
+		return false;
+
+	// Determine whether this archive has earlier be found to be broken
+	std::map<std::string, BrokenArchive>::iterator bai = brokenArchives.find(lcfn);
+	if (bai != brokenArchives.end()) {
+		if (IsSameFile(info, fpath, bai->second.modified, bai->second.size, bai->second.path)) {
+			bai->second.size = info.st_size;
+			bai->second.updated = true;
+			return true;
 		}
+	}
 
-		// Determine whether to rely on the cached info or not
-		std::map<std::string, ArchiveInfo>::iterator aii = archiveInfos.find(lcfn);
-		if (aii != archiveInfos.end()) {
-			// This archive may have been obsoleted, do not process it if so
-			if (!aii->second.replaced.empty()) {
-				return;
-			}
+	// Determine whether to rely on the cached info or not
+	std::map<std::string, ArchiveInfo>::iterator aii = archiveInfos.find(lcfn);
+	if (aii == archiveInfos.end())
+		return false;
 
-			if ((unsigned)info.st_mtime == aii->second.modified && fpath == aii->second.path) {
-				// cache found update checksum if wanted
-				aii->second.updated = true;
-				if (doChecksum && (aii->second.checksum == 0)) {
-					aii->second.checksum = GetCRC(fullName);
-				}
-				return;
+	// This archive may have been obsoleted, do not process it if so
+	if (!aii->second.replaced.empty()) {
+		return true;
+	}
+
+	if (IsSameFile(info, fpath, aii->second.modified, aii->second.size, aii->second.path)) {
+		// cache found update checksum if wanted
+		aii->second.size = info.st_size;
+		aii->second.updated = true;
+		if (doChecksum && (aii->second.checksum == 0)) {
+			if (missingChecksums != NULL) {
+				missingChecksums->push_back(&aii->second);
 			} else {
-				if (aii->second.updated) {
-					const std::string filename = aii->first;
-					LOG_L(L_ERROR, "Found a \"%s\" already in \"%s\", ignoring.", fullName.c_str(), (aii->second.path + aii->second.origName).c_str());
-					if (IsBaseContent(filename)) {
-						throw user_error(std::string("duplicate base content detected:\n\t") + aii->second.path + std::string("\n\t") + fpath
-							+ std::string("\nPlease fix your configuration/installation as this can cause desyncs!"));
-					}
-					return;
-				}
-
-				// If we are here, we could have invalid info in the cache
-				// Force a reread if it is a directory archive (.sdd), as
-				// st_mtime only reflects changes to the directory itself,
-				// not the contents.
-				archiveInfos.erase(aii);
+				aii->second.checksum = GetCRC(fullName);
 			}
 		}
+		return true;
 	}
 
+	if (aii->second.updated) {
+		const std::string filename = aii->first;
+		LOG_L(L_ERROR, "Found a \"%s\" already in \"%s\", ignoring.", fullName.c_str(), (aii->second.path + aii->second.origName).c_str());
+		if (IsBaseContent(filename)) {
+			throw user_error(std::string("duplicate base content detected:\n\t") + aii->second.path + std::string("\n\t") + fpath
+				+ std::string("\nPlease fix your configuration/installation as this can cause desyncs!"));
+		}
+		return true;
+	}
+
+	// If we are here, we could have invalid info in the cache
+	// Force a reread if it is a directory archive (.sdd), as
+	// st_mtime only reflects changes to the directory itself,
+	// not the contents.
+	archiveInfos.erase(aii);
+	return false;
+}
+
+void CArchiveScanner::ScanArchiveFile(const std::string& fullName, bool doChecksum, ScanResult& result)
+{
+	const std::string fn    = FileSystem::GetFilename(fullName);
+	const std::string fpath = FileSystem::GetDirectory(fullName);
+
+	struct stat info = {0};
+	stat(fullName.c_str(), &info);
+
+	result.fullName = fullName;
+
 	boost::scoped_ptr<IArchive> ar(archiveLoader.OpenArchive(fullName));
 	if (!ar || !ar->IsOpen()) {
 		LOG_L(L_WARNING, "Unable to open archive: %s", fullName.c_str());
 
 		// record it as broken, so we don't need to look inside everytime
-		BrokenArchive& ba = brokenArchives[lcfn];
+		BrokenArchive& ba = result.ba;
 		ba.path = fpath;
 		ba.modified = info.st_mtime;
+		ba.size = info.st_size;
 		ba.updated = true;
 		ba.problem = "Unable to open archive";
+		result.broken = true;
 		return;
 	}
 
@@ -604,7 +692,7 @@ void CArchiveScanner::ScanArchive(const std::string& fullName, bool doChecksum)
 	const bool hasMapinfo = ar->FileExists("mapinfo.lua");
 
 
-	ArchiveInfo ai;
+	ArchiveInfo& ai = result.ai;
 	auto& ad = ai.archiveData;
 	if (hasMapinfo) {
 		ScanArchiveLua(ar.get(), "mapinfo.lua", ai, error);
@@ -624,11 +712,13 @@ void CArchiveScanner::ScanArchive(const std::string& fullName, bool doChecksum)
 		LOG_L(L_WARNING, "Failed to scan %s (%s)", fullName.c_str(), error.c_str());
 
 		// record it as broken, so we don't need to look inside everytime
-		BrokenArchive& ba = brokenArchives[lcfn];
+		BrokenArchive& ba = result.ba;
 		ba.path = fpath;
 		ba.modified = info.st_mtime;
+		ba.size = info.st_size;
 		ba.updated = true;
 		ba.problem = error;
+		result.broken = true;
 		return;
 	}
 
@@ -661,10 +751,21 @@ void CArchiveScanner::ScanArchive(const std::string& fullName, bool doChecksum)
 
 	ai.path = fpath;
 	ai.modified = info.st_mtime;
+	ai.size = info.st_size;
 	ai.origName = fn;
 	ai.updated = true;
 	ai.checksum = (doChecksum) ? GetCRC(fullName) : 0;
-	archiveInfos[lcfn] = ai;
+}
+
+void CArchiveScanner::AddScanResult(const ScanResult& result)
+{
+	const std::string lcfn = StringToLower(FileSystem::GetFilename(result.fullName));
+
+	if (result.broken) {
+		brokenArchives[lcfn] = result.ba;
+	} else {
+		archiveInfos[lcfn] = result.ai;
+	}
 }
 
 bool CArchiveScanner::ScanArchiveLua(IArchive* ar, const std::string& fileName, ArchiveInfo& ai, std::string& err)
@@ -794,7 +895,7 @@ unsigned int CArchiveScanner::GetCRC(const std::string& arcName)
 	return digest;
 }
 
-void CArchiveScanner::ReadCacheData(const std::string& filename)
+void CArchiveScanner::ReadLuaCacheData(const std::string& filename)
 {
 	if (!FileSystem::FileExists(filename)) {
 		LOG_L(L_INFO, "Archive cache doesn't exist: %s", filename.c_str());
@@ -855,22 +956,173 @@ void CArchiveScanner::ReadCacheData(const std::string& filename)
 	isDirty = false;
 }
 
-static inline void SafeStr(FILE* out, const char* prefix, const std::string& str)
+/// appends values in host byte-order, the cache never leaves this machine
+class CacheWriter
 {
-	if (str.empty()) {
-		return;
+public:
+	template<typename T> void Write(const T& value) {
+		const boost::uint8_t* bytes = reinterpret_cast<const boost::uint8_t*>(&value);
+		buf.insert(buf.end(), bytes, bytes + sizeof(T));
+	}
+	void WriteString(const std::string& str) {
+		Write(boost::uint32_t(str.size()));
+		buf.insert(buf.end(), str.begin(), str.end());
+	}
+	void WriteStrings(const std::vector<std::string>& strs) {
+		Write(boost::uint32_t(strs.size()));
+		for (const std::string& str: strs) {
+			WriteString(str);
+		}
 	}
-	if ( (str.find_first_of("\\\"") != std::string::npos) || (str.find_first_of("\n") != std::string::npos )) {
-		fprintf(out, "%s[[%s]],\n", prefix, str.c_str());
-	} else {
-		fprintf(out, "%s\"%s\",\n", prefix, str.c_str());
+
+	std::vector<boost::uint8_t> buf;
+};
+
+/// reads from a buffer holding the whole file, Good() is false after any overrun
+class CacheReader
+{
+public:
+	CacheReader(const std::vector<boost::uint8_t>& _buf): buf(_buf), pos(0), good(true) {}
+
+	template<typename T> T Read() {
+		T value = T();
+		if (!Need(sizeof(T)))
+			return value;
+		memcpy(&value, &buf[pos], sizeof(T));
+		pos += sizeof(T);
+		return value;
+	}
+	std::string ReadString() {
+		const boost::uint32_t size = Read<boost::uint32_t>();
+		if (!Need(size))
+			return "";
+		const char* str = reinterpret_cast<const char*>(&buf[0]) + pos;
+		pos += size;
+		return std::string(str, size);
+	}
+	void ReadStrings(std::vector<std::string>& strs) {
+		const boost::uint32_t count = Read<boost::uint32_t>();
+		for (boost::uint32_t n = 0; n < count && good; n++) {
+			strs.push_back(ReadString());
+		}
 	}
-}
+	bool Good() const { return good; }
+	void Fail() { good = false; }
+
+private:
+	bool Need(size_t size) {
+		good = good && (size <= (buf.size() - pos));
+		return good;
+	}
+
+	const std::vector<boost::uint8_t>& buf;
+	size_t pos;
+	bool good;
+};
 
-void FilterDep(std::vector<std::string>& deps, const std::string& exclude)
+
+bool CArchiveScanner::ReadCacheData(const std::string& filename)
 {
-	auto it = std::remove_if(deps.begin(), deps.end(), [&](const std::string& dep) { return (dep == exclude); });
-	deps.erase(it, deps.end());
+	FILE* file = fopen(filename.c_str(), "rb");
+
+	if (file == NULL) {
+		LOG_L(L_INFO, "Archive cache doesn't exist: %s", filename.c_str());
+		return false;
+	}
+
+	// a few 100kB even for thousands of archives, read it in one go
+	std::vector<boost::uint8_t> buf;
+
+	fseek(file, 0, SEEK_END);
+	buf.resize(std::max(0L, ftell(file)));
+	fseek(file, 0, SEEK_SET);
+
+	const bool readOk = buf.empty() || (fread(&buf[0], buf.size(), 1, file) == 1);
+	fclose(file);
+
+	CacheReader reader(buf);
+	char magic[sizeof(CACHE_MAGIC)];
+
+	for (char& c: magic) {
+		c = reader.Read<char>();
+	}
+
+	if (!readOk || !reader.Good() || memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0) {
+		LOG_L(L_ERROR, "Failed to read archive cache: %s", filename.c_str());
+		return false;
+	}
+
+	// Do not load old version caches
+	if (reader.Read<boost::uint32_t>() != CACHE_FORMAT_VER || reader.Read<boost::int32_t>() != INTERNAL_VER) {
+		return false;
+	}
+
+	std::map<std::string, ArchiveInfo> readArchives;
+	std::map<std::string, BrokenArchive> readBrokenArchives;
+
+	const boost::uint32_t numArchives = reader.Read<boost::uint32_t>();
+
+	for (boost::uint32_t i = 0; i < numArchives && reader.Good(); ++i) {
+		const std::string name = reader.ReadString();
+
+		ArchiveInfo& ai = readArchives[StringToLower(name)];
+		ai.origName = name;
+		ai.path     = reader.ReadString();
+		ai.replaced = reader.ReadString();
+		ai.modified = reader.Read<boost::uint32_t>();
+		ai.size     = reader.Read<boost::uint64_t>();
+		ai.checksum = reader.Read<boost::uint32_t>();
+		ai.updated  = false;
+
+		ArchiveData& ad = ai.archiveData;
+		const boost::uint32_t numInfoItems = reader.Read<boost::uint32_t>();
+
+		for (boost::uint32_t n = 0; n < numInfoItems && reader.Good(); ++n) {
+			const std::string key = reader.ReadString();
+
+			switch (reader.Read<boost::uint8_t>()) {
+				case INFO_VALUE_TYPE_STRING: {
+					ad.SetInfoItemValueString(key, reader.ReadString());
+				} break;
+				case INFO_VALUE_TYPE_INTEGER: {
+					ad.SetInfoItemValueInteger(key, reader.Read<boost::int32_t>());
+				} break;
+				case INFO_VALUE_TYPE_FLOAT: {
+					ad.SetInfoItemValueFloat(key, reader.Read<float>());
+				} break;
+				case INFO_VALUE_TYPE_BOOL: {
+					ad.SetInfoItemValueBool(key, reader.Read<boost::uint8_t>() != 0);
+				} break;
+				default: {
+					reader.Fail();
+				} break;
+			}
+		}
+
+		reader.ReadStrings(ad.GetDependencies());
+		reader.ReadStrings(ad.GetReplaces());
+	}
+
+	const boost::uint32_t numBroken = reader.Read<boost::uint32_t>();
+
+	for (boost::uint32_t i = 0; i < numBroken && reader.Good(); ++i) {
+		BrokenArchive& ba = readBrokenArchives[reader.ReadString()];
+		ba.path     = reader.ReadString();
+		ba.modified = reader.Read<boost::uint32_t>();
+		ba.size     = reader.Read<boost::uint64_t>();
+		ba.problem  = reader.ReadString();
+		ba.updated  = false;
+	}
+
+	if (!reader.Good()) {
+		LOG_L(L_ERROR, "Failed to read archive cache (truncated?): %s", filename.c_str());
+		return false;
+	}
+
+	archiveInfos.swap(readArchives);
+	brokenArchives.swap(readBrokenArchives);
+	isDirty = false;
+	return true;
 }
 
 void CArchiveScanner::WriteCacheData(const std::string& filename)
@@ -879,12 +1131,6 @@ void CArchiveScanner::WriteCacheData(const std::string& filename)
 		return;
 	}
 
-	FILE* out = fopen(filename.c_str(), "wt");
-	if (!out) {
-		LOG_L(L_ERROR, "Failed to write to \"%s\"!", filename.c_str());
-		return;
-	}
-
 	// First delete all outdated information
 	// TODO: this pattern should be moved into an utility function..
 	for (std::map<std::string, ArchiveInfo>::iterator i = archiveInfos.begin(); i != archiveInfos.end(); ) {
@@ -902,106 +1148,77 @@ void CArchiveScanner::WriteCacheData(const std::string& filename)
 		}
 	}
 
-	fprintf(out, "local archiveCache = {\n\n");
-	fprintf(out, "\tinternalver = %i,\n\n", INTERNAL_VER);
-
-#ifdef _WIN64 //fprintf sometimes spews false warnings over %I64u
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wformat"
-#endif
+	CacheWriter writer;
 
-	fprintf(out, "\tarchives = {  -- count = " _STPF_ "\n", archiveInfos.size());
+	for (const char c: CACHE_MAGIC) {
+		writer.Write(c);
+	}
 
-#ifdef _WIN64
-#pragma GCC diagnostic pop
-#endif
+	writer.Write(CACHE_FORMAT_VER);
+	writer.Write(boost::int32_t(INTERNAL_VER));
+	writer.Write(boost::uint32_t(archiveInfos.size()));
 
-	std::map<std::string, ArchiveInfo>::const_iterator arcIt;
-	for (arcIt = archiveInfos.begin(); arcIt != archiveInfos.end(); ++arcIt) {
-		const ArchiveInfo& arcInfo = arcIt->second;
+	for (const auto& arcIt: archiveInfos) {
+		const ArchiveInfo& arcInfo = arcIt.second;
 
-		fprintf(out, "\t\t{\n");
-		SafeStr(out, "\t\t\tname = ",              arcInfo.origName);
-		SafeStr(out, "\t\t\tpath = ",              arcInfo.path);
-		fprintf(out, "\t\t\tmodified = \"%u\",\n", arcInfo.modified);
-		fprintf(out, "\t\t\tchecksum = \"%u\",\n", arcInfo.checksum);
-		SafeStr(out, "\t\t\treplaced = ",          arcInfo.replaced);
+		writer.WriteString(arcInfo.origName);
+		writer.WriteString(arcInfo.path);
+		writer.WriteString(arcInfo.replaced);
+		writer.Write(boost::uint32_t(arcInfo.modified));
+		writer.Write(boost::uint64_t(arcInfo.size));
+		writer.Write(boost::uint32_t(arcInfo.checksum));
 
-		// mod info?
 		const ArchiveData& archData = arcInfo.archiveData;
-		if (!archData.GetName().empty()) {
-			fprintf(out, "\t\t\tarchivedata = {\n");
-
-			const std::map<std::string, InfoItem>& info = archData.GetInfo();
-			std::map<std::string, InfoItem>::const_iterator ii;
-			for (ii = info.begin(); ii != info.end(); ++ii) {
-				switch (ii->second.valueType) {
-					case INFO_VALUE_TYPE_STRING: {
-						SafeStr(out, std::string("\t\t\t\t" + ii->first + " = ").c_str(), ii->second.valueTypeString);
-					} break;
-					case INFO_VALUE_TYPE_INTEGER: {
-						fprintf(out, "\t\t\t\t%s = %d,\n", ii->first.c_str(), ii->second.value.typeInteger);
-					} break;
-					case INFO_VALUE_TYPE_FLOAT: {
-						fprintf(out, "\t\t\t\t%s = %f,\n", ii->first.c_str(), ii->second.value.typeFloat);
-					} break;
-					case INFO_VALUE_TYPE_BOOL: {
-						fprintf(out, "\t\t\t\t%s = %d,\n", ii->first.c_str(), (int)ii->second.value.typeBool);
-					} break;
-				}
-			}
+		const std::map<std::string, InfoItem>& info = archData.GetInfo();
 
-			std::vector<std::string> deps = archData.GetDependencies();
-			if (archData.GetModType() == modtype::map) {
-				FilterDep(deps, "Map Helper v1");
-			} else if (archData.GetModType() == modtype::primary) {
-				FilterDep(deps, "Spring content v1");
-			}
+		writer.Write(boost::uint32_t(info.size()));
 
-			if (!deps.empty()) {
-				fprintf(out, "\t\t\t\tdepend = {\n");
-				for (unsigned d = 0; d < deps.size(); d++) {
-					SafeStr(out, "\t\t\t\t\t", deps[d]);
-				}
-				fprintf(out, "\t\t\t\t},\n");
+		for (const auto& ii: info) {
+			writer.WriteString(ii.second.key);
+			writer.Write(boost::uint8_t(ii.second.valueType));
+
+			switch (ii.second.valueType) {
+				case INFO_VALUE_TYPE_STRING: {
+					writer.WriteString(ii.second.valueTypeString);
+				} break;
+				case INFO_VALUE_TYPE_INTEGER: {
+					writer.Write(boost::int32_t(ii.second.value.typeInteger));
+				} break;
+				case INFO_VALUE_TYPE_FLOAT: {
+					writer.Write(ii.second.value.typeFloat);
+				} break;
+				case INFO_VALUE_TYPE_BOOL: {
+					writer.Write(boost::uint8_t(ii.second.value.typeBool));
+				} break;
 			}
-			fprintf(out, "\t\t\t},\n");
 		}
 
-		fprintf(out, "\t\t},\n");
+		// unlike the lua cache, the implicit dependencies are stored as well
+		writer.WriteStrings(archData.GetDependencies());
+		writer.WriteStrings(archData.GetReplaces());
 	}
 
-	fprintf(out, "\t},\n\n"); // close 'archives'
+	writer.Write(boost::uint32_t(brokenArchives.size()));
 
-#ifdef _WIN64 //fprintf sometimes spews false warnings over %I64u
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wformat"
-#endif
-
-	fprintf(out, "\tbrokenArchives = {  -- count = " _STPF_ "\n", brokenArchives.size());
-
-#ifdef _WIN64
-#pragma GCC diagnostic pop
-#endif
-
-	std::map<std::string, BrokenArchive>::const_iterator bai;
-	for (bai = brokenArchives.begin(); bai != brokenArchives.end(); ++bai) {
-		const BrokenArchive& ba = bai->second;
+	for (const auto& bai: brokenArchives) {
+		const BrokenArchive& ba = bai.second;
 
-		fprintf(out, "\t\t{\n");
-		SafeStr(out, "\t\t\tname = ", bai->first);
-		SafeStr(out, "\t\t\tpath = ", ba.path);
-		fprintf(out, "\t\t\tmodified = \"%u\",\n", ba.modified);
-		SafeStr(out, "\t\t\tproblem = ", ba.problem);
-		fprintf(out, "\t\t},\n");
+		writer.WriteString(bai.first);
+		writer.WriteString(ba.path);
+		writer.Write(boost::uint32_t(ba.modified));
+		writer.Write(boost::uint64_t(ba.size));
+		writer.WriteString(ba.problem);
 	}
 
-	fprintf(out, "\t},\n"); // close 'brokenArchives'
+	FILE* out = fopen(filename.c_str(), "wb");
+	if (!out) {
+		LOG_L(L_ERROR, "Failed to write to \"%s\"!", filename.c_str());
+		return;
+	}
 
-	fprintf(out, "}\n\n"); // close 'archiveCache'
-	fprintf(out, "return archiveCache\n");
+	const bool writeOk = (fwrite(&writer.buf[0], writer.buf.size(), 1, out) == 1);
 
-	if (fclose(out) == EOF)
+	if ((fclose(out) == EOF) || !writeOk)
 		LOG_L(L_ERROR, "Failed to write to \"%s\"!", filename.c_str());
 
 	isDirty = false;
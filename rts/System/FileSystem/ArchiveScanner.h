@@ -7,6 +7,7 @@
 #include <vector>
 #include <list>
 #include <map>
+#include <boost/cstdint.hpp>
 #include "System/Info.h"
 
 class IArchive;
@@ -23,6 +24,10 @@ class LuaTable;
  *
  * The archive namespace is global, so it is not allowed to have an archive with
  * the same name in more than one folder.
+ *
+ * The cache is a binary file in the write-dir (shared by spring and unitsync),
+ * an archive is rescanned when its modification time or size changed.
+ * New and changed archives are opened and checksummed in parallel.
  */
 
 namespace modtype
@@ -132,6 +137,7 @@ private:
 	{
 		ArchiveInfo()
 			: modified(0)
+			, size(0)
 			, checksum(0)
 			, updated(false)
 			{}
@@ -140,6 +146,7 @@ private:
 		std::string replaced;     ///< If not empty, use that archive instead
 		ArchiveData archiveData;
 		unsigned int modified;
+		boost::uint64_t size;     ///< 0 if unknown (read from an old cache)
 		unsigned int checksum;
 		bool updated;
 	};
@@ -147,18 +154,40 @@ private:
 	{
 		BrokenArchive()
 			: modified(0)
+			, size(0)
 			, updated(false)
 			{}
 		std::string path;
 		unsigned int modified;
+		boost::uint64_t size;
 		bool updated;
 		std::string problem;
 	};
+	/// what ScanArchiveFile found out about one archive
+	struct ScanResult
+	{
+		ScanResult(): broken(false) {}
+		std::string fullName;
+		bool broken;
+		ArchiveInfo ai;   ///< if !broken
+		BrokenArchive ba; ///< if broken
+	};
 
 private:
 	void ScanDirs(const std::vector<std::string>& dirs, bool checksum = false);
 	void ScanDir(const std::string& curPath, std::list<std::string>* foundArchives);
 
+	/**
+	 * Look the archive up in the cache, marks it as updated if found.
+	 * @param missingChecksums if not NULL, cached archives without a checksum
+	 *   are added to it instead of being checksummed right away
+	 * @return false if the archive has to be (re)scanned
+	 */
+	bool CheckCachedArchive(const std::string& fullName, bool doChecksum, std::vector<ArchiveInfo*>* missingChecksums);
+	/// opens and inspects the archive; does not touch the scanner state, so it is safe to run in parallel
+	void ScanArchiveFile(const std::string& fullName, bool doChecksum, ScanResult& result);
+	void AddScanResult(const ScanResult& result);
+
 	/// scan mapinfo / modinfo lua files
 	bool ScanArchiveLua(IArchive* ar, const std::string& fileName, ArchiveInfo& ai, std::string& err);
 
@@ -169,7 +198,10 @@ private:
 	std::string SearchMapFile(const IArchive* ar, std::string& error);
 
 
-	void ReadCacheData(const std::string& filename);
+	/// @return false if the file is missing, broken or from another version
+	bool ReadCacheData(const std::string& filename);
+	/// reads the ArchiveCache.lua of older versions
+	void ReadLuaCacheData(const std::string& filename);
 	void WriteCacheData(const std::string& filename);
 
 	IFileFilter* CreateIgnoreFilter(IArchive* ar);
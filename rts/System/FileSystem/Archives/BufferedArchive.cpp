@@ -3,9 +3,17 @@
 
 #include "BufferedArchive.h"
 
+#include <boost/thread/thread.hpp>
+#include <algorithm>
 
-CBufferedArchive::CBufferedArchive(const std::string& name, bool cache)
+// every reader keeps the archive open and (7zip) a solid block in memory
+static const unsigned int MAX_READERS = 8;
+
+
+CBufferedArchive::CBufferedArchive(const std::string& name, bool cache, unsigned int _maxReaders)
 	: IArchive(name)
+	, numReaders(0)
+	, maxReaders(std::max(_maxReaders, 1u))
 {
 	caching = cache;
 }
@@ -14,24 +22,70 @@ CBufferedArchive::~CBufferedArchive()
 {
 }
 
-bool CBufferedArchive::GetFile(unsigned int fid, std::vector<boost::uint8_t>& buffer)
+unsigned int CBufferedArchive::GetDefaultMaxReaders()
+{
+	return std::max(1u, std::min(boost::thread::hardware_concurrency(), MAX_READERS));
+}
+
+
+unsigned int CBufferedArchive::AcquireReader()
 {
 	boost::mutex::scoped_lock lck(archiveLock);
+
+	while (freeReaders.empty() && numReaders >= maxReaders)
+		readerReleased.wait(lck);
+
+	if (freeReaders.empty())
+		return numReaders++;
+
+	const unsigned int reader = freeReaders.back();
+	freeReaders.pop_back();
+	return reader;
+}
+
+void CBufferedArchive::ReleaseReader(unsigned int reader)
+{
+	{
+		boost::mutex::scoped_lock lck(archiveLock);
+		freeReaders.push_back(reader);
+	}
+
+	readerReleased.notify_one();
+}
+
+
+bool CBufferedArchive::GetFile(unsigned int fid, std::vector<boost::uint8_t>& buffer)
+{
 	assert(IsFileId(fid));
 
-	if (!caching) {
-		return GetFileImpl(fid,buffer);
+	if (caching) {
+		boost::mutex::scoped_lock lck(archiveLock);
+
+		if (fid < cache.size() && cache[fid].populated) {
+			buffer = cache[fid].data;
+			return cache[fid].exists;
+		}
 	}
 
+	const unsigned int reader = AcquireReader();
+	const bool exists = GetFileImpl(fid, buffer, reader);
+	ReleaseReader(reader);
+
+	if (!caching)
+		return exists;
+
+	boost::mutex::scoped_lock lck(archiveLock);
+
 	if (fid >= cache.size()) {
 		cache.resize(fid + 1);
 	}
-	
+
+	// another thread may have read the same file in the meantime
 	if (!cache[fid].populated) {
-		cache[fid].exists = GetFileImpl(fid, cache[fid].data);
+		cache[fid].exists = exists;
+		cache[fid].data = buffer;
 		cache[fid].populated = true;
 	}
 
-	buffer = cache[fid].data;
-	return cache[fid].exists;
+	return exists;
 }
@@ -4,26 +4,37 @@
 #define _BUFFERED_ARCHIVE_H
 
 #include <map>
+#include <boost/thread/condition_variable.hpp>
 #include <boost/thread/mutex.hpp>
 
 #include "IArchive.h"
 
 /**
  * Provides a helper implementation for archive types that can only uncompress
- * one file to memory at a time.
+ * one file to memory at a time per reader.
+ * Derived classes may open more than one reader on the same archive (each
+ * with its own zlib/7zip context), then that many threads can uncompress
+ * files in parallel.
  */
 class CBufferedArchive : public IArchive
 {
 public:
-	CBufferedArchive(const std::string& name, bool cache = true);
+	CBufferedArchive(const std::string& name, bool cache = true, unsigned int maxReaders = 1);
 	virtual ~CBufferedArchive();
 
 	virtual bool GetFile(unsigned int fid, std::vector<boost::uint8_t>& buffer);
 
 protected:
-	virtual bool GetFileImpl(unsigned int fid, std::vector<boost::uint8_t>& buffer) = 0;
+	/**
+	 * @param reader index of the reader to use, in [0, GetMaxReaders()),
+	 *   no other thread uses the same reader until this returns
+	 */
+	virtual bool GetFileImpl(unsigned int fid, std::vector<boost::uint8_t>& buffer, unsigned int reader) = 0;
+
+	unsigned int GetMaxReaders() const { return maxReaders; }
+	/// one reader per hardware thread, but not too many open files per archive
+	static unsigned int GetDefaultMaxReaders();
 
-	boost::mutex archiveLock; // neither 7zip nor zlib are threadsafe
 	struct FileBuffer
 	{
 		FileBuffer() : populated(false), exists(false) {};
@@ -32,7 +43,21 @@ protected:
 		std::vector<boost::uint8_t> data;
 	};
 	std::vector<FileBuffer> cache; // cache[fileId]
+
+private:
+	unsigned int AcquireReader();
+	void ReleaseReader(unsigned int reader);
+
 private:
+	// guards the cache and the free readers, never held while uncompressing
+	// (neither 7zip nor zlib are threadsafe, but separate contexts are)
+	boost::mutex archiveLock;
+	boost::condition_variable readerReleased;
+
+	std::vector<unsigned int> freeReaders;
+	unsigned int numReaders;
+	unsigned int maxReaders;
+
 	bool caching;
 };
 
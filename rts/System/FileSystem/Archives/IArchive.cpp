@@ -3,8 +3,39 @@
 #include "IArchive.h"
 
 #include "System/CRC.h"
+#include "System/ThreadPool.h"
 #include "System/Util.h"
 
+#include <algorithm>
+
+// files larger than this (maps, sounds, videos) are checksummed in chunks
+// of this size on all threads; GetCrc32 itself already runs once per file
+// on the pool, but .sdd archives often have a single file much larger than
+// all others that would end up on one thread
+static const size_t CRC_CHUNK_SIZE = 4 * 1024 * 1024;
+
+
+static void UpdateCRC(CRC& crc, const boost::uint8_t* data, size_t size)
+{
+	if (size <= CRC_CHUNK_SIZE) {
+		crc.Update(data, size);
+		return;
+	}
+
+	std::vector<unsigned int> chunkCRCs((size + CRC_CHUNK_SIZE - 1) / CRC_CHUNK_SIZE);
+
+	for_mt(0, chunkCRCs.size(), [&](const int i) {
+		const size_t offset = i * CRC_CHUNK_SIZE;
+		chunkCRCs[i] = CRC::GetCRC(data + offset, std::min(CRC_CHUNK_SIZE, size - offset));
+	});
+
+	for (size_t i = 0; i < chunkCRCs.size(); i++) {
+		const size_t offset = i * CRC_CHUNK_SIZE;
+		crc.Combine(chunkCRCs[i], std::min(CRC_CHUNK_SIZE, size - offset));
+	}
+}
+
+
 IArchive::IArchive(const std::string& archiveName)
 	: archiveFile(archiveName)
 {
@@ -45,7 +76,7 @@ unsigned int IArchive::GetCrc32(unsigned int fid)
 	CRC crc;
 	std::vector<boost::uint8_t> buffer;
 	if (GetFile(fid, buffer) && !buffer.empty()) {
-		crc.Update(&buffer[0], buffer.size());
+		UpdateCRC(crc, &buffer[0], buffer.size());
 	}
 
 	return crc.GetDigest();
@@ -44,7 +44,8 @@ static bool gz_really_read(gzFile file, voidp buf, unsigned int len)
 }
 
 CPoolArchive::CPoolArchive(const std::string& name)
-	: CBufferedArchive(name)
+	// every file is a separate .gz in the pool, readers share nothing
+	: CBufferedArchive(name, true, GetDefaultMaxReaders())
 	, isOpen(false)
 {
 	char c_name[255];
@@ -116,7 +117,7 @@ unsigned int CPoolArchive::GetCrc32(unsigned int fid)
 }
 
 
-bool CPoolArchive::GetFileImpl(unsigned int fid, std::vector<boost::uint8_t>& buffer)
+bool CPoolArchive::GetFileImpl(unsigned int fid, std::vector<boost::uint8_t>& buffer, unsigned int reader)
 {
 	assert(IsFileId(fid));
 
@@ -109,12 +109,10 @@ const char* CSevenZipArchive::GetErrorStr(int err)
 
 
 CSevenZipArchive::CSevenZipArchive(const std::string& name):
-	CBufferedArchive(name, false),
-	blockIndex(0xFFFFFFFF),
-	outBuffer(NULL),
-	outBufferSize(0),
+	CBufferedArchive(name, false, GetDefaultMaxReaders()),
 	tempBuf(NULL),
 	tempBufSize(0),
+	readerLocks(new boost::mutex[GetMaxReaders()]),
 	isOpen(false)
 {
 	allocImp.Alloc = SzAlloc;
@@ -124,23 +122,14 @@ CSevenZipArchive::CSevenZipArchive(const std::string& name):
 
 	SzArEx_Init(&db);
 
-	WRes wres = InFile_Open(&archiveStream.file, name.c_str());
-	if (wres) {
-		boost::system::error_code e(wres, boost::system::get_system_category());
-		LOG_L(L_ERROR, "Error opening \"%s\": %s (%i)",
-				name.c_str(), e.message().c_str(), e.value());
-		return;
-	}
+	readers.resize(GetMaxReaders());
 
-	FileInStream_CreateVTable(&archiveStream);
-	LookToRead_CreateVTable(&lookStream, False);
-
-	lookStream.realStream = &archiveStream.s;
-	LookToRead_Init(&lookStream);
+	if (!OpenReader(readers[0], name))
+		return;
 
 	CrcGenerateTable();
 
-	SRes res = SzArEx_Open(&db, &lookStream.s, &allocImp, &allocTempImp);
+	SRes res = SzArEx_Open(&db, &readers[0].lookStream.s, &allocImp, &allocTempImp);
 	if (res == SZ_OK) {
 		isOpen = true;
 	} else {
@@ -179,6 +168,7 @@ CSevenZipArchive::CSevenZipArchive(const std::string& name):
 			fd.crc = (f->Size > 0) ? f->Crc: 0;
 
 			const UInt32 folderIndex = db.FileIndexToFolderIndexMap[i];
+			fd.folderIndex = folderIndex;
 			if (folderIndex == ((UInt32)-1)) {
 				// file has no folder assigned
 				fd.unpackedSize = f->Size;
@@ -200,11 +190,8 @@ CSevenZipArchive::CSevenZipArchive(const std::string& name):
 
 CSevenZipArchive::~CSevenZipArchive()
 {
-	if (outBuffer) {
-		IAlloc_Free(&allocImp, outBuffer);
-	}
-	if (isOpen) {
-		File_Close(&archiveStream.file);
+	for (Reader& reader: readers) {
+		CloseReader(reader);
 	}
 	SzArEx_Free(&db, &allocImp);
 	SzFree(NULL, tempBuf);
@@ -212,6 +199,38 @@ CSevenZipArchive::~CSevenZipArchive()
 	tempBufSize = 0;
 }
 
+bool CSevenZipArchive::OpenReader(Reader& reader, const std::string& name)
+{
+	WRes wres = InFile_Open(&reader.archiveStream.file, name.c_str());
+	if (wres) {
+		boost::system::error_code e(wres, boost::system::get_system_category());
+		LOG_L(L_ERROR, "Error opening \"%s\": %s (%i)",
+				name.c_str(), e.message().c_str(), e.value());
+		return false;
+	}
+
+	FileInStream_CreateVTable(&reader.archiveStream);
+	LookToRead_CreateVTable(&reader.lookStream, False);
+
+	reader.lookStream.realStream = &reader.archiveStream.s;
+	LookToRead_Init(&reader.lookStream);
+
+	reader.isOpen = true;
+	return true;
+}
+
+void CSevenZipArchive::CloseReader(Reader& reader)
+{
+	if (reader.outBuffer) {
+		IAlloc_Free(&allocImp, reader.outBuffer);
+		reader.outBuffer = NULL;
+	}
+	if (reader.isOpen) {
+		File_Close(&reader.archiveStream.file);
+		reader.isOpen = false;
+	}
+}
+
 bool CSevenZipArchive::IsOpen()
 {
 	return isOpen;
@@ -222,19 +241,34 @@ unsigned int CSevenZipArchive::NumFiles() const
 	return fileData.size();
 }
 
-bool CSevenZipArchive::GetFileImpl(unsigned int fid, std::vector<boost::uint8_t>& buffer)
+bool CSevenZipArchive::GetFileImpl(unsigned int fid, std::vector<boost::uint8_t>& buffer, unsigned int readerIdx)
 {
 	assert(IsFileId(fid));
-	
+	assert(readerIdx < readers.size());
+
+	// Decompressing a file unpacks its whole solid block, so the 7zip
+	// context is picked by block rather than by the pooled reader index:
+	// neighbouring files reuse the block already in memory and two threads
+	// never unpack (and keep) a copy of the same block. Threads reading
+	// from different blocks still run in parallel unless the blocks map to
+	// the same context. The db is only read by 7zip.
+	const unsigned int blockReaderIdx = fileData[fid].folderIndex % readers.size();
+
+	boost::mutex::scoped_lock lck(readerLocks[blockReaderIdx]);
+	Reader& reader = readers[blockReaderIdx];
+
+	if (!reader.isOpen && !OpenReader(reader, GetArchiveName()))
+		return false;
+
 	// Get 7zip to decompress it
 	size_t offset;
 	size_t outSizeProcessed;
 	SRes res;
 
-	res = SzArEx_Extract(&db, &lookStream.s, fileData[fid].fp, &blockIndex, &outBuffer, &outBufferSize, &offset, &outSizeProcessed, &allocImp, &allocTempImp);
+	res = SzArEx_Extract(&db, &reader.lookStream.s, fileData[fid].fp, &reader.blockIndex, &reader.outBuffer, &reader.outBufferSize, &offset, &outSizeProcessed, &allocImp, &allocTempImp);
 	if (res == SZ_OK) {
 		buffer.resize(outSizeProcessed);
-		memcpy(&buffer[0], (char*)outBuffer+offset, outSizeProcessed);
+		memcpy(&buffer[0], (char*)reader.outBuffer+offset, outSizeProcessed);
 		return true;
 	} else {
 		return false;
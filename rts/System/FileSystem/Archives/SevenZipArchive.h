@@ -12,6 +12,8 @@ extern "C" {
 #include "BufferedArchive.h"
 #include <vector>
 #include <string>
+#include <boost/scoped_array.hpp>
+#include <boost/thread/mutex.hpp>
 #include "IArchive.h"
 
 /**
@@ -39,15 +41,34 @@ public:
 	virtual bool IsOpen();
 	
 	virtual unsigned int NumFiles() const;
-	virtual bool GetFileImpl(unsigned int fid, std::vector<boost::uint8_t>& buffer);
+	virtual bool GetFileImpl(unsigned int fid, std::vector<boost::uint8_t>& buffer, unsigned int reader);
 	virtual void FileInfo(unsigned int fid, std::string& name, int& size) const;
 	virtual bool HasLowReadingCost(unsigned int fid) const;
 	virtual unsigned GetCrc32(unsigned int fid);
 
 private:
-	UInt32 blockIndex;
-	Byte* outBuffer;
-	size_t outBufferSize;
+	/**
+	 * Everything 7zip needs to extract on its own, the db is shared.
+	 * Each reader keeps the last uncompressed solid block around.
+	 * Solid blocks are bound to a fixed reader (see GetFileImpl), so no
+	 * block is ever held uncompressed by more than one reader.
+	 */
+	struct Reader
+	{
+		Reader(): blockIndex(0xFFFFFFFF), outBuffer(NULL), outBufferSize(0), isOpen(false) {}
+
+		CFileInStream archiveStream;
+		CLookToRead lookStream;
+
+		UInt32 blockIndex;
+		Byte* outBuffer;
+		size_t outBufferSize;
+
+		bool isOpen;
+	};
+
+	bool OpenReader(Reader& reader, const std::string& name);
+	void CloseReader(Reader& reader);
 
 	/**
 	 * How much more unpacked data may be allowed in a solid block,
@@ -93,6 +114,8 @@ private:
 		 * @see #unpackedSize
 		 */
 		int packedSize;
+		/// solid block containing the file, (UInt32)-1 if none
+		UInt32 folderIndex;
 	};
 	int GetFileName(const CSzArEx* db, int i);
 	const char* GetErrorStr(int res);
@@ -101,9 +124,11 @@ private:
 	UInt16 *tempBuf;
 	size_t tempBufSize;
 
-	CFileInStream archiveStream;
+	/// sized once, lookStream.realStream points into the elements
+	std::vector<Reader> readers;
+	/// readerLocks[i] guards readers[i]
+	boost::scoped_array<boost::mutex> readerLocks;
 	CSzArEx db;
-	CLookToRead lookStream;
 	ISzAlloc allocImp;
 	ISzAlloc allocTempImp;
 
@@ -23,7 +23,8 @@ IArchive* CZipArchiveFactory::DoCreateArchive(const std::string& filePath) const
 
 
 CZipArchive::CZipArchive(const std::string& archiveName)
-	: CBufferedArchive(archiveName)
+	: CBufferedArchive(archiveName, true, GetDefaultMaxReaders())
+	, zipReaders(GetMaxReaders(), nullptr)
 {
 	zip = unzOpen(archiveName.c_str());
 	if (!zip) {
@@ -31,6 +32,8 @@ CZipArchive::CZipArchive(const std::string& archiveName)
 		return;
 	}
 
+	zipReaders[0] = zip;
+
 	// We need to map file positions to speed up opening later
 	for (int ret = unzGoToFirstFile(zip); ret == UNZ_OK; ret = unzGoToNextFile(zip))
 	{
@@ -60,10 +63,15 @@ CZipArchive::CZipArchive(const std::string& archiveName)
 
 CZipArchive::~CZipArchive()
 {
-	if (zip != nullptr) {
-		unzClose(zip);
-		zip = nullptr;
+	// includes zip
+	for (unzFile& reader: zipReaders) {
+		if (reader != nullptr) {
+			unzClose(reader);
+			reader = nullptr;
+		}
 	}
+
+	zip = nullptr;
 }
 
 bool CZipArchive::IsOpen()
@@ -92,33 +100,42 @@ unsigned int CZipArchive::GetCrc32(unsigned int fid)
 }
 
 // To simplify things, files are always read completely into memory from
-// the zip-file, since zlib does not provide any way of reading more
-// than one file at a time
-bool CZipArchive::GetFileImpl(unsigned int fid, std::vector<boost::uint8_t>& buffer)
+// the zip-file, since a zlib handle can not read more than one file at a
+// time; every reader has its own handle, so readers can run in parallel
+bool CZipArchive::GetFileImpl(unsigned int fid, std::vector<boost::uint8_t>& buffer, unsigned int reader)
 {
 	// Prevent opening files on missing/invalid archives
 	if (!zip) {
 		return false;
 	}
 	assert(IsFileId(fid));
+	assert(reader < zipReaders.size());
+
+	// the reader is ours until we return, no locking needed
+	unzFile& handle = zipReaders[reader];
+
+	if (handle == nullptr && (handle = unzOpen(GetArchiveName().c_str())) == nullptr) {
+		LOG_L(L_ERROR, "Error reopening \"%s\"", GetArchiveName().c_str());
+		return false;
+	}
 
-	unzGoToFilePos(zip, &fileData[fid].fp);
+	unzGoToFilePos(handle, &fileData[fid].fp);
 
 	unz_file_info fi;
-	unzGetCurrentFileInfo(zip, &fi, nullptr, 0, nullptr, 0, nullptr, 0);
+	unzGetCurrentFileInfo(handle, &fi, nullptr, 0, nullptr, 0, nullptr, 0);
 
-	if (unzOpenCurrentFile(zip) != UNZ_OK) {
+	if (unzOpenCurrentFile(handle) != UNZ_OK) {
 		return false;
 	}
 
 	buffer.resize(fi.uncompressed_size);
 
 	bool ret = true;
-	if (!buffer.empty() && unzReadCurrentFile(zip, &buffer[0], fi.uncompressed_size) != fi.uncompressed_size) {
+	if (!buffer.empty() && unzReadCurrentFile(handle, &buffer[0], fi.uncompressed_size) != fi.uncompressed_size) {
 		ret = false;
 	}
 
-	if (unzCloseCurrentFile(zip) == UNZ_CRCERROR) {
+	if (unzCloseCurrentFile(handle) == UNZ_CRCERROR) {
 		ret = false;
 	}
 
@@ -40,6 +40,8 @@ public:
 
 protected:
 	unzFile zip;
+	/// one handle per reader, [0] is zip, the others are opened on demand
+	std::vector<unzFile> zipReaders;
 
 	struct FileData {
 		unz_file_pos fp;
@@ -48,8 +50,8 @@ protected:
 		unsigned int crc;
 	};
 	std::vector<FileData> fileData;
-	
-	virtual bool GetFileImpl(unsigned int fid, std::vector<boost::uint8_t>& buffer);
+
+	virtual bool GetFileImpl(unsigned int fid, std::vector<boost::uint8_t>& buffer, unsigned int reader);
 };
 
 #endif // _ZIP_ARCHIVE_H
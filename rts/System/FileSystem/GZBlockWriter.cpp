@@ -0,0 +1,246 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "GZBlockWriter.h"
+
+#include "System/Log/ILog.h"
+#include "System/Platform/Threading.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <zlib.h>
+
+
+static void WriteLE32(boost::uint8_t* buf, boost::uint32_t value)
+{
+	buf[0] = (value      ) & 0xFF;
+	buf[1] = (value >>  8) & 0xFF;
+	buf[2] = (value >> 16) & 0xFF;
+	buf[3] = (value >> 24) & 0xFF;
+}
+
+
+CGZBlockWriter::CGZBlockWriter(const std::string& fileName, unsigned int _headerSize, unsigned int _blockSize)
+	: file(NULL)
+	, worker(NULL)
+	, closing(false)
+	, writeError(false)
+	, headerSize(_headerSize)
+	, blockSize(_blockSize)
+	, totalSize(_headerSize)
+	, headerMemberSize(0)
+{
+	file = fopen(fileName.c_str(), "wb");
+
+	if (file == NULL) {
+		LOG_L(L_ERROR, "[%s] could not open \"%s\" for writing", __FUNCTION__, fileName.c_str());
+		return;
+	}
+
+	if (headerSize > 0) {
+		// placeholder until the first WriteHeader()
+		const std::vector<boost::uint8_t> header(headerSize, 0);
+		std::vector<boost::uint8_t> member;
+
+		CompressBlock(&header[0], headerSize, Z_NO_COMPRESSION, member);
+
+		if (fwrite(&member[0], member.size(), 1, file) != 1) {
+			LOG_L(L_ERROR, "[%s] could not write to \"%s\"", __FUNCTION__, fileName.c_str());
+			fclose(file);
+			file = NULL;
+			return;
+		}
+
+		headerMemberSize = member.size();
+	}
+
+	curBlock.reserve(blockSize);
+	worker = new boost::thread(boost::bind(&CGZBlockWriter::WorkerLoop, this));
+}
+
+CGZBlockWriter::~CGZBlockWriter()
+{
+	Close();
+}
+
+
+void CGZBlockWriter::Write(const void* data, unsigned int size)
+{
+	// nothing would ever consume the queued blocks
+	if (!IsOpen())
+		return;
+
+	const boost::uint8_t* bytes = reinterpret_cast<const boost::uint8_t*>(data);
+
+	curBlock.insert(curBlock.end(), bytes, bytes + size);
+	totalSize += size;
+
+	if (curBlock.size() >= blockSize)
+		FlushBlock();
+}
+
+void CGZBlockWriter::WriteHeader(const void* data)
+{
+	if (!IsOpen())
+		return;
+
+	const boost::uint8_t* bytes = reinterpret_cast<const boost::uint8_t*>(data);
+
+	Job job;
+	job.data.assign(bytes, bytes + headerSize);
+	job.isHeader = true;
+
+	QueueJob(job);
+}
+
+void CGZBlockWriter::Close()
+{
+	if (worker == NULL)
+		return;
+
+	FlushBlock();
+
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		closing = true;
+	}
+
+	jobAdded.notify_one();
+	worker->join();
+
+	delete worker;
+	worker = NULL;
+
+	if (file != NULL) {
+		fclose(file);
+		file = NULL;
+	}
+}
+
+
+void CGZBlockWriter::FlushBlock()
+{
+	if (curBlock.empty() || !IsOpen())
+		return;
+
+	Job job;
+	job.data.swap(curBlock);
+	job.isHeader = false;
+
+	QueueJob(job);
+	curBlock.reserve(blockSize);
+}
+
+void CGZBlockWriter::QueueJob(Job& job)
+{
+	{
+		boost::mutex::scoped_lock lock(mutex);
+
+		// the worker gave up on the file, do not pile up blocks for it
+		if (writeError)
+			return;
+
+		jobs.push_back(Job());
+		jobs.back().data.swap(job.data);
+		jobs.back().isHeader = job.isHeader;
+	}
+
+	jobAdded.notify_one();
+}
+
+void CGZBlockWriter::WorkerLoop()
+{
+	Threading::SetThreadName("gzwriter");
+
+	std::vector<boost::uint8_t> member;
+
+	while (true) {
+		Job job;
+
+		{
+			boost::mutex::scoped_lock lock(mutex);
+
+			while (jobs.empty() && !closing)
+				jobAdded.wait(lock);
+
+			// closing and nothing left to write
+			if (jobs.empty())
+				break;
+
+			job.data.swap(jobs.front().data);
+			job.isHeader = jobs.front().isHeader;
+			jobs.pop_front();
+		}
+
+		bool written = true;
+
+		if (job.isHeader) {
+			CompressBlock(&job.data[0], job.data.size(), Z_NO_COMPRESSION, member);
+			assert(member.size() == headerMemberSize);
+
+			written = written && (fseek(file, 0, SEEK_SET) == 0);
+			written = written && (fwrite(&member[0], member.size(), 1, file) == 1);
+			written = written && (fseek(file, 0, SEEK_END) == 0);
+		} else {
+			CompressBlock(&job.data[0], job.data.size(), Z_BEST_COMPRESSION, member);
+			written = (fwrite(&member[0], member.size(), 1, file) == 1);
+		}
+
+		if (written)
+			continue;
+
+		// a partially written member would make the rest unreadable,
+		// keep what was written before it and stop (e.g. disk full)
+		LOG_L(L_ERROR, "[%s] write error (%s), stopped writing after %ld bytes", __FUNCTION__, strerror(errno), ftell(file));
+
+		boost::mutex::scoped_lock lock(mutex);
+		writeError = true;
+		jobs.clear();
+		break;
+	}
+}
+
+
+void CGZBlockWriter::CompressBlock(const boost::uint8_t* data, unsigned int size, int level, std::vector<boost::uint8_t>& member)
+{
+	using namespace GZBlocks;
+
+	z_stream zstream;
+	memset(&zstream, 0, sizeof(zstream));
+
+	// negative window bits: raw deflate, we write the gzip framing ourselves
+	deflateInit2(&zstream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+
+	const unsigned int bound = deflateBound(&zstream, size);
+	member.resize(HEADER_SIZE + bound + TRAILER_SIZE);
+
+	zstream.next_in = const_cast<Bytef*>(data);
+	zstream.avail_in = size;
+	zstream.next_out = &member[HEADER_SIZE];
+	zstream.avail_out = bound;
+
+	const int ret = deflate(&zstream, Z_FINISH);
+	assert(ret == Z_STREAM_END);
+
+	const unsigned int memberSize = HEADER_SIZE + zstream.total_out + TRAILER_SIZE;
+	deflateEnd(&zstream);
+
+	member.resize(memberSize);
+
+	// ID1, ID2, CM = deflate, FLG = FEXTRA, MTIME, XFL, OS = unknown
+	const boost::uint8_t header[12] = {0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 255, 8, 0};
+
+	memcpy(&member[0], header, sizeof(header));
+	member[12] = SUBFIELD_ID1;
+	member[13] = SUBFIELD_ID2;
+	member[14] = 4;
+	member[15] = 0;
+	WriteLE32(&member[16], memberSize);
+
+	WriteLE32(&member[memberSize - TRAILER_SIZE], crc32(0, data, size));
+	WriteLE32(&member[memberSize - TRAILER_SIZE + 4], size);
+
+	(void) ret;
+}
@@ -0,0 +1,99 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _GZ_BLOCK_WRITER_H
+#define _GZ_BLOCK_WRITER_H
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace boost {
+	class thread;
+}
+
+/**
+ * Blocked gzip files are a series of independently compressed gzip members,
+ * which any gzip reader decodes as one stream. Each member carries its own
+ * compressed size in an extra field, so CGZFileHandler can find all members
+ * up front and inflate them in parallel.
+ *
+ * Member layout:
+ *   gzip header with FLG.FEXTRA set, XLEN = 8
+ *   extra subfield 'S','D', SLEN = 4, uint32 size of the whole member
+ *   raw deflate data
+ *   CRC32, ISIZE
+ */
+namespace GZBlocks {
+	static const unsigned int HEADER_SIZE = 20;
+	static const unsigned int TRAILER_SIZE = 8;
+	static const unsigned char SUBFIELD_ID1 = 'S';
+	static const unsigned char SUBFIELD_ID2 = 'D';
+}
+
+
+/**
+ * @brief Writes blocked gzip files, compressing on a background thread
+ * Callers only copy data into the current block; full blocks are deflated
+ * and written by the worker, in order.
+ *
+ * The first headerSize bytes of the uncompressed stream are reserved for
+ * a header that may be rewritten at any time, e.g. once its final contents
+ * are known. It is stored without compression so its size never changes.
+ */
+class CGZBlockWriter : public boost::noncopyable
+{
+public:
+	CGZBlockWriter(const std::string& fileName, unsigned int headerSize, unsigned int blockSize = 256 * 1024);
+	~CGZBlockWriter();
+
+	bool IsOpen() const { return (file != NULL); }
+
+	void Write(const void* data, unsigned int size);
+	/// Replace the reserved header, data must be headerSize bytes
+	void WriteHeader(const void* data);
+	/// Write out all queued blocks, then close the file
+	void Close();
+
+	/// number of uncompressed bytes written so far, including the header
+	unsigned int GetSize() const { return totalSize; }
+
+	/// Deflate data into a complete gzip member
+	static void CompressBlock(const boost::uint8_t* data, unsigned int size, int level, std::vector<boost::uint8_t>& member);
+
+private:
+	struct Job {
+		std::vector<boost::uint8_t> data;
+		bool isHeader;
+	};
+
+	void QueueJob(Job& job);
+	void FlushBlock();
+	void WorkerLoop();
+
+private:
+	FILE* file;
+	boost::thread* worker;
+
+	boost::mutex mutex;
+	boost::condition_variable jobAdded;
+	std::deque<Job> jobs;
+	bool closing;
+	/// set by the worker when writing failed, no more jobs are queued then
+	bool writeError;
+
+	std::vector<boost::uint8_t> curBlock;
+
+	unsigned int headerSize;
+	unsigned int blockSize;
+	unsigned int totalSize;
+	/// compressed size of the stored header member
+	unsigned int headerMemberSize;
+};
+
+#endif // _GZ_BLOCK_WRITER_H
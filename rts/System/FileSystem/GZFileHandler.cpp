@@ -3,12 +3,17 @@
 
 #include "GZFileHandler.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <fstream>
 #include <string>
 #include <zlib.h>
 
 #include "FileQueryFlags.h"
 #include "FileSystem.h"
+#include "GZBlockWriter.h"
+#include "System/ThreadPool.h"
 
 
 #ifndef TOOLS
@@ -35,10 +40,121 @@ CGZFileHandler::CGZFileHandler(const std::string& fileName, const std::string& m
 }
 
 
+static boost::uint32_t ReadLE32(const boost::uint8_t* buf)
+{
+	return (buf[0] | (buf[1] << 8) | (buf[2] << 16) | (buf[3] << 24));
+}
+
+
+bool CGZBlockReader::ParseMembers(const std::vector<boost::uint8_t>& compressed)
+{
+	using namespace GZBlocks;
+
+	members.clear();
+	rawSize = 0;
+
+	for (size_t pos = 0; pos < compressed.size(); ) {
+		const boost::uint8_t* buf = &compressed[pos];
+		const size_t bytesLeft = compressed.size() - pos;
+
+		if (bytesLeft < (HEADER_SIZE + TRAILER_SIZE))
+			break;
+		// plain gzip, or not written by CGZBlockWriter
+		if (buf[0] != 0x1f || buf[1] != 0x8b || buf[2] != 8 || buf[3] != 4 || buf[10] != 8 || buf[11] != 0)
+			return false;
+		if (buf[12] != SUBFIELD_ID1 || buf[13] != SUBFIELD_ID2 || buf[14] != 4 || buf[15] != 0)
+			return false;
+
+		Member m;
+		m.offset = pos;
+		m.size = ReadLE32(buf + 16);
+
+		if (m.size < (HEADER_SIZE + TRAILER_SIZE))
+			return false;
+
+		// the writer was killed before finishing this member, keep the complete ones
+		if (m.size > bytesLeft)
+			break;
+
+		m.rawOffset = rawSize;
+		m.rawSize = ReadLE32(buf + m.size - 4);
+
+		members.push_back(m);
+		rawSize += m.rawSize;
+		pos += m.size;
+	}
+
+	return !members.empty();
+}
+
+bool CGZBlockReader::InflateMember(const std::vector<boost::uint8_t>& compressed, const Member& m, boost::uint8_t* out)
+{
+	using namespace GZBlocks;
+
+	z_stream zstream;
+	memset(&zstream, 0, sizeof(zstream));
+	inflateInit2(&zstream, -MAX_WBITS);
+
+	zstream.next_in = const_cast<Bytef*>(&compressed[m.offset + HEADER_SIZE]);
+	zstream.avail_in = m.size - HEADER_SIZE - TRAILER_SIZE;
+	zstream.next_out = out;
+	zstream.avail_out = m.rawSize;
+
+	const int ret = inflate(&zstream, Z_FINISH);
+	const bool complete = (ret == Z_STREAM_END && zstream.total_out == m.rawSize);
+
+	inflateEnd(&zstream);
+
+	return (complete && crc32(0, out, m.rawSize) == ReadLE32(&compressed[m.offset + m.size - TRAILER_SIZE]));
+}
+
+bool CGZBlockReader::Inflate(const std::vector<boost::uint8_t>& compressed, std::vector<boost::uint8_t>& uncompressed)
+{
+	if (!ParseMembers(compressed))
+		return false;
+
+	uncompressed.resize(rawSize);
+
+	// members are independent, each one has its own slice of the output
+	std::vector<char> valid(members.size(), 0);
+
+	for_mt(0, members.size(), [&](const int i) {
+		valid[i] = InflateMember(compressed, members[i], uncompressed.data() + members[i].rawOffset);
+	});
+
+	if (std::find(valid.begin(), valid.end(), 0) != valid.end()) {
+		uncompressed.clear();
+		return false;
+	}
+
+	return true;
+}
+
+
 bool CGZFileHandler::ReadToBuffer(const std::string& path)
 {
 	assert(fileBuffer.empty());
 
+	{
+		// demos written by CGZBlockWriter can be inflated in parallel
+		std::ifstream ifs(path.c_str(), std::ios::in | std::ios::binary);
+		std::vector<boost::uint8_t> compressed;
+
+		if (ifs.good()) {
+			ifs.seekg(0, std::ios::end);
+			compressed.resize(std::max(int(ifs.tellg()), 0));
+			ifs.seekg(0, std::ios::beg);
+
+			if (!compressed.empty())
+				ifs.read(reinterpret_cast<char*>(&compressed[0]), compressed.size());
+		}
+
+		if (ifs.good() && CGZBlockReader().Inflate(compressed, fileBuffer)) {
+			fileSize = fileBuffer.size();
+			return true;
+		}
+	}
+
 	gzFile file = gzopen(path.c_str(), "rb");
 	if (file == Z_NULL)
 		return false;
@@ -68,6 +184,11 @@ bool CGZFileHandler::UncompressBuffer()
 	std::vector<boost::uint8_t> compressed;
 	std::swap(compressed, fileBuffer);
 
+	if (CGZBlockReader().Inflate(compressed, fileBuffer)) {
+		fileSize = fileBuffer.size();
+		return true;
+	}
+
 
 	z_stream zstream;
 	zstream.opaque = Z_NULL;
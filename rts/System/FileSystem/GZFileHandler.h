@@ -8,6 +8,37 @@
 #include <string>
 
 #include "VFSModes.h"
+
+#include <boost/cstdint.hpp>
+#include <vector>
+
+/**
+ * Inflates blocked gzip files (see GZBlockWriter.h), one member per thread.
+ */
+class CGZBlockReader
+{
+public:
+	CGZBlockReader(): rawSize(0) {}
+
+	/// @return false if the data is not a complete blocked gzip stream
+	bool Inflate(const std::vector<boost::uint8_t>& compressed, std::vector<boost::uint8_t>& uncompressed);
+
+private:
+	struct Member {
+		size_t offset;
+		size_t size;
+		size_t rawOffset;
+		size_t rawSize;
+	};
+
+	bool ParseMembers(const std::vector<boost::uint8_t>& compressed);
+	static bool InflateMember(const std::vector<boost::uint8_t>& compressed, const Member& m, boost::uint8_t* out);
+
+private:
+	std::vector<Member> members;
+	size_t rawSize;
+};
+
 /**
  * Uncompresses the entire file to memory, so don't use with huge files.
  */
@@ -4,13 +4,15 @@
 #include "VFSHandler.h"
 
 #include <algorithm>
-#include <set>
+#include <cstdio>
 #include <cstring>
 
 #include "ArchiveLoader.h"
 #include "System/FileSystem/Archives/IArchive.h"
 #include "FileSystem.h"
 #include "ArchiveScanner.h"
+#include "DataDirsAccess.h"
+#include "FileQueryFlags.h"
 #include "System/Exceptions.h"
 #include "System/Log/ILog.h"
 #include "System/Util.h"
@@ -28,6 +30,10 @@ LOG_REGISTER_SECTION_GLOBAL(LOG_SECTION_VFS)
 
 CVFSHandler* vfsHandler = NULL;
 
+// bump when the format of the index cache files changes
+static const boost::uint32_t INDEX_CACHE_VERSION = 1;
+static const char INDEX_CACHE_MAGIC[8] = {'s', 'p', 'r', 'i', 'v', 'f', 's', 0};
+
 
 CVFSHandler::CVFSHandler()
 {
@@ -41,41 +47,80 @@ bool CVFSHandler::AddArchive(const std::string& archiveName, bool override, cons
 		"AddArchive(arName = \"%s\", override = %s, type = \"%s\")",
 		archiveName.c_str(), override ? "true" : "false", type.c_str());
 
-	IArchive* ar = archives[archiveName];
+	const bool isNew = (archives.find(archiveName) == archives.end());
+	ArchiveData& archive = archives[archiveName];
+
+	if (isNew)
+		archive.type = type;
+
+	// only archives known to the scanner have a (cached) checksum, and
+	// unpacked ones are skipped: the scanner does not reliably notice when
+	// files inside a directory change, so their checksum may be stale
+	unsigned int checksum = 0;
+	if (archiveScanner != NULL && !archiveScanner->GetArchivePath(archiveName).empty()) {
+		if (StringToLower(FileSystem::GetExtension(archiveName)) != "sdd")
+			checksum = archiveScanner->GetSingleArchiveChecksum(archiveName);
+	}
+
+	std::vector<FileEntry> entries;
+	const bool wasOpen = (archive.ar != NULL);
+
+	if (!wasOpen && checksum != 0 && ReadIndexCache(checksum, entries)) {
+		LOG_L(L_DEBUG, "AddArchive: using cached index for '%s' (%u files)", archiveName.c_str(), unsigned(entries.size()));
+		AddFiles(&archive, entries, override);
+		return true;
+	}
+
+	IArchive* ar = GetArchive(&archive);
 
 	if (ar == NULL) {
-		ar = archiveLoader.OpenArchive(archiveName, type);
-		if (!ar) {
-			LOG_L(L_ERROR, "AddArchive: Failed to open archive '%s'.", archiveName.c_str());
-			return false;
-		}
-		archives[archiveName] = ar;
+		if (isNew)
+			archives.erase(archiveName);
+		return false;
 	}
 
+	entries.resize(ar->NumFiles());
+
 	for (unsigned fid = 0; fid != ar->NumFiles(); ++fid) {
-		std::string name;
-		int size;
-		ar->FileInfo(fid, name, size);
-		StringToLowerInPlace(name);
-
-		if (!override) {
-			if (files.find(name) != files.end()) {
-				LOG_L(L_DEBUG, "%s (skipping, exists)", name.c_str());
+		ar->FileInfo(fid, entries[fid].name, entries[fid].size);
+		StringToLowerInPlace(entries[fid].name);
+	}
+
+	AddFiles(&archive, entries, override);
+
+	if (!wasOpen && checksum != 0)
+		WriteIndexCache(checksum, entries);
+
+	return true;
+}
+
+void CVFSHandler::AddFiles(ArchiveData* archive, const std::vector<FileEntry>& entries, bool override)
+{
+	files.reserve(files.size() + entries.size());
+
+	FileData d;
+	d.archive = archive;
+
+	for (const FileEntry& entry: entries) {
+		const auto it = files.find(entry.name);
+
+		if (it != files.end()) {
+			if (!override) {
+				LOG_L(L_DEBUG, "%s (skipping, exists)", entry.name.c_str());
 				continue;
-			} else {
-				LOG_L(L_DEBUG, "%s (adding, does not exist)", name.c_str());
 			}
-		} else {
-			LOG_L(L_DEBUG, "%s (overriding)", name.c_str());
-		} 
 
-		FileData d;
-		d.ar = ar;
-		d.size = size;
-		files[name] = d;
-	}
+			LOG_L(L_DEBUG, "%s (overriding)", entry.name.c_str());
+			d.size = entry.size;
+			it->second = d;
+			continue;
+		}
 
-	return true;
+		LOG_L(L_DEBUG, "%s (adding, does not exist)", entry.name.c_str());
+		d.size = entry.size;
+		files[entry.name] = d;
+		AddToDirTree(entry.name);
+	}
 }
 
 bool CVFSHandler::AddArchiveWithDeps(const std::string& archiveName, bool override, const std::string& type)
@@ -104,24 +149,20 @@ bool CVFSHandler::RemoveArchive(const std::string& archiveName)
 	if (it == archives.end())
 		return true;
 
-	IArchive* ar = it->second;
-
-	if (ar == NULL) {
-		// archive is not loaded
-		return true;
-	}
+	ArchiveData* archive = &(it->second);
 
 	// remove the files loaded from the archive-to-remove
-	for (std::map<std::string, FileData>::iterator f = files.begin(); f != files.end();) {
-		if (f->second.ar == ar) {
+	for (auto f = files.begin(); f != files.end();) {
+		if (f->second.archive == archive) {
 			LOG_L(L_DEBUG, "%s (removing)", f->first.c_str());
-			f = set_erase(files, f);
+			RemoveFromDirTree(f->first);
+			f = files.erase(f);
 		} else {
 			 ++f;
 		}
 	}
-	delete ar;
-	archives.erase(archiveName);
+	delete archive->ar;
+	archives.erase(it);
 
 	return true;
 }
@@ -130,12 +171,164 @@ CVFSHandler::~CVFSHandler()
 {
 	LOG_L(L_INFO, "[%s] #archives=%lu", __FUNCTION__, (long unsigned) archives.size());
 
-	for (std::map<std::string, IArchive*>::iterator i = archives.begin(); i != archives.end(); ++i) {
-		LOG_L(L_INFO, "\tarchive=%s (%p)", (i->first).c_str(), i->second);
-		delete i->second;
+	for (std::map<std::string, ArchiveData>::iterator i = archives.begin(); i != archives.end(); ++i) {
+		LOG_L(L_INFO, "\tarchive=%s (%p)", (i->first).c_str(), i->second.ar);
+		delete i->second.ar;
 	}
 }
 
+IArchive* CVFSHandler::GetArchive(ArchiveData* archive)
+{
+	boost::mutex::scoped_lock lock(archiveMutex);
+
+	if (archive->ar != NULL)
+		return archive->ar;
+
+	for (std::map<std::string, ArchiveData>::iterator i = archives.begin(); i != archives.end(); ++i) {
+		if (&(i->second) != archive)
+			continue;
+
+		archive->ar = archiveLoader.OpenArchive(i->first, archive->type);
+
+		if (archive->ar == NULL)
+			LOG_L(L_ERROR, "Failed to open archive '%s'.", i->first.c_str());
+
+		break;
+	}
+
+	return archive->ar;
+}
+
+
+void CVFSHandler::AddToDirTree(const std::string& filePath)
+{
+	std::string::size_type slash = filePath.rfind('/');
+	std::string dir = (slash == std::string::npos)? "": filePath.substr(0, slash + 1);
+
+	dirs[dir].files.insert(filePath.substr(dir.length()));
+
+	// register dir with all of its parents, up to the first one that existed
+	while (!dir.empty()) {
+		slash = dir.rfind('/', dir.length() - 2);
+		const std::string parent = (slash == std::string::npos)? "": dir.substr(0, slash + 1);
+
+		if (!dirs[parent].dirs.insert(dir.substr(parent.length())).second)
+			break;
+
+		dir = parent;
+	}
+}
+
+void CVFSHandler::RemoveFromDirTree(const std::string& filePath)
+{
+	std::string::size_type slash = filePath.rfind('/');
+	std::string dir = (slash == std::string::npos)? "": filePath.substr(0, slash + 1);
+
+	auto it = dirs.find(dir);
+	if (it == dirs.end())
+		return;
+
+	it->second.files.erase(filePath.substr(dir.length()));
+
+	// prune dirs that became empty
+	while (!dir.empty() && it->second.files.empty() && it->second.dirs.empty()) {
+		dirs.erase(it);
+
+		slash = dir.rfind('/', dir.length() - 2);
+		const std::string parent = (slash == std::string::npos)? "": dir.substr(0, slash + 1);
+
+		if ((it = dirs.find(parent)) == dirs.end())
+			return;
+
+		it->second.dirs.erase(dir.substr(parent.length()));
+		dir = parent;
+	}
+}
+
+
+std::string CVFSHandler::GetIndexCacheFile(unsigned int checksum)
+{
+	static const std::string cacheDir = dataDirsAccess.LocateDir(FileSystem::GetCacheDir() + "/vfsIndex/", FileQueryFlags::WRITE | FileQueryFlags::CREATE_DIRS);
+
+	char name[32];
+	snprintf(name, sizeof(name), "%08x.idx", checksum);
+	return cacheDir + name;
+}
+
+bool CVFSHandler::ReadIndexCache(unsigned int checksum, std::vector<FileEntry>& entries)
+{
+	FILE* file = fopen(GetIndexCacheFile(checksum).c_str(), "rb");
+
+	if (file == NULL)
+		return false;
+
+	char magic[sizeof(INDEX_CACHE_MAGIC)];
+	boost::uint32_t header[3] = {0, 0, 0}; // version, checksum, #entries
+
+	bool ok = true;
+	ok = ok && (fread(magic, sizeof(magic), 1, file) == 1);
+	ok = ok && (fread(header, sizeof(header), 1, file) == 1);
+	ok = ok && (memcmp(magic, INDEX_CACHE_MAGIC, sizeof(magic)) == 0);
+	ok = ok && (header[0] == INDEX_CACHE_VERSION) && (header[1] == checksum);
+
+	if (ok)
+		entries.resize(header[2]);
+
+	for (size_t n = 0; ok && n < entries.size(); n++) {
+		boost::int32_t size;
+		boost::uint16_t nameLen;
+
+		ok = ok && (fread(&size, sizeof(size), 1, file) == 1);
+		ok = ok && (fread(&nameLen, sizeof(nameLen), 1, file) == 1);
+
+		if (!ok)
+			break;
+
+		entries[n].size = size;
+		entries[n].name.resize(nameLen);
+
+		ok = (nameLen == 0) || (fread(&entries[n].name[0], nameLen, 1, file) == 1);
+	}
+
+	fclose(file);
+
+	if (!ok) {
+		LOG_L(L_WARNING, "[%s] ignoring broken index cache for checksum %08x", __FUNCTION__, checksum);
+		entries.clear();
+	}
+
+	return ok;
+}
+
+void CVFSHandler::WriteIndexCache(unsigned int checksum, const std::vector<FileEntry>& entries)
+{
+	const std::string fileName = GetIndexCacheFile(checksum);
+	FILE* file = fopen(fileName.c_str(), "wb");
+
+	if (file == NULL) {
+		LOG_L(L_WARNING, "[%s] could not write \"%s\"", __FUNCTION__, fileName.c_str());
+		return;
+	}
+
+	// host byte-order, the cache never leaves this machine
+	const boost::uint32_t header[3] = {INDEX_CACHE_VERSION, checksum, boost::uint32_t(entries.size())};
+
+	fwrite(INDEX_CACHE_MAGIC, sizeof(INDEX_CACHE_MAGIC), 1, file);
+	fwrite(header, sizeof(header), 1, file);
+
+	for (const FileEntry& entry: entries) {
+		const boost::int32_t size = entry.size;
+		const boost::uint16_t nameLen = std::min(entry.name.size(), size_t(0xFFFF));
+
+		fwrite(&size, sizeof(size), 1, file);
+		fwrite(&nameLen, sizeof(nameLen), 1, file);
+		fwrite(entry.name.data(), nameLen, 1, file);
+	}
+
+	fclose(file);
+}
+
+
 std::string CVFSHandler::GetNormalizedPath(const std::string& rawPath)
 {
 	std::string path = StringToLower(rawPath);
@@ -145,14 +338,12 @@ std::string CVFSHandler::GetNormalizedPath(const std::string& rawPath)
 
 const CVFSHandler::FileData* CVFSHandler::GetFileData(const std::string& normalizedFilePath)
 {
-	const FileData* fileData = NULL;
+	const auto fi = files.find(normalizedFilePath);
 
-	const std::map<std::string, FileData>::const_iterator fi = files.find(normalizedFilePath);
-	if (fi != files.end()) {
-		fileData = &(fi->second);
-	}
+	if (fi != files.end())
+		return &(fi->second);
 
-	return fileData;
+	return NULL;
 }
 
 bool CVFSHandler::LoadFile(const std::string& filePath, std::vector<boost::uint8_t>& buffer)
@@ -167,7 +358,9 @@ bool CVFSHandler::LoadFile(const std::string& filePath, std::vector<boost::uint8
 		return false;
 	}
 
-	if (!fileData->ar->GetFile(normalizedPath, buffer))
+	IArchive* ar = GetArchive(fileData->archive);
+
+	if (ar == NULL || !ar->GetFile(normalizedPath, buffer))
 	{
 		LOG_L(L_DEBUG, "LoadFile: File '%s' does not exist in archive.", filePath.c_str());
 		return false;
@@ -187,7 +380,12 @@ bool CVFSHandler::FileExists(const std::string& filePath)
 		return false;
 	}
 
-	if (!fileData->ar->FileExists(normalizedPath)) {
+	// an index from the cache matches the archive contents (same checksum),
+	// no need to open the archive just to ask it again
+	boost::mutex::scoped_lock lock(archiveMutex);
+	const IArchive* ar = fileData->archive->ar;
+
+	if (ar != NULL && !ar->FileExists(normalizedPath)) {
 		// the file does not exist in the archive
 		return false;
 	}
@@ -202,43 +400,16 @@ std::vector<std::string> CVFSHandler::GetFilesInDir(const std::string& rawDir)
 	std::vector<std::string> ret;
 	std::string dir = GetNormalizedPath(rawDir);
 
-	std::map<std::string, FileData>::const_iterator filesStart = files.begin();
-	std::map<std::string, FileData>::const_iterator filesEnd   = files.end();
-
-	// Non-empty directories to look in should have a trailing backslash
-	if (!dir.empty()) {
-		std::string::size_type dirLast = (dir.length() - 1);
-		if (dir[dirLast] != '/') {
-			dir += "/";
-			dirLast++;
-		}
-		// limit the iterator range
-		std::string dirEnd = dir;
-		dirEnd[dirLast] = dirEnd[dirLast] + 1;
-		filesStart = files.lower_bound(dir);
-		filesEnd   = files.upper_bound(dirEnd);
-	}
-
-	while (filesStart != filesEnd) {
-		const std::string path = FileSystem::GetDirectory(filesStart->first);
+	// Non-empty directories to look in should have a trailing slash
+	if (!dir.empty() && dir[dir.length() - 1] != '/')
+		dir += "/";
 
-		// Check if this file starts with the dir path
-		if (path.compare(0, dir.length(), dir) == 0) {
+	const auto it = dirs.find(dir);
 
-			// Strip pathname
-			const std::string name = filesStart->first.substr(dir.length());
-
-			// Do not return files in subfolders
-			if ((name.find('/') == std::string::npos)
-					&& (name.find('\\') == std::string::npos))
-			{
-				ret.push_back(name);
-				LOG_L(L_DEBUG, "%s", name.c_str());
-			}
-		}
-		++filesStart;
-	}
+	if (it == dirs.end())
+		return ret;
 
+	ret.assign(it->second.files.begin(), it->second.files.end());
 	return ret;
 }
 
@@ -250,44 +421,15 @@ std::vector<std::string> CVFSHandler::GetDirsInDir(const std::string& rawDir)
 	std::vector<std::string> ret;
 	std::string dir = GetNormalizedPath(rawDir);
 
-	std::map<std::string, FileData>::const_iterator filesStart = files.begin();
-	std::map<std::string, FileData>::const_iterator filesEnd   = files.end();
-
-	// Non-empty directories to look in should have a trailing backslash
-	if (!dir.empty()) {
-		std::string::size_type dirLast = (dir.length() - 1);
-		if (dir[dirLast] != '/') {
-			dir += "/";
-			++dirLast;
-		}
-		// limit the iterator range
-		std::string dirEnd = dir;
-		dirEnd[dirLast] = dirEnd[dirLast] + 1;
-		filesStart = files.lower_bound(dir);
-		filesEnd   = files.upper_bound(dirEnd);
-	}
+	// Non-empty directories to look in should have a trailing slash
+	if (!dir.empty() && dir[dir.length() - 1] != '/')
+		dir += "/";
 
-	std::set<std::string> dirs;
-
-	while (filesStart != filesEnd) {
-		const std::string path = FileSystem::GetDirectory(filesStart->first);
-		// Test to see if this file start with the dir path
-		if (path.compare(0, dir.length(), dir) == 0) {
-			// Strip pathname
-			const std::string name = filesStart->first.substr(dir.length());
-			const std::string::size_type slash = name.find_first_of("/\\");
-			if (slash != std::string::npos) {
-				dirs.insert(name.substr(0, slash + 1));
-			}
-		}
-		++filesStart;
-	}
+	const auto it = dirs.find(dir);
 
-	for (std::set<std::string>::const_iterator it = dirs.begin(); it != dirs.end(); ++it) {
-		ret.push_back(*it);
-		LOG_L(L_DEBUG, "%s", it->c_str());
-	}
+	if (it == dirs.end())
+		return ret;
 
+	ret.assign(it->second.dirs.begin(), it->second.dirs.end());
 	return ret;
 }
-
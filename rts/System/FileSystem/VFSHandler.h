@@ -4,9 +4,12 @@
 #define _VFS_HANDLER_H
 
 #include <map>
+#include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
 
 class IArchive;
 
@@ -14,6 +17,12 @@ class IArchive;
  * Main API for accessing the Virtual File System (VFS).
  * This only allows accessing the VFS (stuff within archives registered with the
  * VFS), NOT the real file system.
+ *
+ * Files are kept in a hash table, directory listings come from a directory
+ * tree that is updated whenever archives are added or removed.
+ * The file list of every scanned, packed archive is cached on disk, keyed
+ * by its checksum; archives added from that cache are only opened when the
+ * first file is read from them.
  */
 class CVFSHandler
 {
@@ -74,16 +83,49 @@ public:
 	bool RemoveArchive(const std::string& archiveName);
 
 protected:
-	struct FileData {
+	struct ArchiveData {
+		ArchiveData(): ar(NULL) {}
+		/// NULL while the archive was not opened yet
 		IArchive* ar;
+		std::string type;
+	};
+	struct FileData {
+		ArchiveData* archive;
 		int size;
 	};
-	std::map<std::string, FileData> files; 
-	std::map<std::string, IArchive*> archives;
+	struct FileEntry {
+		std::string name; ///< lower-case
+		int size;
+	};
+	struct DirData {
+		std::set<std::string> files;
+		std::set<std::string> dirs; ///< with trailing slash
+	};
+
+	std::unordered_map<std::string, FileData> files;
+	/// key is the normalized path with trailing slash, "" for the root
+	std::unordered_map<std::string, DirData> dirs;
+	/// std::map does not move its values, FileData points into it
+	std::map<std::string, ArchiveData> archives;
 
 private:
 	std::string GetNormalizedPath(const std::string& rawPath);
 	const FileData* GetFileData(const std::string& normalizedFilePath);
+	/// opens the archive if it was added from the index cache
+	IArchive* GetArchive(ArchiveData* archive);
+
+	/// adds all entries at once, for archives with many files
+	void AddFiles(ArchiveData* archive, const std::vector<FileEntry>& entries, bool override);
+	void AddToDirTree(const std::string& filePath);
+	void RemoveFromDirTree(const std::string& filePath);
+
+	static std::string GetIndexCacheFile(unsigned int checksum);
+	static bool ReadIndexCache(unsigned int checksum, std::vector<FileEntry>& entries);
+	static void WriteIndexCache(unsigned int checksum, const std::vector<FileEntry>& entries);
+
+private:
+	/// guards lazy opening of archives, LoadFile can be called from any thread
+	boost::mutex archiveMutex;
 };
 
 extern CVFSHandler* vfsHandler;
@@ -1,6 +1,13 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
 #include <fstream>
+#include <sstream>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "minizip/zip.h"
 
 #include "ExternalAI/EngineOutHandler.h"
 #include "CregLoadSaveHandler.h"
@@ -24,15 +31,64 @@
 #include "Game/UI/Groups/GroupHandler.h"
 
 #include "System/Platform/errorhandler.h"
+#include "System/Platform/byteorder.h"
+#include "System/Platform/Threading.h"
+#include "System/FileSystem/Archives/IArchive.h"
+#include "System/FileSystem/ArchiveLoader.h"
 #include "System/FileSystem/DataDirsAccess.h"
 #include "System/FileSystem/FileQueryFlags.h"
+#include "System/FileSystem/FileSystem.h"
+#include "System/FileSystem/GZBlockWriter.h"
+#include "System/FileSystem/GZFileHandler.h"
 #include "System/creg/Serializer.h"
+#include "System/EventHandler.h"
 #include "System/Exceptions.h"
 #include "System/Log/ILog.h"
+#include "System/Misc/SpringTime.h"
+
+
+#define SAVEFILE_MAGIC "spring cregsave"
+// bump when the layout changes, creg itself checks the class metadata
+static const int SAVEFILE_VERSION = 1;
+
+struct SaveFileHeader
+{
+	char magic[16];
+	int version;
+	int sectionOffsets[CCregLoadSaveHandler::NUM_SECTIONS];
+	int sectionSizes[CCregLoadSaveHandler::NUM_SECTIONS];
+
+	void SwapBytes()
+	{
+		swabDWordInPlace(version);
+		for (int n = 0; n < CCregLoadSaveHandler::NUM_SECTIONS; n++) {
+			swabDWordInPlace(sectionOffsets[n]);
+			swabDWordInPlace(sectionSizes[n]);
+		}
+	}
+};
+
+/// everything the background thread needs to write a savegame
+struct SaveFileJob
+{
+	std::string fileName;
+	std::string startInfo;
+	std::string sections[CCregLoadSaveHandler::NUM_SECTIONS];
+};
+
+static boost::thread* saveThread = NULL;
+
+
+static std::string ReadWholeFile(const std::string& fileName)
+{
+	std::ifstream ifs(fileName.c_str(), std::ios::in | std::ios::binary);
+	std::ostringstream buf;
+	buf << ifs.rdbuf();
+	return buf.str();
+}
 
 
 CCregLoadSaveHandler::CCregLoadSaveHandler()
-	: ifs(NULL)
 {}
 
 CCregLoadSaveHandler::~CCregLoadSaveHandler()
@@ -96,45 +152,143 @@ static void PrintSize(const char* txt, int size)
 		LOG("%s %u B",    txt, size);
 	}
 }
+
+/// Run the Save call-ins of the Lua handles, they can only write to a zip on disk
+static std::string SaveLuaState(const std::string& tmpFileName)
+{
+	zipFile zip = zipOpen(tmpFileName.c_str(), APPEND_STATUS_CREATE);
+
+	if (zip == NULL) {
+		LOG_L(L_ERROR, "Unable to save Lua state to \"%s\"", tmpFileName.c_str());
+		return "";
+	}
+
+	eventHandler.Save(zip);
+	zipClose(zip, NULL);
+
+	const std::string data = ReadWholeFile(tmpFileName);
+	FileSystem::Remove(tmpFileName);
+	return data;
+}
+
+static void WriteSaveFile(boost::shared_ptr<SaveFileJob> job)
+{
+	Threading::SetThreadName("savegame");
+
+	const spring_time startTime = spring_gettime();
+
+	SaveFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SAVEFILE_MAGIC, sizeof(SAVEFILE_MAGIC));
+	header.version = SAVEFILE_VERSION;
+
+	CGZBlockWriter writer(job->fileName, sizeof(SaveFileHeader));
+
+	if (!writer.IsOpen()) {
+		LOG_L(L_ERROR, "Save failed: unable to open \"%s\"", job->fileName.c_str());
+		return;
+	}
+
+	writer.Write(job->startInfo.data(), job->startInfo.size());
+
+	for (int n = 0; n < CCregLoadSaveHandler::NUM_SECTIONS; n++) {
+		header.sectionOffsets[n] = writer.GetSize();
+		header.sectionSizes[n] = job->sections[n].size();
+
+		writer.Write(job->sections[n].data(), job->sections[n].size());
+
+		// free memory as early as possible, sections can be huge
+		std::string().swap(job->sections[n]);
+	}
+
+	header.SwapBytes();
+	writer.WriteHeader(&header);
+	writer.Close();
+
+	LOG("Game saved to \"%s\" (compressed in %ims)", job->fileName.c_str(), int((spring_gettime() - startTime).toMilliSecsi()));
+}
 #endif //USING_CREG
 
-static void ReadString(std::istream& s, std::string& str)
+static bool ReadString(const std::vector<boost::uint8_t>& data, size_t& pos, size_t end, std::string& str)
 {
-	char cstr[1 << 16]; // 64kB
-	s.getline(cstr, sizeof(cstr), 0);
-	str += cstr;
+	for (size_t n = pos; n < end; n++) {
+		if (data[n] != 0)
+			continue;
+
+		str.assign(reinterpret_cast<const char*>(&data[pos]), n - pos);
+		pos = n + 1;
+		return true;
+	}
+
+	return false;
 }
 
 
 
+void CCregLoadSaveHandler::WaitForPendingSave()
+{
+#ifdef USING_CREG
+	if (saveThread == NULL)
+		return;
+
+	saveThread->join();
+	delete saveThread;
+	saveThread = NULL;
+#endif //USING_CREG
+}
+
 void CCregLoadSaveHandler::SaveGame(const std::string& file)
 {
 #ifdef USING_CREG
+	WaitForPendingSave();
+
 	LOG("Saving game");
 	try {
-		std::ofstream ofs(dataDirsAccess.LocateFile(file, FileQueryFlags::WRITE).c_str(), std::ios::out|std::ios::binary);
-		if (ofs.bad() || !ofs.is_open()) {
+		boost::shared_ptr<SaveFileJob> job(new SaveFileJob());
+		job->fileName = dataDirsAccess.LocateFile(file, FileQueryFlags::WRITE);
+
+		if (job->fileName.empty()) {
 			throw content_error("Unable to save game to file \"" + file + "\"");
 		}
 
-		// write our own header. SavePackage() will add its own
-		WriteString(ofs, gameSetup->setupText);
-		WriteString(ofs, modName);
-		WriteString(ofs, mapName);
+		const spring_time startTime = spring_gettime();
 
-		CGameStateCollector gsc = CGameStateCollector();
+		// our own header, read by LoadGameStartInfo
+		{
+			std::ostringstream startInfo(std::ios::out | std::ios::binary);
+			WriteString(startInfo, gameSetup->setupText);
+			WriteString(startInfo, modName);
+			WriteString(startInfo, mapName);
+			job->startInfo = startInfo.str();
+		}
 
 		// save creg state
-		creg::COutputStreamSerializer os;
-		os.SavePackage(&ofs, &gsc, gsc.GetClass());
-		PrintSize("Game", ofs.tellp());
+		{
+			CGameStateCollector gsc = CGameStateCollector();
+
+			std::stringstream game(std::ios::in | std::ios::out | std::ios::binary);
+			creg::COutputStreamSerializer os;
+			os.SavePackage(&game, &gsc, gsc.GetClass());
+			job->sections[SECTION_GAME] = game.str();
+			PrintSize("Game", job->sections[SECTION_GAME].size());
+		}
 
 		// save ai state
-		int aistart = ofs.tellp();
-		eoh->Save(&ofs);
-		PrintSize("AIs", ((int)ofs.tellp()) - aistart);
+		{
+			std::stringstream ais(std::ios::in | std::ios::out | std::ios::binary);
+			eoh->Save(&ais);
+			job->sections[SECTION_AI] = ais.str();
+			PrintSize("AIs", job->sections[SECTION_AI].size());
+		}
+
+		// save lua state
+		job->sections[SECTION_LUA] = SaveLuaState(job->fileName + ".lua.tmp");
+		PrintSize("Lua", job->sections[SECTION_LUA].size());
+
+		LOG("Game state serialized in %ims", int((spring_gettime() - startTime).toMilliSecsi()));
 
-		//FIXME add lua state
+		// compress and write in the background, the game can go on
+		saveThread = new boost::thread(boost::bind(&WriteSaveFile, job));
 	} catch (const content_error& ex) {
 		LOG_L(L_ERROR, "Save failed(content error): %s", ex.what());
 	} catch (const std::exception& ex) {
@@ -154,27 +308,69 @@ void CCregLoadSaveHandler::SaveGame(const std::string& file)
 /// this just loads the mapname and some other early stuff
 void CCregLoadSaveHandler::LoadGameStartInfo(const std::string& file)
 {
-	ifs = new std::ifstream(dataDirsAccess.LocateFile(FindSaveFile(file)), std::ios::in|std::ios::binary);
+	// the file might still be written
+	WaitForPendingSave();
+
+	saveFileName = file;
+
+	const std::string realName = dataDirsAccess.LocateFile(FindSaveFile(file));
+	const std::string compressedStr = ReadWholeFile(realName);
+	const std::vector<boost::uint8_t> compressed(compressedStr.begin(), compressedStr.end());
+
+	std::vector<boost::uint8_t> data;
+	CGZBlockReader reader;
+
+	if (compressed.empty() || !reader.Inflate(compressed, data) || data.size() < sizeof(SaveFileHeader))
+		throw content_error("Unable to read savegame \"" + file + "\"");
+
+	SaveFileHeader header;
+	memcpy(&header, &data[0], sizeof(header));
+	header.SwapBytes();
 
-	// in case these contained values alredy
-	// (this is the case when loading a game through the spring menu eg),
-	// we set them to empty strings, as ReadString() does append,
-	// and we would end up with the correct value but two times
-	// eg: "AbcAbc" instead of "Abc"
+	if (memcmp(header.magic, SAVEFILE_MAGIC, sizeof(SAVEFILE_MAGIC)) != 0 || header.version != SAVEFILE_VERSION)
+		throw content_error("Savegame \"" + file + "\" has an unsupported format");
 
-	//FIXME remove
-	scriptText = "";
-	modName = "";
-	mapName = "";
+	for (int n = 0; n < NUM_SECTIONS; n++) {
+		const size_t offset = header.sectionOffsets[n];
+		const size_t size = header.sectionSizes[n];
 
-	// read our own header.
-	ReadString(*ifs, scriptText);
-	ReadString(*ifs, modName);
-	ReadString(*ifs, mapName);
+		if (offset < sizeof(header) || (offset + size) > data.size())
+			throw content_error("Savegame \"" + file + "\" is truncated");
+
+		sections[n].assign(reinterpret_cast<const char*>(&data[0]) + offset, size);
+	}
+
+	// read our own header
+	size_t pos = sizeof(header);
+	const size_t end = header.sectionOffsets[SECTION_GAME];
+
+	if (!ReadString(data, pos, end, scriptText) || !ReadString(data, pos, end, modName) || !ReadString(data, pos, end, mapName))
+		throw content_error("Savegame \"" + file + "\" is corrupt");
 
 	CGameSetup::LoadSavedScript(file, scriptText);
 }
 
+void CCregLoadSaveHandler::LoadLuaState(const std::string& file)
+{
+	const std::string tmpFileName = dataDirsAccess.LocateFile(FindSaveFile(file) + ".lua.tmp", FileQueryFlags::WRITE);
+
+	{
+		std::ofstream ofs(tmpFileName.c_str(), std::ios::out | std::ios::binary);
+		ofs.write(sections[SECTION_LUA].data(), sections[SECTION_LUA].size());
+	}
+
+	IArchive* archive = archiveLoader.OpenArchive(tmpFileName, "sdz");
+
+	if (archive != NULL && archive->IsOpen()) {
+		eventHandler.Load(archive);
+	} else {
+		LOG_L(L_ERROR, "Unable to load Lua state from savegame \"%s\"", file.c_str());
+	}
+
+	delete archive;
+	FileSystem::Remove(tmpFileName);
+}
+
 /// this should be called on frame 0 when the game has started
 void CCregLoadSaveHandler::LoadGame()
 {
@@ -185,25 +381,37 @@ void CCregLoadSaveHandler::LoadGame()
 	creg::Class* gsccls = NULL;
 
 	// load creg state
-	creg::CInputStreamSerializer inputStream;
-	inputStream.LoadPackage(ifs, pGSC, gsccls);
-	assert(pGSC && gsccls == CGameStateCollector::StaticClass());
+	{
+		std::istringstream game(sections[SECTION_GAME], std::ios::in | std::ios::binary);
+		creg::CInputStreamSerializer inputStream;
+		inputStream.LoadPackage(&game, pGSC, gsccls);
+		assert(pGSC && gsccls == CGameStateCollector::StaticClass());
+	}
 
 	CGameStateCollector* gsc = static_cast<CGameStateCollector*>(pGSC);
 	delete gsc; // the only job of gsc is to collect gamestate data
 	gsc = NULL;
 
 	// load ai state
-	eoh->Load(ifs);
+	if (!sections[SECTION_AI].empty()) {
+		std::istringstream ais(sections[SECTION_AI], std::ios::in | std::ios::binary);
+		eoh->Load(&ais);
+	}
 	//for (int a=0; a < teamHandler->ActiveTeams(); a++) { // For old savegames
 	//	if (teamHandler->Team(a)->isDead && eoh->IsSkirmishAI(a)) {
 	//		eoh->DestroySkirmishAI(skirmishAIId(a), 2 /* = team died */);
 	//	}
 	//}
 
+	// load lua state
+	if (!sections[SECTION_LUA].empty()) {
+		LoadLuaState(saveFileName);
+	}
+
 	// cleanup
-	delete ifs;
-	ifs = NULL;
+	for (int n = 0; n < NUM_SECTIONS; n++) {
+		std::string().swap(sections[n]);
+	}
 
 	gs->paused = false;
 	if (gameServer) {
@@ -4,11 +4,30 @@
 #define CREG_LOAD_SAVE_HANDLER_H
 
 #include <string>
-#include <fstream>
 #include "LoadSaveHandler.h"
 
+/**
+ * Savegames are blocked gzip files (see GZBlockWriter.h), uncompressed:
+ *   SaveFileHeader
+ *   setup script, mod name, map name (zero-terminated)
+ *   game section: creg package of the whole sim state
+ *   AI section: skirmish AI data
+ *   Lua section: a zip with what the Lua handles wrote in their Save call-ins
+ * Every section is self-contained, empty sections are skipped on load.
+ *
+ * Saving only serializes into memory on the calling thread, compressing
+ * and writing the file happens in the background.
+ */
 class CCregLoadSaveHandler : public ILoadSaveHandler
 {
+public:
+	enum {
+		SECTION_GAME,
+		SECTION_AI,
+		SECTION_LUA,
+		NUM_SECTIONS
+	};
+
 public:
 	CCregLoadSaveHandler();
 	~CCregLoadSaveHandler();
@@ -17,8 +36,15 @@ public:
 	void LoadGameStartInfo(const std::string& file);
 	void LoadGame();
 
+	/// Block until the last savegame is completely written
+	static void WaitForPendingSave();
+
+protected:
+	void LoadLuaState(const std::string& file);
+
 protected:
-	std::ifstream* ifs;
+	std::string saveFileName;
+	std::string sections[NUM_SECTIONS];
 };
 
 #endif // CREG_LOAD_SAVE_HANDLER_H
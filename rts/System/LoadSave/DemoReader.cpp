@@ -21,6 +21,7 @@ CONFIG(bool, DisableDemoVersionCheck).defaultValue(false).description("Allow to
 
 CDemoReader::CDemoReader(const std::string& filename, float curTime)
 	: playbackDemo(NULL)
+	, numFrames(-1)
 {
 	playbackDemo = new CGZFileHandler(filename, SPRING_VFS_PWD_ALL);
 
@@ -78,6 +79,8 @@ CDemoReader::CDemoReader(const std::string& filename, float curTime)
 		bytesRemaining = playbackDemoSize - curPos;
 	}
 	playbackDemo->Seek(curPos);
+
+	LoadFrameIndex();
 }
 
 
@@ -135,6 +138,46 @@ bool CDemoReader::ReachedEnd()
 }
 
 
+void CDemoReader::LoadFrameIndex()
+{
+	// the index is written after the stats, so it is missing whenever they are
+	if (fileHeader.demoStreamSize == 0)
+		return;
+
+	const int trailerPos = playbackDemoSize - sizeof(DemoFrameIndexTrailer);
+	const int statsEndPos = fileHeader.headerSize + fileHeader.scriptSize + fileHeader.demoStreamSize +
+		fileHeader.winningAllyTeamsSize + fileHeader.playerStatSize + fileHeader.teamStatSize;
+
+	if (trailerPos < statsEndPos)
+		return;
+
+	const int curPos = playbackDemo->GetPos();
+
+	DemoFrameIndexTrailer trailer;
+	playbackDemo->Seek(trailerPos);
+	playbackDemo->Read((char*) &trailer, sizeof(trailer));
+	trailer.swab();
+
+	const int indexPos = trailerPos - trailer.numEntries * sizeof(DemoFrameIndexEntry);
+
+	if (memcmp(trailer.magic, DEMOFILE_INDEX_MAGIC, sizeof(trailer.magic)) == 0 && trailer.numEntries >= 0 && indexPos >= statsEndPos) {
+		frameIndex.resize(trailer.numEntries);
+		numFrames = trailer.numFrames;
+
+		if (!frameIndex.empty()) {
+			playbackDemo->Seek(indexPos);
+			playbackDemo->Read((char*) &frameIndex[0], frameIndex.size() * sizeof(DemoFrameIndexEntry));
+		}
+
+		for (DemoFrameIndexEntry& entry: frameIndex) {
+			entry.swab();
+		}
+	}
+
+	playbackDemo->Seek(curPos);
+}
+
+
 void CDemoReader::LoadStats()
 {
 	// Stats are not available if Spring crashed while writing the demo.
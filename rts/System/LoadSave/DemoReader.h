@@ -55,6 +55,14 @@ public:
 	/// Not needed for normal demo watching
 	void LoadStats();
 
+	/// Frame index of the demo stream, empty if the demo has none (e.g. Spring crashed while recording)
+	const std::vector<DemoFrameIndexEntry>& GetFrameIndex() const { return frameIndex; }
+	/// Total number of frames in the demo, -1 if unknown
+	int GetNumFrames() const { return numFrames; }
+
+private:
+	void LoadFrameIndex();
+
 private:
 	CFileHandler* playbackDemo;
 
@@ -70,6 +78,9 @@ private:
 	std::vector<PlayerStatistics> playerStats; // one stat per player
 	std::vector< std::vector<TeamStatistics> > teamStats; // many stats per team
 	std::vector<unsigned char> winningAllyTeams;
+
+	std::vector<DemoFrameIndexEntry> frameIndex;
+	int numFrames;
 };
 
 #endif
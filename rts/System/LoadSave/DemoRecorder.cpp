@@ -5,7 +5,10 @@
 #include "System/FileSystem/FileSystem.h"
 #include "System/FileSystem/FileQueryFlags.h"
 #include "System/FileSystem/FileHandler.h"
+#include "System/FileSystem/GZBlockWriter.h"
 #include "Game/GameVersion.h"
+#include "Net/Protocol/BaseNetProtocol.h"
+#include "Sim/Misc/GlobalConstants.h"
 #include "Sim/Misc/TeamStatistics.h"
 #include "System/Util.h"
 #include "System/TimeUtil.h"
@@ -16,14 +19,17 @@
 #include <cerrno>
 #include <cstring>
 
+// ten seconds of game time between two frame index entries
+static const int DEMO_INDEX_FRAME_INTERVAL = GAME_SPEED * 10;
+
 
 CDemoRecorder::CDemoRecorder(const std::string& mapName, const std::string& modName, bool serverDemo):
-demoStream(std::ios::binary | std::ios::out)
+numFrames(0)
 {
 	SetName(mapName, modName, serverDemo);
-	SetFileHeader();
 
-	file = gzopen(demoName.c_str(), "wb9");
+	writer.reset(new CGZBlockWriter(demoName, sizeof(DemoFileHeader)));
+	SetFileHeader();
 }
 
 CDemoRecorder::~CDemoRecorder()
@@ -32,6 +38,7 @@ CDemoRecorder::~CDemoRecorder()
 	WriteWinnerList();
 	WritePlayerStats();
 	WriteTeamStats();
+	WriteFrameIndex();
 	WriteFileHeader(true);
 	WriteDemoFile();
 }
@@ -49,20 +56,13 @@ void CDemoRecorder::SetFileHeader()
 	fileHeader.teamStatPeriod = TeamStatistics::statsPeriod;
 	fileHeader.winningAllyTeamsSize = 0;
 
-	demoStream.seekp(WriteFileHeader(false) + sizeof(DemoFileHeader));
+	WriteFileHeader(false);
 }
 
 void CDemoRecorder::WriteDemoFile()
 {
-	// using operator<<(basic_stringbuf*) requires the stream to be opened with std::ios::in
-	// stringbuf::{eback(), egptr(), gptr()} are protected so we cannot access them directly
-	// (plus data is not guaranteed to be stored contiguously) ==> the only clean OO solution
-	// that avoids str()'s copy would be to supply our own stringbuffer backend to demoStream
-	// which is slightly overdoing it
-	const std::string data = demoStream.str();
-	gzwrite(file, data.c_str(), data.size());
-	gzflush(file, Z_FINISH);
-	gzclose(file);
+	// waits for the last blocks to be compressed
+	writer->Close();
 }
 
 void CDemoRecorder::WriteSetupText(const std::string& text)
@@ -73,18 +73,31 @@ void CDemoRecorder::WriteSetupText(const std::string& text)
 	}
 
 	fileHeader.scriptSize = length;
-	demoStream.write(text.c_str(), length);
+	writer->Write(text.c_str(), length);
 }
 
 void CDemoRecorder::SaveToDemo(const unsigned char* buf, const unsigned length, const float modGameTime)
 {
 	DemoStreamChunkHeader chunkHeader;
 
+	if (length > 0 && (buf[0] == NETMSG_NEWFRAME || buf[0] == NETMSG_KEYFRAME)) {
+		// frames are numbered from 0, like the server does
+		const int frameNum = numFrames++;
+
+		if ((frameNum % DEMO_INDEX_FRAME_INTERVAL) == 0) {
+			DemoFrameIndexEntry entry;
+			entry.frameNum = frameNum;
+			entry.streamOffset = fileHeader.demoStreamSize;
+			entry.modGameTime = modGameTime;
+			frameIndex.push_back(entry);
+		}
+	}
+
 	chunkHeader.modGameTime = modGameTime;
 	chunkHeader.length = length;
 	chunkHeader.swab();
-	demoStream.write((char*) &chunkHeader, sizeof(chunkHeader));
-	demoStream.write((char*) buf, length);
+	writer->Write(&chunkHeader, sizeof(chunkHeader));
+	writer->Write(buf, length);
 	fileHeader.demoStreamSize += length + sizeof(chunkHeader);
 }
 
@@ -177,49 +190,31 @@ void CDemoRecorder::SetWinningAllyTeams(const std::vector<unsigned char>& winnin
 }
 
 /** @brief Write DemoFileHeader
-Write the DemoFileHeader at the start of the file and restores the original
-position in the file afterwards. */
-unsigned int CDemoRecorder::WriteFileHeader(bool updateStreamLength)
+Replaces the header reserved at the start of the file, the rest of the
+file is not affected. */
+void CDemoRecorder::WriteFileHeader(bool updateStreamLength)
 {
-#ifdef _MSC_VER // MSVC8 behaves strange if tell/seek is called before anything has been written
-	const bool empty = (demoStream.str() == "");
-	const unsigned int pos = empty? 0 : demoStream.tellp();
-#else
-	const unsigned int pos = demoStream.tellp();
-#endif
-
 	DemoFileHeader tmpHeader;
 	memcpy(&tmpHeader, &fileHeader, sizeof(fileHeader));
 	if (!updateStreamLength)
 		tmpHeader.demoStreamSize = 0;
 	tmpHeader.swab(); // to little endian
 
-#ifdef _MSC_VER
-	if (!empty)
-#endif
-	{
-		demoStream.seekp(0);
-	}
-
-
-	demoStream.write((char*) &tmpHeader, sizeof(tmpHeader));
-	demoStream.seekp(pos);
-
-	return pos;
+	writer->WriteHeader(&tmpHeader);
 }
 
 /** @brief Write the CPlayer::Statistics at the current position in the file. */
 void CDemoRecorder::WritePlayerStats()
 {
-	int pos = demoStream.tellp();
+	const int pos = writer->GetSize();
 
 	for (PlayerStatistics& stats: playerStats) {
 		stats.swab();
-		demoStream.write(reinterpret_cast<char*>(&stats), sizeof(PlayerStatistics));
+		writer->Write(reinterpret_cast<char*>(&stats), sizeof(PlayerStatistics));
 	}
 
 	fileHeader.numPlayers = playerStats.size();
-	fileHeader.playerStatSize = (int)demoStream.tellp() - pos;
+	fileHeader.playerStatSize = int(writer->GetSize()) - pos;
 
 	playerStats.clear();
 }
@@ -232,39 +227,59 @@ void CDemoRecorder::WriteWinnerList()
 	if (fileHeader.numTeams == 0)
 		return;
 
-	const int pos = demoStream.tellp();
+	const int pos = writer->GetSize();
 
 	// Write the array of winningAllyTeams.
 	for (std::vector<unsigned char>::const_iterator it = winningAllyTeams.begin(); it != winningAllyTeams.end(); ++it) {
-		demoStream.write((char*) &(*it), sizeof(unsigned char));
+		writer->Write((char*) &(*it), sizeof(unsigned char));
 	}
 
 	winningAllyTeams.clear();
 
-	fileHeader.winningAllyTeamsSize = int(demoStream.tellp()) - pos;
+	fileHeader.winningAllyTeamsSize = int(writer->GetSize()) - pos;
+}
+
+/** @brief Write the frame index and its trailer at the current position in the file. */
+void CDemoRecorder::WriteFrameIndex()
+{
+	for (DemoFrameIndexEntry& entry: frameIndex) {
+		entry.swab();
+		writer->Write(reinterpret_cast<char*>(&entry), sizeof(DemoFrameIndexEntry));
+	}
+
+	DemoFrameIndexTrailer trailer;
+	memset(&trailer, 0, sizeof(DemoFrameIndexTrailer));
+	strcpy(trailer.magic, DEMOFILE_INDEX_MAGIC);
+	trailer.numEntries = frameIndex.size();
+	trailer.frameInterval = DEMO_INDEX_FRAME_INTERVAL;
+	trailer.numFrames = numFrames;
+	trailer.swab();
+	writer->Write(reinterpret_cast<char*>(&trailer), sizeof(DemoFrameIndexTrailer));
+
+	frameIndex.clear();
 }
 
 /** @brief Write the TeamStatistics at the current position in the file. */
 void CDemoRecorder::WriteTeamStats()
 {
-	int pos = demoStream.tellp();
+	const int pos = writer->GetSize();
 
 	// Write array of dwords indicating number of TeamStatistics per team.
 	for (std::vector<TeamStatistics>& history: teamStats) {
 		unsigned int c = swabDWord(history.size());
-		demoStream.write((char*)&c, sizeof(unsigned int));
+		writer->Write((char*)&c, sizeof(unsigned int));
 	}
 
 	// Write big array of TeamStatistics.
 	for (std::vector<TeamStatistics>& history: teamStats) {
 		for (TeamStatistics& stats: history) {
 			stats.swab();
-			demoStream.write(reinterpret_cast<char*>(&stats), sizeof(TeamStatistics));
+			writer->Write(reinterpret_cast<char*>(&stats), sizeof(TeamStatistics));
 		}
 	}
 
 	fileHeader.numTeams = teamStats.size();
-	fileHeader.teamStatSize = (int)demoStream.tellp() - pos;
+	fileHeader.teamStatSize = int(writer->GetSize()) - pos;
 
 	teamStats.clear();
 }
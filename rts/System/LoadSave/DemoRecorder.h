@@ -3,15 +3,15 @@
 #ifndef DEMO_RECORDER
 #define DEMO_RECORDER
 
+#include <boost/scoped_ptr.hpp>
 #include <vector>
-#include <sstream>
 #include <list>
-#include <zlib.h>
 
 #include "Demo.h"
 #include "Game/Players/PlayerStatistics.h"
 #include "Sim/Misc/TeamStatistics.h"
 
+class CGZBlockWriter;
 
 /**
  * @brief Used to record demos
@@ -41,19 +41,24 @@ public:
 	void SetWinningAllyTeams(const std::vector<unsigned char>& winningAllyTeams);
 
 private:
-	unsigned int WriteFileHeader(bool updateStreamLength);
+	void WriteFileHeader(bool updateStreamLength);
 	void SetFileHeader();
 	void WritePlayerStats();
 	void WriteTeamStats();
 	void WriteWinnerList();
+	void WriteFrameIndex();
 	void WriteDemoFile();
 
 private:
-	gzFile file;
-	std::stringstream demoStream;
+	/// compresses on its own thread, SaveToDemo only copies
+	boost::scoped_ptr<CGZBlockWriter> writer;
 	std::vector<PlayerStatistics> playerStats;
 	std::vector< std::vector<TeamStatistics> > teamStats;
 	std::vector<unsigned char> winningAllyTeams;
+
+	/// one entry every DEMO_INDEX_FRAME_INTERVAL frames
+	std::vector<DemoFrameIndexEntry> frameIndex;
+	int numFrames;
 };
 
 
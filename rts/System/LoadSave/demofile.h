@@ -23,6 +23,9 @@
  */
 #define DEMOFILE_VERSION 5
 
+/** The first 16 bytes of the frame index trailer. */
+#define DEMOFILE_INDEX_MAGIC "spring demoidx1"
+
 #pragma pack(push, 1)
 
 /**
@@ -40,6 +43,7 @@
  *         CTeam::Statistics for each team.
  *       - Array of all CTeam::Statistics (total number of items is the
  *         sum of the elements in the array of dwords).
+ *   - Optional frame index, see DemoFrameIndexTrailer
  *
  * The header is designed to be extensible: it contains a version field and a
  * headerSize field to support this. The version field is a major version number
@@ -115,6 +119,50 @@ struct DemoStreamChunkHeader
 	}
 };
 
+/**
+ * @brief Spring demo frame index entry
+ *
+ * Points at the chunk holding the NETMSG_NEWFRAME or NETMSG_KEYFRAME message
+ * that starts frame frameNum. Reading the demo stream from there on yields
+ * the same messages as reading it from the beginning would.
+ */
+struct DemoFrameIndexEntry
+{
+	int frameNum;           ///< Frame started by the indexed chunk.
+	int streamOffset;       ///< Offset of the chunk header, relative to the start of the demo stream.
+	float modGameTime;      ///< Gametime of the indexed chunk.
+
+	/// Change structure from host endian to little endian or vice versa.
+	void swab() {
+		swabDWordInPlace(frameNum);
+		swabDWordInPlace(streamOffset);
+		swabFloatInPlace(modGameTime);
+	}
+};
+
+/**
+ * @brief Spring demo frame index trailer
+ *
+ * Demos written by a clean shutdown end with numEntries DemoFrameIndexEntry's
+ * followed by this trailer, so readers find the index by looking at the last
+ * sizeof(DemoFrameIndexTrailer) bytes of the file. Readers that do not know
+ * about the index never read past the team statistics and are not affected.
+ */
+struct DemoFrameIndexTrailer
+{
+	char magic[16];         ///< DEMOFILE_INDEX_MAGIC
+	int numEntries;         ///< Number of DemoFrameIndexEntry's before this trailer.
+	int frameInterval;      ///< Number of frames between two entries.
+	int numFrames;          ///< Total number of frames in the demo stream.
+
+	/// Change structure from host endian to little endian or vice versa.
+	void swab() {
+		swabDWordInPlace(numEntries);
+		swabDWordInPlace(frameInterval);
+		swabDWordInPlace(numFrames);
+	}
+};
+
 #pragma pack(pop)
 
 #endif // DEMO_FILE_H
@@ -0,0 +1,208 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "DatagramBatch.h"
+#include "System/Log/ILog.h"
+
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__linux__)
+	#define HAVE_MMSG 1
+	#include <sys/socket.h>
+	#include <errno.h>
+#else
+	#define HAVE_MMSG 0
+#endif
+
+
+namespace netcode
+{
+using namespace boost::asio;
+
+#if HAVE_MMSG
+struct DatagramBatch::SysHeaders {
+	SysHeaders(unsigned int n): msgs(n), iovs(n), addrs(n) {}
+
+	std::vector<mmsghdr> msgs;
+	std::vector<iovec> iovs;
+	std::vector<sockaddr_storage> addrs;
+};
+#else
+struct DatagramBatch::SysHeaders {
+	SysHeaders(unsigned int n) {}
+};
+#endif
+
+
+DatagramBatch::DatagramBatch(unsigned int _capacity, unsigned int _maxSize)
+	: capacity(std::max(_capacity, 1u))
+	, maxSize(_maxSize)
+	, numDatagrams(0)
+	, deferSend(false)
+	, buffers(capacity)
+	, lengths(capacity, 0)
+	, endpoints(capacity)
+{
+	sysHeaders.reset(new SysHeaders(capacity));
+}
+
+DatagramBatch::~DatagramBatch()
+{
+}
+
+bool DatagramBatch::IsNative()
+{
+	return HAVE_MMSG;
+}
+
+
+#if HAVE_MMSG
+
+unsigned int DatagramBatch::Receive(ip::udp::socket& socket, boost::system::error_code& err)
+{
+	std::vector<mmsghdr>& msgs = sysHeaders->msgs;
+	std::vector<iovec>& iovs = sysHeaders->iovs;
+	std::vector<sockaddr_storage>& addrs = sysHeaders->addrs;
+
+	for (unsigned int i = 0; i < capacity; ++i) {
+		buffers[i].resize(maxSize);
+
+		iovs[i].iov_base = &buffers[i][0];
+		iovs[i].iov_len = maxSize;
+
+		memset(&msgs[i], 0, sizeof(mmsghdr));
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_name = &addrs[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+	}
+
+	const int ret = recvmmsg(socket.native_handle(), &msgs[0], capacity, MSG_DONTWAIT, NULL);
+
+	numDatagrams = 0;
+	err.clear();
+
+	if (ret < 0) {
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			err = boost::system::error_code(errno, boost::system::system_category());
+
+		return 0;
+	}
+
+	for (int i = 0; i < ret; ++i) {
+		// a truncated datagram would fail its checksum anyway
+		lengths[i] = (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)? 0: msgs[i].msg_len;
+
+		memcpy(endpoints[i].data(), &addrs[i], msgs[i].msg_hdr.msg_namelen);
+		endpoints[i].resize(msgs[i].msg_hdr.msg_namelen);
+	}
+
+	return (numDatagrams = ret);
+}
+
+unsigned int DatagramBatch::Send(ip::udp::socket& socket, boost::system::error_code& err)
+{
+	std::vector<mmsghdr>& msgs = sysHeaders->msgs;
+	std::vector<iovec>& iovs = sysHeaders->iovs;
+
+	if (numDatagrams == 0)
+		return 0;
+
+	for (unsigned int i = 0; i < numDatagrams; ++i) {
+		iovs[i].iov_base = &buffers[i][0];
+		iovs[i].iov_len = lengths[i];
+
+		memset(&msgs[i], 0, sizeof(mmsghdr));
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_name = endpoints[i].data();
+		msgs[i].msg_hdr.msg_namelen = endpoints[i].size();
+	}
+
+	unsigned int numSent = 0;
+	unsigned int next = 0;
+	err.clear();
+
+	// sendmmsg stops at the first datagram it can not send and reports
+	// the error if that was the first one of the call; skip only that one
+	// (UDP may drop it anyway), the rest are usually for other clients
+	while (next < numDatagrams) {
+		const int ret = sendmmsg(socket.native_handle(), &msgs[next], numDatagrams - next, 0);
+
+		if (ret > 0) {
+			numSent += ret;
+			next += ret;
+			continue;
+		}
+
+		if (ret < 0 && errno == EINTR)
+			continue;
+
+		if (ret < 0) {
+			err = boost::system::error_code(errno, boost::system::system_category());
+
+			if (err.value() != boost::system::errc::resource_unavailable_try_again)
+				LOG_L(L_WARNING, "[DatagramBatch::%s] dropping datagram to %s:%u: %s", __FUNCTION__, endpoints[next].address().to_string().c_str(), endpoints[next].port(), err.message().c_str());
+		}
+
+		next += 1;
+	}
+
+	numDatagrams = 0;
+	return numSent;
+}
+
+#else
+
+unsigned int DatagramBatch::Receive(ip::udp::socket& socket, boost::system::error_code& err)
+{
+	numDatagrams = 0;
+	err.clear();
+
+	while (numDatagrams < capacity && socket.available() > 0) {
+		std::vector<boost::uint8_t>& buffer = buffers[numDatagrams];
+		buffer.resize(maxSize);
+
+		const size_t bytesReceived = socket.receive_from(boost::asio::buffer(buffer), endpoints[numDatagrams], 0, err);
+
+		if (err)
+			break;
+
+		lengths[numDatagrams++] = bytesReceived;
+	}
+
+	return numDatagrams;
+}
+
+unsigned int DatagramBatch::Send(ip::udp::socket& socket, boost::system::error_code& err)
+{
+	unsigned int numSent = 0;
+	err.clear();
+
+	for (unsigned int i = 0; i < numDatagrams; ++i) {
+		socket.send_to(boost::asio::buffer(&buffers[i][0], lengths[i]), endpoints[i], 0, err);
+
+		if (!err)
+			numSent++;
+	}
+
+	numDatagrams = 0;
+	return numSent;
+}
+
+#endif
+
+
+void DatagramBatch::Add(ip::udp::socket& socket, const std::vector<boost::uint8_t>& data, const ip::udp::endpoint& addr)
+{
+	if (numDatagrams == capacity)
+		Send(socket);
+
+	buffers[numDatagrams].assign(data.begin(), data.end());
+	lengths[numDatagrams] = data.size();
+	endpoints[numDatagrams] = addr;
+	numDatagrams++;
+}
+
+} // namespace netcode
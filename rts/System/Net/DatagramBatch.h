@@ -0,0 +1,86 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _DATAGRAM_BATCH_H
+#define _DATAGRAM_BATCH_H
+
+#include <boost/asio/ip/udp.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <vector>
+
+namespace netcode
+{
+
+/**
+ * @brief Moves several UDP datagrams per system call
+ * On Linux this uses recvmmsg(2) and sendmmsg(2), elsewhere it falls back
+ * to one asio call per datagram, so callers need no platform checks.
+ * A batch is either used for receiving or for sending, not both.
+ */
+class DatagramBatch : boost::noncopyable
+{
+public:
+	/**
+	 * @param capacity maximum number of datagrams per batch
+	 * @param maxSize maximum size of a received datagram, larger ones may be reported with length 0
+	 */
+	DatagramBatch(unsigned int capacity = 64, unsigned int maxSize = 4096);
+	~DatagramBatch();
+
+	/**
+	 * @brief Read up to Capacity() pending datagrams without blocking
+	 * Previously received datagrams are discarded.
+	 * @return the number of datagrams received, 0 if none were pending
+	 */
+	unsigned int Receive(boost::asio::ip::udp::socket& socket, boost::system::error_code& err);
+
+	/**
+	 * @brief Queue a datagram for the next Send()
+	 * Sends the queued datagrams first if the batch is full.
+	 */
+	void Add(boost::asio::ip::udp::socket& socket, const std::vector<boost::uint8_t>& data, const boost::asio::ip::udp::endpoint& addr);
+
+	/**
+	 * @brief Send all queued datagrams
+	 * @return the number of datagrams handed to the OS
+	 */
+	unsigned int Send(boost::asio::ip::udp::socket& socket, boost::system::error_code& err);
+	unsigned int Send(boost::asio::ip::udp::socket& socket) {
+		boost::system::error_code err;
+		return Send(socket, err);
+	}
+
+	/// While deferring, only the owner calls Send() (after updating all connections)
+	void SetDeferSend(bool b) { deferSend = b; }
+	bool IsDeferringSend() const { return deferSend; }
+
+	unsigned int Size() const { return numDatagrams; }
+	unsigned int Capacity() const { return capacity; }
+
+	const boost::uint8_t* GetData(unsigned int i) const { return &buffers[i][0]; }
+	unsigned int GetLength(unsigned int i) const { return lengths[i]; }
+	const boost::asio::ip::udp::endpoint& GetEndpoint(unsigned int i) const { return endpoints[i]; }
+
+	/// true if batched system calls are available on this platform
+	static bool IsNative();
+
+private:
+	/// platform message headers, kept around to avoid per-call allocations
+	struct SysHeaders;
+	boost::scoped_ptr<SysHeaders> sysHeaders;
+
+	unsigned int capacity;
+	unsigned int maxSize;
+	unsigned int numDatagrams;
+
+	bool deferSend;
+
+	std::vector< std::vector<boost::uint8_t> > buffers;
+	std::vector<unsigned int> lengths;
+	std::vector<boost::asio::ip::udp::endpoint> endpoints;
+};
+
+} // namespace netcode
+
+#endif // _DATAGRAM_BATCH_H
@@ -1,5 +1,6 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
+#include "Socket.h" // must be included before streflop
 #include <boost/format.hpp>
 
 #include "LocalConnection.h"
@@ -60,6 +61,9 @@ void CLocalConnection::SendData(boost::shared_ptr<const RawPacket> packet)
 	// when sending from A to B we must lock B's queue
 	boost::mutex::scoped_lock scoped_lock(mutexes[OtherInstance()]);
 	pqueues[OtherInstance()].push_back(packet);
+
+	// do not let the server thread sleep on a packet from the local client
+	WakeNetEventWaiter();
 }
 
 boost::shared_ptr<const RawPacket> CLocalConnection::GetData()
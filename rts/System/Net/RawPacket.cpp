@@ -11,7 +11,8 @@ namespace netcode
 {
 
 RawPacket::RawPacket(const unsigned char* const tdata, const unsigned newLength)
-	: length(newLength)
+	: data(NULL)
+	, length(newLength)
 {
 	if (length > 0) {
 		data = new unsigned char[length];
@@ -23,7 +24,8 @@ RawPacket::RawPacket(const unsigned char* const tdata, const unsigned newLength)
 }
 
 RawPacket::RawPacket(const unsigned newLength)
-	: length(newLength)
+	: data(NULL)
+	, length(newLength)
 {
 	if (length > 0) {
 		data = new unsigned char[length];
@@ -32,9 +34,7 @@ RawPacket::RawPacket(const unsigned newLength)
 
 RawPacket::~RawPacket()
 {
-	if (length > 0) {
-		delete[] data;
-	}
+	delete[] data;
 }
 
 } // namespace netcode
@@ -2,7 +2,11 @@
 
 #include "Socket.h"
 
+#include <boost/asio/deadline_timer.hpp>
 #include <boost/system/error_code.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <atomic>
 #include "lib/streflop/streflop_cond.h"
 
 #include "System/Log/ILog.h"
@@ -15,6 +19,9 @@ using namespace boost::system::errc;
 
 boost::asio::io_service netservice;
 
+static std::atomic<unsigned int> numWakeUps(0);
+static std::atomic<bool> haveWaiter(false);
+
 bool CheckErrorCode(boost::system::error_code& err)
 {
 	// connection reset can happen when host did not start up
@@ -103,5 +110,68 @@ boost::asio::ip::address GetAnyAddress(const bool IPv6)
 }
 
 
+bool WaitForNetEvents(boost::asio::ip::udp::socket* socket, spring_time maxWait)
+{
+	struct WaitState {
+		WaitState(): done(false), timedOut(false) {}
+
+		std::atomic<bool> done;
+		std::atomic<bool> timedOut;
+	};
+
+	// announce ourselves before taking the snapshot; a wake-up counted
+	// after it ends the loop below even if its handler was never posted
+	haveWaiter = true;
+
+	const unsigned int seenWakeUps = numWakeUps;
+
+	// handlers may run on any thread polling netservice, so
+	// they share ownership of this rather than using our stack
+	const boost::shared_ptr<WaitState> state = boost::make_shared<WaitState>();
+
+	boost::asio::deadline_timer timer(netservice, boost::posix_time::microseconds(std::max(maxWait.toMicroSecsi(), boost::int64_t(0))));
+	timer.async_wait([state](const boost::system::error_code& err) {
+		state->timedOut = !err;
+		state->done = true;
+	});
+
+	if (socket != NULL) {
+		socket->async_receive(boost::asio::null_buffers(), [state](const boost::system::error_code&, size_t) {
+			state->done = true;
+		});
+	}
+
+	// a previous poll() may have stopped the service when it ran out of work
+	netservice.reset();
+
+	while (!state->done && numWakeUps == seenWakeUps) {
+		if (netservice.run_one() == 0)
+			break;
+	}
+
+	haveWaiter = false;
+
+	timer.cancel();
+
+	if (socket != NULL)
+		socket->cancel();
+
+	// run the cancelled handlers now rather than during someone else's poll
+	netservice.poll();
+	return !state->timedOut;
+}
+
+void WakeNetEventWaiter()
+{
+	// always counted, a waiter about to block sees it in its loop condition
+	++numWakeUps;
+
+	// posting any handler makes a blocking run_one() return; without a
+	// waiter it would just sit in the queue until the next poll()
+	if (haveWaiter)
+		netservice.post([]() {});
+}
+
+
 } // namespace netcode
 
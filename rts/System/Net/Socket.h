@@ -8,6 +8,8 @@
 #include <boost/asio/ip/udp.hpp>
 #include <boost/asio/ip/tcp.hpp>
 
+#include "System/Misc/SpringTime.h"
+
 
 namespace netcode
 {
@@ -46,6 +48,21 @@ boost::asio::ip::udp::resolver::iterator WrapResolve(
 
 boost::asio::ip::address GetAnyAddress(const bool IPv6);
 
+
+/**
+ * Blocks the calling thread until <socket> (if non-NULL) has data to read,
+ * WakeNetEventWaiter() is called or <maxWait> has passed, whichever comes
+ * first. Only one thread (the server's) may wait at any time.
+ * @returns false if the wait timed out, true otherwise
+ */
+bool WaitForNetEvents(boost::asio::ip::udp::socket* socket, spring_time maxWait);
+
+/**
+ * Makes a pending WaitForNetEvents() call return immediately.
+ * Safe to call from any thread; used by connections that bypass sockets.
+ */
+void WakeNetEventWaiter();
+
 } // namespace netcode
 
 #endif // SOCKET_H
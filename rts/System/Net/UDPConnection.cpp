@@ -8,6 +8,7 @@
 
 
 #include "Socket.h"
+#include "DatagramBatch.h"
 #include "ProtocolDef.h"
 #include "Exception.h"
 #include "Net/Protocol/BaseNetProtocol.h"
@@ -104,7 +105,7 @@ public:
 	}
 
 	void Unpack(std::vector<boost::uint8_t>& t, unsigned unpackLength) {
-		std::copy(data + pos, data + pos + unpackLength, std::back_inserter(t));
+		t.insert(t.end(), data + pos, data + pos + unpackLength);
 		pos += unpackLength;
 	}
 
@@ -133,7 +134,7 @@ public:
 	}
 
 	void Pack(std::vector<boost::uint8_t>& _data) {
-		std::copy(_data.begin(), _data.end(), std::back_inserter(data));
+		data.insert(data.end(), _data.begin(), _data.end());
 	}
 
 private:
@@ -239,10 +240,11 @@ void Packet::Serialize(std::vector<boost::uint8_t>& data)
 
 
 
-UDPConnection::UDPConnection(boost::shared_ptr<ip::udp::socket> netSocket, const ip::udp::endpoint& myAddr)
+UDPConnection::UDPConnection(boost::shared_ptr<ip::udp::socket> netSocket, const ip::udp::endpoint& myAddr, boost::shared_ptr<DatagramBatch> batch)
 	: addr(myAddr)
 	, sharedSocket(true)
 	, mySocket(netSocket)
+	, sendBatch(batch)
 {
 	Init();
 }
@@ -257,6 +259,7 @@ UDPConnection::UDPConnection(int sourcePort, const std::string& address, const u
 	boost::shared_ptr<ip::udp::socket> tempSocket(new ip::udp::socket(
 			netcode::netservice, ip::udp::endpoint(sourceAddr, sourcePort)));
 	mySocket = tempSocket;
+	recvBatch.reset(new DatagramBatch());
 
 	Init();
 }
@@ -286,6 +289,7 @@ void UDPConnection::Init()
 
 	lastInOrder = -1;
 	waitingPackets.clear();
+	outgoingOffset = 0;
 
 	#ifdef ENABLE_DEBUG_STATS
 	sumDeltaFramePacketRecvTime = 0.0f;
@@ -437,32 +441,29 @@ void UDPConnection::Update()
 	if (!sharedSocket && !closed) {
 		// duplicated code with UDPListener
 		netservice.poll();
-		size_t bytesAvail = 0;
+		boost::system::error_code err;
+		unsigned int numReceived = 0;
 
-		while ((bytesAvail = mySocket->available()) > 0) {
-			std::vector<boost::uint8_t> buffer(bytesAvail, 0);
-			ip::udp::endpoint sender_endpoint;
-			ip::udp::socket::message_flags flags = 0;
-			boost::system::error_code err;
-
-			const size_t bytesReceived = mySocket->receive_from(boost::asio::buffer(buffer), sender_endpoint, flags, err);
-
-			if (CheckErrorCode(err))
-				break;
+		do {
+			numReceived = recvBatch->Receive(*mySocket, err);
 
-			if (bytesReceived < Packet::headerSize)
-				continue;
+			for (unsigned int i = 0; i < numReceived; ++i) {
+				if (recvBatch->GetLength(i) < Packet::headerSize)
+					continue;
 
-			Packet data(&buffer[0], bytesReceived);
+				Packet data(recvBatch->GetData(i), recvBatch->GetLength(i));
 
-			if (IsUsingAddress(sender_endpoint))
-				ProcessRawPacket(data);
+				if (IsUsingAddress(recvBatch->GetEndpoint(i)))
+					ProcessRawPacket(data);
+			}
 
 			// not likely, but make sure we do not get stuck here
 			if ((spring_gettime() - curTime) > spring_msecs(10)) {
 				break;
 			}
-		}
+		} while (numReceived == recvBatch->Capacity());
+
+		CheckErrorCode(err);
 	}
 
 	Flush(false);
@@ -545,25 +546,26 @@ void UDPConnection::ProcessRawPacket(Packet& incoming)
 			continue;
 		}
 
-		waitingPackets.insert(c->chunkNumber, new RawPacket(&c->data[0], c->data.size()));
+		// keep the chunk itself, its data was already copied out of the datagram
+		waitingPackets[c->chunkNumber] = c;
 	}
 
 	packetMap::iterator wpi;
+	std::vector<boost::uint8_t> buf;
 
 	// process all in order packets that we have waiting
 	while ((wpi = waitingPackets.find(lastInOrder + 1)) != waitingPackets.end()) {
-		std::vector<boost::uint8_t> buf;
+		buf.clear();
 
 		if (fragmentBuffer != NULL) {
-			buf.resize(fragmentBuffer->length);
 			// combine with fragment buffer (packet reassembly)
-			std::copy(fragmentBuffer->data, fragmentBuffer->data + fragmentBuffer->length, buf.begin());
+			buf.insert(buf.end(), fragmentBuffer->data, fragmentBuffer->data + fragmentBuffer->length);
 			delete fragmentBuffer;
 			fragmentBuffer = NULL;
 		}
 
 		lastInOrder++;
-		std::copy(wpi->second->data, wpi->second->data + wpi->second->length, std::back_inserter(buf));
+		buf.insert(buf.end(), wpi->second->data.begin(), wpi->second->data.end());
 		waitingPackets.erase(wpi);
 
 		for (unsigned pos = 0; pos < buf.size(); ) {
@@ -645,37 +647,51 @@ void UDPConnection::Flush(const bool forced)
 		// Manually fragment packets to respect configured UDP_MTU.
 		// This is an attempt to fix the bug where players drop out of the game if
 		// someone in the game gives a large order.
-		bool partialPacket = false;
+		// The bandwidth limit only stops sending between messages, also within
+		// packets that hold several merged ones; a started message is finished.
+		const ProtocolDef* proto = ProtocolDef::GetInstance();
+		const bool unlimited = ((globalConfig->linkOutgoingBandwidth <= 0) || forced);
+
+		bool partialMessage = false;
 		bool sendMore = true;
 
+		// end of the message at outgoingOffset in the front packet
+		unsigned messageEnd = 0;
+
 		do {
 			sendMore  = (outgoing.GetAverage(true) <= globalConfig->linkOutgoingBandwidth);
-			sendMore |= ((globalConfig->linkOutgoingBandwidth <= 0) || partialPacket || forced);
+			sendMore |= (unlimited || partialMessage);
 
 			if (!outgoingData.empty() && sendMore) {
-				boost::shared_ptr<const RawPacket>& packet = *(outgoingData.begin());
+				const boost::shared_ptr<const RawPacket>& packet = outgoingData.front();
 
-				if (!partialPacket && !ProtocolDef::GetInstance()->IsValidPacket(packet->data, packet->length)) {
+				if (outgoingOffset == 0 && !proto->IsValidPacket(packet->data, packet->length)) {
 					LOG_L(L_ERROR,
 						"Discarding outgoing invalid packet: ID %d, LEN %d",
 						((packet->length > 0) ? (int)packet->data[0] : -1),
 						packet->length);
 					outgoingData.pop_front();
 				} else {
-					const unsigned numBytes = std::min((unsigned)maxChunkSize - pos, packet->length);
+					if (!partialMessage) {
+						const unsigned remaining = packet->length - outgoingOffset;
+						const int msgLength = unlimited? remaining: proto->PacketLength(packet->data + outgoingOffset, remaining);
+
+						messageEnd = proto->IsValidLength(msgLength, remaining)? (outgoingOffset + msgLength): packet->length;
+					}
+
+					const unsigned numBytes = std::min((unsigned)maxChunkSize - pos, messageEnd - outgoingOffset);
 
 					assert(packet->length > 0);
-					memcpy(buffer + pos, packet->data, numBytes);
+					memcpy(buffer + pos, packet->data + outgoingOffset, numBytes);
 					pos += numBytes;
+					outgoingOffset += numBytes;
 					outgoing.DataSent(numBytes, true);
-					partialPacket = (numBytes != packet->length);
+					partialMessage = (outgoingOffset != messageEnd);
 
-					if (partialPacket) {
-						// partially transfered
-						packet.reset(new RawPacket(packet->data + numBytes, packet->length - numBytes));
-					} else {
+					if (outgoingOffset == packet->length) {
 						// full packet copied
 						outgoingData.pop_front();
+						outgoingOffset = 0;
 					}
 				}
 			}
@@ -761,7 +777,7 @@ void UDPConnection::CreateChunk(const unsigned char* data, const unsigned length
 	ChunkPtr buf(new Chunk);
 	buf->chunkNumber = packetNum;
 	buf->chunkSize = length;
-	std::copy(data, data+length, std::back_inserter(buf->data));
+	buf->data.assign(data, data + length);
 	newChunks.push_back(buf);
 	lastChunkCreatedTime = spring_gettime();
 }
@@ -947,7 +963,12 @@ void UDPConnection::SendPacket(Packet& pkt)
 	boost::system::error_code err;
 
 	EMULATE_LATENCY( !EMULATE_PACKET_LOSS( LOSS_COUNTER ) ) {
-		mySocket->send_to(buffer(data), addr, flags, err);
+		if (sendBatch && sendBatch->IsDeferringSend()) {
+			// our listener sends it together with everyone else's
+			sendBatch->Add(*mySocket, data, addr);
+		} else {
+			mySocket->send_to(buffer(data), addr, flags, err);
+		}
 	}
 
 	if (CheckErrorCode(err))
@@ -3,11 +3,12 @@
 #ifndef _UDP_CONNECTION_H
 #define _UDP_CONNECTION_H
 
-#include <boost/ptr_container/ptr_map.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/asio/ip/udp.hpp>
 #include <deque>
 #include <list>
+#include <map>
 
 #include "Connection.h"
 #include "System/Misc/SpringTime.h"
@@ -27,6 +28,8 @@ namespace netcode {
 #define PACKET_MAX_LATENCY 1250               // in [milliseconds] maximum latency
 #define ENABLE_DEBUG_STATS
 
+class DatagramBatch;
+
 class Chunk
 {
 public:
@@ -76,7 +79,8 @@ class UDPConnection : public CConnection
 {
 public:
 	UDPConnection(boost::shared_ptr<boost::asio::ip::udp::socket> netSocket,
-			const boost::asio::ip::udp::endpoint& myAddr);
+			const boost::asio::ip::udp::endpoint& myAddr,
+			boost::shared_ptr<DatagramBatch> sendBatch = boost::shared_ptr<DatagramBatch>());
 	UDPConnection(int sourceport, const std::string& address,
 			const unsigned port);
 	UDPConnection(CConnection& conn);
@@ -155,7 +159,7 @@ private:
 	spring_time lastFramePacketRecvTime;
 	#endif
 
-	typedef boost::ptr_map<int,RawPacket> packetMap;
+	typedef std::map<int, ChunkPtr> packetMap;
 	typedef std::list< boost::shared_ptr<const RawPacket> > packetList;
 	/// address of the other end
 	boost::asio::ip::udp::endpoint addr;
@@ -174,6 +178,9 @@ private:
 
 	/// outgoing stuff (pure data without header) waiting to be sent
 	packetList outgoingData;
+	/// bytes of outgoingData.front() already put into chunks; a packet
+	/// holding several merged messages may take more than one Flush
+	unsigned outgoingOffset;
 	/// packets we have received but not yet read
 	packetMap waitingPackets;
 
@@ -202,6 +209,11 @@ private:
 	/// Our socket
 	boost::shared_ptr<boost::asio::ip::udp::socket> mySocket;
 
+	/// shared with the UDPListener that owns mySocket, if any
+	boost::shared_ptr<DatagramBatch> sendBatch;
+	/// only used when mySocket is not shared
+	boost::scoped_ptr<DatagramBatch> recvBatch;
+
 	RawPacket* fragmentBuffer;
 
 	// Traffic statistics and stuff
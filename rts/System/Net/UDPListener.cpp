@@ -14,6 +14,7 @@
 #include <queue>
 
 
+#include "DatagramBatch.h"
 #include "ProtocolDef.h"
 #include "UDPConnection.h"
 #include "Socket.h"
@@ -28,6 +29,8 @@ using namespace boost::asio;
 
 UDPListener::UDPListener(int port, const std::string& ip)
 	: acceptNewConnections(false)
+	, recvBatch(new DatagramBatch())
+	, sendBatch(new DatagramBatch())
 {
 	SocketPtr socket;
 
@@ -48,6 +51,12 @@ UDPListener::UDPListener(int port, const std::string& ip)
 	}
 }
 
+UDPListener::~UDPListener()
+{
+	// connections may outlive us, make them send on their own again
+	sendBatch->SetDeferSend(false);
+}
+
 std::string UDPListener::TryBindSocket(int port, SocketPtr* socket, const std::string& ip) {
 
 	std::string errorMsg = "";
@@ -109,56 +118,22 @@ std::string UDPListener::TryBindSocket(int port, SocketPtr* socket, const std::s
 void UDPListener::Update() {
 	netservice.poll();
 
-	size_t bytes_avail = 0;
-
-	while ((bytes_avail = mySocket->available()) > 0) {
-		std::vector<boost::uint8_t> buffer(bytes_avail);
-		ip::udp::endpoint sender_endpoint;
-		boost::asio::ip::udp::socket::message_flags flags = 0;
-		boost::system::error_code err;
-		size_t bytesReceived = mySocket->receive_from(boost::asio::buffer(buffer), sender_endpoint, flags, err);
+	boost::system::error_code err;
+	unsigned int numReceived = 0;
 
-		ConnMap::iterator ci = conn.find(sender_endpoint);
-		bool knownConnection = (ci != conn.end());
+	// a full batch means more datagrams may be pending
+	do {
+		numReceived = recvBatch->Receive(*mySocket, err);
 
-		if (knownConnection && ci->second.expired())
-			continue;
-
-		if (CheckErrorCode(err))
-			break;
-
-		if (bytesReceived < Packet::headerSize)
-			continue;
+		for (unsigned int i = 0; i < numReceived; ++i) {
+			ProcessDatagram(recvBatch->GetData(i), recvBatch->GetLength(i), recvBatch->GetEndpoint(i));
+		}
+	} while (numReceived == recvBatch->Capacity());
 
-		Packet data(&buffer[0], bytesReceived);
+	CheckErrorCode(err);
 
-		if (knownConnection) {
-			ci->second.lock()->ProcessRawPacket(data);
-		}
-		else { // still have the packet (means no connection with the sender's address found)
-			if (acceptNewConnections && data.lastContinuous == -1 && data.nakType == 0)	{
-				if (!data.chunks.empty() && (*data.chunks.begin())->chunkNumber == 0) {
-					// new client wants to connect
-					boost::shared_ptr<UDPConnection> incoming(new UDPConnection(mySocket, sender_endpoint));
-					waiting.push(incoming);
-					conn[sender_endpoint] = incoming;
-					incoming->ProcessRawPacket(data);
-				}
-			}
-			else {
-				LOG_L(L_WARNING, "Dropping packet from unknown IP: [%s]:%i",
-						sender_endpoint.address().to_string().c_str(),
-						sender_endpoint.port());
-			#ifdef DEBUG
-				std::string conns;
-				for (ConnMap::iterator it = conn.begin(); it != conn.end(); ++it) {
-					conns += str(boost::format(" [%s]:%i;") %it->first.address().to_string().c_str() %it->first.port());
-				}
-				LOG_L(L_DEBUG, "Open connections: %s", conns.c_str());
-			#endif
-			}
-		}
-	}
+	// connections queue their datagrams, we send them all at once
+	sendBatch->SetDeferSend(true);
 
 	for (ConnMap::iterator i = conn.begin(); i != conn.end(); ) {
 		if (i->second.expired()) {
@@ -169,11 +144,62 @@ void UDPListener::Update() {
 		i->second.lock()->Update();
 		++i;
 	}
+
+	sendBatch->SetDeferSend(false);
+	sendBatch->Send(*mySocket, err);
+
+	CheckErrorCode(err);
+}
+
+void UDPListener::ProcessDatagram(const boost::uint8_t* buffer, size_t bytesReceived, const ip::udp::endpoint& sender_endpoint)
+{
+	ConnMap::iterator ci = conn.find(sender_endpoint);
+	bool knownConnection = (ci != conn.end());
+
+	if (knownConnection && ci->second.expired())
+		return;
+
+	if (bytesReceived < Packet::headerSize)
+		return;
+
+	Packet data(buffer, bytesReceived);
+
+	if (knownConnection) {
+		ci->second.lock()->ProcessRawPacket(data);
+	}
+	else { // still have the packet (means no connection with the sender's address found)
+		if (acceptNewConnections && data.lastContinuous == -1 && data.nakType == 0)	{
+			if (!data.chunks.empty() && (*data.chunks.begin())->chunkNumber == 0) {
+				// new client wants to connect
+				boost::shared_ptr<UDPConnection> incoming(new UDPConnection(mySocket, sender_endpoint, sendBatch));
+				waiting.push(incoming);
+				conn[sender_endpoint] = incoming;
+				incoming->ProcessRawPacket(data);
+			}
+		}
+		else {
+			LOG_L(L_WARNING, "Dropping packet from unknown IP: [%s]:%i",
+					sender_endpoint.address().to_string().c_str(),
+					sender_endpoint.port());
+		#ifdef DEBUG
+			std::string conns;
+			for (ConnMap::iterator it = conn.begin(); it != conn.end(); ++it) {
+				conns += str(boost::format(" [%s]:%i;") %it->first.address().to_string().c_str() %it->first.port());
+			}
+			LOG_L(L_DEBUG, "Open connections: %s", conns.c_str());
+		#endif
+		}
+	}
+}
+
+bool UDPListener::WaitForData(spring_time maxWait)
+{
+	return WaitForNetEvents(mySocket.get(), maxWait);
 }
 
 boost::shared_ptr<UDPConnection> UDPListener::SpawnConnection(const std::string& ip, const unsigned port)
 {
-	boost::shared_ptr<UDPConnection> newConn(new UDPConnection(mySocket, ip::udp::endpoint(WrapIP(ip), port)));
+	boost::shared_ptr<UDPConnection> newConn(new UDPConnection(mySocket, ip::udp::endpoint(WrapIP(ip), port), sendBatch));
 	conn[newConn->GetEndpoint()] = newConn;
 	return newConn;
 }
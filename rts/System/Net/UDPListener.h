@@ -4,6 +4,7 @@
 #define _UDP_LISTENER_H
 
 #include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/weak_ptr.hpp>
 #include <boost/asio/ip/udp.hpp>
@@ -12,8 +13,11 @@
 #include <queue>
 #include <string>
 
+#include "System/Misc/SpringTime.h"
+
 namespace netcode
 {
+class DatagramBatch;
 class UDPConnection;
 typedef boost::shared_ptr<boost::asio::ip::udp::socket> SocketPtr;
 
@@ -37,7 +41,7 @@ public:
 	/**
 	 * @brief close the socket and DELETE all connections
 	 */
-	~UDPListener() {}
+	~UDPListener();
 
 	/**
 	 * Try to bind a socket to a local address and port.
@@ -59,6 +63,13 @@ public:
 	 */
 	void Update();
 
+	/**
+	 * @brief Block until there is data to Update()
+	 * Returns early on WakeNetEventWaiter(), and after at most maxWait.
+	 * @return false if the wait timed out
+	 */
+	bool WaitForData(spring_time maxWait);
+
 	/**
 	 * @brief Initiate a connection
 	 * Make a new connection to ip:port. It will be pushed back in conn.
@@ -81,6 +92,9 @@ public:
 	void UpdateConnections(); // Updates connections when the endpoint has been reconnected
 
 private:
+	/// hand a received datagram to its connection, or open a new one
+	void ProcessDatagram(const boost::uint8_t* buffer, size_t length, const boost::asio::ip::udp::endpoint& sender);
+
 	/**
 	 * @brief Do we accept packets from unknown sources?
 	 * If true, we will create a new connection, if false, they get dropped.
@@ -95,6 +109,11 @@ private:
 	typedef std::map< boost::asio::ip::udp::endpoint, boost::weak_ptr<UDPConnection> > ConnMap;
 	ConnMap conn;
 
+	/// incoming datagrams, drained several at a time
+	boost::scoped_ptr<DatagramBatch> recvBatch;
+	/// outgoing datagrams of all our connections, sent after updating them
+	boost::shared_ptr<DatagramBatch> sendBatch;
+
 	std::queue< boost::shared_ptr<UDPConnection> > waiting;
 };
 
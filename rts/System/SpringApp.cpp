@@ -18,6 +18,7 @@
 #include "aGui/Gui.h"
 #include "ExternalAI/IAILibraryManager.h"
 #include "Game/Benchmark.h"
+#include "Game/ReplayAnalysis.h"
 #include "Game/ClientSetup.h"
 #include "Game/GameSetup.h"
 #include "Game/GameVersion.h"
@@ -282,6 +283,7 @@ bool SpringApp::Initialize()
 
 	// Multithreading & Affinity
 	Threading::SetThreadName("unknown"); // set default threadname
+	CTimeProfiler::SetThreadName("main");
 	Threading::InitThreadPool();
 	Threading::SetThreadScheduler();
 	battery = new CBattery();
@@ -650,6 +652,7 @@ void SpringApp::ParseCmdLine(const std::string& binaryName)
 	cmdline->AddSwitch('t', "textureatlas",       "Dump each finalized textureatlas in textureatlasN.tga");
 	cmdline->AddInt(   0,   "benchmark",          "Enable benchmark mode (writes a benchmark.data file). The given number specifies the timespan to test.");
 	cmdline->AddInt(   0,   "benchmarkstart",     "Benchmark start time in minutes.");
+	cmdline->AddString(0,   "replay-analysis",    "Run the given demo (or start script) as fast as possible without unsynced work, then write team stats, sync checksums and SimFrame timings as JSON to the given file and quit");
 
 	cmdline->AddSwitch(0,   "list-ai-interfaces", "Dump a list of available AI Interfaces to stdout");
 	cmdline->AddSwitch(0,   "list-skirmish-ais",  "Dump a list of available Skirmish AIs to stdout");
@@ -775,6 +778,11 @@ void SpringApp::ParseCmdLine(const std::string& binaryName)
 		}
 		CBenchmark::endFrame = CBenchmark::startFrame + cmdline->GetInt("benchmark") * 60 * GAME_SPEED;
 	}
+
+	if (cmdline->IsSet("replay-analysis")) {
+		CReplayAnalysis::enabled = true;
+		CReplayAnalysis::outputFile = cmdline->GetString("replay-analysis");
+	}
 }
 
 
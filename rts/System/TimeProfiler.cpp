@@ -2,10 +2,12 @@
 
 #include "System/TimeProfiler.h"
 
+#include <cstdio>
 #include <cstring>
 #include <boost/unordered_map.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/locks.hpp>
+#include <boost/thread/tss.hpp>
 
 #include "System/Log/ILog.h"
 #include "System/UnsyncedRNG.h"
@@ -13,64 +15,156 @@
 	#include "System/ThreadPool.h"
 #endif
 
-static boost::mutex m;
-static std::map<int, std::string> hashToName;
-static std::map<int, int> refs;
+// ~100MB, a few minutes of a busy game
+static const size_t MAX_TRACE_EVENTS = 1 << 22;
 
 
+/**
+ * Times of one thread, summed up until the next CTimeProfiler::Update.
+ * Only the owning thread adds to them, the mutex is only contended
+ * while Update merges.
+ */
+struct ThreadTimers {
+	struct Sum {
+		Sum(): showGraph(false) {}
+		spring_time total;
+		spring_time maxTime;
+		bool showGraph;
+	};
 
-static unsigned hash_(const std::string& s)
+	ThreadTimers(unsigned int _lane): lane(_lane), exited(false) {}
+
+	/// guarded by mutex, indexed by TimerID
+	std::vector<Sum> sums;
+	std::vector<CTimeProfiler::TraceEvent> events;
+	boost::mutex mutex;
+
+	/// nesting depth per TimerID, only touched by the owning thread
+	std::vector<unsigned int> active;
+
+	const unsigned int lane;
+	/// set (under the registry lock) once the thread is gone
+	bool exited;
+};
+
+
+/// everything below is guarded by mutex
+struct TimerRegistry {
+	boost::mutex mutex;
+
+	std::deque<std::string> names;
+	boost::unordered_map<std::string, CTimeProfiler::TimerID> ids;
+
+	std::vector<ThreadTimers*> threads;
+	/// indexed by lane
+	std::vector<std::string> laneNames;
+	std::vector<unsigned int> freeLanes;
+};
+
+static TimerRegistry& GetRegistry()
 {
-	unsigned hash = s.size();
-	for (std::string::const_iterator it = s.begin(); it != s.end(); ++it) {
-		hash += *it;
+	static TimerRegistry registry;
+	return registry;
+}
+
+static std::string EscapeJSON(const std::string& str)
+{
+	std::string ret;
+	ret.reserve(str.size());
+
+	for (const char c: str) {
+		if (c == '"' || c == '\\')
+			ret += '\\';
+		ret += c;
 	}
-	return hash;
+
+	return ret;
 }
 
-static unsigned hash_(const char* s)
+static void SpinLock(boost::unique_lock<boost::mutex>& ulk)
 {
-	unsigned hash = 0;
-	for (size_t i = 0; ; ++i) {
-		if (s[i]) {
-			hash += s[i];
-		} else {
-			unsigned len = i;
-			hash += len;
-			break;
-		}
+	while (!ulk.try_lock()) {}
+}
+
+
+static void ReleaseThreadTimers(ThreadTimers* timers)
+{
+	TimerRegistry& reg = GetRegistry();
+	boost::lock_guard<boost::mutex> lk(reg.mutex);
+
+	// merged and deleted by the next Update
+	timers->exited = true;
+}
+
+static ThreadTimers* GetThreadTimers()
+{
+	// registry first, it has to outlive the cleanup calls
+	TimerRegistry& reg = GetRegistry();
+	static boost::thread_specific_ptr<ThreadTimers> localTimers(ReleaseThreadTimers);
+
+	ThreadTimers* timers = localTimers.get();
+
+	if (timers != nullptr)
+		return timers;
+
+	boost::lock_guard<boost::mutex> lk(reg.mutex);
+
+	unsigned int lane = reg.laneNames.size();
+
+	if (!reg.freeLanes.empty()) {
+		lane = reg.freeLanes.back();
+		reg.freeLanes.pop_back();
+	} else {
+		reg.laneNames.emplace_back();
 	}
-	return hash;
+
+	char laneName[32];
+#ifdef THREADPOOL
+	if (ThreadPool::GetThreadNum() > 0) {
+		snprintf(laneName, sizeof(laneName), "worker %d", ThreadPool::GetThreadNum());
+	} else
+#endif
+	{
+		snprintf(laneName, sizeof(laneName), "thread %u", lane);
+	}
+
+	reg.laneNames[lane] = laneName;
+
+	timers = new ThreadTimers(lane);
+	reg.threads.push_back(timers);
+	localTimers.reset(timers);
+	return timers;
+}
+
+
+
+BasicTimer::BasicTimer(unsigned int timerID)
+: id(timerID)
+, starttime(spring_gettime())
+
+{
 }
 
 
 BasicTimer::BasicTimer(const std::string& myname)
-: hash(hash_(myname))
+: id(CTimeProfiler::RegisterTimer(myname))
 , starttime(spring_gettime())
 
 {
-	nameIterator = hashToName.find(hash);
-	if (nameIterator == hashToName.end()) {
-		nameIterator = hashToName.insert(std::pair<int,std::string>(hash, myname)).first;
-	}
 }
 
 
 BasicTimer::BasicTimer(const char* myname)
-: hash(hash_(myname))
+: id(CTimeProfiler::RegisterTimer(myname))
 , starttime(spring_gettime())
 
 {
-	nameIterator = hashToName.find(hash);
-	if (nameIterator == hashToName.end()) {
-		nameIterator = hashToName.insert(std::pair<int,std::string>(hash, myname)).first;
-	}
 }
 
 
 const std::string& BasicTimer::GetName() const
 {
-	return nameIterator->second;
+	return CTimeProfiler::GetTimerName(id);
 }
 
 
@@ -80,16 +174,21 @@ spring_time BasicTimer::GetDuration() const
 }
 
 
+ScopedTimer::ScopedTimer(unsigned int timerID, bool autoShow)
+	: BasicTimer(timerID)
+	, autoShowGraph(autoShow)
+
+{
+	Enter();
+}
+
+
 ScopedTimer::ScopedTimer(const std::string& name, bool autoShow)
 	: BasicTimer(name)
 	, autoShowGraph(autoShow)
 
 {
-	it = refs.find(hash);
-	if (it == refs.end()) {
-		it = refs.insert(std::pair<int,int>(hash, 0)).first;
-	}
-	++(it->second);
+	Enter();
 }
 
 
@@ -98,19 +197,27 @@ ScopedTimer::ScopedTimer(const char* name, bool autoShow)
 	, autoShowGraph(autoShow)
 
 {
-	it = refs.find(hash);
-	if (it == refs.end()) {
-		it = refs.insert(std::pair<int,int>(hash, 0)).first;
-	}
-	++(it->second);
+	Enter();
+}
+
+
+void ScopedTimer::Enter()
+{
+	ThreadTimers* timers = GetThreadTimers();
+
+	if (id >= timers->active.size())
+		timers->active.resize(id + 1, 0);
+
+	timers->active[id] += 1;
 }
 
 
 ScopedTimer::~ScopedTimer()
 {
-	int& ref = it->second;
-	if (--ref == 0)
-		profiler.AddTime(GetName(), GetDuration(), autoShowGraph);
+	ThreadTimers* timers = GetThreadTimers();
+
+	if ((timers->active[id] -= 1) == 0)
+		profiler.AddTime(id, starttime, spring_gettime(), autoShowGraph);
 }
 
 ScopedOnceTimer::~ScopedOnceTimer()
@@ -120,6 +227,13 @@ ScopedOnceTimer::~ScopedOnceTimer()
 
 
 
+ScopedMtTimer::ScopedMtTimer(unsigned int timerID, bool autoShow)
+	: BasicTimer(timerID)
+	, autoShowGraph(autoShow)
+{
+}
+
+
 ScopedMtTimer::ScopedMtTimer(const std::string& name, bool autoShow)
 	: BasicTimer(name)
 	, autoShowGraph(autoShow)
@@ -136,10 +250,12 @@ ScopedMtTimer::ScopedMtTimer(const char* name, bool autoShow)
 
 ScopedMtTimer::~ScopedMtTimer()
 {
-	profiler.AddTime(GetName(), GetDuration(), autoShowGraph);
+	const spring_time endtime = spring_gettime();
+
+	profiler.AddTime(id, starttime, endtime, autoShowGraph);
 #ifdef THREADPOOL
 	auto& list = profiler.profileCore[ThreadPool::GetThreadNum()];
-	list.emplace_back(starttime, spring_gettime());
+	list.emplace_back(starttime, endtime);
 #endif
 }
 
@@ -151,7 +267,8 @@ ScopedMtTimer::~ScopedMtTimer()
 
 CTimeProfiler::CTimeProfiler():
 	lastBigUpdate(spring_gettime()),
-	currentPosition(0)
+	currentPosition(0),
+	tracing(false)
 {
 #ifdef THREADPOOL
 	profileCore.resize(ThreadPool::GetMaxThreads());
@@ -160,8 +277,8 @@ CTimeProfiler::CTimeProfiler():
 
 CTimeProfiler::~CTimeProfiler()
 {
-	boost::unique_lock<boost::mutex> ulk(m, boost::defer_lock);
-	while (!ulk.try_lock()) {}
+	boost::unique_lock<boost::mutex> ulk(GetRegistry().mutex, boost::defer_lock);
+	SpinLock(ulk);
 }
 
 CTimeProfiler& CTimeProfiler::GetInstance()
@@ -170,11 +287,124 @@ CTimeProfiler& CTimeProfiler::GetInstance()
 	return tp;
 }
 
+
+CTimeProfiler::TimerID CTimeProfiler::RegisterTimer(const std::string& name)
+{
+	TimerRegistry& reg = GetRegistry();
+	boost::lock_guard<boost::mutex> lk(reg.mutex);
+
+	const auto it = reg.ids.find(name);
+
+	if (it != reg.ids.end())
+		return it->second;
+
+	const TimerID id = reg.names.size();
+
+	reg.names.push_back(name);
+	reg.ids[name] = id;
+	return id;
+}
+
+const std::string& CTimeProfiler::GetTimerName(TimerID id)
+{
+	TimerRegistry& reg = GetRegistry();
+	boost::lock_guard<boost::mutex> lk(reg.mutex);
+
+	// deque, references stay valid while names are added
+	return reg.names[id];
+}
+
+void CTimeProfiler::SetThreadName(const std::string& name)
+{
+	const ThreadTimers* timers = GetThreadTimers();
+
+	TimerRegistry& reg = GetRegistry();
+	boost::lock_guard<boost::mutex> lk(reg.mutex);
+
+	reg.laneNames[timers->lane] = name;
+}
+
+
+CTimeProfiler::TimeRecord& CTimeProfiler::GetRecord(TimerID id)
+{
+	// registry lock is held by the caller
+	if (id >= records.size())
+		records.resize(id + 1, nullptr);
+
+	if (records[id] != nullptr)
+		return *records[id];
+
+	TimeRecord& p = profile[GetRegistry().names[id]];
+	static UnsyncedRNG rand;
+	rand.Seed(spring_tomsecs(spring_gettime()));
+	p.color.x = rand.RandFloat();
+	p.color.y = rand.RandFloat();
+	p.color.z = rand.RandFloat();
+
+	records[id] = &p;
+	return p;
+}
+
+void CTimeProfiler::MergeThreadTimes()
+{
+	// registry lock is held by the caller
+	TimerRegistry& reg = GetRegistry();
+
+	for (auto it = reg.threads.begin(); it != reg.threads.end(); ) {
+		ThreadTimers* timers = *it;
+
+		{
+			boost::lock_guard<boost::mutex> lk(timers->mutex);
+
+			for (TimerID id = 0; id < timers->sums.size(); id++) {
+				ThreadTimers::Sum& sum = timers->sums[id];
+
+				if (sum.total.toNanoSecsi() == 0 && !sum.showGraph)
+					continue;
+
+				TimeRecord& p = GetRecord(id);
+				p.total   += sum.total;
+				p.current += sum.total;
+				p.frames[currentPosition] += sum.total;
+				p.showGraph |= sum.showGraph;
+
+				if (p.maxLag < sum.maxTime.toMilliSecsf()) {
+					p.maxLag     = sum.maxTime.toMilliSecsf();
+					p.newLagPeak = true;
+				}
+
+				sum = ThreadTimers::Sum();
+			}
+
+			if (!timers->events.empty()) {
+				traceEvents.insert(traceEvents.end(), timers->events.begin(), timers->events.end());
+				timers->events.clear();
+			}
+		}
+
+		if (timers->exited) {
+			reg.freeLanes.push_back(timers->lane);
+			delete timers;
+			it = reg.threads.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	if (tracing && traceEvents.size() >= MAX_TRACE_EVENTS) {
+		LOG_L(L_WARNING, "[%s] trace buffer full, recording stopped", __FUNCTION__);
+		tracing = false;
+	}
+}
+
+
 void CTimeProfiler::Update()
 {
-	//FIXME non-locking threadsafe
-	boost::unique_lock<boost::mutex> ulk(m, boost::defer_lock);
-	while (!ulk.try_lock()) {}
+	boost::unique_lock<boost::mutex> ulk(GetRegistry().mutex, boost::defer_lock);
+	SpinLock(ulk);
+
+	// times since the last update belong to the current position
+	MergeThreadTimes();
 
 	++currentPosition;
 	currentPosition &= TimeRecord::frames_size-1;
@@ -210,46 +440,113 @@ void CTimeProfiler::Update()
 
 float CTimeProfiler::GetPercent(const char* name)
 {
-	boost::unique_lock<boost::mutex> ulk(m, boost::defer_lock);
-	while (!ulk.try_lock()) {}
+	boost::unique_lock<boost::mutex> ulk(GetRegistry().mutex, boost::defer_lock);
+	SpinLock(ulk);
 
 	return profile[name].percent;
 }
 
+void CTimeProfiler::AddTime(TimerID id, const spring_time startTime, const spring_time endTime, const bool showGraph)
+{
+	ThreadTimers* timers = GetThreadTimers();
+	const spring_time time = endTime - startTime;
+
+	boost::lock_guard<boost::mutex> lk(timers->mutex);
+
+	if (id >= timers->sums.size())
+		timers->sums.resize(id + 1);
+
+	ThreadTimers::Sum& sum = timers->sums[id];
+	sum.total += time;
+	sum.showGraph |= showGraph;
+
+	if (sum.maxTime < time)
+		sum.maxTime = time;
+
+	if (IsTracing())
+		timers->events.push_back({id, timers->lane, startTime, endTime});
+}
+
 void CTimeProfiler::AddTime(const std::string& name, const spring_time time, const bool showGraph)
 {
-	auto pi = profile.find(name);
-	if (pi != profile.end()) {
-		// profile already exists
-		//FIXME use atomic ints
-		auto& p = pi->second;
-		p.total   += time;
-		p.current += time;
-		p.frames[currentPosition] += time;
-		if (p.maxLag < time.toMilliSecsf()) {
-			p.maxLag     = time.toMilliSecsf();
-			p.newLagPeak = true;
-		}
-	} else {
-		boost::unique_lock<boost::mutex> ulk(m, boost::defer_lock);
-		while (!ulk.try_lock()) {}
-
-		// create a new profile
-		auto& p = profile[name];
-		p.total   = time;
-		p.current = time;
-		p.maxLag  = time.toMilliSecsf();
-		p.percent = 0;
-		memset(p.frames, 0, TimeRecord::frames_size * sizeof(unsigned));
-		static UnsyncedRNG rand;
-		rand.Seed(spring_tomsecs(spring_gettime()));
-		p.color.x = rand.RandFloat();
-		p.color.y = rand.RandFloat();
-		p.color.z = rand.RandFloat();
-		p.showGraph = showGraph;
+	const spring_time endTime = spring_gettime();
+	AddTime(RegisterTimer(name), endTime - time, endTime, showGraph);
+}
+
+
+void CTimeProfiler::StartTrace()
+{
+	boost::unique_lock<boost::mutex> ulk(GetRegistry().mutex, boost::defer_lock);
+	SpinLock(ulk);
+
+	// drop whatever an earlier trace left in the thread buffers
+	tracing = false;
+	MergeThreadTimes();
+
+	traceEvents.clear();
+	traceStartTime = spring_gettime();
+	tracing = true;
+}
+
+int CTimeProfiler::StopTrace(const std::string& fileName)
+{
+	std::vector<TraceEvent> events;
+	std::vector<std::string> laneNames;
+	std::deque<std::string> names;
+
+	{
+		boost::unique_lock<boost::mutex> ulk(GetRegistry().mutex, boost::defer_lock);
+		SpinLock(ulk);
+
+		tracing = false;
+		MergeThreadTimes();
+
+		events.swap(traceEvents);
+		laneNames = GetRegistry().laneNames;
+		names = GetRegistry().names;
+	}
+
+	FILE* file = fopen(fileName.c_str(), "w");
+
+	if (file == NULL)
+		return -1;
+
+	// Chrome trace-event format, times in microseconds
+	fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+
+	for (size_t n = 0; n < laneNames.size(); n++) {
+		fprintf(file, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %u, \"args\": {\"name\": \"%s\"}},\n", unsigned(n), EscapeJSON(laneNames[n]).c_str());
+	}
+
+	// escaped once per timer, not once per event
+	for (std::string& name: names) {
+		name = EscapeJSON(name);
 	}
+
+	int numWritten = 0;
+
+	for (const TraceEvent& e: events) {
+		// skip scopes that started before the trace did
+		if (e.start < traceStartTime)
+			continue;
+
+		numWritten += 1;
+
+		fprintf(file, "{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 0, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f},\n",
+			names[e.id].c_str(), e.lane,
+			(e.start - traceStartTime).toNanoSecsi() * 0.001,
+			(e.end - e.start).toNanoSecsi() * 0.001);
+	}
+
+	// no trailing comma allowed
+	fprintf(file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, \"args\": {\"name\": \"spring\"}}\n");
+	fprintf(file, "]}\n");
+	fclose(file);
+
+	return numWritten;
 }
 
+
 void CTimeProfiler::PrintProfilingInfo() const
 {
 	LOG("%35s|%18s|%s", "Part", "Total Time", "Time of the last 0.5s");
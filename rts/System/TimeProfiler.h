@@ -7,6 +7,7 @@
 #include "System/float3.h"
 
 #include <boost/noncopyable.hpp>
+#include <atomic>
 #include <cstring>
 #include <string>
 #include <map>
@@ -15,13 +16,21 @@
 
 // disable this if you want minimal profiling
 // (sim time is still measured because of game slowdown)
-#define SCOPED_TIMER(name) ScopedTimer myScopedTimerFromMakro(name);
-#define SCOPED_MT_TIMER(name) ScopedMtTimer myScopedTimerFromMakro(name);
+//
+// the timer name is looked up once per call-site, so the
+// macros only take names that never change (eg. literals)
+#define SCOPED_TIMER(name) \
+	static const CTimeProfiler::TimerID myTimerIDFromMakro = CTimeProfiler::RegisterTimer(name); \
+	ScopedTimer myScopedTimerFromMakro(myTimerIDFromMakro);
+#define SCOPED_MT_TIMER(name) \
+	static const CTimeProfiler::TimerID myTimerIDFromMakro = CTimeProfiler::RegisterTimer(name); \
+	ScopedMtTimer myScopedTimerFromMakro(myTimerIDFromMakro);
 
 
 class BasicTimer : public boost::noncopyable
 {
 public:
+	BasicTimer(unsigned int timerID);
 	BasicTimer(const std::string& myname);
 	BasicTimer(const char* myname);
 
@@ -29,9 +38,8 @@ public:
 	spring_time GetDuration() const;
 
 protected:
-	const unsigned hash;
+	const unsigned int id;
 	const spring_time starttime;
-	std::map<int, std::string>::iterator nameIterator;
 };
 
 
@@ -40,30 +48,34 @@ protected:
  *
  * Construct an instance of this class where you want to begin time measuring,
  * and destruct it at the end (or let it be autodestructed).
+ * Recursive timers with the same name only count the outermost scope.
  */
 class ScopedTimer : public BasicTimer
 {
 public:
+	ScopedTimer(unsigned int timerID, bool autoShow = false);
 	ScopedTimer(const std::string& name, bool autoShow = false);
 	ScopedTimer(const char* name, bool autoShow = false);
 	~ScopedTimer();
 
+private:
+	void Enter();
+
 private:
 	const bool autoShowGraph;
-	std::map<int, int>::iterator it;
 };
 
 
 class ScopedMtTimer : public BasicTimer
 {
 public:
+	ScopedMtTimer(unsigned int timerID, bool autoShow = false);
 	ScopedMtTimer(const std::string& name, bool autoShow = false);
 	ScopedMtTimer(const char* name, bool autoShow = false);
 	~ScopedMtTimer();
 
 private:
 	const bool autoShowGraph;
-	std::map<int, int>::iterator it;
 };
 
 
@@ -81,21 +93,45 @@ public:
 
 
 
+/**
+ * Timers are identified by small integers, names are registered once.
+ * Every thread sums its timings into its own buffer, Update() merges
+ * them into the records shown by the profile drawer. While a trace is
+ * recorded every timed scope is also kept as an event (per thread) and
+ * written in the Chrome trace-event format by StopTrace, which can be
+ * opened in chrome://tracing or ui.perfetto.dev.
+ */
 class CTimeProfiler
 {
 public:
+	typedef unsigned int TimerID;
+
 	CTimeProfiler();
 	~CTimeProfiler();
 
 	static CTimeProfiler& GetInstance();
 
+	/// thread-safe, same name gives the same id
+	static TimerID RegisterTimer(const std::string& name);
+	static TimerID RegisterTimer(const char* name) { return (RegisterTimer(std::string(name))); }
+	static const std::string& GetTimerName(TimerID id);
+
+	/// label of the calling thread's lane in traces
+	static void SetThreadName(const std::string& name);
+
 	float GetPercent(const char *name);
 	void Update();
 
 	void PrintProfilingInfo() const;
 
+	void AddTime(TimerID id, const spring_time startTime, const spring_time endTime, const bool showGraph = false);
 	void AddTime(const std::string& name, const spring_time time, const bool showGraph = false);
 
+	void StartTrace();
+	/// returns the number of events written, -1 if the file could not be opened
+	int StopTrace(const std::string& fileName);
+	bool IsTracing() const { return tracing.load(std::memory_order_relaxed); }
+
 public:
 	struct TimeRecord {
 		TimeRecord()
@@ -124,14 +160,32 @@ public:
 		bool showGraph;
 	};
 
+	struct TraceEvent {
+		TimerID id;
+		unsigned int lane;
+		spring_time start;
+		spring_time end;
+	};
+
 	std::map<std::string,TimeRecord> profile;
 
 	std::vector<std::deque<std::pair<spring_time,spring_time>>> profileCore;
 
+private:
+	void MergeThreadTimes();
+	TimeRecord& GetRecord(TimerID id);
+
 private:
 	spring_time lastBigUpdate;
 	/// increases each update, from 0 to (frames_size-1)
 	unsigned currentPosition;
+
+	/// indexed by TimerID, NULL until the first time is added
+	std::vector<TimeRecord*> records;
+
+	std::atomic<bool> tracing;
+	spring_time traceStartTime;
+	std::vector<TraceEvent> traceEvents;
 };
 
 #define profiler (CTimeProfiler::GetInstance())
@@ -137,14 +137,32 @@ bool COutputStreamSerializer::IsWriting()
 
 COutputStreamSerializer::ObjectRef* COutputStreamSerializer::FindObjectRef(void* inst, creg::Class* objClass, bool isEmbedded)
 {
-	std::vector<ObjectRef*>* refs = &(ptrToId[inst]);
-	for (std::vector<ObjectRef*>::iterator i = refs->begin(); i != refs->end(); ++i) {
-		if ((*i)->isThisObject(inst, objClass, isEmbedded))
-			return *i;
+	const std::unordered_map<void*, ObjectRef*>::const_iterator it = ptrToId.find(inst);
+
+	if (it == ptrToId.end())
+		return NULL;
+
+	for (ObjectRef* ref = it->second; ref != NULL; ref = ref->next) {
+		if (ref->isThisObject(inst, objClass, isEmbedded))
+			return ref;
 	}
 	return NULL;
 }
 
+COutputStreamSerializer::ObjectRef* COutputStreamSerializer::AddObjectRef(void* inst, bool isEmbedded, creg::Class* objClass)
+{
+	objects.push_back(ObjectRef(inst, objects.size(), isEmbedded, objClass));
+	ObjectRef* obj = &objects.back();
+
+	// keep the order refs were added in, FindObjectRef returns the first match
+	ObjectRef** ref = &ptrToId[inst];
+	while (*ref != NULL)
+		ref = &((*ref)->next);
+	*ref = obj;
+
+	return obj;
+}
+
 void COutputStreamSerializer::SerializeObject(Class* c, void* ptr, ObjectRef* objr)
 {
 	if (c->base)
@@ -152,6 +170,7 @@ void COutputStreamSerializer::SerializeObject(Class* c, void* ptr, ObjectRef* ob
 
 	ObjectMemberGroup omg;
 	omg.membersClass = c;
+	omg.size = 0;
 
 	for (uint a = 0; a < c->members.size(); a++)
 	{
@@ -194,9 +213,7 @@ void COutputStreamSerializer::SerializeObjectInstance(void* inst, creg::Class* o
 	// register the object, and mark it as embedded if a pointer was already referencing it
 	ObjectRef* obj = FindObjectRef(inst, objClass, true);
 	if (!obj) {
-		objects.push_back(ObjectRef(inst, objects.size(), true, objClass));
-		obj = &objects.back();
-		ptrToId[inst].push_back(obj);
+		obj = AddObjectRef(inst, true, objClass);
 	} else if (obj->isEmbedded) {
 		throw "Reserialization of embedded object (" + objClass->name + ")";
 	} else {
@@ -224,9 +241,7 @@ void COutputStreamSerializer::SerializeObjectPtr(void** ptr, creg::Class* objCla
 		int id;
 		ObjectRef* obj = FindObjectRef(*ptr, objClass, false);
 		if (!obj) {
-			objects.push_back(ObjectRef(*ptr, objects.size(), false, objClass));
-			obj = &objects.back();
-			ptrToId[*ptr].push_back(obj);
+			obj = AddObjectRef(*ptr, false, objClass);
 			pendingObjects.push_back(obj);
 		}
 		id = obj->id;
@@ -284,9 +299,7 @@ void COutputStreamSerializer::SavePackage(std::ostream* s, void* rootObj, Class*
 	obj->classIndex = 0;
 
 	// Insert the first object that will provide references to everything
-	objects.push_back(ObjectRef(rootObj, objects.size(), false, rootObjClass));
-	obj = &objects.back();
-	ptrToId[rootObj].push_back(obj);
+	obj = AddObjectRef(rootObj, false, rootObjClass);
 	pendingObjects.push_back(obj);
 
 	std::map<creg::Class*, int> classSizes;
@@ -312,7 +325,7 @@ void COutputStreamSerializer::SavePackage(std::ostream* s, void* rootObj, Class*
 	std::map<creg::Class*, ClassRef> classMap;
 	std::vector<ClassRef*> classRefs;
 	std::map<int, int> classObjects;
-	for (std::list<ObjectRef>::iterator i = objects.begin(); i != objects.end(); ++i) {
+	for (std::deque<ObjectRef>::iterator i = objects.begin(); i != objects.end(); ++i) {
 		if (i->ptr == NULL) continue;
 
 		creg::Class* c = i->class_;
@@ -354,7 +367,7 @@ void COutputStreamSerializer::SavePackage(std::ostream* s, void* rootObj, Class*
 	// Write object info
 	ph.objTableOffset = (int)stream->tellp();
 	ph.numObjects = objects.size();
-	for (std::list<ObjectRef>::iterator i = objects.begin(); i != objects.end(); ++i) {
+	for (std::deque<ObjectRef>::iterator i = objects.begin(); i != objects.end(); ++i) {
 		int classRefIndex = i->classIndex;
 		char isEmbedded = i->isEmbedded ? 1 : 0;
 		WriteVarSizeUInt(stream, classRefIndex);
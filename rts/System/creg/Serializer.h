@@ -8,10 +8,10 @@
 
 #ifdef USING_CREG
 
-#include <map>
+#include <deque>
 #include <vector>
-#include <list>
 #include <istream>
+#include <unordered_map>
 
 namespace creg {
 
@@ -40,6 +40,7 @@ namespace creg {
 				classIndex=0;
 				isEmbedded=false;
 				class_=0;
+				next=0;
 			}
 			ObjectRef(void* ptr, int id, bool isEmbedded, Class* class_) {
 				this->ptr = ptr;
@@ -47,6 +48,7 @@ namespace creg {
 				classIndex=0;
 				this->isEmbedded=isEmbedded;
 				this->class_=class_;
+				next=0;
 			}
 			ObjectRef(const ObjectRef&src) :memberGroups(src.memberGroups){
 				ptr=src.ptr;
@@ -54,11 +56,14 @@ namespace creg {
 				classIndex=src.classIndex;
 				isEmbedded=src.isEmbedded;
 				class_=src.class_;
+				next=src.next;
 			}
 			void* ptr;
 			int id, classIndex;
 			bool isEmbedded;
 			Class* class_;
+			// next object at the same address (an object and its first embedded member)
+			ObjectRef* next;
 			std::vector<COutputStreamSerializer::ObjectMemberGroup> memberGroups;
 			bool isThisObject(void* objPtr, Class* objClass, bool objEmbedded) const
 			{
@@ -81,8 +86,10 @@ namespace creg {
 		struct ClassRef;
 
 		std::ostream* stream;
-		std::map<void*,std::vector<ObjectRef*> > ptrToId;
-		std::list<ObjectRef> objects;
+		// first object stored at each address, the others are chained through ObjectRef::next
+		std::unordered_map<void*, ObjectRef*> ptrToId;
+		// deque: stable addresses for ptrToId, no allocation per object
+		std::deque<ObjectRef> objects;
 		std::vector<ObjectRef*> pendingObjects; // these objects still have to be saved
 
 		// Serialize all class names
@@ -91,6 +98,7 @@ namespace creg {
 		void WriteObjectRef(void* inst, Class* cls, bool embedded);
 
 		ObjectRef* FindObjectRef(void* inst, Class* objClass, bool isEmbedded);
+		ObjectRef* AddObjectRef(void* inst, bool isEmbedded, Class* objClass);
 
 		void SerializeObject(Class* c, void* ptr, ObjectRef* objr);
 
@@ -0,0 +1,252 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/float3SoA.h"
+#include "System/Matrix44f.h"
+
+#include <cstring>
+
+// NOTE:
+//   the engine is built with -mno-sse2 to stay in sync, so only SSE1 is used
+//   here; the integer step of fastmath::isqrt2_nosse is done per lane
+//
+//   every loop ends with the scalar code for the last (size % 4) elements,
+//   the SSE part has to give exactly the same results as that
+
+namespace math {
+
+#ifndef DEDICATED_NOSSE
+
+__FORCE_ALIGN_STACK__
+void BatchDot(const float3SoA& a, const float3SoA& b, float* out)
+{
+	const size_t n = a.size();
+	size_t i = 0;
+
+	for (; (i + 4) <= n; i += 4) {
+		__m128 r;
+		r =               _mm_mul_ps(_mm_loadu_ps(&a.x[i]), _mm_loadu_ps(&b.x[i]));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(&a.y[i]), _mm_loadu_ps(&b.y[i])));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(&a.z[i]), _mm_loadu_ps(&b.z[i])));
+		_mm_storeu_ps(&out[i], r);
+	}
+	for (; i < n; i++) {
+		out[i] = a.Get(i).dot(b.Get(i));
+	}
+}
+
+__FORCE_ALIGN_STACK__
+void BatchDot(const float3SoA& a, const float3& b, float* out)
+{
+	const size_t n = a.size();
+	const __m128 bx = _mm_set1_ps(b.x);
+	const __m128 by = _mm_set1_ps(b.y);
+	const __m128 bz = _mm_set1_ps(b.z);
+	size_t i = 0;
+
+	for (; (i + 4) <= n; i += 4) {
+		__m128 r;
+		r =               _mm_mul_ps(_mm_loadu_ps(&a.x[i]), bx);
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(&a.y[i]), by));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(&a.z[i]), bz));
+		_mm_storeu_ps(&out[i], r);
+	}
+	for (; i < n; i++) {
+		out[i] = a.Get(i).dot(b);
+	}
+}
+
+
+__FORCE_ALIGN_STACK__
+void BatchCross(const float3SoA& a, const float3SoA& b, float3SoA* out)
+{
+	const size_t n = a.size();
+	size_t i = 0;
+
+	out->resize(n);
+
+	for (; (i + 4) <= n; i += 4) {
+		const __m128 ax = _mm_loadu_ps(&a.x[i]);
+		const __m128 ay = _mm_loadu_ps(&a.y[i]);
+		const __m128 az = _mm_loadu_ps(&a.z[i]);
+		const __m128 bx = _mm_loadu_ps(&b.x[i]);
+		const __m128 by = _mm_loadu_ps(&b.y[i]);
+		const __m128 bz = _mm_loadu_ps(&b.z[i]);
+
+		_mm_storeu_ps(&out->x[i], _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by)));
+		_mm_storeu_ps(&out->y[i], _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz)));
+		_mm_storeu_ps(&out->z[i], _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx)));
+	}
+	for (; i < n; i++) {
+		out->Set(i, a.Get(i).cross(b.Get(i)));
+	}
+}
+
+
+__FORCE_ALIGN_STACK__
+void BatchSafeNormalize(float3SoA* v)
+{
+	const size_t n = v->size();
+	const __m128 eps  = _mm_set1_ps(float3::NORMALIZE_EPS);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 c15  = _mm_set1_ps(1.5f);
+	size_t i = 0;
+
+	for (; (i + 4) <= n; i += 4) {
+		const __m128 x = _mm_loadu_ps(&v->x[i]);
+		const __m128 y = _mm_loadu_ps(&v->y[i]);
+		const __m128 z = _mm_loadu_ps(&v->z[i]);
+
+		// float3::SqLength
+		__m128 sql;
+		sql =                 _mm_mul_ps(x, x);
+		sql = _mm_add_ps(sql, _mm_mul_ps(y, y));
+		sql = _mm_add_ps(sql, _mm_mul_ps(z, z));
+
+		// fastmath::isqrt2_nosse, the magic number step without SSE2
+		float lanes[4];
+		boost::int32_t bits[4];
+
+		_mm_storeu_ps(lanes, sql);
+		memcpy(bits, lanes, sizeof(bits));
+
+		for (int k = 0; k < 4; k++) {
+			bits[k] = 0x5f375a86 - (bits[k] >> 1);
+		}
+
+		memcpy(lanes, bits, sizeof(lanes));
+
+		const __m128 xh = _mm_mul_ps(half, sql);
+		__m128 is = _mm_loadu_ps(lanes);
+		is = _mm_mul_ps(is, _mm_sub_ps(c15, _mm_mul_ps(xh, _mm_mul_ps(is, is))));
+		is = _mm_mul_ps(is, _mm_sub_ps(c15, _mm_mul_ps(xh, _mm_mul_ps(is, is))));
+
+		// vectors too short to normalize stay as they are
+		const __m128 mask = _mm_cmpgt_ps(sql, eps);
+
+		_mm_storeu_ps(&v->x[i], _mm_or_ps(_mm_and_ps(mask, _mm_mul_ps(x, is)), _mm_andnot_ps(mask, x)));
+		_mm_storeu_ps(&v->y[i], _mm_or_ps(_mm_and_ps(mask, _mm_mul_ps(y, is)), _mm_andnot_ps(mask, y)));
+		_mm_storeu_ps(&v->z[i], _mm_or_ps(_mm_and_ps(mask, _mm_mul_ps(z, is)), _mm_andnot_ps(mask, z)));
+	}
+	for (; i < n; i++) {
+		v->Set(i, v->Get(i).SafeNormalize());
+	}
+}
+
+
+__FORCE_ALIGN_STACK__
+void BatchSqDistance(const float3SoA& a, const float3SoA& b, float* out)
+{
+	const size_t n = a.size();
+	size_t i = 0;
+
+	for (; (i + 4) <= n; i += 4) {
+		const __m128 dx = _mm_sub_ps(_mm_loadu_ps(&a.x[i]), _mm_loadu_ps(&b.x[i]));
+		const __m128 dy = _mm_sub_ps(_mm_loadu_ps(&a.y[i]), _mm_loadu_ps(&b.y[i]));
+		const __m128 dz = _mm_sub_ps(_mm_loadu_ps(&a.z[i]), _mm_loadu_ps(&b.z[i]));
+
+		__m128 r;
+		r =               _mm_mul_ps(dx, dx);
+		r = _mm_add_ps(r, _mm_mul_ps(dy, dy));
+		r = _mm_add_ps(r, _mm_mul_ps(dz, dz));
+		_mm_storeu_ps(&out[i], r);
+	}
+	for (; i < n; i++) {
+		out[i] = a.Get(i).SqDistance(b.Get(i));
+	}
+}
+
+__FORCE_ALIGN_STACK__
+void BatchSqDistance(const float3SoA& a, const float3& b, float* out)
+{
+	const size_t n = a.size();
+	const __m128 bx = _mm_set1_ps(b.x);
+	const __m128 by = _mm_set1_ps(b.y);
+	const __m128 bz = _mm_set1_ps(b.z);
+	size_t i = 0;
+
+	for (; (i + 4) <= n; i += 4) {
+		const __m128 dx = _mm_sub_ps(_mm_loadu_ps(&a.x[i]), bx);
+		const __m128 dy = _mm_sub_ps(_mm_loadu_ps(&a.y[i]), by);
+		const __m128 dz = _mm_sub_ps(_mm_loadu_ps(&a.z[i]), bz);
+
+		__m128 r;
+		r =               _mm_mul_ps(dx, dx);
+		r = _mm_add_ps(r, _mm_mul_ps(dy, dy));
+		r = _mm_add_ps(r, _mm_mul_ps(dz, dz));
+		_mm_storeu_ps(&out[i], r);
+	}
+	for (; i < n; i++) {
+		out[i] = a.Get(i).SqDistance(b);
+	}
+}
+
+
+__FORCE_ALIGN_STACK__
+void BatchTransform(const CMatrix44f& m, const float3SoA& v, float3SoA* out)
+{
+	const size_t n = v.size();
+	size_t i = 0;
+
+	out->resize(n);
+
+	// CMatrix44f::operator*(float3) multiplies the translation by 1.0f, which
+	// is exact, so adding it as it is gives the same result
+	__m128 mc[12];
+
+	for (int k = 0; k < 3; k++) {
+		mc[k * 4 + 0] = _mm_set1_ps(m.m[ 0 + k]);
+		mc[k * 4 + 1] = _mm_set1_ps(m.m[ 4 + k]);
+		mc[k * 4 + 2] = _mm_set1_ps(m.m[ 8 + k]);
+		mc[k * 4 + 3] = _mm_set1_ps(m.m[12 + k]);
+	}
+
+	for (; (i + 4) <= n; i += 4) {
+		const __m128 x = _mm_loadu_ps(&v.x[i]);
+		const __m128 y = _mm_loadu_ps(&v.y[i]);
+		const __m128 z = _mm_loadu_ps(&v.z[i]);
+
+		float* outs[3] = {&out->x[i], &out->y[i], &out->z[i]};
+
+		for (int k = 0; k < 3; k++) {
+			__m128 r;
+			r =               _mm_mul_ps(mc[k * 4 + 0], x);
+			r = _mm_add_ps(r, _mm_mul_ps(mc[k * 4 + 1], y));
+			r = _mm_add_ps(r, _mm_mul_ps(mc[k * 4 + 2], z));
+			r = _mm_add_ps(r, mc[k * 4 + 3]);
+			_mm_storeu_ps(outs[k], r);
+		}
+	}
+	for (; i < n; i++) {
+		out->Set(i, m * v.Get(i));
+	}
+}
+
+#else
+
+void BatchDot(const float3SoA& a, const float3SoA& b, float* out) {
+	for (size_t i = 0; i < a.size(); i++) { out[i] = a.Get(i).dot(b.Get(i)); }
+}
+void BatchDot(const float3SoA& a, const float3& b, float* out) {
+	for (size_t i = 0; i < a.size(); i++) { out[i] = a.Get(i).dot(b); }
+}
+void BatchCross(const float3SoA& a, const float3SoA& b, float3SoA* out) {
+	out->resize(a.size());
+	for (size_t i = 0; i < a.size(); i++) { out->Set(i, a.Get(i).cross(b.Get(i))); }
+}
+void BatchSafeNormalize(float3SoA* v) {
+	for (size_t i = 0; i < v->size(); i++) { v->Set(i, v->Get(i).SafeNormalize()); }
+}
+void BatchSqDistance(const float3SoA& a, const float3SoA& b, float* out) {
+	for (size_t i = 0; i < a.size(); i++) { out[i] = a.Get(i).SqDistance(b.Get(i)); }
+}
+void BatchSqDistance(const float3SoA& a, const float3& b, float* out) {
+	for (size_t i = 0; i < a.size(); i++) { out[i] = a.Get(i).SqDistance(b); }
+}
+void BatchTransform(const CMatrix44f& m, const float3SoA& v, float3SoA* out) {
+	out->resize(v.size());
+	for (size_t i = 0; i < v.size(); i++) { out->Set(i, m * v.Get(i)); }
+}
+
+#endif
+
+}
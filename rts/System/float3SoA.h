@@ -0,0 +1,72 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef FLOAT3_SOA_H
+#define FLOAT3_SOA_H
+
+#include <vector>
+
+#include "System/float3.h"
+
+class CMatrix44f;
+
+
+/**
+ * @brief float3 array in structure-of-arrays layout
+ *
+ * Keeps the x, y and z components in arrays of their own, so the
+ * math::Batch* functions below can work on four vectors at once.
+ */
+struct float3SoA
+{
+	size_t size() const { return x.size(); }
+	bool empty() const { return x.empty(); }
+
+	void clear() { x.clear(); y.clear(); z.clear(); }
+	void reserve(size_t n) { x.reserve(n); y.reserve(n); z.reserve(n); }
+	void resize(size_t n) { x.resize(n); y.resize(n); z.resize(n); }
+
+	void push_back(const float3& v) { x.push_back(v.x); y.push_back(v.y); z.push_back(v.z); }
+
+	float3 Get(size_t i) const { return float3(x[i], y[i], z[i]); }
+	void Set(size_t i, const float3& v) { x[i] = v.x; y[i] = v.y; z[i] = v.z; }
+
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+};
+
+
+/**
+ * Batched float3 and CMatrix44f operations for sim loops.
+ *
+ * Each result is bit-identical to the scalar function named in its comment:
+ * the SSE kernels do the same IEEE operations in the same order under the
+ * same (streflop) MXCSR settings, so they are as sync-safe as the scalar
+ * code. Operations that would round differently (rsqrt, FMA, reordered
+ * sums) are left out on purpose.
+ *
+ * Float outputs need room for a.size() elements, float3SoA outputs are
+ * resized. An output may be one of the inputs.
+ */
+namespace math {
+	/// out[i] = a[i].dot(b[i])
+	void BatchDot(const float3SoA& a, const float3SoA& b, float* out);
+	/// out[i] = a[i].dot(b)
+	void BatchDot(const float3SoA& a, const float3& b, float* out);
+
+	/// out[i] = a[i].cross(b[i])
+	void BatchCross(const float3SoA& a, const float3SoA& b, float3SoA* out);
+
+	/// v[i].SafeNormalize()
+	void BatchSafeNormalize(float3SoA* v);
+
+	/// out[i] = a[i].SqDistance(b[i])
+	void BatchSqDistance(const float3SoA& a, const float3SoA& b, float* out);
+	/// out[i] = a[i].SqDistance(b)
+	void BatchSqDistance(const float3SoA& a, const float3& b, float* out);
+
+	/// out[i] = m * v[i]
+	void BatchTransform(const CMatrix44f& m, const float3SoA& v, float3SoA* out);
+}
+
+#endif // FLOAT3_SOA_H
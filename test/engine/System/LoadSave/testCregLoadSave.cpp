@@ -21,6 +21,19 @@ class EmbeddedObj {
 CR_BIND(EmbeddedObj, );
 CR_REG_METADATA(EmbeddedObj, CR_MEMBER(value));
 
+// first member shares the address of its parent
+struct Holder {
+	CR_DECLARE_STRUCT(Holder);
+	EmbeddedObj first;
+	int value;
+};
+
+CR_BIND(Holder, );
+CR_REG_METADATA(Holder, (
+	CR_MEMBER(first),
+	CR_MEMBER(value)
+));
+
 enum EnumClass {
 	A,
 	B,
@@ -39,6 +52,8 @@ struct TestObj {
 		for(int a=0;a<5;a++) sarray[a] = 0;
 		children[0] = children[1] = 0;
 		embeddedPtr = &embedded;
+		holderFirstPtr = &holder.first;
+		holder.value = 0;
 	}
 	virtual ~TestObj() {
 		if (children[0]) delete children[0];
@@ -55,6 +70,8 @@ struct TestObj {
 	EmbeddedObj* embeddedPtr;
 	TestObj* children[2];
 	EmbeddedObj embedded;
+	Holder holder;
+	EmbeddedObj* holderFirstPtr;
 
 	//this test fails atm
 	//std::vector<EmbeddedObj>  embeddeds;
@@ -72,7 +89,9 @@ CR_REG_METADATA(TestObj, (
 	CR_MEMBER(darray),
 	CR_MEMBER(children),
 	CR_MEMBER(embedded),
-	CR_MEMBER(embeddedPtr)//,
+	CR_MEMBER(embeddedPtr),
+	CR_MEMBER(holder),
+	CR_MEMBER(holderFirstPtr)//,
 	//CR_MEMBER(embeddeds),
 	//CR_MEMBER(embeddedPtrs)
 ));
@@ -88,6 +107,7 @@ static void savetest(std::ostream* os)
 	o->fvar = 666.666f;
 	o->enumVar = EnumClass::C;
 	o->str = "Hi!";
+	o->holder.value = 42;
 	for (int a=0;a<5;a++) o->sarray[a]=a+10;
 	//o->embeddeds.resize(10);
 
@@ -142,6 +162,8 @@ static bool test_creg_pointers(TestObj* obj)
 	if (obj->children[0] != obj->children[1]) return false;
 	if (obj->children[0]->intvar != 144) return false;
 	if (obj->embeddedPtr != &obj->embedded) return false;
+	if (obj->holderFirstPtr != &obj->holder.first) return false;
+	if (obj->holder.value != 42) return false;
 
 	/*TestObj* c = obj->children[0];
 	if (obj->embeddeds.size() != 10) return false;
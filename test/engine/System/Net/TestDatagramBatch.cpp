@@ -0,0 +1,231 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/Net/DatagramBatch.h"
+#include "System/Log/ILog.h"
+
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+#define BOOST_TEST_MODULE DatagramBatch
+#include <boost/test/unit_test.hpp>
+
+using namespace boost::asio;
+using netcode::DatagramBatch;
+
+static const unsigned int NUM_DATAGRAMS = 200000;
+// small enough to never overflow the receive buffer, so loopback loses nothing
+static const unsigned int BURST_SIZE = 64;
+// about the size of a frame packet with a few chunks
+static const unsigned int DATAGRAM_SIZE = 200;
+// loopback delivers at once, a datagram missing for this long was dropped
+static const std::chrono::seconds RECEIVE_TIMEOUT(5);
+
+
+struct LoopbackPair {
+	LoopbackPair()
+		: sender(service, ip::udp::endpoint(ip::address_v4::loopback(), 0))
+		, receiver(service, ip::udp::endpoint(ip::address_v4::loopback(), 0))
+	{
+		receiver.set_option(socket_base::receive_buffer_size(1 << 20));
+		// receiving never blocks, see WaitForData
+		receiver.non_blocking(true);
+	}
+
+	io_service service;
+	ip::udp::socket sender;
+	ip::udp::socket receiver;
+};
+
+/// false if nothing arrived within RECEIVE_TIMEOUT, the test fails then instead of hanging
+static bool WaitForData(ip::udp::socket& socket)
+{
+	const auto deadline = std::chrono::steady_clock::now() + RECEIVE_TIMEOUT;
+
+	while (socket.available() == 0) {
+		if (std::chrono::steady_clock::now() >= deadline)
+			return false;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	return true;
+}
+
+static void FillDatagram(std::vector<boost::uint8_t>& data, unsigned int seqNum)
+{
+	for (unsigned int i = 0; i < data.size(); i++) {
+		data[i] = (seqNum + i) & 0xFF;
+	}
+}
+
+static bool CheckDatagram(const boost::uint8_t* data, unsigned int length, unsigned int seqNum)
+{
+	if (length != DATAGRAM_SIZE)
+		return false;
+
+	for (unsigned int i = 0; i < length; i++) {
+		if (data[i] != ((seqNum + i) & 0xFF))
+			return false;
+	}
+
+	return true;
+}
+
+static void LogRate(const char* name, unsigned int numPackets, clock_t cpuTicks)
+{
+	const double cpuSecs = std::max(double(cpuTicks) / CLOCKS_PER_SEC, 0.001);
+
+	LOG("[DatagramBatch] %s: %u datagrams sent and received in %.0fms CPU time (%.0f packets/sec per core)",
+		name, numPackets, cpuSecs * 1000.0, numPackets / cpuSecs);
+}
+
+
+BOOST_AUTO_TEST_CASE(SingleDatagrams)
+{
+	LoopbackPair pair;
+
+	const ip::udp::endpoint target = pair.receiver.local_endpoint();
+	const ip::udp::endpoint source = pair.sender.local_endpoint();
+
+	std::vector<boost::uint8_t> data(DATAGRAM_SIZE);
+	std::vector<boost::uint8_t> buffer(4096);
+
+	unsigned int numValid = 0;
+	const clock_t t0 = clock();
+
+	for (unsigned int seqNum = 0; seqNum < NUM_DATAGRAMS; ) {
+		const unsigned int burstEnd = std::min(seqNum + BURST_SIZE, NUM_DATAGRAMS);
+
+		for (unsigned int n = seqNum; n < burstEnd; n++) {
+			FillDatagram(data, n);
+			pair.sender.send_to(boost::asio::buffer(data), target);
+		}
+
+		// the same loop UDPListener used before batching
+		while (seqNum < burstEnd) {
+			ip::udp::endpoint sender;
+			boost::system::error_code err;
+			const size_t length = pair.receiver.receive_from(boost::asio::buffer(buffer), sender, 0, err);
+
+			if (err == error::would_block) {
+				BOOST_REQUIRE_MESSAGE(WaitForData(pair.receiver), "datagram " << seqNum << " was not received");
+				continue;
+			}
+
+			BOOST_REQUIRE(!err);
+
+			numValid += (sender == source && CheckDatagram(&buffer[0], length, seqNum));
+			seqNum++;
+		}
+	}
+
+	LogRate("send_to/receive_from", NUM_DATAGRAMS, clock() - t0);
+
+	BOOST_CHECK(numValid == NUM_DATAGRAMS);
+}
+
+
+BOOST_AUTO_TEST_CASE(BatchedDatagrams)
+{
+	LoopbackPair pair;
+
+	const ip::udp::endpoint target = pair.receiver.local_endpoint();
+	const ip::udp::endpoint source = pair.sender.local_endpoint();
+
+	DatagramBatch sendBatch(BURST_SIZE);
+	DatagramBatch recvBatch(BURST_SIZE);
+
+	std::vector<boost::uint8_t> data(DATAGRAM_SIZE);
+
+	unsigned int numSent = 0;
+	unsigned int numReceived = 0;
+	unsigned int numValid = 0;
+
+	const clock_t t0 = clock();
+
+	for (unsigned int seqNum = 0; seqNum < NUM_DATAGRAMS; ) {
+		const unsigned int burstEnd = std::min(seqNum + BURST_SIZE, NUM_DATAGRAMS);
+
+		for (unsigned int n = seqNum; n < burstEnd; n++) {
+			FillDatagram(data, n);
+			sendBatch.Add(pair.sender, data, target);
+		}
+
+		numSent += sendBatch.Send(pair.sender);
+
+		while (seqNum < burstEnd) {
+			boost::system::error_code err;
+			const unsigned int count = recvBatch.Receive(pair.receiver, err);
+
+			BOOST_REQUIRE(!err);
+
+			if (count == 0) {
+				BOOST_REQUIRE_MESSAGE(WaitForData(pair.receiver), "datagram " << seqNum << " was not received");
+				continue;
+			}
+
+			for (unsigned int i = 0; i < count; i++, seqNum++) {
+				numValid += (recvBatch.GetEndpoint(i) == source && CheckDatagram(recvBatch.GetData(i), recvBatch.GetLength(i), seqNum));
+			}
+
+			numReceived += count;
+		}
+	}
+
+	LogRate(DatagramBatch::IsNative()? "sendmmsg/recvmmsg": "batched fallback", NUM_DATAGRAMS, clock() - t0);
+
+	BOOST_CHECK(numSent == NUM_DATAGRAMS);
+	BOOST_CHECK(numReceived == NUM_DATAGRAMS);
+	BOOST_CHECK(numValid == NUM_DATAGRAMS);
+}
+
+
+BOOST_AUTO_TEST_CASE(DeferredSend)
+{
+	LoopbackPair pair;
+
+	const ip::udp::endpoint target = pair.receiver.local_endpoint();
+
+	// a full batch is sent while adding, nothing may get lost
+	DatagramBatch sendBatch(4);
+	DatagramBatch recvBatch(16);
+
+	std::vector<boost::uint8_t> data(DATAGRAM_SIZE);
+
+	sendBatch.SetDeferSend(true);
+	BOOST_CHECK(sendBatch.IsDeferringSend());
+
+	for (unsigned int n = 0; n < 10; n++) {
+		FillDatagram(data, n);
+		sendBatch.Add(pair.sender, data, target);
+	}
+
+	BOOST_CHECK(sendBatch.Size() == 2);
+	BOOST_CHECK(sendBatch.Send(pair.sender) == 2);
+	BOOST_CHECK(sendBatch.Size() == 0);
+
+	unsigned int numReceived = 0;
+	unsigned int numValid = 0;
+
+	while (numReceived < 10) {
+		boost::system::error_code err;
+		const unsigned int count = recvBatch.Receive(pair.receiver, err);
+
+		BOOST_REQUIRE(!err);
+
+		if (count == 0) {
+			BOOST_REQUIRE_MESSAGE(WaitForData(pair.receiver), "datagram " << numReceived << " was not received");
+			continue;
+		}
+
+		for (unsigned int i = 0; i < count; i++, numReceived++) {
+			numValid += CheckDatagram(recvBatch.GetData(i), recvBatch.GetLength(i), numReceived);
+		}
+	}
+
+	BOOST_CHECK(numValid == 10);
+}
@@ -0,0 +1,125 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/Net/LoopbackConnection.h"
+#include "System/Net/PackPacket.h"
+#include "System/Log/ILog.h"
+#include "System/Misc/SpringTime.h"
+
+#include <boost/shared_ptr.hpp>
+#include <vector>
+
+/**
+ * Throughput micro-benchmark for CLoopbackConnection: one packet is handed
+ * to a few hundred loopback links per message and drained every frame.
+ * This does not exercise CGameServer or UDPConnection, the fan-out below
+ * is a plain loop over the links.
+ */
+#define BOOST_TEST_MODULE LoopbackThroughput
+#include <boost/test/unit_test.hpp>
+
+using netcode::CLoopbackConnection;
+using netcode::PackPacket;
+using netcode::RawPacket;
+
+// mirrors a large tournament cast: every message is sent to all of them
+static const unsigned int NUM_PLAYERS = 16;
+static const unsigned int NUM_SPECTATORS = 200;
+static const unsigned int NUM_FRAMES = 30 * 60 * 2;
+
+// ids match NETMSG_NEWFRAME and NETMSG_COMMAND, loopbacks do not validate
+static const unsigned char MSG_NEWFRAME = 2;
+static const unsigned char MSG_COMMAND = 11;
+
+
+struct LoopbackLinks {
+	LoopbackLinks(): numMessages(0), numBytes(0) {
+		for (unsigned int n = 0; n < (NUM_PLAYERS + NUM_SPECTATORS); n++) {
+			links.push_back(boost::shared_ptr<CLoopbackConnection>(new CLoopbackConnection()));
+		}
+	}
+
+	// serialize once, hand the same packet to every link
+	void SendToAll(boost::shared_ptr<const RawPacket> packet) {
+		for (const auto& link: links) {
+			link->SendData(packet);
+		}
+
+		numMessages += 1;
+		numBytes += packet->length;
+	}
+
+	std::vector< boost::shared_ptr<CLoopbackConnection> > links;
+
+	unsigned int numMessages;
+	unsigned int numBytes;
+};
+
+
+static boost::shared_ptr<const RawPacket> MakeCommandPacket(unsigned char playerNum, unsigned int frameNum)
+{
+	// a move order with a varying number of params, like real traffic
+	const unsigned int numParams = 3 + (frameNum + playerNum) % 8;
+	const unsigned short length = 1 + 2 + 1 + 4 + 1 + numParams * sizeof(float);
+
+	PackPacket* packet = new PackPacket(length, MSG_COMMAND);
+	*packet << length << playerNum << int(10) << (unsigned char) 0;
+
+	for (unsigned int n = 0; n < numParams; n++) {
+		*packet << float(n);
+	}
+
+	return boost::shared_ptr<const RawPacket>(packet);
+}
+
+
+BOOST_AUTO_TEST_CASE(SendToManyLinks)
+{
+	spring_clock::PushTickRate();
+	spring_time::setstarttime(spring_time::gettime(true));
+
+	LoopbackLinks loopbacks;
+
+	unsigned int numReceived = 0;
+	unsigned int numShared = 0;
+
+	const spring_time t0 = spring_gettime();
+
+	for (unsigned int frameNum = 0; frameNum < NUM_FRAMES; frameNum++) {
+		std::vector< boost::shared_ptr<const RawPacket> > framePackets;
+
+		framePackets.push_back(boost::shared_ptr<const RawPacket>(new PackPacket(1, MSG_NEWFRAME)));
+		loopbacks.SendToAll(framePackets.back());
+
+		// every player issues an order twice per second
+		if ((frameNum % 15) == 0) {
+			for (unsigned int playerNum = 0; playerNum < NUM_PLAYERS; playerNum++) {
+				framePackets.push_back(MakeCommandPacket(playerNum, frameNum));
+				loopbacks.SendToAll(framePackets.back());
+			}
+		}
+
+		// clients drain their queues every frame
+		for (const auto& link: loopbacks.links) {
+			boost::shared_ptr<const RawPacket> packet;
+
+			for (unsigned int n = 0; (packet = link->GetData()); n++) {
+				numReceived += 1;
+				numShared += (n < framePackets.size() && packet == framePackets[n]);
+			}
+		}
+	}
+
+	const spring_time t1 = spring_gettime();
+	const float msecs = (t1 - t0).toMilliSecsf();
+
+	const unsigned int numLinks = NUM_PLAYERS + NUM_SPECTATORS;
+	const unsigned int numDelivered = loopbacks.numMessages * numLinks;
+
+	LOG("[LoopbackThroughput] %u links, %u frames: %u messages (%u bytes) delivered %u times in %.2fms (%.0f deliveries/sec)",
+		numLinks, NUM_FRAMES, loopbacks.numMessages, loopbacks.numBytes, numDelivered,
+		msecs, numDelivered / std::max(msecs * 0.001f, 0.001f));
+
+	BOOST_CHECK(numReceived == numDelivered);
+	// loopbacks hand out the packet that was sent, never a copy per link
+	BOOST_CHECK(numShared == numDelivered);
+}
@@ -0,0 +1,161 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/Net/UDPConnection.h"
+#include "System/Net/RawPacket.h"
+#include "System/Net/Socket.h"
+#include "Net/Protocol/BaseNetProtocol.h"
+#include "System/GlobalConfig.h"
+#include "System/Log/ILog.h"
+#include "System/Misc/SpringTime.h"
+
+#include <boost/shared_ptr.hpp>
+#include <cstring>
+#include <vector>
+
+#define BOOST_TEST_MODULE UDPConnection
+#include <boost/test/unit_test.hpp>
+
+using netcode::RawPacket;
+using netcode::UDPConnection;
+
+static const int PORT_A = 11211;
+static const int PORT_B = 11212;
+
+
+struct InitGlobals {
+	InitGlobals() {
+		GlobalConfig::Instantiate();
+		spring_clock::PushTickRate();
+		spring_time::setstarttime(spring_time::gettime(true));
+	}
+	~InitGlobals() {
+		GlobalConfig::Deallocate();
+	}
+};
+
+BOOST_GLOBAL_FIXTURE(InitGlobals);
+
+
+static boost::shared_ptr<const RawPacket> MakeLuaMsg(unsigned int size, unsigned int seed)
+{
+	std::vector<boost::uint8_t> msg(size);
+
+	for (unsigned int i = 0; i < size; i++) {
+		msg[i] = (i * 31 + seed) & 0xFF;
+	}
+
+	return CBaseNetProtocol::Get().SendLuaMsg(0, 100, 0, msg);
+}
+
+
+// polls both ends until <to> received <count> messages or a timeout
+static void Receive(UDPConnection& from, UDPConnection& to, size_t count, std::vector< boost::shared_ptr<const RawPacket> >& received)
+{
+	const spring_time t0 = spring_gettime();
+
+	while (received.size() < count && (spring_gettime() - t0) < spring_secs(5)) {
+		// also resends in case the loopback dropped a datagram
+		from.Update();
+		to.Update();
+
+		boost::shared_ptr<const RawPacket> packet;
+
+		while ((packet = to.GetData())) {
+			received.push_back(packet);
+		}
+
+		netcode::WaitForNetEvents(NULL, spring_msecs(5));
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(SplitAndReassemble)
+{
+	UDPConnection a(PORT_A, "127.0.0.1", PORT_B);
+	UDPConnection b(PORT_B, "127.0.0.1", PORT_A);
+	a.Unmute();
+	b.Unmute();
+
+	std::vector< boost::shared_ptr<const RawPacket> > received;
+
+	// like a client connecting: until both ends got a chunk, packets that
+	// ack nothing are taken for reconnection attempts and dropped
+	b.SendData(MakeLuaMsg(1, 0));
+	b.Flush(true);
+	Receive(b, a, 1, received);
+	BOOST_REQUIRE(received.size() == 1);
+	received.clear();
+
+	// each is split over many chunks (254 bytes), the small ones end up
+	// sharing a chunk with the head or tail of a large one
+	std::vector< boost::shared_ptr<const RawPacket> > sent;
+	sent.push_back(MakeLuaMsg(5000, 1));
+	sent.push_back(MakeLuaMsg(3, 2));
+	sent.push_back(MakeLuaMsg(12345, 3));
+	sent.push_back(MakeLuaMsg(250, 4));
+	sent.push_back(MakeLuaMsg(700, 5));
+
+	for (const auto& packet: sent) {
+		a.SendData(packet);
+	}
+
+	a.Flush(true);
+	Receive(a, b, sent.size(), received);
+
+	BOOST_REQUIRE(received.size() == sent.size());
+
+	for (size_t n = 0; n < sent.size(); n++) {
+		BOOST_CHECK(received[n]->length == sent[n]->length);
+		BOOST_CHECK(memcmp(received[n]->data, sent[n]->data, sent[n]->length) == 0);
+	}
+
+	LOG("[UDPConnection] %s", a.Statistics().c_str());
+}
+
+
+BOOST_AUTO_TEST_CASE(MergedPacketWithBandwidthLimit)
+{
+	UDPConnection a(PORT_A, "127.0.0.1", PORT_B);
+	UDPConnection b(PORT_B, "127.0.0.1", PORT_A);
+	a.Unmute();
+	b.Unmute();
+
+	std::vector< boost::shared_ptr<const RawPacket> > received;
+
+	b.SendData(MakeLuaMsg(1, 0));
+	b.Flush(true);
+	Receive(b, a, 1, received);
+	BOOST_REQUIRE(received.size() == 1);
+	received.clear();
+
+	// several messages in one packet (like the spectator relay sends), more
+	// than the link may send at once: unforced flushes stop between them
+	std::vector< boost::shared_ptr<const RawPacket> > sent;
+	unsigned int mergedLength = 0;
+
+	for (unsigned int n = 0; n < 24; n++) {
+		sent.push_back(MakeLuaMsg(4000 + n * 7, n));
+		mergedLength += sent.back()->length;
+	}
+
+	RawPacket* merged = new RawPacket(mergedLength);
+
+	for (unsigned int pos = 0, n = 0; n < sent.size(); n++) {
+		memcpy(merged->data + pos, sent[n]->data, sent[n]->length);
+		pos += sent[n]->length;
+	}
+
+	BOOST_REQUIRE(mergedLength > (unsigned) globalConfig->linkOutgoingBandwidth);
+
+	a.SendData(boost::shared_ptr<const RawPacket>(merged));
+	Receive(a, b, sent.size(), received);
+
+	BOOST_REQUIRE(received.size() == sent.size());
+
+	for (size_t n = 0; n < sent.size(); n++) {
+		BOOST_CHECK(received[n]->length == sent[n]->length);
+		BOOST_CHECK(memcmp(received[n]->data, sent[n]->data, sent[n]->length) == 0);
+	}
+
+	LOG("[UDPConnection] %s", a.Statistics().c_str());
+}
@@ -0,0 +1,160 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/CRC.h"
+#include "System/Log/ILog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+
+extern "C" {
+#include "lib/7z/7zCrc.h"
+}
+
+#define BOOST_TEST_MODULE CRC
+#include <boost/test/unit_test.hpp>
+
+
+// the 7z implementation CRC used before, the checksums must not change
+static unsigned int RefCRC(const void* data, unsigned int size) {
+	return CRC_GET_DIGEST(CrcUpdate(CRC_INIT_VAL, data, size));
+}
+
+static unsigned int NewCRC(const void* data, unsigned int size) {
+	return CRC().Update(data, size).GetDigest();
+}
+
+
+struct Fixture {
+	Fixture() {
+		CrcGenerateTable();
+		srand(42);
+
+		buffer.resize(1 << 16);
+
+		for (size_t i = 0; i < buffer.size(); i++) {
+			buffer[i] = rand() & 0xFF;
+		}
+	}
+	~Fixture() {
+		CRC::UseHardwareCRC(true);
+	}
+
+	std::vector<unsigned char> buffer;
+};
+
+
+BOOST_FIXTURE_TEST_CASE( KnownValue, Fixture )
+{
+	BOOST_CHECK(NewCRC("123456789", 9) == 0xCBF43926);
+	BOOST_CHECK(NewCRC("", 0) == 0);
+}
+
+
+BOOST_FIXTURE_TEST_CASE( SameAs7z, Fixture )
+{
+	size_t numDiffs = 0;
+
+	// both code paths, with every alignment and the lengths around the
+	// 16 and 64 byte block sizes of PCLMULQDQ
+	for (int hw = 0; hw < 2; hw++) {
+		CRC::UseHardwareCRC(hw != 0);
+
+		for (unsigned int offset = 0; offset < 16; offset++) {
+			for (unsigned int size = 0; size < 300; size++) {
+				numDiffs += (NewCRC(&buffer[offset], size) != RefCRC(&buffer[offset], size));
+			}
+		}
+		for (int n = 0; n < 200; n++) {
+			const unsigned int offset = rand() % 64;
+			const unsigned int size = rand() % (buffer.size() - offset);
+
+			numDiffs += (NewCRC(&buffer[offset], size) != RefCRC(&buffer[offset], size));
+			numDiffs += (CRC::GetCRC(&buffer[offset], size) != CrcUpdate(0, &buffer[offset], size));
+		}
+
+		// the 4 byte and operator<< overloads
+		CRC crc;
+		crc.Update(0x12345678u);
+		crc << 42 << 3.5f;
+
+		const unsigned int v[3] = {0x12345678u, 42u, 0x40600000u};
+		numDiffs += (crc.GetDigest() != RefCRC(v, sizeof(v)));
+	}
+
+	BOOST_CHECK(numDiffs == 0);
+}
+
+
+BOOST_FIXTURE_TEST_CASE( Combine, Fixture )
+{
+	size_t numDiffs = 0;
+
+	for (int n = 0; n < 200; n++) {
+		CRC crc;
+
+		unsigned int pos = 0;
+		unsigned int end = rand() % buffer.size();
+
+		// random chunks, including empty ones
+		while (pos < end) {
+			const unsigned int size = std::min(end - pos, (unsigned int) (rand() % 5000));
+			crc.Combine(CRC::GetCRC(&buffer[pos], size), size);
+			pos += size;
+		}
+
+		numDiffs += (crc.GetDigest() != RefCRC(&buffer[0], end));
+	}
+
+	BOOST_CHECK(numDiffs == 0);
+}
+
+
+template<typename F>
+static double MegaBytesPerSec(const std::vector<unsigned char>& data, F f) {
+	typedef std::chrono::high_resolution_clock Clock;
+
+	const int numRuns = 8;
+	unsigned int sum = 0;
+
+	const Clock::time_point t0 = Clock::now();
+
+	for (int n = 0; n < numRuns; n++) {
+		sum += f(&data[0], data.size());
+	}
+
+	const Clock::time_point t1 = Clock::now();
+	const double secs = std::chrono::duration<double>(t1 - t0).count();
+
+	// keep the compiler from dropping the loop
+	BOOST_CHECK(sum != 0 || data.empty());
+
+	return (numRuns * data.size() / (1024.0 * 1024.0)) / std::max(secs, 1e-9);
+}
+
+BOOST_FIXTURE_TEST_CASE( Throughput, Fixture )
+{
+	std::vector<unsigned char> data(32 * 1024 * 1024);
+
+	for (size_t i = 0; i < data.size(); i++) {
+		data[i] = i * 7 + (i >> 11);
+	}
+
+	const double refSpeed = MegaBytesPerSec(data, RefCRC);
+
+	CRC::UseHardwareCRC(false);
+	const double tableSpeed = MegaBytesPerSec(data, NewCRC);
+
+	CRC::UseHardwareCRC(true);
+	const double hwSpeed = MegaBytesPerSec(data, NewCRC);
+
+	LOG("7z CrcUpdate: %8.1f MB/s", refSpeed);
+	LOG("slice-by-8:   %8.1f MB/s", tableSpeed);
+
+	if (CRC::HaveHardwareCRC()) {
+		LOG("PCLMULQDQ:    %8.1f MB/s", hwSpeed);
+	} else {
+		LOG("PCLMULQDQ:    not supported by this CPU");
+	}
+}
@@ -0,0 +1,167 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/float3SoA.h"
+#include "System/Matrix44f.h"
+#include "System/Log/ILog.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#define BOOST_TEST_MODULE Float3SoA
+#include <boost/test/unit_test.hpp>
+
+
+// not a multiple of 4, the scalar tail gets tested too
+static const size_t NUM_VECTORS = 4099;
+
+
+static inline float RandFloat(const float min, const float max) {
+	return min + (max - min) * (rand() / float(RAND_MAX));
+}
+
+// any magnitude the sim might see, plus the corner cases
+static float3 RandVector(size_t i) {
+	switch (i % 8) {
+		case 0: return ZeroVector;
+		case 1: return float3(1e-7f, -1e-7f, 1e-7f); // shorter than NORMALIZE_EPS
+		case 2: return float3(RandFloat(-1.0f, 1.0f), RandFloat(-1.0f, 1.0f), RandFloat(-1.0f, 1.0f));
+		case 3: return float3(RandFloat(-1e-3f, 1e-3f), RandFloat(-1e-3f, 1e-3f), RandFloat(-1e-3f, 1e-3f));
+		case 4: return float3(RandFloat(-1e5f, 1e5f), RandFloat(-1e5f, 1e5f), RandFloat(-1e5f, 1e5f));
+		default: return float3(RandFloat(0.0f, 8192.0f), RandFloat(-500.0f, 2000.0f), RandFloat(0.0f, 8192.0f));
+	}
+}
+
+static void RandVectors(float3SoA* soa, std::vector<float3>* aos) {
+	soa->clear();
+	aos->clear();
+
+	for (size_t i = 0; i < NUM_VECTORS; i++) {
+		const float3 v = RandVector(i + rand());
+		soa->push_back(v);
+		aos->push_back(v);
+	}
+}
+
+static inline bool BitEqual(const float a, const float b) {
+	return (memcmp(&a, &b, sizeof(float)) == 0);
+}
+
+static inline bool BitEqual(const float3& a, const float3& b) {
+	return (BitEqual(a.x, b.x) && BitEqual(a.y, b.y) && BitEqual(a.z, b.z));
+}
+
+
+struct Fixture {
+	Fixture() {
+		srand(42);
+		RandVectors(&a, &aVec);
+		RandVectors(&b, &bVec);
+		out.resize(NUM_VECTORS);
+	}
+
+	float3SoA a;
+	float3SoA b;
+	std::vector<float3> aVec;
+	std::vector<float3> bVec;
+	std::vector<float> out;
+};
+
+
+BOOST_FIXTURE_TEST_CASE( Dot, Fixture )
+{
+	size_t numDiffs = 0;
+
+	math::BatchDot(a, b, &out[0]);
+
+	for (size_t i = 0; i < NUM_VECTORS; i++) {
+		numDiffs += !BitEqual(out[i], aVec[i].dot(bVec[i]));
+	}
+
+	const float3 c = bVec[2];
+	math::BatchDot(a, c, &out[0]);
+
+	for (size_t i = 0; i < NUM_VECTORS; i++) {
+		numDiffs += !BitEqual(out[i], aVec[i].dot(c));
+	}
+
+	BOOST_CHECK(numDiffs == 0);
+}
+
+
+BOOST_FIXTURE_TEST_CASE( Cross, Fixture )
+{
+	size_t numDiffs = 0;
+	float3SoA c;
+
+	math::BatchCross(a, b, &c);
+	BOOST_CHECK(c.size() == NUM_VECTORS);
+
+	for (size_t i = 0; i < NUM_VECTORS; i++) {
+		numDiffs += !BitEqual(c.Get(i), aVec[i].cross(bVec[i]));
+	}
+
+	// in-place
+	math::BatchCross(a, b, &a);
+
+	for (size_t i = 0; i < NUM_VECTORS; i++) {
+		numDiffs += !BitEqual(a.Get(i), c.Get(i));
+	}
+
+	BOOST_CHECK(numDiffs == 0);
+}
+
+
+BOOST_FIXTURE_TEST_CASE( SafeNormalize, Fixture )
+{
+	size_t numDiffs = 0;
+
+	math::BatchSafeNormalize(&a);
+
+	for (size_t i = 0; i < NUM_VECTORS; i++) {
+		numDiffs += !BitEqual(a.Get(i), aVec[i].SafeNormalize());
+	}
+
+	BOOST_CHECK(numDiffs == 0);
+}
+
+
+BOOST_FIXTURE_TEST_CASE( SqDistance, Fixture )
+{
+	size_t numDiffs = 0;
+
+	math::BatchSqDistance(a, b, &out[0]);
+
+	for (size_t i = 0; i < NUM_VECTORS; i++) {
+		numDiffs += !BitEqual(out[i], aVec[i].SqDistance(bVec[i]));
+	}
+
+	const float3 c = bVec[5];
+	math::BatchSqDistance(a, c, &out[0]);
+
+	for (size_t i = 0; i < NUM_VECTORS; i++) {
+		numDiffs += !BitEqual(out[i], aVec[i].SqDistance(c));
+	}
+
+	BOOST_CHECK(numDiffs == 0);
+}
+
+
+BOOST_FIXTURE_TEST_CASE( Transform, Fixture )
+{
+	size_t numDiffs = 0;
+	float3SoA c;
+
+	CMatrix44f m(float3(1000.0f, 50.0f, -300.0f));
+	m.RotateY(0.7f);
+	m.RotateX(-0.3f);
+	m.Scale(float3(1.5f, 1.0f, 0.75f));
+
+	math::BatchTransform(m, a, &c);
+	BOOST_CHECK(c.size() == NUM_VECTORS);
+
+	for (size_t i = 0; i < NUM_VECTORS; i++) {
+		numDiffs += !BitEqual(c.Get(i), m * aVec[i]);
+	}
+
+	BOOST_CHECK(numDiffs == 0);
+}
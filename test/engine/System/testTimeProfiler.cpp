@@ -0,0 +1,112 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/TimeProfiler.h"
+#include "System/Log/ILog.h"
+#include <boost/thread.hpp>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#define BOOST_TEST_MODULE TimeProfiler
+#include <boost/test/unit_test.hpp>
+
+
+static int CountOccurrences(const std::string& haystack, const std::string& needle)
+{
+	int count = 0;
+
+	for (size_t pos = haystack.find(needle); pos != std::string::npos; pos = haystack.find(needle, pos + 1)) {
+		count++;
+	}
+
+	return count;
+}
+
+static std::string ReadFile(const std::string& fileName)
+{
+	std::ifstream file(fileName.c_str());
+	std::stringstream buf;
+	buf << file.rdbuf();
+	return buf.str();
+}
+
+
+struct InitClock {
+	InitClock() {
+		spring_clock::PushTickRate();
+		spring_time::setstarttime(spring_time::gettime(true));
+	}
+};
+
+BOOST_GLOBAL_FIXTURE(InitClock);
+
+
+BOOST_AUTO_TEST_CASE( TimerIDs )
+{
+	const CTimeProfiler::TimerID a = CTimeProfiler::RegisterTimer("test::a");
+	const CTimeProfiler::TimerID b = CTimeProfiler::RegisterTimer(std::string("test::b"));
+
+	BOOST_CHECK(a != b);
+	BOOST_CHECK(a == CTimeProfiler::RegisterTimer(std::string("test::a")));
+	BOOST_CHECK(CTimeProfiler::GetTimerName(a) == "test::a");
+	BOOST_CHECK(CTimeProfiler::GetTimerName(b) == "test::b");
+}
+
+
+BOOST_AUTO_TEST_CASE( MergeThreads )
+{
+	boost::thread thread([]() {
+		SCOPED_TIMER("test::thread");
+		boost::this_thread::sleep_for(boost::chrono::milliseconds(5));
+	});
+	thread.join();
+
+	// the thread is gone, its times still have to arrive
+	profiler.Update();
+
+	BOOST_CHECK(profiler.profile.find("test::thread") != profiler.profile.end());
+	BOOST_CHECK(profiler.profile["test::thread"].total.toMilliSecsf() >= 4.0f);
+}
+
+
+BOOST_AUTO_TEST_CASE( Trace )
+{
+	const std::string fileName = "testTimeProfiler_trace.json";
+
+	// not part of the trace
+	{ SCOPED_TIMER("test::before"); }
+
+	profiler.StartTrace();
+	BOOST_CHECK(profiler.IsTracing());
+
+	{
+		SCOPED_TIMER("test::outer");
+
+		for (int i = 0; i < 3; i++) {
+			SCOPED_TIMER("test::inner");
+		}
+
+		// recursion only counts the outermost scope
+		ScopedTimer nested("test::outer");
+	}
+
+	boost::thread thread([]() {
+		CTimeProfiler::SetThreadName("test lane");
+		SCOPED_TIMER("test::thread");
+	});
+	thread.join();
+
+	BOOST_CHECK(profiler.StopTrace(fileName) == 5);
+	BOOST_CHECK(!profiler.IsTracing());
+
+	const std::string trace = ReadFile(fileName);
+	std::remove(fileName.c_str());
+
+	BOOST_CHECK(trace.find("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [") == 0);
+	BOOST_CHECK(trace.rfind("]}") != std::string::npos);
+	BOOST_CHECK(CountOccurrences(trace, "\"test::before\"") == 0);
+	BOOST_CHECK(CountOccurrences(trace, "\"test::outer\"") == 1);
+	BOOST_CHECK(CountOccurrences(trace, "\"test::inner\"") == 3);
+	BOOST_CHECK(CountOccurrences(trace, "\"test::thread\"") == 1);
+	BOOST_CHECK(CountOccurrences(trace, "\"test lane\"") == 1);
+}
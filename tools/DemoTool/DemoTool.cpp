@@ -4,6 +4,7 @@
 #include <iostream>
 #include <boost/program_options.hpp>
 #include <iomanip> //hex
+#include <chrono>
 
 #include "StringSerializer.h"
 
@@ -26,6 +27,7 @@ no console output (you still could use this.exe > z.tzt though).
 */
 
 void TrafficDump(CDemoReader& reader, bool trafficStats);
+void ReadBenchmark(const std::string& filename, unsigned numRuns);
 void WriteTeamstatHistory(CDemoReader& reader, unsigned team, const std::string& file);
 
 int main (int argc, char* argv[])
@@ -41,10 +43,12 @@ int main (int argc, char* argv[])
 	all.add_options()("dump,d", "Only dump networc traffic saved in demo");
 	all.add_options()("stats,s", "Print all game, player and team stats");
 	all.add_options()("header,H", "Print demoheader content");
+	all.add_options()("index,i", "Print the frame index");
 	all.add_options()("playerstats,p", "Print playerstats");
 	all.add_options()("teamstats,t", "Print teamstats");
 	all.add_options()("team", po::value<unsigned>(), "Select team");
 	all.add_options()("teamsstatcsv", po::value<std::string>(), "Write teamstats in a csv file");
+	all.add_options()("benchmark,b", po::value<unsigned>()->implicit_value(5), "Measure read throughput over N runs (default 5)");
 
 	po::store(po::command_line_parser(argc, argv).options(all).positional(p).run(), vm);
 	po::notify(vm);
@@ -67,6 +71,12 @@ int main (int argc, char* argv[])
 		return 1;
 	}
 
+	if (vm.count("benchmark"))
+	{
+		ReadBenchmark(filename, vm["benchmark"].as<unsigned>());
+		return 0;
+	}
+
 	const bool printStats = vm.count("stats");
 	CDemoReader reader(filename, 0.0f);
 	reader.LoadStats();
@@ -93,6 +103,15 @@ int main (int argc, char* argv[])
 		buf << reader.GetFileHeader();
 		std::wcout << buf.str();
 	}
+	if (vm.count("index") || printStats)
+	{
+		const std::vector<DemoFrameIndexEntry>& index = reader.GetFrameIndex();
+		std::cout << "-- Frame index: " << index.size() << " entries, " << reader.GetNumFrames() << " frames --" << std::endl;
+		for (unsigned i = 0; i < index.size(); ++i)
+		{
+			std::cout << "frame " << index[i].frameNum << ": offset " << index[i].streamOffset << ", time " << index[i].modGameTime << std::endl;
+		}
+	}
 	if (vm.count("playerstats") || printStats)
 	{
 		const std::vector<PlayerStatistics> statvec = reader.GetPlayerStats();
@@ -473,3 +492,47 @@ void WriteTeamstatHistory(CDemoReader& reader, unsigned team, const std::string&
 		exit(1);
 	}
 };
+
+
+void ReadBenchmark(const std::string& filename, unsigned numRuns)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	double openSecs = 0.0;
+	double readSecs = 0.0;
+	size_t numChunks = 0;
+	size_t numBytes = 0;
+
+	for (unsigned run = 0; run < numRuns; ++run)
+	{
+		// opening inflates the whole file, reading only walks the chunks
+		const Clock::time_point t0 = Clock::now();
+		CDemoReader reader(filename, 0.0f);
+		const Clock::time_point t1 = Clock::now();
+
+		numChunks = 0;
+		numBytes = 0;
+		while (!reader.ReachedEnd())
+		{
+			netcode::RawPacket* packet = reader.GetData(3.402823466e+38f);
+			if (packet == NULL)
+				continue;
+			numChunks += 1;
+			numBytes += packet->length;
+			delete packet;
+		}
+		const Clock::time_point t2 = Clock::now();
+
+		openSecs += std::chrono::duration<double>(t1 - t0).count();
+		readSecs += std::chrono::duration<double>(t2 - t1).count();
+	}
+
+	const double mbytes = numBytes / (1024.0 * 1024.0);
+	const double totalSecs = std::max(openSecs + readSecs, 1e-6);
+
+	std::cout << "-- Read benchmark: " << numRuns << " runs --" << std::endl;
+	std::cout << "chunks: " << numChunks << ", stream data: " << std::fixed << std::setprecision(2) << mbytes << " MB" << std::endl;
+	std::cout << "open (inflate): " << (openSecs * 1000.0 / numRuns) << " ms/run" << std::endl;
+	std::cout << "read (chunks): " << (readSecs * 1000.0 / numRuns) << " ms/run" << std::endl;
+	std::cout << "throughput: " << (mbytes * numRuns / totalSecs) << " MB/s" << std::endl;
+}
@@ -0,0 +1,102 @@
+#!/usr/bin/python
+# Replays many demos with spring-headless --replay-analysis, N at a time,
+# and collects the per-demo JSON results into a single file.
+#
+# Every worker slot gets its own write-dir so infologs and caches of
+# concurrent engines don't clobber each other; slots are reused, so the
+# archive cache only has to be built once per slot.
+#
+# usage: ./replay_analysis.py [-j N] [-s spring-headless] [-o results.json] demo1.sdfz demo2.sdfz ...
+
+import json
+import optparse
+import os
+import subprocess
+import sys
+import threading
+import time
+
+try:
+	import queue
+except ImportError:
+	import Queue as queue
+
+
+def run_demo(spring, slotdir, demo, timeout):
+	outfile = os.path.join(slotdir, "replay_analysis.json")
+	if os.path.exists(outfile):
+		os.remove(outfile)
+
+	cmd = [spring, "--write-dir", slotdir, "--replay-analysis", outfile, os.path.abspath(demo)]
+	start = time.time()
+	with open(os.path.join(slotdir, "stdout.txt"), "w") as log:
+		proc = subprocess.Popen(cmd, stdout=log, stderr=subprocess.STDOUT)
+		while proc.poll() is None:
+			if timeout > 0 and time.time() - start > timeout:
+				proc.kill()
+				break
+			time.sleep(0.1)
+
+	result = {"demo": demo, "exitCode": proc.wait(), "processTime": time.time() - start}
+	try:
+		with open(outfile) as f:
+			result["analysis"] = json.load(f)
+	except (IOError, ValueError) as e:
+		result["error"] = str(e)
+	return result
+
+
+def worker(slot, options, jobs, results, lock):
+	slotdir = os.path.abspath(os.path.join(options.workdir, "slot%d" % slot))
+	if not os.path.isdir(slotdir):
+		os.makedirs(slotdir)
+
+	while True:
+		try:
+			demo = jobs.get_nowait()
+		except queue.Empty:
+			return
+		result = run_demo(options.spring, slotdir, demo, options.timeout)
+		with lock:
+			results.append(result)
+			status = "ok" if "analysis" in result else "FAILED"
+			print("[%d/%d] %s: %s (%.1fs)" % (len(results), options.numdemos, demo, status, result["processTime"]))
+			sys.stdout.flush()
+
+
+def main():
+	parser = optparse.OptionParser(usage="%prog [options] demo...")
+	parser.add_option("-j", "--jobs", type="int", default=2, help="number of engines to run concurrently")
+	parser.add_option("-s", "--spring", default="./spring-headless", help="engine binary to run")
+	parser.add_option("-o", "--output", default="replay_analysis.json", help="file to write the collected results to")
+	parser.add_option("-w", "--workdir", default="replay_analysis", help="where to put the per-worker write-dirs")
+	parser.add_option("-t", "--timeout", type="float", default=0, help="kill an engine after this many seconds (0 = never)")
+	(options, demos) = parser.parse_args()
+
+	if not demos:
+		parser.error("no demos given")
+
+	options.numdemos = len(demos)
+	jobs = queue.Queue()
+	for demo in demos:
+		jobs.put(demo)
+
+	results = []
+	lock = threading.Lock()
+	threads = [threading.Thread(target=worker, args=(slot, options, jobs, results, lock)) for slot in range(max(1, options.jobs))]
+	for t in threads:
+		t.start()
+	for t in threads:
+		t.join()
+
+	results.sort(key=lambda r: r["demo"])
+	with open(options.output, "w") as f:
+		json.dump(results, f, indent=1)
+
+	failed = len([r for r in results if "analysis" not in r])
+	print("%d demos analysed, %d failed, results in %s" % (len(results) - failed, failed, options.output))
+	return 1 if failed else 0
+
+
+if __name__ == "__main__":
+	sys.exit(main())
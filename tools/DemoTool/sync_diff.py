@@ -0,0 +1,93 @@
+#!/usr/bin/python
+# Compares two .sync files (written with SyncChecksumStream=1, one per
+# player of a desynced game, or a game and a replay of its demo) and
+# prints the first frame at which they differ and in which subsystems.
+#
+# The checksums roll, so every frame after the first divergent one differs
+# as well; LOS maps are only hashed every 30 frames, a "los" divergence can
+# have happened up to 29 frames earlier.
+#
+# usage: ./sync_diff.py [-c N] a.sync b.sync
+
+import optparse
+import struct
+import sys
+
+MAGIC = b"SPRSYNC\0"
+VERSION = 1
+
+
+def read_stream(path):
+	with open(path, "rb") as f:
+		data = f.read()
+
+	if data[:8] != MAGIC:
+		raise ValueError("%s: not a sync checksum file" % path)
+
+	version, numSubsystems = struct.unpack_from("<II", data, 8)
+	if version != VERSION:
+		raise ValueError("%s: unsupported version %d" % (path, version))
+
+	pos = 16
+	names = []
+	for _ in range(numSubsystems):
+		end = data.index(b"\0", pos)
+		names.append(data[pos:end].decode("ascii"))
+		pos = end + 1
+
+	recfmt = "<i%dI" % numSubsystems
+	recsize = struct.calcsize(recfmt)
+	frames = {}
+
+	# a crashed game can leave a partial record at the end
+	while pos + recsize <= len(data):
+		rec = struct.unpack_from(recfmt, data, pos)
+		frames[rec[0]] = rec[1:]
+		pos += recsize
+
+	return names, frames
+
+
+def main():
+	parser = optparse.OptionParser(usage="usage: %prog [options] a.sync b.sync")
+	parser.add_option("-c", "--context", type="int", default=0,
+		help="also print N frames before the first divergent one")
+	options, args = parser.parse_args()
+
+	if len(args) != 2:
+		parser.error("need two .sync files")
+
+	namesA, framesA = read_stream(args[0])
+	namesB, framesB = read_stream(args[1])
+
+	if namesA != namesB:
+		print("subsystems differ: %s vs. %s" % (namesA, namesB))
+		return 2
+
+	common = sorted(set(framesA) & set(framesB))
+	if not common:
+		print("no frames in common (a: %d frames, b: %d frames)" % (len(framesA), len(framesB)))
+		return 2
+
+	for n, frame in enumerate(common):
+		a = framesA[frame]
+		b = framesB[frame]
+		if a == b:
+			continue
+
+		for prev in common[max(0, n - options.context):n]:
+			print("frame %d: equal" % prev)
+
+		diffs = [namesA[i] for i in range(len(namesA)) if a[i] != b[i]]
+		print("first divergent frame: %d" % frame)
+		print("subsystems: %s" % ", ".join(diffs))
+		for i in range(len(namesA)):
+			print("  %-12s %08x %08x%s" % (namesA[i], a[i], b[i], "" if a[i] == b[i] else "  <--"))
+		return 1
+
+	print("equal over %d common frames (%d..%d)" % (len(common), common[0], common[-1]))
+	return 0
+
+
+if __name__ == "__main__":
+	sys.exit(main())
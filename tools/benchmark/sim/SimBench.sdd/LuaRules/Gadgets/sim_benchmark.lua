@@ -0,0 +1,260 @@
+--------------------------------------------------------------------------------
+--------------------------------------------------------------------------------
+--
+--  file:    sim_benchmark.lua
+--  brief:   spawns the benchmark scenario, keeps it busy and ends the game
+--
+--  Mod options (set by tools/benchmark/sim/simbench.sh):
+--    scenario  move | artillery | builders | terraform | all
+--    count     units per team (move, artillery, builders), or
+--              terraformed rectangles per second (terraform)
+--    frames    the game ends after this many frames
+--
+--  Everything here is synced and only uses the synced RNG, so the same
+--  options give the same game (and the same final sync checksum).
+--
+--------------------------------------------------------------------------------
+--------------------------------------------------------------------------------
+
+function gadget:GetInfo()
+	return {
+		name    = "Sim benchmark",
+		desc    = "Runs a scripted scenario for a fixed number of frames",
+		author  = "",
+		date    = "",
+		license = "GPL v2 or later",
+		layer   = 0,
+		enabled = true,
+	}
+end
+
+if (not gadgetHandler:IsSyncedCode()) then
+	return false
+end
+
+--------------------------------------------------------------------------------
+
+local modOptions = Spring.GetModOptions() or {}
+
+local SCENARIO = modOptions.scenario or "all"
+local COUNT    = tonumber(modOptions.count) or 200
+local FRAMES   = tonumber(modOptions.frames) or 3000
+
+local MOVE_PERIOD      = 600  -- movers swap sides this often
+local BUILD_PERIOD     = 150  -- idle builders get a new block this often
+local BLOCK_LIFETIME   = 150  -- finished blocks are destroyed after this
+local TERRAFORM_UNDO   = 60   -- raised rectangles are lowered again after this
+local TERRAFORM_HEIGHT = 8
+
+local blockDefID = UnitDefNames["block"].id
+
+local mapX = Game.mapSizeX
+local mapZ = Game.mapSizeZ
+
+local teams = {}
+local movers = {}
+local builders = {}
+local blocksToDestroy = {}  -- [frame] = {unitID, ...}
+local terraformUndo = {}    -- [frame] = {{x1, z1, x2, z2}, ...}
+
+--------------------------------------------------------------------------------
+
+-- team 1 spawns in the top half, team 2 in the (mirrored) bottom half
+local function SpawnGrid(defName, teamNum, count, zMin, zMax, list)
+	local cols = math.ceil(math.sqrt(count * mapX / (mapZ * (zMax - zMin))))
+	local rows = math.ceil(count / cols)
+	local teamID = teams[teamNum]
+
+	for n = 0, count - 1 do
+		local x = mapX * (0.05 + 0.9 * ((n % cols) + 0.5) / cols)
+		local z = mapZ * (zMin + (zMax - zMin) * (math.floor(n / cols) + 0.5) / rows)
+
+		if (teamNum == 2) then
+			z = mapZ - z
+		end
+
+		local unitID = Spring.CreateUnit(defName, x, Spring.GetGroundHeight(x, z), z, (teamNum == 1) and "s" or "n", teamID)
+
+		if (unitID and list) then
+			list[#list + 1] = unitID
+		end
+	end
+end
+
+local function AddLater(tbl, frame, value)
+	tbl[frame] = tbl[frame] or {}
+	tbl[frame][#tbl[frame] + 1] = value
+end
+
+--------------------------------------------------------------------------------
+
+local function SpawnMove()
+	SpawnGrid("mover", 1, COUNT, 0.05, 0.3, movers)
+	SpawnGrid("mover", 2, COUNT, 0.05, 0.3, movers)
+end
+
+-- everybody drives to the mirrored position, right through the other team
+local function UpdateMove(frame)
+	if ((frame % MOVE_PERIOD) ~= 1) then
+		return
+	end
+
+	for i = 1, #movers do
+		local unitID = movers[i]
+
+		if (Spring.ValidUnitID(unitID)) then
+			local x, _, z = Spring.GetUnitPosition(unitID)
+			z = mapZ - z
+			Spring.GiveOrderToUnit(unitID, CMD.MOVE, {x, Spring.GetGroundHeight(x, z), z}, {})
+		end
+	end
+end
+
+
+-- two lines of cannons in range of each other, they fire on their own
+local function SpawnArtillery()
+	SpawnGrid("artillery", 1, COUNT, 0.33, 0.37)
+	SpawnGrid("artillery", 2, COUNT, 0.33, 0.37)
+end
+
+
+local function SpawnBuilders()
+	SpawnGrid("builder", 1, COUNT, 0.4, 0.48, builders)
+	SpawnGrid("builder", 2, COUNT, 0.4, 0.48, builders)
+
+	for i = 1, #teams do
+		Spring.SetTeamResource(teams[i], "ms", 1000000)
+		Spring.SetTeamResource(teams[i], "es", 1000000)
+	end
+end
+
+local function UpdateBuilders(frame)
+	local destroy = blocksToDestroy[frame]
+
+	if (destroy) then
+		for i = 1, #destroy do
+			if (Spring.ValidUnitID(destroy[i])) then
+				Spring.DestroyUnit(destroy[i], false, true)
+			end
+		end
+		blocksToDestroy[frame] = nil
+	end
+
+	if ((frame % BUILD_PERIOD) ~= 1) then
+		return
+	end
+
+	for i = 1, #teams do
+		Spring.SetTeamResource(teams[i], "m", 1000000)
+		Spring.SetTeamResource(teams[i], "e", 1000000)
+	end
+
+	for i = 1, #builders do
+		local unitID = builders[i]
+
+		if (Spring.ValidUnitID(unitID) and Spring.GetUnitCommands(unitID, 0) == 0) then
+			local x, _, z = Spring.GetUnitPosition(unitID)
+			x = math.max(64, math.min(mapX - 64, x + math.random(-200, 200)))
+			z = math.max(64, math.min(mapZ - 64, z + math.random(-200, 200)))
+			Spring.GiveOrderToUnit(unitID, -blockDefID, {x, Spring.GetGroundHeight(x, z), z, 0}, {})
+		end
+	end
+end
+
+
+local function UpdateTerraform(frame)
+	local undo = terraformUndo[frame]
+
+	if (undo) then
+		for i = 1, #undo do
+			local r = undo[i]
+			Spring.AdjustHeightMap(r[1], r[2], r[3], r[4], -TERRAFORM_HEIGHT)
+		end
+		terraformUndo[frame] = nil
+	end
+
+	-- spread COUNT rectangles per second evenly over the frames
+	local num = math.floor(COUNT * (frame + 1) / Game.gameSpeed) - math.floor(COUNT * frame / Game.gameSpeed)
+
+	for i = 1, num do
+		local sizeX = math.random(64, 256)
+		local sizeZ = math.random(64, 256)
+		local x1 = math.random(0, mapX - sizeX)
+		local z1 = math.random(0, mapZ - sizeZ)
+		local rect = {x1, z1, x1 + sizeX, z1 + sizeZ}
+
+		Spring.AdjustHeightMap(rect[1], rect[2], rect[3], rect[4], TERRAFORM_HEIGHT)
+		AddLater(terraformUndo, frame + TERRAFORM_UNDO, rect)
+	end
+end
+
+--------------------------------------------------------------------------------
+
+-- a list, so "all" always spawns in the same order
+local scenarios = {
+	{name = "move",      spawn = SpawnMove,      update = UpdateMove},
+	{name = "artillery", spawn = SpawnArtillery, update = nil},
+	{name = "builders",  spawn = SpawnBuilders,  update = UpdateBuilders},
+	{name = "terraform", spawn = nil,            update = UpdateTerraform},
+}
+
+local active = {}
+
+
+function gadget:Initialize()
+	local gaiaTeamID = Spring.GetGaiaTeamID()
+	local teamList = Spring.GetTeamList()
+
+	for i = 1, #teamList do
+		if (teamList[i] ~= gaiaTeamID) then
+			teams[#teams + 1] = teamList[i]
+		end
+	end
+
+	if (#teams < 2) then
+		Spring.Log(gadget:GetInfo().name, LOG.ERROR, "need two teams, got " .. #teams)
+		gadgetHandler:RemoveGadget()
+		return
+	end
+
+	for i = 1, #scenarios do
+		if (SCENARIO == "all" or SCENARIO == scenarios[i].name) then
+			active[#active + 1] = scenarios[i]
+		end
+	end
+
+	if (#active == 0) then
+		Spring.Log(gadget:GetInfo().name, LOG.ERROR, "unknown scenario " .. SCENARIO)
+	end
+end
+
+
+function gadget:UnitFinished(unitID, unitDefID, teamID)
+	if (unitDefID == blockDefID) then
+		AddLater(blocksToDestroy, Spring.GetGameFrame() + BLOCK_LIFETIME, unitID)
+	end
+end
+
+
+function gadget:GameFrame(frame)
+	if (frame == 1) then
+		for i = 1, #active do
+			if (active[i].spawn) then
+				active[i].spawn()
+			end
+		end
+	end
+
+	for i = 1, #active do
+		if (active[i].update) then
+			active[i].update(frame)
+		end
+	end
+
+	if (frame == FRAMES) then
+		Spring.GameOver({})
+	end
+end
+
+--------------------------------------------------------------------------------
+--------------------------------------------------------------------------------
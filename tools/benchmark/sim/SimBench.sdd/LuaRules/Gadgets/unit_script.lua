@@ -0,0 +1,2 @@
+-- the Lua unit script framework that ships with the engine
+return VFS.Include("LuaGadgets/Gadgets/unit_script.lua", nil, VFS.ZIP_ONLY)
@@ -0,0 +1 @@
+VFS.Include("LuaGadgets/gadgets.lua", nil, VFS.ZIP_ONLY)
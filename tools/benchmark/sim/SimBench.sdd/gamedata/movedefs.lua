@@ -0,0 +1,10 @@
+return {
+	{
+		name          = "tank2",
+		footprintX    = 2,
+		footprintZ    = 2,
+		maxSlope      = 36,
+		maxWaterDepth = 22,
+		crushStrength = 10,
+	},
+}
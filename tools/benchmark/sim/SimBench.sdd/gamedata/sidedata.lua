@@ -0,0 +1,7 @@
+-- units are spawned by LuaRules/Gadgets/sim_benchmark.lua, not as start units
+return {
+	{
+		name      = "Bench",
+		startunit = "mover",
+	},
+}
@@ -0,0 +1,13 @@
+-- synthetic game for tools/benchmark/sim, every unit is a textureless box
+local modinfo = {
+	name        = "SimBench",
+	shortname   = "SB",
+	version     = "1",
+	description = "Scripted sim-only benchmark scenarios",
+	modtype     = 1,
+	depend      = {
+		"Spring content v1",
+	},
+}
+
+return modinfo
@@ -0,0 +1,13 @@
+-- meta-data for box.obj (see rts/Rendering/Models/OBJParser.cpp)
+return {
+	tex1 = "",
+	tex2 = "",
+	numpieces = 1,
+	globalvertexoffsets = false,
+	localpieceoffsets = true,
+	pieces = {
+		base = {
+			offset = {0.0, 0.0, 0.0},
+		},
+	},
+}
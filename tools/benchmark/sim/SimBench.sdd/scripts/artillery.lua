@@ -0,0 +1,20 @@
+local base = piece "base"
+
+function script.Create()
+end
+
+function script.AimFromWeapon1()
+	return base
+end
+
+function script.QueryWeapon1()
+	return base
+end
+
+function script.AimWeapon1(heading, pitch)
+	return true
+end
+
+function script.Killed(recentDamage, maxHealth)
+	return 0
+end
@@ -0,0 +1,20 @@
+local base = piece "base"
+
+function script.Create()
+end
+
+function script.QueryNanoPiece()
+	return base
+end
+
+function script.StartBuilding(heading, pitch)
+	SetUnitValue(COB.INBUILDSTANCE, 1)
+end
+
+function script.StopBuilding()
+	SetUnitValue(COB.INBUILDSTANCE, 0)
+end
+
+function script.Killed(recentDamage, maxHealth)
+	return 0
+end
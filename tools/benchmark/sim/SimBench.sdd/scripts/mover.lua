@@ -0,0 +1,8 @@
+local base = piece "base"
+
+function script.Create()
+end
+
+function script.Killed(recentDamage, maxHealth)
+	return 0
+end
@@ -0,0 +1,36 @@
+-- immobile cannon for the artillery duel, sturdy enough to survive it
+return {
+	artillery = {
+		name            = "Artillery",
+		objectName      = "box.obj",
+		footprintX      = 2,
+		footprintZ      = 2,
+		maxDamage       = 1000000,
+		autoHeal        = 1000,
+		buildCostMetal  = 10,
+		buildCostEnergy = 10,
+		buildTime       = 10,
+		sightDistance   = 1400,
+		weapons = {
+			{ def = "shell" },
+		},
+		weaponDefs = {
+			shell = {
+				name              = "Shell",
+				weaponType        = "Cannon",
+				range             = 1300,
+				reloadTime        = 1,
+				weaponVelocity    = 400,
+				highTrajectory    = 1,
+				accuracy          = 600,
+				areaOfEffect      = 48,
+				craterMult        = 0.2,
+				craterBoost       = 0,
+				tolerance         = 8000,
+				damage = {
+					default = 10,
+				},
+			},
+		},
+	},
+}
@@ -0,0 +1,16 @@
+-- cheap structure the builders keep putting up (and the gadget tears down)
+return {
+	block = {
+		name            = "Block",
+		objectName      = "box.obj",
+		footprintX      = 2,
+		footprintZ      = 2,
+		yardMap         = "oooo",
+		maxDamage       = 500,
+		buildCostMetal  = 5,
+		buildCostEnergy = 5,
+		buildTime       = 100,
+		levelGround     = true,
+		sightDistance   = 100,
+	},
+}
@@ -0,0 +1,26 @@
+-- mobile constructor for the builder-swarm scenario
+return {
+	builder = {
+		name            = "Builder",
+		objectName      = "box.obj",
+		footprintX      = 2,
+		footprintZ      = 2,
+		movementClass   = "tank2",
+		maxVelocity     = 2,
+		acceleration    = 0.1,
+		brakeRate       = 0.2,
+		turnRate        = 600,
+		maxDamage       = 1000,
+		buildCostMetal  = 10,
+		buildCostEnergy = 10,
+		buildTime       = 10,
+		canMove         = true,
+		builder         = true,
+		workerTime      = 50,
+		buildDistance   = 120,
+		sightDistance   = 300,
+		buildoptions = {
+			"block",
+		},
+	},
+}
@@ -0,0 +1,20 @@
+-- ground unit for the mass-move scenario
+return {
+	mover = {
+		name            = "Mover",
+		objectName      = "box.obj",
+		footprintX      = 2,
+		footprintZ      = 2,
+		movementClass   = "tank2",
+		maxVelocity     = 2.5,
+		acceleration    = 0.1,
+		brakeRate       = 0.2,
+		turnRate        = 600,
+		maxDamage       = 1000,
+		buildCostMetal  = 10,
+		buildCostEnergy = 10,
+		buildTime       = 10,
+		canMove         = true,
+		sightDistance   = 300,
+	},
+}
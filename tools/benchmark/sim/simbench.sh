@@ -0,0 +1,123 @@
+#!/bin/sh
+# Sim-only benchmark: runs scripted scenarios of the SimBench game (see
+# SimBench.sdd/LuaRules/Gadgets/sim_benchmark.lua) on a generated map with
+# spring-headless --replay-analysis and collects the results.
+#
+# Every scenario writes <outdir>/<scenario>.json (frame times, time per
+# SimFrame stage, sync checksums, ...), all of them are combined into
+# <outdir>/simbench.json. Same engine + same options give the same final
+# checksum, so a changed checksum means the sim changed.
+#
+# usage: ./simbench.sh /path/to/spring-headless [outdir]
+# environment: SCENARIOS, FRAMES, COUNT, DATADIR (has to hold base/,
+# defaults to the directory of the engine binary, as in a build tree)
+
+set -e
+
+if [ $# -lt 1 ]; then
+	echo "Usage: $0 /path/to/spring-headless [outdir]"
+	exit 1
+fi
+
+SPRING="$1"
+OUTDIR="${2:-simbench}"
+SCENARIOS="${SCENARIOS:-move artillery builders terraform all}"
+FRAMES="${FRAMES:-1800}"
+COUNT="${COUNT:-200}"
+
+if [ ! -x "$SPRING" ]; then
+	echo "$SPRING isn't executable!"
+	exit 1
+fi
+
+SRCDIR=$(cd "$(dirname "$0")" && pwd)
+mkdir -p "$OUTDIR"
+OUTDIR=$(cd "$OUTDIR" && pwd)
+WRITEDIR="$OUTDIR/writedir"
+
+DATADIR="${DATADIR:-$(dirname "$SPRING")}"
+
+mkdir -p "$WRITEDIR/games"
+rm -rf "$WRITEDIR/games/SimBench.sdd"
+cp -r "$SRCDIR/SimBench.sdd" "$WRITEDIR/games/"
+
+# $1 = scenario
+write_script() {
+cat <<EOD
+[GAME]
+{
+	IsHost=1;
+	HostIP=127.0.0.1;
+	HostPort=0;
+	MyPlayerName=Bench;
+	Mapname=SimBenchMap;
+	MapSeed=1;
+	GameType=SimBench;
+	StartPosType=0;
+	[modoptions]
+	{
+		scenario=$1;
+		count=$COUNT;
+		frames=$FRAMES;
+	}
+	[PLAYER0]
+	{
+		Name=Bench;
+		Spectator=0;
+		Team=0;
+	}
+	[TEAM0]
+	{
+		TeamLeader=0;
+		AllyTeam=0;
+	}
+	[TEAM1]
+	{
+		TeamLeader=0;
+		AllyTeam=1;
+	}
+	[ALLYTEAM0]
+	{
+		NumAllies=0;
+	}
+	[ALLYTEAM1]
+	{
+		NumAllies=0;
+	}
+}
+EOD
+}
+
+FAILED=0
+for SCENARIO in $SCENARIOS; do
+	SCRIPT="$OUTDIR/$SCENARIO.txt"
+	RESULT="$OUTDIR/$SCENARIO.json"
+
+	write_script "$SCENARIO" > "$SCRIPT"
+	rm -f "$RESULT"
+
+	echo "Running $SCENARIO ($COUNT, $FRAMES frames)"
+	"$SPRING" --nocolor --isolation-dir "$DATADIR" --isolation --write-dir "$WRITEDIR" --replay-analysis "$RESULT" "$SCRIPT" > "$OUTDIR/$SCENARIO.log" 2>&1 || true
+
+	if [ ! -s "$RESULT" ]; then
+		echo "$SCENARIO FAILED, see $OUTDIR/$SCENARIO.log"
+		FAILED=1
+	fi
+done
+
+# {"scenario": {...}, ...}
+{
+	echo "{"
+	SEP=""
+	for SCENARIO in $SCENARIOS; do
+		if [ -s "$OUTDIR/$SCENARIO.json" ]; then
+			printf '%s"%s": ' "$SEP" "$SCENARIO"
+			cat "$OUTDIR/$SCENARIO.json"
+			SEP=","
+		fi
+	done
+	echo "}"
+} > "$OUTDIR/simbench.json"
+
+echo "Results in $OUTDIR/simbench.json"
+exit $FAILED